@@ -5,6 +5,7 @@
 #include "interrupt_asm.h"
 #include "syscall.h"
 #include "pit.h"
+#include "paging.h"
 
 
 // Exception messages array with main 20
@@ -123,3 +124,19 @@ void exception_handler(uint32_t vec_num, struct x86_regs regs, uint32_t flags, u
     }
     halt(255); // Freeze the system
 }
+
+/* 
+Handles page faults by filling user program pages on demand
+void page_fault_dispatch(uint32_t addr, uint32_t error)
+Inputs: addr (faulting linear address from CR2), error (error code pushed by the CPU)
+Outputs: None
+Effects: Returns to the wrapper, which retries the faulting instruction, if paging_demand_fault
+filled the page. Any other page fault is reported and halts the process like the other exceptions.
+*/
+void page_fault_dispatch(uint32_t addr, uint32_t error) {
+    if (paging_demand_fault(addr, error) == 0) {
+        return;
+    }
+    printf("Exception: %s\n", exceptions[PAGE_FAULT_VECTOR]);
+    halt(255); // Freeze the system
+}
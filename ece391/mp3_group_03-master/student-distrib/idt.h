@@ -11,6 +11,7 @@
 #define KEYBOARD_VECTOR 0x21 // According to OSDEV
 #define RTC_VECTOR 0x28 // According to OSDEV
 #define PIT_VECTOR 0x20 // According to OSDEV
+#define PAGE_FAULT_VECTOR 0x0E // According to OSDEV
 
 /* Registers used for debugging */
  struct x86_regs {
@@ -30,5 +31,8 @@ void idt_init(void);
 /* Called by the exception handler wrapper to handle specific exceptions */
 void exception_handler(uint32_t vec_num, struct x86_regs regs, uint32_t flags, uint32_t error);
 
+/* Called by the page fault wrapper; returns only if the page was filled on demand */
+void page_fault_dispatch(uint32_t addr, uint32_t error);
+
 #endif /* ASM */
 #endif /* _IDT_H */
@@ -1,9 +1,23 @@
 #include "paging.h"
+#include "lib.h"
+#include "filesystem.h"
+#include "syscall.h"
 // Declare the paging structures in .c so they are allocated correctly
 page_dir_entry_t page_directory[NUM_PAGE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB)));
 page_dir_entry_4MB_t page_directory_4MB[NUM_PAGE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB)));
 page_table_entry_t first_page_table[NUM_PAGE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB)));
 page_table_entry_t video_page_table[NUM_PAGE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB)));
+// One 4KB page table per process for the 4MB user space
+page_table_entry_t user_page_tables[MAX_PID_NUM][NUM_PAGE_ENTRIES] __attribute__((aligned(PAGE_SIZE_4KB)));
+
+// Executable backing the user pages of a process
+typedef struct user_image {
+    uint32_t inode;  // Inode of the executable
+    uint32_t length; // Length of the executable in bytes
+} user_image_t;
+
+static user_image_t user_images[MAX_PID_NUM];
+static uint32_t mapped_pid = 0; // Process whose page table is in the user space directory entry
 
 // Function prototype for enabling paging, assuming it's defined elsewhere
 
@@ -26,6 +40,9 @@ void paging_init() {
         *((uint32_t*)&first_page_table[i]) = 0;
         *((uint32_t*)&video_page_table[i]) = 0;
     }
+    for (i = 0; i < MAX_PID_NUM * NUM_PAGE_ENTRIES; i++) {
+        *((uint32_t*)&user_page_tables[0][0] + i) = 0;
+    }
     // Set up the first page table for the first 4MB of physical memory
     page_directory[0].present = 1;          // Mark the entry as present
     page_directory[0].read_write = 1;       // Allow read and write operations
@@ -38,12 +55,12 @@ void paging_init() {
     page_directory[INDEX_KERNEL].user = 0; // Mark as supervisor level, not accessible from user mode
     page_directory[INDEX_KERNEL].size = 1; // Indicates usage of a 4MB page
     page_directory[INDEX_KERNEL].table_address = ADDR_KERNEL_BASE / PAGE_SIZE_4KB; // Set the base address for the kernel
-    // Setup user space
+    // Setup user space with 4KB pages, filled on demand by paging_demand_fault()
     page_directory[INDEX_USER_SPACE].present = 1; // Mark the entry as present
     page_directory[INDEX_USER_SPACE].read_write = 1; // Allow read and write operations
     page_directory[INDEX_USER_SPACE].user = 1; // Mark as user level, accessible from user mode
-    page_directory[INDEX_USER_SPACE].size = 1; // Indicates usage of a 4MB page
-    page_directory[INDEX_USER_SPACE].table_address = ADDR_USER_SPACE_BASE / PAGE_SIZE_4KB; // Set the base address for user space
+    page_directory[INDEX_USER_SPACE].size = 0; // Use 4KB pages
+    page_directory[INDEX_USER_SPACE].table_address = ((int)user_page_tables[0]) / PAGE_SIZE_4KB; // Set the address of the first user page table
 
 
     page_directory[INDEX_VIDMEM].present = 1; // Mark the entry as present
@@ -72,3 +89,120 @@ void paging_init() {
     // Enable paging by setting up the control registers
     enable_paging((int)page_directory);
 }
+
+/*
+ * paging_map_user(uint32_t pid)
+ * Inputs: pid - process whose user space is mapped
+ * Outputs: none
+ * Effects: Points the user space directory entry at the process's page table and flushes the TLB.
+ */
+void paging_map_user(uint32_t pid) {
+    page_directory[INDEX_USER_SPACE].table_address = ((uint32_t)user_page_tables[pid]) / PAGE_SIZE_4KB;
+    mapped_pid = pid;
+    flush_tlb();
+}
+
+/*
+ * paging_load_user_program(uint32_t pid, uint32_t inode, uint32_t length)
+ * Inputs: pid - process being started
+ *         inode - inode of its executable
+ *         length - length of the executable in bytes
+ * Outputs: none
+ * Effects: Marks every user page of the process as not present and maps its page table. Nothing is
+ *          copied here; each page is read from the filesystem image the first time it is touched.
+ */
+void paging_load_user_program(uint32_t pid, uint32_t inode, uint32_t length) {
+    unsigned int i;
+    for (i = 0; i < NUM_PAGE_ENTRIES; i++) {
+        *((uint32_t*)&user_page_tables[pid][i]) = 0;
+    }
+    user_images[pid].inode = inode;
+    user_images[pid].length = length;
+    paging_map_user(pid);
+}
+
+/*
+ * fill_user_page(uint32_t pid, uint32_t index)
+ * Inputs: pid - process owning the page
+ *         index - page index within the 4MB user space
+ * Outputs: 0 on success, -1 if the program image could not be read
+ * Effects: Maps the page to the process's physical frame and fills it: the part covered by the program
+ *          image is read from the filesystem and the rest is zeroed. On a read failure the page is
+ *          unmapped again.
+ */
+static int32_t fill_user_page(uint32_t pid, uint32_t index) {
+    user_image_t* image = &user_images[pid];
+    uint32_t vaddr = ADDR_USER_SPACE_BASE + index * PAGE_SIZE_4KB;
+    uint32_t start = vaddr, end = vaddr;
+
+    // Each process keeps the physical 4MB it had with a single 4MB page (8MB + 4MB per PID)
+    user_page_tables[pid][index].page_address = (_8M + pid * _4M) / PAGE_SIZE_4KB + index;
+    user_page_tables[pid][index].read_write = 1; // Allow read and write operations
+    user_page_tables[pid][index].user = 1; // Accessible from user mode
+    user_page_tables[pid][index].present = 1;
+    asm volatile("invlpg (%0)" : : "r"(vaddr) : "memory");
+
+    // Part of the page covered by the program image
+    if (vaddr + PAGE_SIZE_4KB > PROGRAM_ADDR && vaddr < PROGRAM_ADDR + image->length) {
+        start = (vaddr > PROGRAM_ADDR) ? vaddr : PROGRAM_ADDR;
+        end = (vaddr + PAGE_SIZE_4KB < PROGRAM_ADDR + image->length) ? vaddr + PAGE_SIZE_4KB : PROGRAM_ADDR + image->length;
+        if (read_data(image->inode, start - PROGRAM_ADDR, (uint8_t*)start, end - start) == -1) {
+            *((uint32_t*)&user_page_tables[pid][index]) = 0; // Unreadable image: leave the page missing
+            asm volatile("invlpg (%0)" : : "r"(vaddr) : "memory");
+            return -1;
+        }
+    }
+    memset((void*)vaddr, 0, start - vaddr);
+    memset((void*)end, 0, vaddr + PAGE_SIZE_4KB - end);
+    return 0;
+}
+
+/*
+ * paging_demand_fault(uint32_t addr, uint32_t error)
+ * Inputs: addr - faulting linear address (CR2)
+ *         error - page fault error code
+ * Outputs: 0 if the page was filled and the instruction can be retried, -1 for a real fault
+ *          or if the page could not be read from the program image
+ * Effects: Fills a missing page of the current user space, then reads ahead the next
+ *          USER_PAGE_READAHEAD pages of the program image that are still missing.
+ */
+int32_t paging_demand_fault(uint32_t addr, uint32_t error) {
+    // Only missing pages inside the user space are filled; protection faults are real faults
+    if ((error & PF_ERROR_PRESENT) || addr < ADDR_USER_SPACE_BASE || addr >= ADDR_USER_SPACE_BASE + PAGE_SIZE_4MB) {
+        return -1;
+    }
+
+    uint32_t index = (addr - ADDR_USER_SPACE_BASE) / PAGE_SIZE_4KB;
+    if (user_page_tables[mapped_pid][index].present) {
+        return -1;
+    }
+    if (fill_user_page(mapped_pid, index) == -1) {
+        return -1;
+    }
+
+    // Code and data are mostly read in order, so the neighbouring image pages are usually next.
+    // A page that fails to read here stays missing and faults again when it is touched.
+    uint32_t first = (PROGRAM_ADDR - ADDR_USER_SPACE_BASE) / PAGE_SIZE_4KB;
+    uint32_t last = (PROGRAM_ADDR - ADDR_USER_SPACE_BASE + user_images[mapped_pid].length + PAGE_SIZE_4KB - 1) / PAGE_SIZE_4KB;
+    uint32_t i;
+    for (i = index + 1; i <= index + USER_PAGE_READAHEAD && i < last && i < NUM_PAGE_ENTRIES; i++) {
+        if (i >= first && !user_page_tables[mapped_pid][i].present) {
+            fill_user_page(mapped_pid, i);
+        }
+    }
+    return 0;
+}
+
+/*
+ * paging_user_pages_mapped(uint32_t pid)
+ * Inputs: pid - process to count
+ * Outputs: number of user pages of the process that are present
+ * Effects: none
+ */
+uint32_t paging_user_pages_mapped(uint32_t pid) {
+    uint32_t i, count = 0;
+    for (i = 0; i < NUM_PAGE_ENTRIES; i++) {
+        if (user_page_tables[pid][i].present) count++;
+    }
+    return count;
+}
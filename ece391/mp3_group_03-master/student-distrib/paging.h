@@ -23,6 +23,10 @@
 #define INDEX_USER_SPACE 32
 #define INDEX_VIDMEM 34
 
+// Demand paging of user programs
+#define USER_PAGE_READAHEAD 1 // Program image pages filled after the faulting one (0 disables readahead)
+#define PF_ERROR_PRESENT 0x1 // Page fault error code bit: the page was present (a protection violation)
+
 // Struct for page directory entries for 4KB
 typedef struct __attribute__((packed)) directory_entry  {
     uint32_t present            : 1;
@@ -83,4 +87,16 @@ extern page_table_entry_t video_page_table[NUM_PAGE_ENTRIES] __attribute__((alig
 // Function to initialize paging
 extern void paging_init(void);
 
+// Points the user space directory entry at a process's 4KB page table
+extern void paging_map_user(uint32_t pid);
+
+// Unmaps all user pages of a process and backs them with an executable, read on first touch
+extern void paging_load_user_program(uint32_t pid, uint32_t inode, uint32_t length);
+
+// Fills a missing user page from the program image; returns 0 if filled, -1 for a real fault
+extern int32_t paging_demand_fault(uint32_t addr, uint32_t error);
+
+// Number of user pages of a process filled so far
+extern uint32_t paging_user_pages_mapped(uint32_t pid);
+
 #endif /* PAGING_H */
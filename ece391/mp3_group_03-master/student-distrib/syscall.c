@@ -147,14 +147,8 @@ int32_t halt(uint8_t status) {
     // Clear PCB buffer entry for halted process
     pcb_buffer[tmp_pcb_ptr->pid] = 0;
 
-    // Restore paging to parent process
-    // Calculate the base physical address for user-space pages based on the current process's PID
-    uint32_t phys_addr = _8M + (terminals[current_scheduled_terminal].pid * _4M); // 8 MB offset plus 4 MB per process
-    
-    // Convert the physical address to a page directory index and assign it to the user space entry
-    page_directory[INDEX_USER_SPACE].table_address = phys_addr / _4K; // Convert byte address to page table index
-
-    flush_tlb();  // Flush the TLB after updating page directory
+    // Restore paging to parent process by mapping its user page table (also flushes the TLB)
+    paging_map_user(terminals[current_scheduled_terminal].pid);
 
     // Close any file descriptors that are open
     int i;
@@ -304,21 +298,12 @@ int32_t execute(const uint8_t* command) {
 
     assign_process_to_terminal(curr_pid_val, current_terminal); // Update terminal struct by adding new process
 
-    // Configure paging for the new proces and flush tlb
-    // Calculate the base physical address for user-space pages based on the current process's PID
-    uint32_t phys_addr = _8M + (curr_pid_val * _4M); // 8 MB offset plus 4 MB per process
-
-    // Convert the physical address to a page directory index and assign it to the user space entry
-    page_directory[INDEX_USER_SPACE].table_address = phys_addr / _4K; // Convert byte address to page table index
-    flush_tlb();
-
     // Obtain a pointer to the inode structure based on the directory entry's inode number
     inode_t* inode_ptr = (inode_t*)(inode_start + dentry.inode_num);
 
-    // Load the executable into memory
-    if (read_data(dentry.inode_num, 0, (uint8_t*)PROGRAM_ADDR, inode_ptr->length) == -1) {
-        return -1;
-    }
+    // Configure paging for the new process: its user pages start out unmapped and are read from the
+    // executable by the page fault handler on first touch, so only the pages the program uses are loaded
+    paging_load_user_program(curr_pid_val, dentry.inode_num, inode_ptr->length);
 
     // Initialize Process Control Block (PCB) for the new process and set up file descriptors
     pcb_ptr = get_curr_pcb(curr_pid_val); // Get the PCB associated with the current PID
@@ -822,10 +807,8 @@ void schedule_helper(void) {
         return; // Skip scheduling if no next process is available
     }
 
-    // Update the page directory for the next process
-    uint32_t phys_addr = _8M + (next_pcb_ptr->pid * _4M);
-    page_directory[INDEX_USER_SPACE].table_address = phys_addr / _4K;
-    flush_tlb(); // Flush the TLB after updating page directory
+    // Update the page directory for the next process (also flushes the TLB)
+    paging_map_user(next_pcb_ptr->pid);
 
     // Update TSS for the next process
     tss.esp0 = next_pcb_ptr->tss;
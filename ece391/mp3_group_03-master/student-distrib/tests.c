@@ -667,6 +667,91 @@ int filesystem_test_executable(void) {
 /* Checkpoint 4 tests */
 /* Checkpoint 5 tests */
 
+#define EXEC_TEST_PID 0 // User page table borrowed by the execute test (no process runs yet)
+#define ELF_ENTRY_OFFSET 24 // Bytes 24-27 of the executable hold the entry point
+
+static uint8_t exec_test_block[BLOCK_SIZE]; // File contents to compare against the demand-filled pages
+
+/* Reads the low 32 bits of the time stamp counter */
+static inline uint32_t rdtsc_low(void) {
+	uint32_t lo, hi;
+	asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+	return lo;
+}
+
+/* Execute Latency Test
+ * 
+ * Times the program load of execute() with rdtsc: the whole-image copy it used to do against demand
+ * paging, which only fills the pages touched before the first instruction runs (the entry page, its
+ * readahead and the top of the user stack). Then touches every image page and checks that the pages
+ * filled by the page fault handler match the file.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Uses the user page table of PID 0, so it must run before the first shell
+ * Coverage: paging_load_user_program, paging_demand_fault, page fault wrapper
+ * Files: paging.c/h, idt.c, idt_asm.S, syscall.c
+ */
+int execute_latency_test(void) {
+	TEST_HEADER;
+
+	static const char* programs[] = {"shell", "fish", "grep", "counter", "pingpong"};
+	int result = PASS;
+	uint32_t p, i, offset;
+
+	for (p = 0; p < sizeof(programs) / sizeof(programs[0]); p++) {
+		dentry_t dentry;
+		if (read_dentry_by_name((const uint8_t*)programs[p], &dentry) == -1) {
+			printf("%s: not found\n", programs[p]);
+			result = FAIL;
+			continue;
+		}
+		uint32_t length = (inode_start + dentry.inode_num)->length;
+		uint32_t image_pages = (length + _4K - 1) / _4K;
+
+		// Eager load: copy the whole image into already mapped user pages (mapping them is not timed)
+		paging_load_user_program(EXEC_TEST_PID, dentry.inode_num, length);
+		for (offset = 0; offset < length; offset += _4K) {
+			*((volatile uint8_t*)PROGRAM_ADDR + offset);
+		}
+		uint32_t start = rdtsc_low();
+		read_data(dentry.inode_num, 0, (uint8_t*)PROGRAM_ADDR, length);
+		uint32_t eager_cycles = rdtsc_low() - start;
+
+		// Demand paging: map nothing, then touch what the first instruction needs
+		uint32_t eip;
+		start = rdtsc_low();
+		paging_load_user_program(EXEC_TEST_PID, dentry.inode_num, length);
+		read_data(dentry.inode_num, ELF_ENTRY_OFFSET, (uint8_t*)&eip, sizeof(eip));
+		if (eip < PROGRAM_ADDR || eip >= PROGRAM_ADDR + length) {
+			printf("%s: entry point 0x%x outside the image\n", programs[p], eip);
+			result = FAIL;
+			continue;
+		}
+		*((volatile uint8_t*)eip); // Fetch of the first instruction
+		*((volatile uint32_t*)(_128M + _4M - sizeof(int32_t))) = 0; // First push onto the user stack
+		uint32_t demand_cycles = rdtsc_low() - start;
+		uint32_t touched = paging_user_pages_mapped(EXEC_TEST_PID);
+
+		printf("%s: %u bytes, %u pages: eager %u cycles, demand %u cycles (%u pages)\n",
+		       programs[p], length, image_pages, eager_cycles, demand_cycles, touched);
+		if (touched > USER_PAGE_READAHEAD + 2) {
+			result = FAIL; // More than the entry page, its readahead and the stack page
+		}
+
+		// Every image page filled on demand must hold the file's bytes
+		for (offset = 0; offset < length; offset += BLOCK_SIZE) {
+			int32_t count = read_data(dentry.inode_num, offset, exec_test_block, BLOCK_SIZE);
+			for (i = 0; i < (uint32_t)count; i++) {
+				if (*((uint8_t*)PROGRAM_ADDR + offset + i) != exec_test_block[i]) {
+					result = FAIL;
+					break;
+				}
+			}
+		}
+	}
+	return result;
+}
+
 /* Test suite entry point */
 void launch_tests(){
 	// launch your tests here
@@ -706,4 +791,5 @@ void launch_tests(){
 
     /* Checkpoint 4 tests */
     /* Checkpoint 5 tests */
+    //TEST_OUTPUT("execute_latency_test", execute_latency_test());
 }
@@ -1,19 +1,17 @@
 #!/bin/bash
 
-while true
-do
-    echo "Uploading files at $(date)..."
+# Ships only the export segments sealed since the last pass; segments never change, so
+# nothing is uploaded twice. crypto_ws must run with `--segments segments`.
 
-    # Upload ticker data
-    aws s3 cp ../software_websocket_connection_files/ticker_output_data.json s3://crypto-json-storage/
+WS_DIR=../software_websocket_connection_files
 
-    # Upload trade data
-    aws s3 cp ../software_websocket_connection_files/trades_output_data.json s3://crypto-json-storage/
+if [ ! -x "$WS_DIR/segment_upload" ]; then
+    make -C "$WS_DIR" segment_upload || exit 1
+fi
 
-    echo "Upload complete. Waiting 5 seconds..."
-    echo ""
-    sleep 5
-done
+exec "$WS_DIR/segment_upload" "$WS_DIR/segments" \
+    --exec 'aws s3 cp --only-show-errors "$1" s3://crypto-json-storage/segments/' \
+    --watch 5
 
 # run 'chmod +x upload_to_s3.sh' to make executable
-# run './upload_to_s3.sh' to execute
\ No newline at end of file
+# run './upload_to_s3.sh' to execute
@@ -0,0 +1,66 @@
+#!/bin/sh
+#
+# Bench Convert
+#
+# Times the text-to-CSV converters on the same synthetic input and checks that
+# they produce the same rows.
+#
+# Features:
+#  - Generates LINES lines with `dataTxtToCSV --generate` (default 2,000,000).
+#  - Runs `dataTxtToCSV` (streaming external sort), `dataTvtToCSV.py`, and an
+#    older build of the C converter when OLD=path/to/binary is given. The old
+#    converter expects "[time] [exchange] [product]", so it gets a spaced copy.
+#  - Prints wall time, throughput and peak memory of each (peak memory needs GNU time).
+#
+# Usage:
+#  ./bench_convert.sh [LINES] [extra dataTxtToCSV options, e.g. --memory 64]
+#  OLD=/tmp/dataTxtToCSV_qsort ./bench_convert.sh 5000000
+#
+# Created: 10/18/2026
+# Updated: 10/18/2026
+
+set -e
+cd "$(dirname "$0")"
+
+LINES=${1:-2000000}
+[ $# -gt 0 ] && shift
+WORK=${TMPDIR:-/tmp}/bench_convert.$$
+mkdir -p "$WORK"
+trap 'rm -rf "$WORK"' EXIT
+
+gcc -O2 -Wall -Wextra dataTxtToCSV.c -o "$WORK/dataTxtToCSV" -lpthread -lm
+"$WORK/dataTxtToCSV" --generate "$LINES" "$WORK/input.txt"
+BYTES=$(stat -c %s "$WORK/input.txt")
+echo "Input: $LINES lines, $((BYTES / 1000000)) MB"
+
+# run NAME OUTPUT COMMAND...
+run() {
+    name=$1
+    output=$2
+    shift 2
+    if [ -x /usr/bin/time ]; then
+        /usr/bin/time -f "%e %M" -o "$WORK/time" "$@" > /dev/null 2> "$WORK/stderr" || {
+            echo "$name failed:"; tail -3 "$WORK/stderr"; return 0; }
+        read -r seconds kilobytes < "$WORK/time"
+    else
+        start=$(date +%s.%N)
+        "$@" > /dev/null 2> "$WORK/stderr" || { echo "$name failed:"; tail -3 "$WORK/stderr"; return 0; }
+        seconds=$(awk -v a="$start" -v b="$(date +%s.%N)" 'BEGIN { print b - a }')
+        kilobytes=0
+    fi
+    awk -v n="$name" -v s="$seconds" -v k="$kilobytes" -v b="$BYTES" -v l="$LINES" 'BEGIN {
+        printf("%-24s %8.2f s %9.1f MB/s %7.2f M lines/s %s\n", n, s,
+               (s > 0 ? b / 1e6 / s : 0), (s > 0 ? l / 1e6 / s : 0),
+               (k > 0 ? sprintf("%8.0f MB peak", k / 1024) : "")) }'
+    tr -d '\r' < "$output" | cut -d, -f1-4 > "$output.rows"
+}
+
+run "dataTxtToCSV" "$WORK/c.csv" "$WORK/dataTxtToCSV" "$WORK/input.txt" "$WORK/c.csv" "$@"
+run "dataTvtToCSV.py" "$WORK/py.csv" python3 dataTvtToCSV.py "$WORK/input.txt" "$WORK/py.csv"
+cmp -s "$WORK/c.csv.rows" "$WORK/py.csv.rows" && echo "  rows match dataTvtToCSV.py" || echo "  ROWS DIFFER from dataTvtToCSV.py"
+
+if [ -n "$OLD" ]; then
+    sed 's/\]\[/] [/g' "$WORK/input.txt" > "$WORK/spaced.txt"
+    run "old dataTxtToCSV" "$WORK/old.csv" "$OLD" "$WORK/spaced.txt" "$WORK/old.csv"
+    cmp -s "$WORK/c.csv.rows" "$WORK/old.csv.rows" && echo "  rows match the old converter" || echo "  ROWS DIFFER from the old converter"
+fi
@@ -1,5 +1,6 @@
 import re
 import csv
+import sys
 from datetime import datetime
 
 def process_input_to_csv(input_file, output_file):
@@ -96,5 +97,8 @@ def process_input_to_csv(input_file, output_file):
 
 
 
-# Example usage (modify filenames as needed)
-process_input_to_csv("Global-Crypto-Market-Continuous-Data-Extraction/Backend/software_websocket_connection_files/arbitrage_data.txt", "Global-Crypto-Market-Continuous-Data-Extraction/Backend/filter/outputPython.csv")
\ No newline at end of file
+# Example usage (modify filenames as needed), or: python3 dataTvtToCSV.py INPUT OUTPUT
+if len(sys.argv) == 3:
+    process_input_to_csv(sys.argv[1], sys.argv[2])
+else:
+    process_input_to_csv("Global-Crypto-Market-Continuous-Data-Extraction/Backend/software_websocket_connection_files/arbitrage_data.txt", "Global-Crypto-Market-Continuous-Data-Extraction/Backend/filter/outputPython.csv")
\ No newline at end of file
@@ -1,36 +1,123 @@
-// Note the current issues with this file are the following:
-// 1. The Input file for the text data needs to be in the filter directory and names "output_data.txt"
-// 2. The code counter method us,ed to identify if the "unknown" values from Kraken's Exchange are "ADA-USD", "BTC-USD", or "ETH-USD" does not run properly.
-
-// To run this code, type the following in the base lines
-// gcc your_program.c -o your_program
-// ./your_program /path/to/input.txt /path/to/output.csv
-
+/*
+ * Data Text to CSV
+ *
+ * Converts the logger's price lines ("[time][exchange][product] Price: 123.45")
+ * into a time-ordered CSV, like `dataTvtToCSV.py`, for inputs much larger than
+ * memory: a full day of capture.
+ *
+ * The input is memory-mapped and never copied. Run generation parses it on several
+ * threads into 16-byte (timestamp, line offset) records, sorts each bounded batch
+ * with a radix sort and spills it to a temporary run file. The runs are then merged
+ * with a k-way heap, and each line is re-read from the mapping as it is written,
+ * so the heap holds only the records; nothing is allocated per line or per field.
+ *
+ * Features:
+ *  - Timestamps are sorted as instants (ISO 8601 with 'Z' or an offset), ties in input order,
+ *    so the row order matches the Python script's stable sort.
+ *  - Product renames (BTCUSDT -> BTC-USD, ...) and the "unknown" product guess from the
+ *    closest last price are applied in time order while streaming the output.
+ *  - Prices are copied as they appear in the input (the Python output), not reformatted.
+ *  - Memory use is about `--memory` MB plus one read buffer per run, whatever the input size.
+ *  - `--generate` writes a synthetic input for benchmarks (see `bench_convert.sh`).
+ *
+ * Dependencies:
+ *  - POSIX (mmap, pthread, pread).
+ *  - Standard C libraries (stdio, stdlib, string, math, time).
+ *
+ * Usage:
+ *  gcc -O2 -Wall -Wextra dataTxtToCSV.c -o dataTxtToCSV -lpthread -lm
+ *  ./dataTxtToCSV INPUT.txt OUTPUT.csv [--threads N] [--memory MB] [--tmp DIR] [--stats]
+ *  ./dataTxtToCSV --generate LINES OUTPUT.txt
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define DEFAULT_MEMORY_MB 256
+#define MAX_THREADS 16
+
+/* Run file read buffer per run during the merge */
+#define RUN_BUFFER_RECORDS (64 * 1024 / sizeof(SortRecord))
+
+/* Output stdio buffer */
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+/* Invalid lines reported one by one before only counting them */
+#define MAX_REPORTED_LINES 20
+
+/* One valid input line: its instant and where it starts in the mapped input */
+typedef struct {
+    int64_t ts_ns;
+    uint64_t offset;
+} SortRecord;
+
+/* A sorted run, in memory (the last batch of a thread) or in an unlinked temporary file */
+typedef struct {
+    SortRecord *records;        // in-memory run, or NULL
+    int fd;                     // run file, or -1
+    size_t count;
+} SortRun;
 
+/* Merge cursor over one run */
 typedef struct {
-    char *timestamp;
-    char *exchange;
-    char *product;
-    double price;
-} Entry;
+    const SortRun *run;
+    SortRecord *buffer;
+    size_t position;            // next record in `buffer`
+    size_t buffered;
+    size_t consumed;            // records of the run already loaded
+    SortRecord current;
+} RunCursor;
 
+/* Fields of one line, pointing into the mapped input */
 typedef struct {
-    char *key;
-    char *value;
+    const char *time;
+    size_t time_len;
+    const char *exchange;
+    size_t exchange_len;
+    const char *product;
+    size_t product_len;
+    const char *price;
+    size_t price_len;
+} LineFields;
+
+typedef struct {
+    const char *data;           // whole input
+    size_t begin, end;          // this thread's lines
+    size_t capacity;            // records per batch
+    const char *tmp_dir;
+    SortRun *runs;
+    size_t run_count;
+    uint64_t lines;
+    uint64_t invalid;
+    int failed;
+} RunWorker;
+
+typedef struct {
+    const char *key;
+    const char *value;
 } ProductMapping;
 
 typedef struct {
-    char *product;
+    const char *product;
     double value;
     int initialized;
 } PriceCounter;
 
-ProductMapping product_mappings[] = {
+static const ProductMapping product_mappings[] = {
     {"tBTCUSD", "BTC-USD"},
     {"BTCUSDT", "BTC-USD"},
     {"ADAUSDT", "ADA-USD"},
@@ -38,191 +125,641 @@ ProductMapping product_mappings[] = {
     {NULL, NULL}
 };
 
-PriceCounter price_counters[] = {
+static PriceCounter price_counters[] = {
     {"ADA-USD", 0.0, 0},
     {"BTC-USD", 0.0, 0},
     {"ETH-USD", 0.0, 0}
 };
 
-int compare_entries(const void *a, const void *b) {
-    const Entry *entry_a = (const Entry *)a;
-    const Entry *entry_b = (const Entry *)b;
-    return strcmp(entry_a->timestamp, entry_b->timestamp);
+static pthread_mutex_t report_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t reported_lines = 0;
+
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
 }
 
-void free_entry(Entry *entry) {
-    free(entry->timestamp);
-    free(entry->exchange);
-    free(entry->product);
+static void report_invalid(const char *reason, const char *line, size_t len) {
+    pthread_mutex_lock(&report_lock);
+    if (reported_lines++ < MAX_REPORTED_LINES)
+        fprintf(stderr, "Skipping %s: %.*s\n", reason, (int)(len > 200 ? 200 : len), line);
+    pthread_mutex_unlock(&report_lock);
 }
 
-Entry *parse_line(char *line) {
-    char *timestamp_start = strchr(line, '[');
-    if (!timestamp_start) return NULL;
-    timestamp_start += 1;
-    char *timestamp_end = strchr(timestamp_start, ']');
-    if (!timestamp_end) return NULL;
-    size_t timestamp_len = timestamp_end - timestamp_start;
-    char *timestamp = malloc(timestamp_len + 1);
-    strncpy(timestamp, timestamp_start, timestamp_len);
-    timestamp[timestamp_len] = '\0';
+/* ------------------------------ Line parsing ------------------------------ */
 
-    char *exchange_start = timestamp_end + 2;
-    if (*exchange_start != '[') {
-        free(timestamp);
-        return NULL;
+static int read_digits(const char *text, int count) {
+    int value = 0;
+    for (int i = 0; i < count; i++) {
+        if (text[i] < '0' || text[i] > '9') return -1;
+        value = value * 10 + (text[i] - '0');
     }
-    exchange_start += 1;
-    char *exchange_end = strchr(exchange_start, ']');
-    if (!exchange_end) {
-        free(timestamp);
-        return NULL;
+    return value;
+}
+
+/* Days from 1970-01-01 to a proleptic Gregorian date */
+static int64_t days_from_civil(int year, int month, int day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t year_of_era = year - era * 400;
+    int64_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+/* "YYYY-MM-DDTHH:MM:SS[.fraction][Z|+HH:MM|-HH:MM]" as epoch ns. Returns 0 or -1. */
+static int parse_timestamp(const char *text, size_t len, int64_t *out) {
+    if (len < 19 || text[4] != '-' || text[7] != '-' || (text[10] != 'T' && text[10] != ' ') ||
+        text[13] != ':' || text[16] != ':')
+        return -1;
+
+    int year = read_digits(text, 4), month = read_digits(text + 5, 2), day = read_digits(text + 8, 2);
+    int hour = read_digits(text + 11, 2), minute = read_digits(text + 14, 2), second = read_digits(text + 17, 2);
+    if (year < 0 || month < 1 || month > 12 || day < 1 || day > 31 || hour < 0 || hour > 23 ||
+        minute < 0 || minute > 59 || second < 0 || second > 59)
+        return -1;
+
+    size_t i = 19;
+    int64_t fraction = 0;
+    if (i < len && text[i] == '.') {
+        int digits = 0;
+        for (i++; i < len && text[i] >= '0' && text[i] <= '9'; i++, digits++) {
+            if (digits < 9) fraction = fraction * 10 + (text[i] - '0');
+        }
+        if (digits == 0) return -1;
+        for (; digits < 9; digits++) fraction *= 10;
     }
-    size_t exchange_len = exchange_end - exchange_start;
-    char *exchange = malloc(exchange_len + 1);
-    strncpy(exchange, exchange_start, exchange_len);
-    exchange[exchange_len] = '\0';
 
-    char *product_start = exchange_end + 2;
-    if (*product_start != '[') {
-        free(timestamp);
-        free(exchange);
-        return NULL;
+    int64_t offset_seconds = 0;
+    if (i < len && text[i] == 'Z') {
+        i++;
+    } else if (i < len && (text[i] == '+' || text[i] == '-')) {
+        if (len - i < 6 || text[i + 3] != ':') return -1;
+        int offset_hours = read_digits(text + i + 1, 2), offset_minutes = read_digits(text + i + 4, 2);
+        if (offset_hours < 0 || offset_minutes < 0) return -1;
+        offset_seconds = (offset_hours * 3600 + offset_minutes * 60) * (text[i] == '-' ? -1 : 1);
+        i += 6;
     }
-    product_start += 1;
-    char *product_end = strchr(product_start, ']');
-    if (!product_end) {
-        free(timestamp);
-        free(exchange);
-        return NULL;
+    if (i != len) return -1;
+
+    int64_t seconds = days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offset_seconds;
+    *out = seconds * 1000000000LL + fraction;
+    return 0;
+}
+
+/* Splits "[time][exchange][product] Price: digits[.digits]" (already trimmed). Returns 0 or -1. */
+static int split_line(const char *line, size_t len, LineFields *fields) {
+    const char *end = line + len;
+    const char *starts[3];
+    size_t lengths[3];
+    const char *p = line;
+
+    for (int f = 0; f < 3; f++) {
+        while (f > 0 && p < end && *p == ' ') p++;     // "[time] [exchange] [product]" also accepted
+        if (p >= end || *p != '[') return -1;
+        const char *close = memchr(p + 1, ']', (size_t)(end - p - 1));
+        if (!close) return -1;
+        starts[f] = p + 1;
+        lengths[f] = (size_t)(close - p - 1);
+        p = close + 1;
     }
-    size_t product_len = product_end - product_start;
-    char *product = malloc(product_len + 1);
-    strncpy(product, product_start, product_len);
-    product[product_len] = '\0';
 
-    char *price_start = strstr(product_end, "Price: ");
-    if (!price_start) {
-        free(timestamp);
-        free(exchange);
-        free(product);
-        return NULL;
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (end - p < 6 || memcmp(p, "Price:", 6) != 0) return -1;
+    p += 6;
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+
+    const char *price = p;
+    while (p < end && *p >= '0' && *p <= '9') p++;
+    if (p == price) return -1;
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') p++;
     }
-    price_start += 7;
-    double price = strtod(price_start, NULL);
+    if (p != end) return -1;
 
-    Entry *entry = malloc(sizeof(Entry));
-    entry->timestamp = timestamp;
-    entry->exchange = exchange;
-    entry->product = product;
-    entry->price = price;
+    fields->time = starts[0];
+    fields->time_len = lengths[0];
+    fields->exchange = starts[1];
+    fields->exchange_len = lengths[1];
+    fields->product = starts[2];
+    fields->product_len = lengths[2];
+    fields->price = price;
+    fields->price_len = (size_t)(end - price);
+    return 0;
+}
 
-    return entry;
+/* Trims the line starting at `line` (ending before `end` or at its newline). Returns the trimmed length. */
+static size_t trim_line(const char *line, const char *end, const char **trimmed) {
+    const char *newline = memchr(line, '\n', (size_t)(end - line));
+    const char *stop = newline ? newline : end;
+    while (line < stop && (*line == ' ' || *line == '\t' || *line == '\r')) line++;
+    while (stop > line && (stop[-1] == ' ' || stop[-1] == '\t' || stop[-1] == '\r')) stop--;
+    *trimmed = line;
+    return (size_t)(stop - line);
 }
 
-int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <input_file> <output_file>\n", argv[0]);
-        return 1;
+/* -------------------------------- Run sorting ------------------------------ */
+
+/* Stable LSD radix sort on the timestamp; passes whose byte is the same in every record are skipped */
+static SortRecord *radix_sort(SortRecord *records, SortRecord *scratch, size_t count) {
+    if (count < 2) return records;
+
+    for (int pass = 0; pass < 8; pass++) {
+        int shift = pass * 8;
+        size_t counts[256] = {0};
+        for (size_t i = 0; i < count; i++) counts[((uint64_t)records[i].ts_ns ^ (1ULL << 63)) >> shift & 0xFF]++;
+
+        size_t first_byte = ((uint64_t)records[0].ts_ns ^ (1ULL << 63)) >> shift & 0xFF;
+        if (counts[first_byte] == count) continue;
+
+        size_t position = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t n = counts[b];
+            counts[b] = position;
+            position += n;
+        }
+        for (size_t i = 0; i < count; i++)
+            scratch[counts[((uint64_t)records[i].ts_ns ^ (1ULL << 63)) >> shift & 0xFF]++] = records[i];
+
+        SortRecord *swap = records;
+        records = scratch;
+        scratch = swap;
     }
+    return records;
+}
 
-    FILE *input = fopen(argv[1], "r");
-    if (!input) {
-        perror("Error opening input file");
-        return 1;
+/* Writes a sorted batch to an unlinked temporary file. Returns the file descriptor or -1. */
+static int spill_run(const char *tmp_dir, const SortRecord *records, size_t count) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/dataTxtToCSV.XXXXXX", tmp_dir);
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "[ERROR] Could not create a run file in %s: %s\n", tmp_dir, strerror(errno));
+        return -1;
     }
+    unlink(path);
 
-    Entry *entries = NULL;
-    size_t num_entries = 0;
-    size_t capacity = 0;
+    const char *data = (const char *)records;
+    size_t remaining = count * sizeof(SortRecord);
+    while (remaining > 0) {
+        ssize_t written = write(fd, data, remaining);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) {
+            fprintf(stderr, "[ERROR] Failed to write a run file: %s\n", strerror(errno));
+            close(fd);
+            return -1;
+        }
+        data += written;
+        remaining -= (size_t)written;
+    }
+    return fd;
+}
 
-    char *line = NULL;
-    size_t line_len = 0;
-    while (getline(&line, &line_len, input) != -1) {
-        char *trimmed_line = line;
-        while (*trimmed_line == ' ' || *trimmed_line == '\t') trimmed_line++;
-        size_t len = strlen(trimmed_line);
-        while (len > 0 && (trimmed_line[len-1] == '\n' || trimmed_line[len-1] == '\r'))
-            trimmed_line[--len] = '\0';
-        if (len == 0) continue;
+static int add_run(RunWorker *worker, SortRecord *records, int fd, size_t count) {
+    SortRun *runs = realloc(worker->runs, (worker->run_count + 1) * sizeof(SortRun));
+    if (!runs) return -1;
+    worker->runs = runs;
+    worker->runs[worker->run_count++] = (SortRun){ records, fd, count };
+    return 0;
+}
 
-        Entry *entry = parse_line(trimmed_line);
-        if (!entry) {
-            fprintf(stderr, "Skipping invalid line: %s\n", trimmed_line);
-            continue;
+/* Parses this worker's lines into sorted runs; only its last batch may stay in memory */
+static void *generate_runs(void *arg) {
+    RunWorker *worker = arg;
+    SortRecord *batch = malloc(worker->capacity * sizeof(SortRecord));
+    SortRecord *scratch = malloc(worker->capacity * sizeof(SortRecord));
+    if (!batch || !scratch) {
+        fprintf(stderr, "[ERROR] Memory allocation failed for a sort batch\n");
+        worker->failed = 1;
+        free(batch);
+        free(scratch);
+        return NULL;
+    }
+
+    const char *data = worker->data, *end = data + worker->end;
+    size_t count = 0;
+    for (const char *line = data + worker->begin; line < end;) {
+        const char *trimmed;
+        size_t len = trim_line(line, end, &trimmed);
+        const char *newline = memchr(line, '\n', (size_t)(end - line));
+        const char *next = newline ? newline + 1 : end;
+
+        if (len > 0) {
+            LineFields fields;
+            int64_t ts_ns;
+            worker->lines++;
+            if (split_line(trimmed, len, &fields) != 0) {
+                report_invalid("invalid line", trimmed, len);
+                worker->invalid++;
+            } else if (parse_timestamp(fields.time, fields.time_len, &ts_ns) != 0) {
+                report_invalid("line with invalid timestamp", trimmed, len);
+                worker->invalid++;
+            } else {
+                batch[count].ts_ns = ts_ns;
+                batch[count].offset = (uint64_t)(trimmed - data);
+                count++;
+            }
         }
+        line = next;
 
-        if (num_entries >= capacity) {
-            capacity = capacity ? capacity * 2 : 16;
-            entries = realloc(entries, capacity * sizeof(Entry));
-            if (!entries) {
-                perror("Memory allocation failed");
-                exit(1);
+        if (count == worker->capacity || (line >= end && count > 0)) {
+            SortRecord *sorted = radix_sort(batch, scratch, count);
+            if (line >= end) {
+                /* The last batch stays in memory for the merge */
+                SortRecord *other = sorted == batch ? scratch : batch;
+                free(other);
+                batch = scratch = NULL;
+                if (add_run(worker, sorted, -1, count) != 0) {
+                    free(sorted);
+                    worker->failed = 1;
+                }
+                break;
+            }
+            int fd = spill_run(worker->tmp_dir, sorted, count);
+            if (fd < 0 || add_run(worker, NULL, fd, count) != 0) {
+                if (fd >= 0) close(fd);
+                worker->failed = 1;
+                break;
             }
+            count = 0;
         }
-        entries[num_entries++] = *entry;
-        free(entry);
     }
-    free(line);
-    fclose(input);
 
-    qsort(entries, num_entries, sizeof(Entry), compare_entries);
+    free(batch);
+    free(scratch);
+    return NULL;
+}
 
-    for (size_t i = 0; i < num_entries; i++) {
-        Entry *entry = &entries[i];
-        for (ProductMapping *m = product_mappings; m->key; m++) {
-            if (strcmp(entry->product, m->key) == 0) {
-                free(entry->product);
-                entry->product = strdup(m->value);
-                break;
+/* ---------------------------------- Merge ---------------------------------- */
+
+static int record_less(const SortRecord *a, const SortRecord *b) {
+    return a->ts_ns < b->ts_ns || (a->ts_ns == b->ts_ns && a->offset < b->offset);
+}
+
+/* Loads the cursor's next record. Returns 1, 0 at the end of the run, or -1 on a read error. */
+static int cursor_advance(RunCursor *cursor) {
+    const SortRun *run = cursor->run;
+    if (run->records) {
+        if (cursor->consumed == run->count) return 0;
+        cursor->current = run->records[cursor->consumed++];
+        return 1;
+    }
+
+    if (cursor->position == cursor->buffered) {
+        if (cursor->consumed == run->count) return 0;
+        size_t want = run->count - cursor->consumed;
+        if (want > RUN_BUFFER_RECORDS) want = RUN_BUFFER_RECORDS;
+        size_t bytes = want * sizeof(SortRecord), got = 0;
+        while (got < bytes) {
+            ssize_t n = pread(run->fd, (char *)cursor->buffer + got, bytes - got,
+                              (off_t)(cursor->consumed * sizeof(SortRecord) + got));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                fprintf(stderr, "[ERROR] Failed to read a run file: %s\n", n < 0 ? strerror(errno) : "truncated");
+                return -1;
             }
+            got += (size_t)n;
         }
+        cursor->consumed += want;
+        cursor->buffered = want;
+        cursor->position = 0;
+    }
+    cursor->current = cursor->buffer[cursor->position++];
+    return 1;
+}
 
-        for (int j = 0; j < 3; j++) {
-            if (strcmp(entry->product, price_counters[j].product) == 0) {
-                price_counters[j].value = entry->price;
-                price_counters[j].initialized = 1;
-                break;
-            }
+static void heap_sift_down(RunCursor **heap, size_t count, size_t i) {
+    for (;;) {
+        size_t smallest = i, left = 2 * i + 1, right = left + 1;
+        if (left < count && record_less(&heap[left]->current, &heap[smallest]->current)) smallest = left;
+        if (right < count && record_less(&heap[right]->current, &heap[smallest]->current)) smallest = right;
+        if (smallest == i) return;
+        RunCursor *swap = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = swap;
+        i = smallest;
+    }
+}
+
+/* --------------------------------- Output ---------------------------------- */
+
+static void write_field(FILE *output, const char *text, size_t len) {
+    /* Quoted like Python's csv module when the field needs it */
+    if (!memchr(text, ',', len) && !memchr(text, '"', len) && !memchr(text, '\n', len)) {
+        fwrite_unlocked(text, 1, len, output);
+        return;
+    }
+    fputc_unlocked('"', output);
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] == '"') fputc_unlocked('"', output);
+        fputc_unlocked(text[i], output);
+    }
+    fputc_unlocked('"', output);
+}
+
+static void write_u64(FILE *output, uint64_t value) {
+    char digits[24];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (n > 0) fputc_unlocked(digits[--n], output);
+}
+
+/* Renames the product and resolves "unknown" from the closest last price, in time order */
+static void resolve_product(LineFields *fields) {
+    for (const ProductMapping *m = product_mappings; m->key; m++) {
+        if (fields->product_len == strlen(m->key) && memcmp(fields->product, m->key, fields->product_len) == 0) {
+            fields->product = m->value;
+            fields->product_len = strlen(m->value);
+            break;
         }
+    }
 
-        if (strcmp(entry->product, "unknown") == 0) {
-            double min_diff = INFINITY;
-            int closest = -1;
-            for (int j = 0; j < 3; j++) {
-                if (price_counters[j].initialized) {
-                    double diff = fabs(entry->price - price_counters[j].value);
-                    if (diff < min_diff) {
-                        min_diff = diff;
-                        closest = j;
-                    }
-                }
+    int counters = (int)(sizeof(price_counters) / sizeof(price_counters[0]));
+    for (int j = 0; j < counters; j++) {
+        if (fields->product_len == strlen(price_counters[j].product) &&
+            memcmp(fields->product, price_counters[j].product, fields->product_len) == 0) {
+            price_counters[j].value = strtod(fields->price, NULL);
+            price_counters[j].initialized = 1;
+            return;
+        }
+    }
+
+    if (fields->product_len == 7 && memcmp(fields->product, "unknown", 7) == 0) {
+        double price = strtod(fields->price, NULL);
+        double min_diff = INFINITY;
+        int closest = -1;
+        for (int j = 0; j < counters; j++) {
+            if (!price_counters[j].initialized) continue;
+            double diff = fabs(price - price_counters[j].value);
+            if (diff < min_diff) {
+                min_diff = diff;
+                closest = j;
             }
-            if (closest != -1) {
-                free(entry->product);
-                entry->product = strdup(price_counters[closest].product);
+        }
+        if (closest != -1) {
+            fields->product = price_counters[closest].product;
+            fields->product_len = strlen(price_counters[closest].product);
+        }
+    }
+}
+
+/* Merges the runs and writes one CSV row per record. Returns the rows written, or -1. */
+static int64_t merge_runs(const char *data, size_t size, SortRun *runs, size_t run_count, FILE *output) {
+    RunCursor *cursors = calloc(run_count ? run_count : 1, sizeof(RunCursor));
+    RunCursor **heap = calloc(run_count ? run_count : 1, sizeof(RunCursor *));
+    if (!cursors || !heap) {
+        free(cursors);
+        free(heap);
+        return -1;
+    }
+
+    size_t heap_count = 0;
+    int64_t rows = 0;
+    for (size_t i = 0; i < run_count; i++) {
+        cursors[i].run = &runs[i];
+        if (!runs[i].records) {
+            cursors[i].buffer = malloc(RUN_BUFFER_RECORDS * sizeof(SortRecord));
+            if (!cursors[i].buffer) {
+                rows = -1;
+                goto done;
             }
         }
+        int loaded = cursor_advance(&cursors[i]);
+        if (loaded < 0) {
+            rows = -1;
+            goto done;
+        }
+        if (loaded) heap[heap_count++] = &cursors[i];
     }
+    for (size_t i = heap_count / 2; i-- > 0;) heap_sift_down(heap, heap_count, i);
+
+    fputs("index,time,exchange,product,price\n", output);
+    while (heap_count > 0) {
+        RunCursor *top = heap[0];
+        const char *line = data + top->current.offset;
+        const char *trimmed;
+        size_t len = trim_line(line, data + size, &trimmed);
+        LineFields fields;
+        if (split_line(trimmed, len, &fields) == 0) {
+            resolve_product(&fields);
+            write_u64(output, (uint64_t)++rows);
+            fputc_unlocked(',', output);
+            write_field(output, fields.time, fields.time_len);
+            fputc_unlocked(',', output);
+            write_field(output, fields.exchange, fields.exchange_len);
+            fputc_unlocked(',', output);
+            write_field(output, fields.product, fields.product_len);
+            fputc_unlocked(',', output);
+            fwrite_unlocked(fields.price, 1, fields.price_len, output);
+            fputc_unlocked('\n', output);
+        }
+
+        int loaded = cursor_advance(top);
+        if (loaded < 0) {
+            rows = -1;
+            break;
+        }
+        if (!loaded) heap[0] = heap[--heap_count];
+        heap_sift_down(heap, heap_count, 0);
+    }
+
+done:
+    for (size_t i = 0; i < run_count; i++) free(cursors[i].buffer);
+    free(cursors);
+    free(heap);
+    return rows;
+}
+
+/* -------------------------------- Generator -------------------------------- */
+
+/* Synthetic logger output: several exchanges whose lines arrive slightly out of time order */
+static int generate(uint64_t lines, const char *path) {
+    static const char *exchanges[] = { "Coinbase", "Binance", "Kraken", "Bitfinex" };
+    static const char *products[][3] = {
+        { "BTC-USD", "ETH-USD", "ADA-USD" },
+        { "BTCUSDT", "ETHUSDT", "ADAUSDT" },
+        { "unknown", "unknown", "unknown" },
+        { "tBTCUSD", "tBTCUSD", "tBTCUSD" },
+    };
+    double prices[3] = { 93000.0, 2500.0, 0.7 };
 
-    FILE *output = fopen(argv[2], "w");
+    FILE *output = fopen(path, "w");
     if (!output) {
-        perror("Error opening output file");
+        fprintf(stderr, "[ERROR] Could not open %s: %s\n", path, strerror(errno));
         return 1;
     }
+    setvbuf(output, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    int64_t base_ns = 1740435777000000000LL;
+    for (uint64_t i = 0; i < lines; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        int exchange = (int)(state % 4), product = exchange == 3 ? 0 : (int)((state >> 8) % 3);
+        prices[product] *= 1.0 + ((double)((state >> 16) % 2001) - 1000.0) * 1e-7;
 
-    fprintf(output, "index,time,exchange,product,price\n");
-    for (size_t i = 0; i < num_entries; i++) {
-        Entry *entry = &entries[i];
-        fprintf(output, "%zu,%s,%s,%s,%.8f\n", i + 1, entry->timestamp, entry->exchange, entry->product, entry->price);
+        /* Up to 50 ms of delivery jitter, so the input is only nearly sorted */
+        int64_t ts_ns = base_ns + (int64_t)i * 1000000 - (int64_t)((state >> 32) % 50) * 1000000;
+        time_t seconds = (time_t)(ts_ns / 1000000000LL);
+        struct tm tm;
+        gmtime_r(&seconds, &tm);
+        fprintf(output, "[%04d-%02d-%02dT%02d:%02d:%02d.%06lldZ][%s][%s] Price: %.*f\n",
+                tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                (long long)(ts_ns % 1000000000LL / 1000), exchanges[exchange], products[exchange][product],
+                product == 2 ? 4 : 2, prices[product]);
     }
 
-    fclose(output);
+    if (fclose(output) != 0) {
+        fprintf(stderr, "[ERROR] Failed to write %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    return 0;
+}
 
-    for (size_t i = 0; i < num_entries; i++) {
-        free_entry(&entries[i]);
+/* ---------------------------------- Main ----------------------------------- */
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s <input_file> <output_file> [--threads N] [--memory MB] [--tmp DIR] [--stats]\n"
+                    "       %s --generate LINES <output_file>\n", program, program);
+}
+
+int main(int argc, char *argv[]) {
+    const char *input_path = NULL, *output_path = NULL;
+    const char *tmp_dir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    long memory_mb = DEFAULT_MEMORY_MB;
+    int stats = 0;
+
+    if (argc == 4 && strcmp(argv[1], "--generate") == 0) return generate(strtoull(argv[2], NULL, 10), argv[3]);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc) {
+            memory_mb = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--tmp") == 0 && i + 1 < argc) {
+            tmp_dir = argv[++i];
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats = 1;
+        } else if (argv[i][0] != '-' && !input_path) {
+            input_path = argv[i];
+        } else if (argv[i][0] != '-' && !output_path) {
+            output_path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!input_path || !output_path || memory_mb < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    int64_t start = monotonic_ns();
+    int fd = open(input_path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror("Error opening input file");
+        return 1;
+    }
+    size_t size = (size_t)st.st_size;
+    const char *data = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : "";
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("Error mapping input file");
+        return 1;
+    }
+    if (size) madvise((void *)data, size, MADV_SEQUENTIAL);
+
+    /* Small inputs are not worth splitting across threads */
+    if ((size_t)threads > size / (1 << 20) + 1) threads = (long)(size / (1 << 20) + 1);
+
+    /* Each worker holds a batch and the radix sort's scratch copy of it */
+    size_t capacity = (size_t)memory_mb * 1024 * 1024 / (size_t)threads / (2 * sizeof(SortRecord));
+    if (capacity < 1024) capacity = 1024;
+
+    RunWorker workers[MAX_THREADS];
+    pthread_t thread_ids[MAX_THREADS];
+    memset(workers, 0, sizeof(workers));
+    size_t begin = 0;
+    for (long t = 0; t < threads; t++) {
+        size_t end = (t == threads - 1) ? size : size / (size_t)threads * (size_t)(t + 1);
+        if (end < begin) end = begin;
+        const char *newline = end < size ? memchr(data + end, '\n', size - end) : NULL;
+        end = (t == threads - 1 || !newline) ? size : (size_t)(newline - data) + 1;
+
+        workers[t] = (RunWorker){ .data = data, .begin = begin, .end = end, .capacity = capacity, .tmp_dir = tmp_dir };
+        begin = end;
+        if (pthread_create(&thread_ids[t], NULL, generate_runs, &workers[t]) != 0) {
+            fprintf(stderr, "[ERROR] Failed to start a sort thread\n");
+            return 1;
+        }
+    }
+
+    SortRun *runs = NULL;
+    size_t run_count = 0, spilled = 0;
+    uint64_t lines = 0, invalid = 0;
+    int failed = 0;
+    for (long t = 0; t < threads; t++) {
+        pthread_join(thread_ids[t], NULL);
+        failed |= workers[t].failed;
+        lines += workers[t].lines;
+        invalid += workers[t].invalid;
+
+        SortRun *grown = realloc(runs, (run_count + workers[t].run_count + 1) * sizeof(SortRun));
+        if (!grown) {
+            failed = 1;
+            continue;
+        }
+        runs = grown;
+        for (size_t r = 0; r < workers[t].run_count; r++) {
+            runs[run_count++] = workers[t].runs[r];
+            spilled += workers[t].runs[r].fd >= 0;
+        }
+        free(workers[t].runs);
     }
-    free(entries);
+    int64_t sorted_ns = monotonic_ns();
 
+    FILE *output = failed ? NULL : fopen(output_path, "w");
+    int64_t rows = -1;
+    if (output) {
+        setvbuf(output, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+        if (size) madvise((void *)data, size, MADV_NORMAL);
+        rows = merge_runs(data, size, runs, run_count, output);
+        if (fclose(output) != 0) {
+            perror("Error writing output file");
+            rows = -1;
+        }
+    } else if (!failed) {
+        perror("Error opening output file");
+    }
+
+    for (size_t r = 0; r < run_count; r++) {
+        free(runs[r].records);
+        if (runs[r].fd >= 0) close(runs[r].fd);
+    }
+    free(runs);
+    if (size) munmap((void *)data, size);
+
+    if (invalid > MAX_REPORTED_LINES)
+        fprintf(stderr, "Skipped %llu invalid lines in total\n", (unsigned long long)invalid);
+    if (rows < 0) return 1;
+
+    if (stats) {
+        double total = (double)(monotonic_ns() - start) / 1e9, sorting = (double)(sorted_ns - start) / 1e9;
+        fprintf(stderr, "%llu lines, %lld rows, %zu runs (%zu spilled) on %ld threads; "
+                        "sort %.3f s, merge and write %.3f s; %.1f MB/s, %.2f M lines/s\n",
+                (unsigned long long)lines, (long long)rows, run_count, spilled, threads,
+                sorting, total - sorting, total > 0 ? (double)size / 1e6 / total : 0.0,
+                total > 0 ? (double)lines / 1e6 / total : 0.0);
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,388 @@
+/*
+ * Archive Writer
+ *
+ * This module writes the columnar tick archive. Each (exchange, kind) has one
+ * open daily file, and each symbol a small row buffer. A buffer becomes one
+ * block when it reaches ARCHIVE_BLOCK_ROWS rows, when its oldest row is
+ * ARCHIVE_FLUSH_INTERVAL seconds old, at the UTC day rollover and on shutdown.
+ *
+ * Features:
+ *  - Per-symbol blocks with min/max timestamps, so readers skip by symbol and time range.
+ *  - Symbols are dictionary-encoded per file (a short DICT record on first use).
+ *  - Fixed-point columns keep their integer mantissas; no text formatting on this path.
+ *  - Absent ticker fields cost nothing once a whole block lacks them.
+ *  - A single mutex serializes writer-thread appends with main-thread flushes.
+ *
+ * Dependencies:
+ *  - tick_archive.h: Format and column codec.
+ *  - Standard C libraries (stdio, stdlib, string, stddef, time, errno, pthread, sys/stat).
+ *
+ * Usage:
+ *  - Enabled by `crypto_ws --archive DIR`; fed from `ingest.c`, flushed from `main.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "archive_writer.h"
+#include "tick_archive.h"
+#include "symbol_table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define SECONDS_PER_DAY 86400
+
+/* stdio buffer per open archive file */
+#define ARCHIVE_FILE_BUFFER_SIZE (256 * 1024)
+
+/* No file index assigned yet in the current file */
+#define NO_FILE_SYMBOL UINT16_MAX
+
+/* Buffered rows of one symbol */
+typedef struct {
+    uint16_t file_symbol;       // dictionary index in the open file, NO_FILE_SYMBOL until written
+    uint32_t count;
+    uint32_t capacity;
+    time_t oldest;              // arrival of the first buffered row
+    union {
+        TickerData *tickers;
+        TradeData *trades;
+    } rows;
+} SymbolRows;
+
+/* One open archive file for an (exchange, kind) pair */
+typedef struct {
+    ArchiveKind kind;
+    uint16_t exchange_id;
+    FILE *fp;
+    char *buffer;
+    long day;                   // days since epoch of the open file
+    uint16_t next_file_symbol;
+    SymbolRows *symbols[MAX_SYMBOLS];
+    uint16_t active[MAX_SYMBOLS];   // symbol IDs with a row buffer, in first-seen order
+    int active_count;
+} ArchiveSink;
+
+#define OFFSET_ENTRY(member) offsetof(TickerData, member),
+#define TRADE_OFFSET_ENTRY(member) offsetof(TradeData, member),
+
+/* Column n + 1 of each kind is the Fixed member at offsets[n] */
+static const size_t ticker_offsets[] = { ARCHIVE_TICKER_FIELDS(OFFSET_ENTRY) };
+static const size_t trade_offsets[] = { ARCHIVE_TRADE_FIELDS(TRADE_OFFSET_ENTRY) };
+
+static ArchiveSink *sinks[EXCHANGE_COUNT][2];
+static char archive_dir[256];
+static int archive_compress = 1;
+static int archive_enabled = 0;
+static ArchiveStats stats;
+
+/* Column scratch reused by every block (under the lock) */
+static int64_t column_values[ARCHIVE_BLOCK_ROWS];
+static int8_t column_scales[ARCHIVE_BLOCK_ROWS];
+static ArchiveBuffer block_data;
+
+static pthread_mutex_t archive_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *kind_names[] = { "ticker", "trade" };
+
+int archive_writer_open(const char *dir, int compress) {
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        printf("[ERROR] Could not create archive directory %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    snprintf(archive_dir, sizeof(archive_dir), "%s", dir);
+    archive_compress = compress;
+    archive_enabled = 1;
+    printf("[INFO] Archiving ticks to %s/ (%s)\n", archive_dir, compress ? "zlib columns" : "uncompressed");
+    return 0;
+}
+
+int archive_writer_enabled(void) {
+    return archive_enabled;
+}
+
+static int write_all(ArchiveSink *sink, const void *data, size_t len) {
+    if (fwrite(data, 1, len, sink->fp) != len) {
+        printf("[ERROR] Failed to write %s %s archive: %s\n",
+               exchange_name(sink->exchange_id), kind_names[sink->kind], strerror(errno));
+        return -1;
+    }
+    stats.bytes += len;
+    return 0;
+}
+
+/* Fills the column scratch with column `column` of a symbol's buffered rows */
+static void gather_column(const ArchiveSink *sink, const SymbolRows *rows, int column) {
+    for (uint32_t i = 0; i < rows->count; i++) {
+        if (sink->kind == ARCHIVE_KIND_TICKER) {
+            const TickerData *ticker = &rows->rows.tickers[i];
+            if (column == 0) {
+                column_values[i] = ticker->ts_ns;
+                column_scales[i] = 0;
+            } else {
+                const Fixed *field = (const Fixed *)((const char *)ticker + ticker_offsets[column - 1]);
+                column_values[i] = field->value;
+                column_scales[i] = field->scale;
+            }
+            continue;
+        }
+
+        const TradeData *trade = &rows->rows.trades[i];
+        int fields = (int)(sizeof(trade_offsets) / sizeof(trade_offsets[0]));
+        if (column == 0) {
+            column_values[i] = trade->ts_ns;
+            column_scales[i] = 0;
+        } else if (column <= fields) {
+            const Fixed *field = (const Fixed *)((const char *)trade + trade_offsets[column - 1]);
+            column_values[i] = field->value;
+            column_scales[i] = field->scale;
+        } else {
+            column_values[i] = trade->market_maker;
+            column_scales[i] = trade->market_maker < 0 ? -1 : 0;
+        }
+    }
+}
+
+/* Encodes a symbol's buffered rows as one block and empties the buffer */
+static int write_block(ArchiveSink *sink, uint16_t symbol_id, SymbolRows *rows) {
+    if (rows->count == 0) return 0;
+
+    if (rows->file_symbol == NO_FILE_SYMBOL) {
+        const char *name = symbol_name(symbol_id);
+        size_t name_len = strlen(name);
+        if (name_len > ARCHIVE_MAX_NAME) name_len = ARCHIVE_MAX_NAME;
+
+        ArchiveDictEntry entry = { ARCHIVE_DICT_MAGIC, sink->next_file_symbol, (uint8_t)name_len, 0 };
+        if (write_all(sink, &entry, sizeof(entry)) != 0 || write_all(sink, name, name_len) != 0) return -1;
+        rows->file_symbol = sink->next_file_symbol++;
+    }
+
+    ArchiveBlockHeader header = { ARCHIVE_BLOCK_MAGIC, rows->file_symbol, (uint8_t)sink->kind, 0, rows->count, 0,
+                                  INT64_MAX, INT64_MIN };
+    ArchiveColumnInfo columns[ARCHIVE_MAX_COLUMNS];
+    block_data.len = 0;
+
+    for (int column = 0; column < archive_column_count(sink->kind); column++) {
+        gather_column(sink, rows, column);
+        if (column == 0) {
+            for (uint32_t i = 0; i < rows->count; i++) {
+                if (column_values[i] < header.ts_min) header.ts_min = column_values[i];
+                if (column_values[i] > header.ts_max) header.ts_max = column_values[i];
+            }
+        }
+
+        ArchiveColumnInfo *info = &columns[header.column_count];
+        int result = archive_encode_column(&block_data, column_values, column_scales, rows->count,
+                                           archive_compress, info);
+        if (result < 0) {
+            printf("[ERROR] Failed to encode %s archive block, dropping %u rows\n",
+                   exchange_name(sink->exchange_id), rows->count);
+            rows->count = 0;
+            rows->oldest = 0;
+            return -1;
+        }
+        if (result == 0) {
+            info->column = (uint8_t)column;
+            header.column_count++;
+        }
+    }
+    header.data_len = (uint32_t)block_data.len;
+
+    int status = 0;
+    if (write_all(sink, &header, sizeof(header)) != 0 ||
+        write_all(sink, columns, header.column_count * sizeof(ArchiveColumnInfo)) != 0 ||
+        write_all(sink, block_data.data, block_data.len) != 0)
+        status = -1;
+
+    stats.rows += rows->count;
+    stats.blocks++;
+    rows->count = 0;
+    rows->oldest = 0;
+    return status;
+}
+
+static void write_pending(ArchiveSink *sink, time_t now, int force) {
+    for (int i = 0; i < sink->active_count; i++) {
+        uint16_t id = sink->active[i];
+        SymbolRows *rows = sink->symbols[id];
+        if (rows->count == 0) continue;
+        if (force || now - rows->oldest >= ARCHIVE_FLUSH_INTERVAL) write_block(sink, id, rows);
+    }
+}
+
+static void close_file(ArchiveSink *sink) {
+    if (!sink->fp) return;
+
+    write_pending(sink, 0, 1);
+    if (fclose(sink->fp) != 0)
+        printf("[ERROR] Failed to close %s archive: %s\n", exchange_name(sink->exchange_id), strerror(errno));
+    sink->fp = NULL;
+
+    /* Dictionary indices restart with the next file */
+    for (int i = 0; i < sink->active_count; i++)
+        sink->symbols[sink->active[i]]->file_symbol = NO_FILE_SYMBOL;
+    sink->next_file_symbol = 0;
+}
+
+/* Open (or reopen after UTC midnight) the daily file; an existing file is appended to */
+static int open_file(ArchiveSink *sink, time_t now) {
+    close_file(sink);
+
+    struct tm tm;
+    gmtime_r(&now, &tm);
+
+    char filename[400];
+    snprintf(filename, sizeof(filename), "%s/%s_%s_%04d%02d%02d.tca", archive_dir,
+             exchange_name(sink->exchange_id), kind_names[sink->kind], tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+
+    /* Appending continues the file, so its dictionary indices must not be reused */
+    struct stat st;
+    int exists = (stat(filename, &st) == 0 && st.st_size > 0);
+    if (exists) {
+        ArchiveReader reader;
+        if (archive_reader_open(&reader, filename) != 0) return -1;
+        while (archive_reader_next(&reader) > 0) {}
+        sink->next_file_symbol = (uint16_t)reader.name_count;
+        archive_reader_close(&reader);
+    }
+
+    sink->fp = fopen(filename, "ab");
+    if (!sink->fp) {
+        printf("[ERROR] Failed to open archive %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+    if (!sink->buffer) sink->buffer = malloc(ARCHIVE_FILE_BUFFER_SIZE);
+    if (sink->buffer) setvbuf(sink->fp, sink->buffer, _IOFBF, ARCHIVE_FILE_BUFFER_SIZE);
+
+    if (!exists) {
+        ArchiveFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, ARCHIVE_MAGIC, ARCHIVE_MAGIC_LENGTH);
+        header.exchange_id = sink->exchange_id;
+        header.kind = (uint8_t)sink->kind;
+        header.version = ARCHIVE_VERSION;
+        strncpy(header.exchange, exchange_name(sink->exchange_id), sizeof(header.exchange) - 1);
+        if (write_all(sink, &header, sizeof(header)) != 0) return -1;
+    }
+
+    sink->day = now / SECONDS_PER_DAY;
+    return 0;
+}
+
+/* Buffer slot for the next row of a symbol, writing a full block first */
+static void *reserve_row(ArchiveKind kind, uint16_t exchange_id, uint16_t symbol_id) {
+    if (exchange_id >= EXCHANGE_COUNT || symbol_id >= MAX_SYMBOLS) return NULL;
+
+    ArchiveSink *sink = sinks[exchange_id][kind];
+    if (!sink) {
+        sink = calloc(1, sizeof(*sink));
+        if (!sink) return NULL;
+        sink->kind = kind;
+        sink->exchange_id = exchange_id;
+        sink->day = -1;
+        sinks[exchange_id][kind] = sink;
+    }
+
+    time_t now = time(NULL);
+    if (!sink->fp || now / SECONDS_PER_DAY != sink->day) {
+        if (open_file(sink, now) != 0) return NULL;
+    }
+
+    SymbolRows *rows = sink->symbols[symbol_id];
+    if (!rows) {
+        rows = calloc(1, sizeof(*rows));
+        if (!rows) return NULL;
+        rows->file_symbol = NO_FILE_SYMBOL;
+        sink->symbols[symbol_id] = rows;
+        sink->active[sink->active_count++] = symbol_id;
+    }
+
+    if (rows->count == ARCHIVE_BLOCK_ROWS) write_block(sink, symbol_id, rows);
+
+    size_t row_size = (kind == ARCHIVE_KIND_TICKER) ? sizeof(TickerData) : sizeof(TradeData);
+    if (rows->count == rows->capacity) {
+        uint32_t grown = rows->capacity ? rows->capacity * 2 : 16;
+        if (grown > ARCHIVE_BLOCK_ROWS) grown = ARCHIVE_BLOCK_ROWS;
+        void *data = realloc(rows->rows.tickers, grown * row_size);
+        if (!data) return NULL;
+        rows->rows.tickers = data;
+        rows->capacity = grown;
+    }
+
+    if (rows->count == 0) rows->oldest = now;
+    return (char *)rows->rows.tickers + (size_t)rows->count++ * row_size;
+}
+
+void archive_writer_ticker(const TickerData *ticker) {
+    if (!archive_enabled) return;
+
+    pthread_mutex_lock(&archive_lock);
+    TickerData *row = reserve_row(ARCHIVE_KIND_TICKER, ticker->exchange_id, ticker->symbol_id);
+    if (row) *row = *ticker;
+    pthread_mutex_unlock(&archive_lock);
+}
+
+void archive_writer_trade(const TradeData *trade) {
+    if (!archive_enabled) return;
+
+    pthread_mutex_lock(&archive_lock);
+    TradeData *row = reserve_row(ARCHIVE_KIND_TRADE, trade->exchange_id, trade->symbol_id);
+    if (row) *row = *trade;
+    pthread_mutex_unlock(&archive_lock);
+}
+
+void archive_writer_flush(int force) {
+    static time_t last_flush = 0;
+    if (!archive_enabled) return;
+
+    /* Called every housekeeping tick; blocks are due on a seconds scale */
+    time_t now = time(NULL);
+    if (!force && now == last_flush) return;
+    last_flush = now;
+
+    pthread_mutex_lock(&archive_lock);
+    for (int exchange = 0; exchange < EXCHANGE_COUNT; exchange++) {
+        for (int kind = 0; kind < 2; kind++) {
+            ArchiveSink *sink = sinks[exchange][kind];
+            if (!sink || !sink->fp) continue;
+            write_pending(sink, now, force);
+            fflush(sink->fp);
+        }
+    }
+    pthread_mutex_unlock(&archive_lock);
+}
+
+void archive_writer_close_all(void) {
+    pthread_mutex_lock(&archive_lock);
+    for (int exchange = 0; exchange < EXCHANGE_COUNT; exchange++) {
+        for (int kind = 0; kind < 2; kind++) {
+            ArchiveSink *sink = sinks[exchange][kind];
+            if (!sink) continue;
+            close_file(sink);
+            for (int i = 0; i < sink->active_count; i++) {
+                free(sink->symbols[sink->active[i]]->rows.tickers);
+                free(sink->symbols[sink->active[i]]);
+            }
+            free(sink->buffer);
+            free(sink);
+            sinks[exchange][kind] = NULL;
+        }
+    }
+    archive_buffer_free(&block_data);
+    archive_enabled = 0;
+    pthread_mutex_unlock(&archive_lock);
+}
+
+void archive_writer_stats(ArchiveStats *out) {
+    pthread_mutex_lock(&archive_lock);
+    *out = stats;
+    pthread_mutex_unlock(&archive_lock);
+}
@@ -0,0 +1,59 @@
+/*
+ * Archive Writer Header
+ *
+ * Declares the columnar tick archive sink that runs next to the BSON writer.
+ * Records are buffered per (exchange, kind, symbol) and written as compressed
+ * column blocks to `<dir>/<exchange>_<kind>_YYYYMMDD.tca` (format in `tick_archive.h`).
+ *
+ * Features:
+ *  - archive_writer_open(): Enables the archive (`crypto_ws --archive DIR`).
+ *  - archive_writer_ticker() / archive_writer_trade(): Buffer one record; no-ops when disabled.
+ *  - archive_writer_flush(): Writes out symbols whose rows waited longer than the interval.
+ *  - archive_writer_close_all(): Writes every pending block and closes the files.
+ *
+ * Dependencies:
+ *  - market_record.h: TickerData / TradeData.
+ *
+ * Usage:
+ *  - Fed on the ingest writer threads next to write_ticker_to_bson()/write_trade_to_bson().
+ *  - Flushed from the housekeeping loop in `main.c`. Safe to call from any thread.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef ARCHIVE_WRITER_H
+#define ARCHIVE_WRITER_H
+
+#include <stdint.h>
+
+#include "market_record.h"
+
+/* Seconds a symbol's rows may wait before a (short) block is written for them */
+#define ARCHIVE_FLUSH_INTERVAL 60
+
+/* Archive counters since startup */
+typedef struct {
+    uint64_t rows;
+    uint64_t blocks;
+    uint64_t bytes;             // bytes written to archive files
+} ArchiveStats;
+
+/* Starts archiving to `dir` (created if missing). `compress` enables the zlib pass. Returns 0 or -1. */
+int archive_writer_open(const char *dir, int compress);
+
+/* Non-zero once archive_writer_open() succeeded. */
+int archive_writer_enabled(void);
+
+void archive_writer_ticker(const TickerData *ticker);
+void archive_writer_trade(const TradeData *trade);
+
+/* Writes blocks for symbols whose oldest buffered row is older than the interval (or all, if forced). */
+void archive_writer_flush(int force);
+
+/* Writes every pending block and closes every file. */
+void archive_writer_close_all(void);
+
+void archive_writer_stats(ArchiveStats *stats);
+
+#endif // ARCHIVE_WRITER_H
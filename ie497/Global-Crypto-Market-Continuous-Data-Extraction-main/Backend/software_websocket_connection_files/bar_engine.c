@@ -0,0 +1,436 @@
+/*
+ * Bar Engine
+ *
+ * This module aggregates the trade stream into OHLCV/VWAP bars as it arrives,
+ * replacing the sort-then-bucket pass of the offline filters. Each (exchange,
+ * symbol) has one compact slot holding the open bar of every configured
+ * interval; a trade updates those bars in place and is then forgotten, so
+ * memory and CPU grow with the number of symbols, not with the trades in a bar.
+ *
+ * Bars are closed by a watermark rather than by the next trade: once the
+ * exchange's newest trade time is BAR_LATENESS_SECONDS past a bar's end the
+ * bar is written out. Until then a trade that arrives out of order still
+ * lands in its own bar, because each interval keeps the last few buckets
+ * open side by side. An exchange that goes quiet has its trade time moved
+ * on by the wall time since its last trade, less BAR_IDLE_SECONDS, so its
+ * last bars still close (replayed captures keep their own timeline). A trade
+ * for a bar that was already written is counted as late and left out.
+ *
+ * Features:
+ *  - One row per closed bar: start, exchange, canonical symbol, OHLC, volume, VWAP, trade count.
+ *  - Prices and volume stay exact Fixed values (fixed_compare(), fixed_add()); only VWAP
+ *    goes through a long double.
+ *  - Append-only CSV per interval and UTC day of the bar start, with a header line on creation.
+ *  - One lock per exchange; records of one exchange always arrive on the same writer thread,
+ *    so the housekeeping flush is the only other party.
+ *
+ * Dependencies:
+ *  - market_record.h / symbol_table.h: TradeData, Fixed helpers, symbol names.
+ *  - pthread: Per-exchange and output locks.
+ *
+ * Usage:
+ *  - Enabled from `main.c` (`--bars DIR [--bar-intervals LIST]`); bar_engine_trade() is called
+ *    from the ingest writer threads next to log_trade_price().
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "bar_engine.h"
+#include "symbol_table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define NS_PER_SECOND 1000000000LL
+#define SECONDS_PER_DAY 86400
+
+/* Flushes not forced run at most this often */
+#define BAR_FLUSH_INTERVAL_NS (250LL * 1000000LL)
+
+/* VWAP is printed with this many more decimals than the close */
+#define BAR_VWAP_EXTRA_DECIMALS 4
+
+/* Open bars per interval. Intervals are at least 1 s, so a bucket that needs a slot while all are
+ * taken is at least this many seconds past the oldest one, whose end the watermark has then passed. */
+#define BAR_PENDING_BARS (BAR_LATENESS_SECONDS + 2)
+
+typedef struct {
+    int64_t start_ns;           // 0 while the slot is free
+    Fixed open;
+    Fixed high;
+    Fixed low;
+    Fixed close;
+    Fixed volume;
+    int64_t open_ns;            // trade times of the open and close
+    int64_t close_ns;
+    long double notional;       // sum of price * size, for VWAP
+    uint32_t trades;
+} Bar;
+
+typedef struct {
+    Bar pending[BAR_PENDING_BARS];  // open bars of one interval, in no particular order
+    int64_t closed_until;           // end of the last bar written; older trades are late
+} BarSeries;
+
+typedef struct {
+    BarSeries series[BAR_MAX_INTERVALS];
+    int active;                 // listed in BarExchange.active
+} BarSymbol;
+
+typedef struct {
+    pthread_mutex_t lock;
+    BarSymbol *symbols[MAX_SYMBOLS];
+    uint16_t active[MAX_SYMBOLS];   // symbol IDs with an open bar
+    int active_count;
+    int64_t max_ts_ns;              // newest trade time seen on the exchange
+    int64_t arrival_ns;             // wall-clock time of its last trade
+} BarExchange;
+
+typedef struct {
+    int64_t length_ns;
+    char label[8];              // "1s", "1m", ...
+    FILE *fp;
+    long day;                   // days since epoch of the open file
+} BarInterval;
+
+static BarExchange *exchanges[EXCHANGE_COUNT];
+static BarInterval intervals[BAR_MAX_INTERVALS];
+static int interval_count = 0;
+static char bar_dir[256];
+static int bar_enabled = 0;
+static int64_t last_flush_ns = 0;
+static BarStats stats;
+
+/* Taken after an exchange lock, never before */
+static pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Parses "1s,1m,5m" into `intervals`. Returns 0 or -1. */
+static int parse_intervals(const char *list) {
+    const char *p = list;
+    interval_count = 0;
+
+    while (*p) {
+        char *end;
+        long amount = strtol(p, &end, 10);
+        int64_t unit;
+        switch (*end) {
+            case 's': unit = 1; break;
+            case 'm': unit = 60; break;
+            case 'h': unit = 3600; break;
+            default: unit = 0; break;
+        }
+        /* amount is bounded first, so amount * unit cannot overflow and the label fits */
+        if (end == p || amount <= 0 || amount > SECONDS_PER_DAY || unit == 0 ||
+            amount * unit > SECONDS_PER_DAY || (end[1] != ',' && end[1] != '\0')) {
+            printf("[ERROR] Invalid bar interval list \"%s\" (expected e.g. 1s,1m,5m)\n", list);
+            return -1;
+        }
+        if (interval_count == BAR_MAX_INTERVALS) {
+            printf("[ERROR] At most %d bar intervals are supported\n", BAR_MAX_INTERVALS);
+            return -1;
+        }
+
+        BarInterval *interval = &intervals[interval_count++];
+        interval->length_ns = amount * unit * NS_PER_SECOND;
+        snprintf(interval->label, sizeof(interval->label), "%ld%c", amount, *end);
+        interval->fp = NULL;
+        interval->day = -1;
+
+        p = end[1] == ',' ? end + 2 : end + 1;
+    }
+
+    if (interval_count == 0) {
+        printf("[ERROR] No bar intervals given\n");
+        return -1;
+    }
+    return 0;
+}
+
+int bar_engine_open(const char *dir, const char *interval_list) {
+    if (parse_intervals(interval_list ? interval_list : BAR_DEFAULT_INTERVALS) != 0) return -1;
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        printf("[ERROR] Could not create bar directory %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    for (int i = 0; i < EXCHANGE_COUNT; i++) {
+        exchanges[i] = calloc(1, sizeof(BarExchange));
+        if (!exchanges[i]) {
+            printf("[ERROR] Failed to allocate bar state\n");
+            return -1;
+        }
+        pthread_mutex_init(&exchanges[i]->lock, NULL);
+    }
+
+    snprintf(bar_dir, sizeof(bar_dir), "%s", dir);
+    bar_enabled = 1;
+
+    char labels[64] = "";
+    for (int i = 0; i < interval_count; i++) {
+        strncat(labels, i ? "," : "", sizeof(labels) - strlen(labels) - 1);
+        strncat(labels, intervals[i].label, sizeof(labels) - strlen(labels) - 1);
+    }
+    printf("[INFO] Writing %s trade bars to %s/\n", labels, bar_dir);
+    return 0;
+}
+
+int bar_engine_enabled(void) {
+    return bar_enabled;
+}
+
+/* Output file of an interval for the day of `start_ns`, opened on demand (under output_lock) */
+static FILE *interval_file(BarInterval *interval, int64_t start_ns) {
+    long day = (long)(start_ns / NS_PER_SECOND / SECONDS_PER_DAY);
+    if (interval->fp && interval->day == day) return interval->fp;
+
+    if (interval->fp) {
+        fclose(interval->fp);
+        interval->fp = NULL;
+    }
+
+    time_t day_start = (time_t)day * SECONDS_PER_DAY;
+    struct tm tm_info;
+    gmtime_r(&day_start, &tm_info);
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/bars_%s_%04d%02d%02d.csv", bar_dir, interval->label,
+             tm_info.tm_year + 1900, tm_info.tm_mon + 1, tm_info.tm_mday);
+
+    interval->fp = fopen(path, "a");
+    if (!interval->fp) {
+        printf("[ERROR] Could not open bar file %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    interval->day = day;
+
+    if (fseek(interval->fp, 0, SEEK_END) == 0 && ftell(interval->fp) == 0)
+        fprintf(interval->fp, "start,start_ns,exchange,symbol,open,high,low,close,volume,vwap,trades\n");
+    return interval->fp;
+}
+
+/* Writes a finished bar and frees its slot (under the exchange lock) */
+static void emit_bar(uint16_t exchange_id, uint16_t symbol_id, int interval_index, BarSeries *series, Bar *bar) {
+    BarInterval *interval = &intervals[interval_index];
+    char start[40], open[32], high[32], low[32], close[32], volume[32], vwap[48] = "";
+
+    format_timestamp_ns(bar->start_ns, 1, start, sizeof(start));
+    fixed_format(bar->open, open, sizeof(open));
+    fixed_format(bar->high, high, sizeof(high));
+    fixed_format(bar->low, low, sizeof(low));
+    fixed_format(bar->close, close, sizeof(close));
+    fixed_format(bar->volume, volume, sizeof(volume));
+
+    if (FIXED_PRESENT(bar->volume) && bar->volume.value != 0) {
+        long double size = (long double)bar->volume.value;
+        for (int i = 0; i < bar->volume.scale; i++) size /= 10;
+
+        int decimals = bar->close.scale + BAR_VWAP_EXTRA_DECIMALS;
+        if (decimals > FIXED_MAX_SCALE) decimals = FIXED_MAX_SCALE;
+        snprintf(vwap, sizeof(vwap), "%.*Lf", decimals, bar->notional / size);
+    }
+
+    const char *symbol = symbol_canonical(symbol_id);
+    pthread_mutex_lock(&output_lock);
+    FILE *fp = interval_file(interval, bar->start_ns);
+    if (fp) {
+        fprintf(fp, "%s,%lld,%s,%s,%s,%s,%s,%s,%s,%s,%u\n", start, (long long)bar->start_ns,
+                exchange_name(exchange_id), symbol[0] ? symbol : symbol_name(symbol_id), open, high, low,
+                close, volume, vwap, bar->trades);
+        __atomic_add_fetch(&stats.bars, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&output_lock);
+
+    series->closed_until = bar->start_ns + interval->length_ns;
+    bar->start_ns = 0;
+    __atomic_sub_fetch(&stats.open_bars, 1, __ATOMIC_RELAXED);
+}
+
+/* Oldest open bar of a series, or NULL */
+static Bar *oldest_bar(BarSeries *series) {
+    Bar *oldest = NULL;
+    for (int k = 0; k < BAR_PENDING_BARS; k++) {
+        Bar *bar = &series->pending[k];
+        if (bar->start_ns != 0 && (!oldest || bar->start_ns < oldest->start_ns)) oldest = bar;
+    }
+    return oldest;
+}
+
+/* Open bar of `start_ns` in a series, taking a free slot (or writing out the oldest bar) for a new
+ * bucket. Returns NULL if the trade is late. */
+static Bar *series_bar(uint16_t exchange_id, uint16_t symbol_id, int interval_index, BarSeries *series,
+                       int64_t start_ns) {
+    if (start_ns < series->closed_until) return NULL;
+
+    Bar *free_bar = NULL;
+    for (int k = 0; k < BAR_PENDING_BARS; k++) {
+        Bar *bar = &series->pending[k];
+        if (bar->start_ns == start_ns) return bar;
+        if (bar->start_ns == 0 && !free_bar) free_bar = bar;
+    }
+
+    if (!free_bar) {
+        free_bar = oldest_bar(series);
+        if (start_ns < free_bar->start_ns) return NULL;    // older than every bar kept open
+        emit_bar(exchange_id, symbol_id, interval_index, series, free_bar);
+    }
+
+    free_bar->start_ns = start_ns;
+    free_bar->volume = FIXED_ABSENT;
+    free_bar->notional = 0;
+    free_bar->trades = 0;
+    __atomic_add_fetch(&stats.open_bars, 1, __ATOMIC_RELAXED);
+    return free_bar;
+}
+
+void bar_engine_trade(const TradeData *trade) {
+    if (!bar_enabled || !FIXED_PRESENT(trade->price) || trade->ts_ns <= 0) return;
+    if (trade->exchange_id >= EXCHANGE_COUNT || trade->symbol_id == 0) return;
+
+    BarExchange *exchange = exchanges[trade->exchange_id];
+    pthread_mutex_lock(&exchange->lock);
+
+    BarSymbol *symbol = exchange->symbols[trade->symbol_id];
+    if (!symbol) {
+        symbol = calloc(1, sizeof(BarSymbol));
+        if (!symbol) {
+            pthread_mutex_unlock(&exchange->lock);
+            return;
+        }
+        exchange->symbols[trade->symbol_id] = symbol;
+    }
+
+    if (trade->ts_ns > exchange->max_ts_ns) __atomic_store_n(&exchange->max_ts_ns, trade->ts_ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&exchange->arrival_ns, market_clock_ns(), __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats.trades, 1, __ATOMIC_RELAXED);
+
+    long double price = (long double)trade->price.value;
+    for (int i = 0; i < trade->price.scale; i++) price /= 10;
+    long double size = 0;
+    if (FIXED_PRESENT(trade->size)) {
+        size = (long double)trade->size.value;
+        for (int i = 0; i < trade->size.scale; i++) size /= 10;
+    }
+
+    int late = 0;
+    for (int i = 0; i < interval_count; i++) {
+        int64_t start = trade->ts_ns - trade->ts_ns % intervals[i].length_ns;
+        Bar *bar = series_bar(trade->exchange_id, trade->symbol_id, i, &symbol->series[i], start);
+        if (!bar) {
+            late = 1;
+            continue;
+        }
+
+        /* Open and close follow trade time, so a trade that arrived out of order can still set them */
+        if (bar->trades == 0) {
+            bar->open = bar->high = bar->low = bar->close = trade->price;
+            bar->open_ns = bar->close_ns = trade->ts_ns;
+        } else {
+            if (fixed_compare(trade->price, bar->high) > 0) bar->high = trade->price;
+            if (fixed_compare(trade->price, bar->low) < 0) bar->low = trade->price;
+            if (trade->ts_ns < bar->open_ns) {
+                bar->open = trade->price;
+                bar->open_ns = trade->ts_ns;
+            }
+            if (trade->ts_ns >= bar->close_ns) {
+                bar->close = trade->price;
+                bar->close_ns = trade->ts_ns;
+            }
+        }
+        bar->volume = fixed_add(bar->volume, trade->size);
+        bar->notional += price * size;
+        bar->trades++;
+    }
+    if (late) __atomic_add_fetch(&stats.late, 1, __ATOMIC_RELAXED);
+
+    if (!symbol->active) {
+        symbol->active = 1;
+        exchange->active[exchange->active_count++] = trade->symbol_id;
+    }
+    pthread_mutex_unlock(&exchange->lock);
+}
+
+/* Closes an exchange's bars that ended at or before `watermark_ns` (every bar if force) */
+static void close_bars(uint16_t exchange_id, int64_t watermark_ns, int force) {
+    BarExchange *exchange = exchanges[exchange_id];
+    pthread_mutex_lock(&exchange->lock);
+
+    int kept = 0;
+    for (int a = 0; a < exchange->active_count; a++) {
+        uint16_t symbol_id = exchange->active[a];
+        BarSymbol *symbol = exchange->symbols[symbol_id];
+        int open = 0;
+
+        for (int i = 0; i < interval_count; i++) {
+            BarSeries *series = &symbol->series[i];
+            Bar *bar;
+            /* Oldest first, so each file stays in bar order */
+            while ((bar = oldest_bar(series)) != NULL) {
+                if (!force && bar->start_ns + intervals[i].length_ns > watermark_ns) {
+                    open = 1;
+                    break;
+                }
+                emit_bar(exchange_id, symbol_id, i, series, bar);
+            }
+        }
+
+        if (open) exchange->active[kept++] = symbol_id;
+        else symbol->active = 0;
+    }
+    exchange->active_count = kept;
+    pthread_mutex_unlock(&exchange->lock);
+}
+
+void bar_engine_flush(int force) {
+    if (!bar_enabled) return;
+
+    int64_t now_ns = market_clock_ns();
+    if (!force && now_ns - last_flush_ns < BAR_FLUSH_INTERVAL_NS) return;
+    last_flush_ns = now_ns;
+
+    for (int i = 0; i < EXCHANGE_COUNT; i++) {
+        int64_t max_ts_ns = __atomic_load_n(&exchanges[i]->max_ts_ns, __ATOMIC_RELAXED);
+        int64_t watermark_ns = max_ts_ns - BAR_LATENESS_SECONDS * NS_PER_SECOND;
+        int64_t arrival_ns = __atomic_load_n(&exchanges[i]->arrival_ns, __ATOMIC_RELAXED);
+        int64_t idle_ns = max_ts_ns + (now_ns - arrival_ns) - BAR_IDLE_SECONDS * NS_PER_SECOND;
+        if (idle_ns > watermark_ns) watermark_ns = idle_ns;
+        close_bars((uint16_t)i, watermark_ns, force);
+    }
+
+    pthread_mutex_lock(&output_lock);
+    for (int i = 0; i < interval_count; i++) {
+        if (intervals[i].fp) fflush(intervals[i].fp);
+    }
+    pthread_mutex_unlock(&output_lock);
+}
+
+void bar_engine_close(void) {
+    if (!bar_enabled) return;
+
+    bar_engine_flush(1);
+    bar_enabled = 0;
+
+    for (int i = 0; i < interval_count; i++) {
+        if (intervals[i].fp) fclose(intervals[i].fp);
+        intervals[i].fp = NULL;
+    }
+    for (int i = 0; i < EXCHANGE_COUNT; i++) {
+        for (int s = 0; s < MAX_SYMBOLS; s++) free(exchanges[i]->symbols[s]);
+        pthread_mutex_destroy(&exchanges[i]->lock);
+        free(exchanges[i]);
+        exchanges[i] = NULL;
+    }
+}
+
+void bar_engine_stats(BarStats *out) {
+    out->trades = __atomic_load_n(&stats.trades, __ATOMIC_RELAXED);
+    out->bars = __atomic_load_n(&stats.bars, __ATOMIC_RELAXED);
+    out->late = __atomic_load_n(&stats.late, __ATOMIC_RELAXED);
+    out->open_bars = __atomic_load_n(&stats.open_bars, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,67 @@
+/*
+ * Bar Engine Header
+ *
+ * Declares the streaming OHLCV/VWAP bar aggregator. Every trade updates the open
+ * bar of its (exchange, symbol) for each configured interval; finished bars are
+ * appended to `<dir>/bars_<interval>_YYYYMMDD.csv`.
+ *
+ * Features:
+ *  - bar_engine_open(): Enables bars (`crypto_ws --bars DIR [--bar-intervals 1s,1m,5m]`).
+ *  - bar_engine_trade(): Folds one trade into its open bars; a no-op when disabled.
+ *  - bar_engine_flush(): Closes bars the watermark has passed and flushes the files.
+ *  - bar_engine_close(): Closes every open bar and the files.
+ *
+ * Dependencies:
+ *  - market_record.h: TradeData and Fixed helpers.
+ *
+ * Usage:
+ *  - Fed on the ingest writer threads next to log_trade_price(); flushed from the
+ *    housekeeping loop in `main.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef BAR_ENGINE_H
+#define BAR_ENGINE_H
+
+#include <stdint.h>
+
+#include "market_record.h"
+
+/* Intervals used when none are given, and the most that can be configured */
+#define BAR_DEFAULT_INTERVALS "1s,1m,5m"
+#define BAR_MAX_INTERVALS 4
+
+/* A bar closes once the exchange's newest trade time is this far past its end */
+#define BAR_LATENESS_SECONDS 2
+
+/* ...or, on an exchange that went quiet, once its trade time plus the wall time since its last
+ * trade is this far past the end */
+#define BAR_IDLE_SECONDS 10
+
+typedef struct {
+    uint64_t trades;            // trades folded into bars
+    uint64_t bars;              // bars written
+    uint64_t late;              // trades for a bar that was already written
+    uint64_t open_bars;         // bars currently open
+} BarStats;
+
+/* Starts writing bars to `dir` (created if missing) for a comma-separated interval list
+ * such as "1s,1m,5m" (units s, m, h). Returns 0 or -1. */
+int bar_engine_open(const char *dir, const char *intervals);
+
+/* Non-zero once bar_engine_open() succeeded. */
+int bar_engine_enabled(void);
+
+void bar_engine_trade(const TradeData *trade);
+
+/* Closes bars behind the watermark (at most a few times per second unless forced) and
+ * flushes the output files. `force` closes every open bar. */
+void bar_engine_flush(int force);
+
+void bar_engine_close(void);
+
+void bar_engine_stats(BarStats *stats);
+
+#endif // BAR_ENGINE_H
@@ -0,0 +1,260 @@
+/*
+ * JSON Parser Microbenchmark
+ *
+ * Compares the single-pass extract_fields() extractor against the original
+ * per-field extract_order_data()/extract_numeric() sequences used by
+ * `callback_combined()`, on captured Binance, Coinbase, Huobi and OKX payloads.
+ *
+ * Features:
+ *  - Runs each payload through both extractors for a fixed number of iterations;
+ *    the single-pass side parses straight into the fixed-point records.
+ *  - Reports ns/msg and the speedup of the single-pass extractor.
+ *  - Checks that both extractors agree on the required fields.
+ *  - Reports structural-scanner throughput (GB/s) for the scalar, SSE2 and AVX2 paths.
+ *
+ * Dependencies:
+ *  - json_parser.c, json_scan.c, exchange_fields.c, market_record.c, symbol_table.c (jansson).
+ *  - Standard C libraries (stdio, string, time).
+ *
+ * Usage:
+ *  - make bench_json_parser
+ *  - ./bench_json_parser [iterations]
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "json_parser.h"
+#include "exchange_fields.h"
+#include "json_scan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_ITERATIONS 200000
+
+/* Captured payloads (Huobi is shown after gzip decompression) */
+static const char binance_trade_msg[] =
+    "{\"e\":\"trade\",\"E\":1747064305123,\"s\":\"BTCUSDT\",\"t\":112233445,\"p\":\"104250.12000000\","
+    "\"q\":\"0.00150000\",\"T\":1747064305120,\"m\":true,\"M\":true}";
+
+static const char binance_ticker_msg[] =
+    "{\"e\":\"24hrTicker\",\"E\":1747064305456,\"s\":\"ETHUSDT\",\"p\":\"-12.34000000\",\"P\":\"-0.487\","
+    "\"w\":\"2531.20431822\",\"x\":\"2534.11000000\",\"c\":\"2521.77000000\",\"Q\":\"0.10000000\","
+    "\"b\":\"2521.50000000\",\"B\":\"1.20000000\",\"a\":\"2522.01000000\",\"A\":\"0.75000000\","
+    "\"o\":\"2534.11000000\",\"h\":\"2580.00000000\",\"l\":\"2490.00000000\",\"v\":\"1532.88310000\","
+    "\"q\":\"3880012.55210000\",\"O\":1746977905456,\"C\":1747064305456,\"F\":40021,\"L\":41833,\"n\":1813}";
+
+static const char coinbase_ticker_msg[] =
+    "{\"type\":\"ticker\",\"sequence\":95811132223,\"product_id\":\"BTC-USD\",\"price\":\"104231.51\","
+    "\"open_24h\":\"103022.01\",\"volume_24h\":\"9312.29458211\",\"low_24h\":\"102100\",\"high_24h\":\"105000\","
+    "\"volume_30d\":\"281234.11283311\",\"best_bid\":\"104231.50\",\"best_bid_size\":\"0.01821600\","
+    "\"best_ask\":\"104231.51\",\"best_ask_size\":\"0.25000000\",\"side\":\"buy\","
+    "\"time\":\"2025-05-12T15:38:25.123456Z\",\"trade_id\":812345678,\"last_size\":\"0.00012\"}";
+
+static const char huobi_ticker_msg[] =
+    "{\"ch\":\"market.btcusdt.ticker\",\"ts\":1747064305789,\"tick\":{\"open\":103010.5,\"high\":105100.0,"
+    "\"low\":102050.1,\"close\":104200.3,\"amount\":4123.5562,\"vol\":429912345.12,\"count\":812345,"
+    "\"bid\":104200.2,\"bidSize\":0.1281,\"ask\":104200.3,\"askSize\":0.0021,\"lastPrice\":104200.3,"
+    "\"lastSize\":0.0004}}";
+
+static const char okx_ticker_msg[] =
+    "{\"arg\":{\"channel\":\"tickers\",\"instId\":\"BTC-USDT\"},\"data\":[{\"instType\":\"SPOT\","
+    "\"instId\":\"BTC-USDT\",\"last\":\"104222.1\",\"lastSz\":\"0.00038\",\"askPx\":\"104222.2\","
+    "\"askSz\":\"0.71\",\"bidPx\":\"104222.1\",\"bidSz\":\"1.02\",\"open24h\":\"103100\","
+    "\"high24h\":\"105050\",\"low24h\":\"102080.3\",\"volCcy24h\":\"912345678.1\",\"vol24h\":\"8812.33\","
+    "\"ts\":\"1747064305901\",\"sodUtc0\":\"103900\",\"sodUtc8\":\"103500.2\"}]}";
+
+/* Text-field record layouts used before the fixed-point records, kept for the legacy path */
+typedef struct {
+    char price[32], currency[32], time_ms[32], timestamp[64];
+    char bid[32], ask[32], bid_qty[32], ask_qty[32];
+    char open_price[32], high_price[32], low_price[32];
+    char close_price[32], volume_24h[32], volume_30d[32], quote_volume[32];
+    char symbol[32], last_trade_time[32], last_trade_price[32], last_trade_size[32];
+    char trade_id[64], sequence[64], exchange[32];
+    char bid_whole[32], ask_whole[32], last_vol[32], vol_today[32], vwap_today[32];
+    char low_today[32], vwap_24h[32], high_today[32], open_today[32];
+} LegacyTicker;
+
+typedef struct {
+    char exchange[32], currency[32], price[32], size[32];
+    char trade_id[64], timestamp[64], market_maker[32];
+} LegacyTrade;
+
+/* Original multi-strstr sequences, copied from callback_combined() */
+static int legacy_binance_trade(const char *msg, LegacyTrade *t) {
+    return extract_order_data(msg, "\"E\":", t->timestamp, sizeof(t->timestamp)) &&
+           extract_order_data(msg, "\"s\":\"", t->currency, sizeof(t->currency)) &&
+           extract_order_data(msg, "\"p\":\"", t->price, sizeof(t->price)) &&
+           extract_order_data(msg, "\"q\":\"", t->size, sizeof(t->size)) &&
+           extract_order_data(msg, "\"t\":", t->trade_id, sizeof(t->trade_id)) &&
+           extract_order_data(msg, "\"m\":", t->market_maker, sizeof(t->market_maker));
+}
+
+static int legacy_binance_ticker(const char *in, LegacyTicker *t) {
+    if (!(extract_order_data(in, "\"E\":", t->time_ms, sizeof(t->time_ms)) &&
+          extract_order_data(in, "\"s\":\"", t->currency, sizeof(t->currency)) &&
+          extract_order_data(in, "\"c\":\"", t->price, sizeof(t->price))))
+        return 0;
+    extract_order_data(in, "\"b\":\"", t->bid, sizeof(t->bid));
+    extract_order_data(in, "\"B\":\"", t->bid_qty, sizeof(t->bid_qty));
+    extract_order_data(in, "\"a\":\"", t->ask, sizeof(t->ask));
+    extract_order_data(in, "\"A\":\"", t->ask_qty, sizeof(t->ask_qty));
+    extract_order_data(in, "\"o\":\"", t->open_price, sizeof(t->open_price));
+    extract_order_data(in, "\"h\":\"", t->high_price, sizeof(t->high_price));
+    extract_order_data(in, "\"l\":\"", t->low_price, sizeof(t->low_price));
+    extract_order_data(in, "\"v\":\"", t->volume_24h, sizeof(t->volume_24h));
+    extract_order_data(in, "\"q\":\"", t->quote_volume, sizeof(t->quote_volume));
+    extract_order_data(in, "\"t\":\"", t->last_trade_time, sizeof(t->last_trade_time));
+    extract_order_data(in, "\"p\":\"", t->last_trade_price, sizeof(t->last_trade_price));
+    extract_order_data(in, "\"C\":\"", t->close_price, sizeof(t->close_price));
+    extract_order_data(in, "\"S\":\"", t->symbol, sizeof(t->symbol));
+    return 1;
+}
+
+static int legacy_coinbase_ticker(const char *in, LegacyTicker *t) {
+    if (!(extract_order_data(in, "\"time\":\"", t->timestamp, sizeof(t->timestamp)) &&
+          extract_order_data(in, "\"product_id\":\"", t->currency, sizeof(t->currency)) &&
+          extract_order_data(in, "\"price\":\"", t->price, sizeof(t->price))))
+        return 0;
+    extract_order_data(in, "\"best_bid\":\"", t->bid, sizeof(t->bid));
+    extract_order_data(in, "\"best_ask\":\"", t->ask, sizeof(t->ask));
+    extract_order_data(in, "\"best_bid_size\":\"", t->bid_qty, sizeof(t->bid_qty));
+    extract_order_data(in, "\"best_ask_size\":\"", t->ask_qty, sizeof(t->ask_qty));
+    extract_order_data(in, "\"open_24h\":\"", t->open_price, sizeof(t->open_price));
+    extract_order_data(in, "\"high_24h\":\"", t->high_price, sizeof(t->high_price));
+    extract_order_data(in, "\"low_24h\":\"", t->low_price, sizeof(t->low_price));
+    extract_order_data(in, "\"volume_24h\":\"", t->volume_24h, sizeof(t->volume_24h));
+    extract_order_data(in, "\"volume_30d\":\"", t->volume_30d, sizeof(t->volume_30d));
+    extract_order_data(in, "\"trade_id\":", t->trade_id, sizeof(t->trade_id));
+    extract_order_data(in, "\"last_size\":\"", t->last_trade_size, sizeof(t->last_trade_size));
+    return 1;
+}
+
+static int legacy_huobi_ticker(const char *in, LegacyTicker *t) {
+    if (!(extract_numeric(in, "\"close\":", t->price, sizeof(t->price)) &&
+          extract_huobi_currency(in, t->currency, sizeof(t->currency))))
+        return 0;
+    extract_numeric(in, "\"bid\":\"", t->bid, sizeof(t->bid));
+    extract_numeric(in, "\"bidSize\":\"", t->bid_qty, sizeof(t->bid_qty));
+    extract_numeric(in, "\"ask\":\"", t->ask, sizeof(t->ask));
+    extract_numeric(in, "\"askSize\":\"", t->ask_qty, sizeof(t->ask_qty));
+    extract_numeric(in, "\"open\":\"", t->open_price, sizeof(t->open_price));
+    extract_numeric(in, "\"high\":\"", t->high_price, sizeof(t->high_price));
+    extract_numeric(in, "\"low\":\"", t->low_price, sizeof(t->low_price));
+    extract_numeric(in, "\"close\":\"", t->close_price, sizeof(t->close_price));
+    extract_numeric(in, "\"amount\":\"", t->volume_24h, sizeof(t->volume_24h));
+    extract_numeric(in, "\"ts\":", t->time_ms, sizeof(t->time_ms));
+    return 1;
+}
+
+static int legacy_okx_ticker(const char *in, LegacyTicker *t) {
+    if (!(extract_order_data(in, "\"last\":\"", t->price, sizeof(t->price)) &&
+          extract_order_data(in, "\"instId\":\"", t->currency, sizeof(t->currency))))
+        return 0;
+    extract_order_data(in, "\"bidPx\":\"", t->bid, sizeof(t->bid));
+    extract_order_data(in, "\"bidSz\":\"", t->bid_qty, sizeof(t->bid_qty));
+    extract_order_data(in, "\"askPx\":\"", t->ask, sizeof(t->ask));
+    extract_order_data(in, "\"askSz\":\"", t->ask_qty, sizeof(t->ask_qty));
+    extract_order_data(in, "\"open24h\":\"", t->open_price, sizeof(t->open_price));
+    extract_order_data(in, "\"high24h\":\"", t->high_price, sizeof(t->high_price));
+    extract_order_data(in, "\"low24h\":\"", t->low_price, sizeof(t->low_price));
+    extract_order_data(in, "\"vol24h\":\"", t->volume_24h, sizeof(t->volume_24h));
+    extract_order_data(in, "\"ts\":\"", t->timestamp, sizeof(t->timestamp));
+    return 1;
+}
+
+typedef struct {
+    const char *name;
+    const char *msg;
+    int is_trade;
+    int (*legacy)(const char *msg, void *record);
+    const FieldSpec *fields;
+    const size_t *field_count;
+} BenchCase;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+    long iterations = (argc > 1) ? atol(argv[1]) : DEFAULT_ITERATIONS;
+    if (iterations <= 0) iterations = DEFAULT_ITERATIONS;
+
+    BenchCase cases[] = {
+        { "binance trade",   binance_trade_msg,   1, (int (*)(const char *, void *))legacy_binance_trade,   binance_trade_fields,   &binance_trade_field_count },
+        { "binance ticker",  binance_ticker_msg,  0, (int (*)(const char *, void *))legacy_binance_ticker,  binance_ticker_fields,  &binance_ticker_field_count },
+        { "coinbase ticker", coinbase_ticker_msg, 0, (int (*)(const char *, void *))legacy_coinbase_ticker, coinbase_ticker_fields, &coinbase_ticker_field_count },
+        { "huobi ticker",    huobi_ticker_msg,    0, (int (*)(const char *, void *))legacy_huobi_ticker,    huobi_ticker_fields,    &huobi_ticker_field_count },
+        { "okx ticker",      okx_ticker_msg,      0, (int (*)(const char *, void *))legacy_okx_ticker,      okx_ticker_fields,      &okx_ticker_field_count },
+    };
+
+    printf("%-16s %6s %14s %14s %8s\n", "payload", "bytes", "legacy ns/msg", "single ns/msg", "speedup");
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        BenchCase *bc = &cases[c];
+        size_t len = strlen(bc->msg);
+        size_t legacy_size = bc->is_trade ? sizeof(LegacyTrade) : sizeof(LegacyTicker);
+        union {
+            LegacyTicker legacy_ticker;
+            LegacyTrade legacy_trade;
+            TickerData ticker;
+            TradeData trade;
+        } record;
+        volatile int sink = 0;
+
+        memset(&record, 0, sizeof(record));
+        double start = now_ns();
+        for (long i = 0; i < iterations; i++) {
+            memset(&record, 0, legacy_size);
+            sink += bc->legacy(bc->msg, &record);
+        }
+        double legacy_ns = (now_ns() - start) / iterations;
+
+        start = now_ns();
+        for (long i = 0; i < iterations; i++) {
+            if (bc->is_trade) trade_init(&record.trade, EXCHANGE_BINANCE);
+            else ticker_init(&record.ticker, EXCHANGE_UNKNOWN);
+            sink += extract_fields(bc->msg, len, bc->fields, *bc->field_count, &record);
+        }
+        double single_ns = (now_ns() - start) / iterations;
+
+        if (sink != 2 * iterations)
+            printf("[WARNING] %s: an extractor missed a required field\n", bc->name);
+
+        printf("%-16s %6zu %14.1f %14.1f %7.2fx\n", bc->name, len, legacy_ns, single_ns, legacy_ns / single_ns);
+    }
+
+    /* Structural scanner throughput for each implementation the CPU supports */
+    static const char *impls[] = { "scalar", "sse2", "avx2" };
+    const char *msgs[] = { binance_trade_msg, binance_ticker_msg, coinbase_ticker_msg, huobi_ticker_msg, okx_ticker_msg };
+    uint32_t positions[JSON_INDEX_STACK_CAPACITY];
+
+    printf("\n%-16s %14s %10s\n", "scanner", "ns/msg (avg)", "GB/s");
+    for (size_t k = 0; k < sizeof(impls) / sizeof(impls[0]); k++) {
+        if (json_scan_set_impl(impls[k]) != 0) continue;
+
+        size_t bytes = 0;
+        volatile size_t sink = 0;
+        double start = now_ns();
+        for (long i = 0; i < iterations; i++) {
+            for (size_t m = 0; m < sizeof(msgs) / sizeof(msgs[0]); m++) {
+                JsonIndex ix;
+                size_t len = strlen(msgs[m]);
+                json_index_build(&ix, msgs[m], len, positions, JSON_INDEX_STACK_CAPACITY);
+                sink += ix.count;
+                bytes += len;
+            }
+        }
+        double elapsed = now_ns() - start;
+        printf("%-16s %14.1f %10.2f\n", impls[k],
+               elapsed / (iterations * (double)(sizeof(msgs) / sizeof(msgs[0]))), bytes / elapsed);
+    }
+
+    return 0;
+}
@@ -0,0 +1,255 @@
+/*
+ * Capture Replay Benchmark
+ *
+ * Replays a raw frame capture recorded with `crypto_ws --capture FILE` through
+ * the same handle_exchange_message() path the live callback uses: gzip
+ * inflate (Huobi), field extraction, fixed-point normalization, the rolling
+ * JSON window append and the BSON write. No sockets are opened.
+ *
+ * Features:
+ *  - Loads the whole capture into memory first so file reads are not timed.
+ *  - Times every frame and reports, per exchange: frames, msgs/s, p50/p90/p99/max ns/msg.
+ *  - Counts heap allocations per message by wrapping malloc/calloc/realloc (glibc).
+ *  - Snapshot and BSON flushes run every FLUSH_EVERY frames, outside the timed region.
+ *  - Writes its output into a scratch directory so live data files are never touched.
+ *  - Clears the trade de-duplication tables before each loop, so later loops are not suppressed.
+ *
+ * Notes:
+ *  - Entries older than the 10-minute rolling window are not appended to the JSON
+ *    snapshot (same rule as live), so old captures time the BSON path only for JSON.
+ *
+ * Dependencies:
+ *  - Every crypto_ws module except main.c (libwebsockets is linked but not used).
+ *  - Standard C libraries (stdio, stdlib, string, time, unistd, sys/stat).
+ *
+ * Usage:
+ *  - make bench_replay
+ *  - ./bench_replay capture.cap [--loops N]
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "exchange_websocket.h"
+#include "capture.h"
+#include "utils.h"
+#include "bson_writer.h"
+#include "json_scan.h"
+#include "symbol_table.h"
+#include "inflate_stream.h"
+#include "trade_dedup.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define DEFAULT_LOOPS 1
+
+/* Frames between untimed snapshot/BSON flushes, standing in for the housekeeping loop */
+#define FLUSH_EVERY 1024
+
+/* ----------------------------- Allocation Count ----------------------------- */
+
+/* glibc entry points behind malloc; the wrappers below count and forward to them */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static unsigned long long allocation_count = 0;
+
+void *malloc(size_t size) {
+    allocation_count++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    allocation_count++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    allocation_count++;
+    return __libc_realloc(ptr, size);
+}
+
+/* ---------------------------------- Results --------------------------------- */
+
+typedef struct {
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t allocations;
+    uint64_t total_ns;
+    uint32_t *latencies;        // ns per frame, frames entries
+} ExchangeResult;
+
+/* ----------------------------------- Report --------------------------------- */
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const uint32_t *sorted, uint64_t count, double p) {
+    uint64_t index = (uint64_t)(p * (double)(count - 1));
+    return sorted[index];
+}
+
+static void print_result(const char *name, ExchangeResult *result) {
+    if (!result->frames) return;
+
+    qsort(result->latencies, result->frames, sizeof(uint32_t), compare_u32);
+    double seconds = (double)result->total_ns / 1e9;
+    printf("%-10s %10llu %12.0f %8u %8u %8u %10u %10.2f %8.1f\n", name,
+           (unsigned long long)result->frames,
+           seconds > 0 ? (double)result->frames / seconds : 0.0,
+           percentile(result->latencies, result->frames, 0.50),
+           percentile(result->latencies, result->frames, 0.90),
+           percentile(result->latencies, result->frames, 0.99),
+           result->latencies[result->frames - 1],
+           (double)result->allocations / (double)result->frames,
+           (double)result->bytes / (double)result->frames);
+}
+
+int main(int argc, char **argv) {
+    const char *capture_path = NULL;
+    int loops = DEFAULT_LOOPS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc) {
+            loops = atoi(argv[++i]);
+        } else if (!capture_path) {
+            capture_path = argv[i];
+        } else {
+            capture_path = NULL;
+            break;
+        }
+    }
+    if (!capture_path || loops <= 0) {
+        printf("[ERROR] Usage: %s CAPTURE_FILE [--loops N]\n", argv[0]);
+        return 1;
+    }
+
+    CaptureArchive capture;
+    if (capture_load(&capture, capture_path, 0) != 0) return 1;
+    if (capture.count == 0) {
+        printf("[ERROR] %s holds no frames\n", capture_path);
+        return 1;
+    }
+    printf("[INFO] Loaded %zu frames (%zu bytes) from %s\n", capture.count, capture.bytes, capture_path);
+
+    json_scan_init();
+    printf("[INFO] JSON structural scanner: %s\n", json_scan_impl_name());
+    size_t symbol_total = symbol_table_load(CURRENCY_FILES_DIR);
+    printf("[INFO] Symbol table loaded: %zu symbols\n", symbol_total);
+
+    /* Snapshots and BSON files go to a scratch directory */
+    char scratch[] = "/tmp/bench_replay.XXXXXX";
+    if (!mkdtemp(scratch) || chdir(scratch) != 0 || mkdir("bson_output", 0755) != 0) {
+        printf("[ERROR] Failed to set up scratch directory\n");
+        return 1;
+    }
+    ticker_data_file = fopen("ticker_output_data.json", "a");
+    trades_data_file = fopen("trades_output_data.json", "a");
+    if (!ticker_data_file || !trades_data_file) {
+        printf("[ERROR] Failed to open JSON output files in %s\n", scratch);
+        return 1;
+    }
+    init_json_buffers();
+
+    ExchangeResult results[EXCHANGE_COUNT];
+    memset(results, 0, sizeof(results));
+    for (size_t i = 0; i < capture.count; i++) {
+        if (capture.frames[i].header.exchange_id < EXCHANGE_COUNT)
+            results[capture.frames[i].header.exchange_id].frames++;
+    }
+    for (int e = 0; e < EXCHANGE_COUNT; e++) {
+        results[e].latencies = malloc((results[e].frames * loops + 1) * sizeof(uint32_t));
+        results[e].frames = 0;
+    }
+
+    /* One session per exchange so inflate state is reused across frames, as on a live connection */
+    SessionData sessions[EXCHANGE_COUNT];
+    memset(sessions, 0, sizeof(sessions));
+    for (int e = 0; e < EXCHANGE_COUNT; e++) {
+        sessions[e].connection = -1;
+        sessions[e].exchange_id = (uint16_t)e;
+        sessions[e].ready = 1;
+    }
+
+    uint64_t handled = 0;
+    uint64_t wall_start = now_ns();
+    for (int loop = 0; loop < loops; loop++) {
+        trade_dedup_reset();    // every loop writes the capture's trades again
+        for (size_t i = 0; i < capture.count; i++) {
+            const CaptureFrame *frame = &capture.frames[i];
+            if (frame->header.exchange_id >= EXCHANGE_COUNT) continue;
+
+            SessionData *session = &sessions[frame->header.exchange_id];
+            ExchangeResult *result = &results[frame->header.exchange_id];
+
+            unsigned long long allocations_before = allocation_count;
+            uint64_t start = now_ns();
+            handle_exchange_message(NULL, session, capture.arena + frame->offset, frame->header.len);
+            uint64_t elapsed = now_ns() - start;
+
+            result->allocations += allocation_count - allocations_before;
+            result->total_ns += elapsed;
+            result->bytes += frame->header.len;
+            result->latencies[result->frames++] = (elapsed > UINT32_MAX) ? UINT32_MAX : (uint32_t)elapsed;
+
+            if (++handled % FLUSH_EVERY == 0) {
+                flush_json_snapshots(0);
+                bson_writer_flush(0);
+            }
+        }
+    }
+    uint64_t wall_ns = now_ns() - wall_start;
+
+    flush_json_snapshots(1);
+    bson_writer_close_all();
+
+    printf("\n%-10s %10s %12s %8s %8s %8s %10s %10s %8s\n",
+           "exchange", "frames", "msgs/s", "p50 ns", "p90 ns", "p99 ns", "max ns", "allocs/msg", "bytes");
+    for (int e = 0; e < EXCHANGE_COUNT; e++)
+        print_result(exchange_name(e)[0] ? exchange_name(e) : "unknown", &results[e]);
+
+    printf("\n[INFO] %llu frames in %.3f s wall (%d loop(s)), %.0f msgs/s including flushes\n",
+           (unsigned long long)handled, (double)wall_ns / 1e9, loops,
+           (double)handled / ((double)wall_ns / 1e9));
+
+    InflateStats inflated;
+    inflate_stats(&inflated);
+    if (inflated.frames || inflated.failed) {
+        printf("[INFO] Inflate: %llu frames, ratio %.2f, %llu oversize, %llu failed, largest %llu bytes\n",
+               (unsigned long long)inflated.frames,
+               inflated.bytes_in ? (double)inflated.bytes_out / inflated.bytes_in : 0.0,
+               (unsigned long long)inflated.oversize, (unsigned long long)inflated.failed,
+               (unsigned long long)inflated.largest);
+    }
+
+    TradeDedupStats dedup;
+    trade_dedup_stats(EXCHANGE_UNKNOWN, &dedup);
+    if (dedup.suppressed)
+        printf("[INFO] Dedup: %llu duplicate trades suppressed\n", (unsigned long long)dedup.suppressed);
+    printf("[INFO] Output written to %s\n", scratch);
+
+    free_json_buffers();
+    trade_dedup_close();
+    fclose(ticker_data_file);
+    fclose(trades_data_file);
+    for (int e = 0; e < EXCHANGE_COUNT; e++) {
+        free(results[e].latencies);
+        inflate_stream_release(&sessions[e].inflate);
+    }
+    capture_archive_free(&capture);
+    return 0;
+}
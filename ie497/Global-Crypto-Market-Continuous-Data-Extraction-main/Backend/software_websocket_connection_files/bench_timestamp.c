@@ -0,0 +1,202 @@
+/*
+ * Timestamp Codec Microbenchmark
+ *
+ * Compares the timestamp codec against the sscanf()/timegm() and
+ * gmtime_r()/snprintf() round-trips it replaced, on generated Coinbase, Binance
+ * and Kraken timestamps.
+ *
+ * Features:
+ *  - Parses ISO 8601, epoch milliseconds and fractional epoch seconds with libc and with the codec.
+ *  - Formats in-order timestamps (1 ms apart, as records arrive) and random ones, which
+ *    miss the per-second cache every time.
+ *  - Reports ns/op and the speedup of the codec.
+ *  - Checks that both sides produce the same nanoseconds and the same text.
+ *
+ * Dependencies:
+ *  - timestamp_codec.c.
+ *  - Standard C libraries (stdio, stdlib, string, time).
+ *
+ * Usage:
+ *  - make bench_timestamp
+ *  - ./bench_timestamp [iterations]
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#define _GNU_SOURCE
+#include "timestamp_codec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_ITERATIONS 2000000
+#define SAMPLE_COUNT 4096            // power of two; inputs are cycled through
+#define LIBC_TEXT_SIZE 64            // room for any snprintf() output, so gcc does not warn about truncation
+
+/* 2025-05-12T15:38:25Z, around the captured payloads in bench_json_parser.c */
+#define BASE_NS 1747064305000000000LL
+
+static int64_t sequential_ns[SAMPLE_COUNT];
+static int64_t random_ns[SAMPLE_COUNT];
+static char iso_text[SAMPLE_COUNT][TS_TEXT_SIZE];
+static char ms_text[SAMPLE_COUNT][TS_TEXT_SIZE];
+static char seconds_text[SAMPLE_COUNT][TS_TEXT_SIZE];
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* ------------------------------ libc versions ------------------------------ */
+
+static int64_t libc_parse_iso(const char *text) {
+    struct tm t = {0};
+    int micros = 0;
+    if (sscanf(text, "%4d-%2d-%2dT%2d:%2d:%2d.%6d", &t.tm_year, &t.tm_mon, &t.tm_mday,
+               &t.tm_hour, &t.tm_min, &t.tm_sec, &micros) < 6)
+        return 0;
+    t.tm_year -= 1900;
+    t.tm_mon -= 1;
+    return (int64_t)timegm(&t) * TS_NS_PER_SECOND + micros * 1000LL;
+}
+
+static int64_t libc_parse_epoch_ms(const char *text) {
+    return atoll(text) * TS_NS_PER_MS;
+}
+
+static int64_t libc_parse_epoch_seconds(const char *text) {
+    char *end;
+    long long seconds = strtoll(text, &end, 10);
+    int64_t fraction_ns = 0;
+    if (*end == '.') fraction_ns = (int64_t)(strtod(end, NULL) * 1e9 + 0.5);
+    return seconds * TS_NS_PER_SECOND + fraction_ns;
+}
+
+static void libc_format(int64_t ts_ns, char *buf, size_t size) {
+    time_t seconds = (time_t)(ts_ns / TS_NS_PER_SECOND);
+    struct tm t;
+    gmtime_r(&seconds, &t);
+    snprintf(buf, size, "%04d-%02d-%02d %02d:%02d:%02d.%06d UTC",
+             t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
+             t.tm_hour, t.tm_min, t.tm_sec, (int)(ts_ns % TS_NS_PER_SECOND / 1000));
+}
+
+/* -------------------------------- Inputs ---------------------------------- */
+
+static void make_inputs(void) {
+    srand(497);
+    for (int i = 0; i < SAMPLE_COUNT; i++) {
+        sequential_ns[i] = BASE_NS + i * TS_NS_PER_MS + 123000;
+        /* Any microsecond within ~30 years of the base */
+        int64_t offset_us = ((int64_t)rand() << 31 | rand()) % (30LL * 365 * TS_SECONDS_PER_DAY * 1000000);
+        random_ns[i] = BASE_NS - offset_us * 1000;
+
+        char utc[LIBC_TEXT_SIZE];
+        libc_format(random_ns[i], utc, sizeof(utc));
+        utc[10] = 'T';
+        memcpy(utc + 26, "Z", 2);
+        memcpy(iso_text[i], utc, TS_TEXT_SIZE);
+
+        int64_t us = random_ns[i] / 1000;
+        snprintf(ms_text[i], sizeof(ms_text[i]), "%lld", (long long)(us / 1000));
+        snprintf(seconds_text[i], sizeof(seconds_text[i]), "%lld.%06lld",
+                 (long long)(us / 1000000), (long long)(us % 1000000));
+    }
+}
+
+/* ------------------------------- Benchmark -------------------------------- */
+
+typedef struct {
+    const char *name;
+    char (*text)[TS_TEXT_SIZE];
+    int64_t (*libc)(const char *);
+    int (*codec)(const char *, size_t, int64_t *);
+} ParseCase;
+
+static void report(const char *name, double libc_ns, double codec_ns) {
+    printf("%-22s %12.1f %12.1f %7.2fx\n", name, libc_ns, codec_ns, libc_ns / codec_ns);
+}
+
+static void bench_parse(const ParseCase *pc, long iterations) {
+    size_t lengths[SAMPLE_COUNT];
+    int mismatches = 0;
+    for (int i = 0; i < SAMPLE_COUNT; i++) {
+        int64_t codec_ns = 0;
+        lengths[i] = strlen(pc->text[i]);
+        if (!pc->codec(pc->text[i], lengths[i], &codec_ns) || codec_ns != pc->libc(pc->text[i]))
+            mismatches++;
+    }
+    if (mismatches)
+        printf("[WARNING] %s: %d of %d inputs parse differently\n", pc->name, mismatches, SAMPLE_COUNT);
+
+    volatile uint64_t sink = 0;
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++)
+        sink += (uint64_t)pc->libc(pc->text[i & (SAMPLE_COUNT - 1)]);
+    double libc_ns = (now_ns() - start) / iterations;
+
+    start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        int64_t ts_ns = 0;
+        size_t k = (size_t)i & (SAMPLE_COUNT - 1);
+        pc->codec(pc->text[k], lengths[k], &ts_ns);
+        sink += (uint64_t)ts_ns;
+    }
+    double codec_ns = (now_ns() - start) / iterations;
+
+    report(pc->name, libc_ns, codec_ns);
+}
+
+static void bench_format(const char *name, const int64_t *values, long iterations) {
+    char libc_buf[LIBC_TEXT_SIZE], codec_buf[TS_TEXT_SIZE];
+    int mismatches = 0;
+    for (int i = 0; i < SAMPLE_COUNT; i++) {
+        libc_format(values[i], libc_buf, sizeof(libc_buf));
+        ts_format(values[i], TS_FORMAT_UTC, codec_buf, sizeof(codec_buf));
+        mismatches += strcmp(libc_buf, codec_buf) != 0;
+    }
+    if (mismatches)
+        printf("[WARNING] %s: %d of %d timestamps format differently\n", name, mismatches, SAMPLE_COUNT);
+
+    volatile char sink = 0;
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        libc_format(values[i & (SAMPLE_COUNT - 1)], libc_buf, sizeof(libc_buf));
+        sink += libc_buf[25];
+    }
+    double libc_ns = (now_ns() - start) / iterations;
+
+    start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        ts_format(values[i & (SAMPLE_COUNT - 1)], TS_FORMAT_UTC, codec_buf, sizeof(codec_buf));
+        sink += codec_buf[25];
+    }
+    double codec_ns = (now_ns() - start) / iterations;
+
+    report(name, libc_ns, codec_ns);
+}
+
+int main(int argc, char **argv) {
+    long iterations = (argc > 1) ? atol(argv[1]) : DEFAULT_ITERATIONS;
+    if (iterations <= 0) iterations = DEFAULT_ITERATIONS;
+
+    make_inputs();
+
+    ParseCase cases[] = {
+        { "parse iso 8601",      iso_text,     libc_parse_iso,           ts_parse_iso },
+        { "parse epoch ms",      ms_text,      libc_parse_epoch_ms,      ts_parse_epoch_ms },
+        { "parse epoch seconds", seconds_text, libc_parse_epoch_seconds, ts_parse_epoch_seconds },
+    };
+
+    printf("%-22s %12s %12s %8s\n", "operation", "libc ns/op", "codec ns/op", "speedup");
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+        bench_parse(&cases[c], iterations);
+
+    bench_format("format in order", sequential_ns, iterations);
+    bench_format("format random", random_ns, iterations);
+    return 0;
+}
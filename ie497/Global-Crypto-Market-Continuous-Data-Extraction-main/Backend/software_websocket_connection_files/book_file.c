@@ -0,0 +1,226 @@
+/*
+ * Book File
+ *
+ * This module implements the level codec and the sequential reader of the
+ * order book snapshot files described in `book_file.h`. Like `tick_archive.c`
+ * it has no dependency on the rest of `crypto_ws`, so `book_query` links it on
+ * its own.
+ *
+ * Features:
+ *  - Best price as a zigzag delta from the previous snapshot, deeper levels as distances.
+ *  - Reader keeps the per-symbol best prices needed to decode any later snapshot.
+ *
+ * Dependencies:
+ *  - Standard C libraries (stdio, stdlib, string).
+ *
+ * Usage:
+ *  - Linked into `crypto_ws` (through `order_book.c`) and into `book_query`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "book_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static size_t put_varint(uint8_t *out, uint64_t value) {
+    size_t len = 0;
+    while (value >= 0x80) {
+        out[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[len++] = (uint8_t)value;
+    return len;
+}
+
+/* Returns the bytes read, or 0 if the varint runs past `len` */
+static size_t get_varint(const uint8_t *data, size_t len, uint64_t *value) {
+    uint64_t result = 0;
+    for (size_t i = 0; i < len && i < 10; i++) {
+        result |= (uint64_t)(data[i] & 0x7F) << (7 * i);
+        if (!(data[i] & 0x80)) {
+            *value = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+size_t book_encode_levels(uint8_t *out, const int64_t *price, const int64_t *qty, int count, int ask,
+                          int64_t *previous_best) {
+    size_t len = 0;
+    for (int i = 0; i < count; i++) {
+        if (i == 0) {
+            len += put_varint(out + len, zigzag((int64_t)((uint64_t)price[0] - (uint64_t)*previous_best)));
+            *previous_best = price[0];
+        } else {
+            uint64_t distance = ask ? (uint64_t)price[i] - (uint64_t)price[i - 1]
+                                    : (uint64_t)price[i - 1] - (uint64_t)price[i];
+            len += put_varint(out + len, distance);
+        }
+        len += put_varint(out + len, (uint64_t)qty[i]);
+    }
+    return len;
+}
+
+size_t book_decode_levels(const uint8_t *data, size_t len, int count, int ask, int64_t *previous_best,
+                          BookSideLevels *side) {
+    size_t used = 0;
+    int64_t price = *previous_best;
+    for (int i = 0; i < count; i++) {
+        uint64_t encoded, qty;
+        size_t n = get_varint(data + used, len - used, &encoded);
+        if (n == 0) return 0;
+        used += n;
+        n = get_varint(data + used, len - used, &qty);
+        if (n == 0) return 0;
+        used += n;
+
+        if (i == 0) {
+            price = (int64_t)((uint64_t)price + (uint64_t)unzigzag(encoded));
+            *previous_best = price;
+        } else {
+            price = ask ? (int64_t)((uint64_t)price + encoded) : (int64_t)((uint64_t)price - encoded);
+        }
+        if (side && i < BOOK_FILE_MAX_LEVELS) {
+            side->price[i] = price;
+            side->qty[i] = (int64_t)qty;
+        }
+    }
+    if (side) side->count = count < BOOK_FILE_MAX_LEVELS ? count : BOOK_FILE_MAX_LEVELS;
+    return used;
+}
+
+int book_reader_open(BookReader *reader, const char *path) {
+    memset(reader, 0, sizeof(*reader));
+    reader->file = fopen(path, "rb");
+    if (!reader->file) {
+        fprintf(stderr, "[ERROR] Could not open book file %s\n", path);
+        return -1;
+    }
+    setvbuf(reader->file, NULL, _IOFBF, 1 << 20);
+
+    if (fread(&reader->header, sizeof(reader->header), 1, reader->file) != 1 ||
+        memcmp(reader->header.magic, BOOK_FILE_MAGIC, BOOK_FILE_MAGIC_LENGTH) != 0 ||
+        reader->header.version != BOOK_FILE_VERSION) {
+        fprintf(stderr, "[ERROR] %s is not a version %d book file\n", path, BOOK_FILE_VERSION);
+        fclose(reader->file);
+        reader->file = NULL;
+        return -1;
+    }
+    reader->header.exchange[sizeof(reader->header.exchange) - 1] = '\0';
+    return 0;
+}
+
+/* Makes room for dictionary index `symbol` in the name and best price arrays */
+static int grow_symbols(BookReader *reader, uint16_t symbol) {
+    if (symbol < reader->name_count) return 0;
+
+    size_t count = (size_t)symbol + 1;
+    void *names = realloc(reader->names, count * sizeof(*reader->names));
+    if (!names) return -1;
+    reader->names = names;
+    void *best = realloc(reader->last_best, count * sizeof(*reader->last_best));
+    if (!best) return -1;
+    reader->last_best = best;
+
+    memset(reader->names + reader->name_count, 0, (count - reader->name_count) * sizeof(*reader->names));
+    memset(reader->last_best + reader->name_count, 0, (count - reader->name_count) * sizeof(*reader->last_best));
+    reader->name_count = count;
+    return 0;
+}
+
+static int read_dict_entry(BookReader *reader, uint32_t magic) {
+    BookDictEntry entry;
+    entry.magic = magic;
+    if (fread((char *)&entry + sizeof(magic), sizeof(entry) - sizeof(magic), 1, reader->file) != 1) return -1;
+    if (grow_symbols(reader, entry.symbol) != 0) return -1;
+
+    char *name = reader->names[entry.symbol];
+    size_t keep = entry.name_len > BOOK_FILE_MAX_NAME ? BOOK_FILE_MAX_NAME : entry.name_len;
+    if (fread(name, 1, keep, reader->file) != keep) return -1;
+    name[keep] = '\0';
+    if (entry.name_len > keep && fseeko(reader->file, entry.name_len - keep, SEEK_CUR) != 0) return -1;
+
+    /* A writer that (re)assigns an index starts its best prices over */
+    reader->last_best[entry.symbol][0] = reader->last_best[entry.symbol][1] = 0;
+    return 0;
+}
+
+int book_reader_next(BookReader *reader) {
+    for (;;) {
+        uint32_t magic;
+        if (fread(&magic, sizeof(magic), 1, reader->file) != 1) return feof(reader->file) ? 0 : -1;
+
+        if (magic == BOOK_DICT_MAGIC) {
+            if (read_dict_entry(reader, magic) != 0) return -1;
+            continue;
+        }
+        if (magic != BOOK_SNAPSHOT_MAGIC) return -1;
+
+        BookSnapshotHeader *snapshot = &reader->snapshot;
+        snapshot->magic = magic;
+        if (fread((char *)snapshot + sizeof(magic), sizeof(*snapshot) - sizeof(magic), 1, reader->file) != 1)
+            return -1;
+        if (snapshot->symbol >= reader->name_count || snapshot->bid_count > BOOK_FILE_MAX_LEVELS ||
+            snapshot->ask_count > BOOK_FILE_MAX_LEVELS ||
+            snapshot->data_len > BOOK_ENCODED_MAX(snapshot->bid_count + snapshot->ask_count))
+            return -1;
+
+        if (snapshot->data_len > reader->data_capacity) {
+            uint8_t *data = realloc(reader->data, snapshot->data_len);
+            if (!data) return -1;
+            reader->data = data;
+            reader->data_capacity = snapshot->data_len;
+        }
+        if (fread(reader->data, 1, snapshot->data_len, reader->file) != snapshot->data_len) return -1;
+        reader->bytes_read += sizeof(*snapshot) + snapshot->data_len;
+
+        /* Move the symbol's best prices on, whether or not the caller decodes this one */
+        int64_t *best = reader->last_best[snapshot->symbol];
+        reader->base_best[0] = best[0];
+        reader->base_best[1] = best[1];
+        size_t used = book_decode_levels(reader->data, snapshot->data_len, snapshot->bid_count, 0, &best[0], NULL);
+        if (used == 0 && snapshot->bid_count) return -1;
+        if (snapshot->ask_count &&
+            book_decode_levels(reader->data + used, snapshot->data_len - used, snapshot->ask_count, 1, &best[1], NULL) == 0)
+            return -1;
+        return 1;
+    }
+}
+
+int book_reader_levels(BookReader *reader, BookSideLevels *bids, BookSideLevels *asks) {
+    const BookSnapshotHeader *snapshot = &reader->snapshot;
+    int64_t best[2] = { reader->base_best[0], reader->base_best[1] };
+
+    bids->count = asks->count = 0;
+    size_t used = book_decode_levels(reader->data, snapshot->data_len, snapshot->bid_count, 0, &best[0], bids);
+    if (used == 0 && snapshot->bid_count) return -1;
+    if (snapshot->ask_count &&
+        book_decode_levels(reader->data + used, snapshot->data_len - used, snapshot->ask_count, 1, &best[1], asks) == 0)
+        return -1;
+    return 0;
+}
+
+const char *book_reader_symbol(const BookReader *reader, uint16_t symbol) {
+    return symbol < reader->name_count ? reader->names[symbol] : "";
+}
+
+void book_reader_close(BookReader *reader) {
+    if (reader->file) fclose(reader->file);
+    free(reader->names);
+    free(reader->last_best);
+    free(reader->data);
+    memset(reader, 0, sizeof(*reader));
+}
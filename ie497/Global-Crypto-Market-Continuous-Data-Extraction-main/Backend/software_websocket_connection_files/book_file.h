@@ -0,0 +1,136 @@
+/*
+ * Book File Header
+ *
+ * Declares the order book snapshot file format shared by the writer in
+ * `crypto_ws` (`order_book.c`) and the `book_query` reader. One file holds the
+ * periodic top-of-book snapshots of one (exchange, UTC day).
+ *
+ * File layout (host byte order, like capture files):
+ *  - BookFileHeader (magic "CWSOBK01").
+ *  - Repeated records, each starting with a uint32 magic:
+ *      BOOK_DICT_MAGIC:     BookDictEntry + `name_len` bytes; gives a symbol its file index.
+ *      BOOK_SNAPSHOT_MAGIC: BookSnapshotHeader + `data_len` bytes of encoded levels.
+ *
+ * Level encoding (LEB128 varints, bids then asks, best level first):
+ *  - The best price of a side is a zigzag varint of its difference from the same side's
+ *    best price in the symbol's previous snapshot since its dictionary entry (0 before the
+ *    first). A writer appending to an existing file writes new dictionary entries.
+ *  - Each further price is the plain varint distance from the level before it, away
+ *    from the top of the book (bids falling, asks rising): usually one byte.
+ *  - Each quantity is a plain varint. Prices and quantities are integers at the
+ *    snapshot's `price_scale` / `qty_scale`.
+ *
+ * Features:
+ *  - book_encode_levels() / book_decode_levels(): The level codec.
+ *  - BookReader: Walks snapshots; only the ones asked for are decoded into levels (the
+ *    others are read, since each best price is relative to the one before).
+ *
+ * Dependencies:
+ *  - Standard C libraries (stdio.h, stddef.h, stdint.h).
+ *
+ * Usage:
+ *  - Written by `order_book.c` (`crypto_ws --books DIR`); read by `book_query.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef BOOK_FILE_H
+#define BOOK_FILE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BOOK_FILE_MAGIC "CWSOBK01"
+#define BOOK_FILE_MAGIC_LENGTH 8
+#define BOOK_FILE_VERSION 1
+
+#define BOOK_DICT_MAGIC 0x4B4F4244u        // "DBOK"
+#define BOOK_SNAPSHOT_MAGIC 0x4B4F4253u    // "SBOK"
+
+/* Most levels per side a snapshot can hold */
+#define BOOK_FILE_MAX_LEVELS 1000
+
+/* Longest symbol name stored in the dictionary */
+#define BOOK_FILE_MAX_NAME 63
+
+/* Worst-case encoded size of `levels` levels (two 10-byte varints each) */
+#define BOOK_ENCODED_MAX(levels) ((size_t)(levels) * 20)
+
+typedef struct {
+    char magic[BOOK_FILE_MAGIC_LENGTH];
+    uint16_t exchange_id;       // ExchangeId
+    uint8_t version;            // BOOK_FILE_VERSION
+    uint8_t reserved;
+    uint32_t reserved2;
+    char exchange[16];          // display name, NUL-padded
+} BookFileHeader;
+
+typedef struct {
+    uint32_t magic;             // BOOK_DICT_MAGIC
+    uint16_t symbol;            // index used by later snapshots of this file
+    uint8_t name_len;
+    uint8_t reserved;
+} BookDictEntry;
+
+typedef struct {
+    uint32_t magic;             // BOOK_SNAPSHOT_MAGIC
+    uint16_t symbol;            // dictionary index
+    int8_t price_scale;
+    int8_t qty_scale;
+    int64_t ts_ns;              // exchange time of the last update in the snapshot, epoch ns
+    uint64_t sequence;          // exchange sequence number of that update, 0 if none
+    uint16_t bid_count;
+    uint16_t ask_count;
+    uint32_t data_len;          // encoded level bytes that follow
+} BookSnapshotHeader;
+
+/* One side of a book, best level first */
+typedef struct {
+    int64_t price[BOOK_FILE_MAX_LEVELS];
+    int64_t qty[BOOK_FILE_MAX_LEVELS];
+    int count;
+} BookSideLevels;
+
+/* Sequential reader; the current snapshot's header is in `snapshot` */
+typedef struct {
+    FILE *file;
+    BookFileHeader header;
+    char (*names)[BOOK_FILE_MAX_NAME + 1];  // dictionary, indexed by snapshot symbol
+    size_t name_count;
+    int64_t (*last_best)[2];                // latest best bid/ask per symbol
+    BookSnapshotHeader snapshot;
+    int64_t base_best[2];                   // best bid/ask the current snapshot is relative to
+    uint8_t *data;                          // encoded levels of the current snapshot
+    size_t data_capacity;
+    uint64_t bytes_read;
+} BookReader;
+
+/* Encodes one side (best level first) into `out`, which must hold BOOK_ENCODED_MAX(count) bytes.
+ * `previous_best` is the side's best price in the symbol's last snapshot (0 for the first); it is
+ * updated. `ask` selects the direction of the distances. Returns the bytes written. */
+size_t book_encode_levels(uint8_t *out, const int64_t *price, const int64_t *qty, int count, int ask,
+                          int64_t *previous_best);
+
+/* Decodes `count` levels from `data` into `side` (NULL only walks them to update `previous_best`).
+ * Returns the bytes consumed, or 0 on a truncated buffer. */
+size_t book_decode_levels(const uint8_t *data, size_t len, int count, int ask, int64_t *previous_best,
+                          BookSideLevels *side);
+
+/* Opens a snapshot file and checks its header. Returns 0 or -1. */
+int book_reader_open(BookReader *reader, const char *path);
+
+/* Advances to the next snapshot (dictionary entries are absorbed on the way).
+ * Returns 1 with the snapshot header loaded, 0 at the end of the file, or -1 on a corrupt file. */
+int book_reader_next(BookReader *reader);
+
+/* Decodes the current snapshot's levels. Returns 0 or -1. */
+int book_reader_levels(BookReader *reader, BookSideLevels *bids, BookSideLevels *asks);
+
+/* Symbol name of a dictionary index, "" if unknown. */
+const char *book_reader_symbol(const BookReader *reader, uint16_t symbol);
+
+void book_reader_close(BookReader *reader);
+
+#endif // BOOK_FILE_H
@@ -0,0 +1,238 @@
+/*
+ * Book Query
+ *
+ * Command-line reader for the order book snapshot files written by
+ * `crypto_ws --books DIR`. It prints the snapshots of a symbol, or the book
+ * of each symbol as it stood at a given time.
+ *
+ * Features:
+ *  - Default: CSV `timestamp_ns,symbol,sequence,side,level,price,qty` of every snapshot.
+ *  - `--at TIME`: Only the last snapshot of each symbol at or before TIME.
+ *  - `--depth N`: Levels per side printed (all stored levels by default).
+ *  - `--stats`: No per-level output; snapshot counts, bytes per snapshot and read throughput.
+ *  - Snapshots of other symbols are read but not decoded.
+ *
+ * Dependencies:
+ *  - book_file.c.
+ *  - Standard C libraries (stdio, stdlib, string, time).
+ *
+ * Usage:
+ *  make book_query
+ *  ./book_query FILE... [--symbol NAME] [--at TIME] [--depth N] [--stats]
+ *  TIME is epoch nanoseconds or UTC "YYYY-MM-DDTHH:MM:SS".
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#define _GNU_SOURCE
+#include "book_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+typedef struct {
+    const char *symbol;
+    int64_t at_ns;
+    int at;
+    int depth;
+    int stats;
+} QueryOptions;
+
+/* Latest snapshot of one symbol at or before `--at` */
+typedef struct {
+    char exchange[16];
+    char symbol[BOOK_FILE_MAX_NAME + 1];
+    BookSnapshotHeader snapshot;
+    BookSideLevels bids;
+    BookSideLevels asks;
+} AtBook;
+
+typedef struct {
+    uint64_t snapshots;
+    uint64_t matched;
+    uint64_t levels;
+    uint64_t bytes_read;
+    uint64_t file_bytes;
+    AtBook *books;
+    size_t book_count;
+} QueryTotals;
+
+static BookSideLevels bids, asks;
+
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Epoch nanoseconds, or a UTC "YYYY-MM-DDTHH:MM:SS" time */
+static int parse_time(const char *text, int64_t *out) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char *end = strptime(text, "%Y-%m-%dT%H:%M:%S", &tm);
+    if (end && (*end == '\0' || strcmp(end, "Z") == 0)) {
+        *out = (int64_t)timegm(&tm) * 1000000000LL;
+        return 0;
+    }
+
+    char *rest;
+    long long value = strtoll(text, &rest, 10);
+    if (*text == '\0' || *rest != '\0') return -1;
+    *out = value;
+    return 0;
+}
+
+/* value / 10^scale as text */
+static void format_fixed(int64_t value, int scale, char *buf, size_t size) {
+    if (scale <= 0 || scale > 18) {
+        snprintf(buf, size, "%lld", (long long)value);
+        return;
+    }
+
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    unsigned long long divisor = 1;
+    for (int i = 0; i < scale; i++) divisor *= 10;
+    snprintf(buf, size, "%s%llu.%0*llu", value < 0 ? "-" : "", magnitude / divisor, scale, magnitude % divisor);
+}
+
+static void print_side(const char *symbol, const BookSnapshotHeader *snapshot, const BookSideLevels *side,
+                       const char *name, int depth) {
+    for (int i = 0; i < side->count && (depth <= 0 || i < depth); i++) {
+        char price[48], qty[48];
+        format_fixed(side->price[i], snapshot->price_scale, price, sizeof(price));
+        format_fixed(side->qty[i], snapshot->qty_scale, qty, sizeof(qty));
+        printf("%lld,%s,%llu,%s,%d,%s,%s\n", (long long)snapshot->ts_ns, symbol,
+               (unsigned long long)snapshot->sequence, name, i, price, qty);
+    }
+}
+
+static AtBook *at_book(QueryTotals *totals, const char *exchange, const char *symbol) {
+    for (size_t i = 0; i < totals->book_count; i++) {
+        if (strcmp(totals->books[i].exchange, exchange) == 0 && strcmp(totals->books[i].symbol, symbol) == 0)
+            return &totals->books[i];
+    }
+
+    AtBook *grown = realloc(totals->books, (totals->book_count + 1) * sizeof(AtBook));
+    if (!grown) return NULL;
+    totals->books = grown;
+    AtBook *book = &totals->books[totals->book_count++];
+    memset(book, 0, sizeof(*book));
+    snprintf(book->exchange, sizeof(book->exchange), "%s", exchange);
+    snprintf(book->symbol, sizeof(book->symbol), "%s", symbol);
+    return book;
+}
+
+static int scan_file(const char *path, const QueryOptions *options, QueryTotals *totals) {
+    BookReader reader;
+    if (book_reader_open(&reader, path) != 0) return -1;
+
+    struct stat st;
+    if (stat(path, &st) == 0) totals->file_bytes += (uint64_t)st.st_size;
+
+    int result;
+    while ((result = book_reader_next(&reader)) > 0) {
+        const BookSnapshotHeader *snapshot = &reader.snapshot;
+        const char *symbol = book_reader_symbol(&reader, snapshot->symbol);
+        totals->snapshots++;
+        if ((options->symbol && strcmp(symbol, options->symbol) != 0) ||
+            (options->at && snapshot->ts_ns > options->at_ns))
+            continue;
+
+        totals->matched++;
+        totals->levels += (uint64_t)snapshot->bid_count + snapshot->ask_count;
+        if (options->stats) continue;
+
+        if (options->at) {
+            AtBook *book = at_book(totals, reader.header.exchange, symbol);
+            if (!book) {
+                result = -1;
+                break;
+            }
+            if (book->snapshot.magic && snapshot->ts_ns < book->snapshot.ts_ns) continue;
+            if (book_reader_levels(&reader, &book->bids, &book->asks) != 0) {
+                result = -1;
+                break;
+            }
+            book->snapshot = *snapshot;
+            continue;
+        }
+
+        if (book_reader_levels(&reader, &bids, &asks) != 0) {
+            result = -1;
+            break;
+        }
+        print_side(symbol, snapshot, &bids, "bid", options->depth);
+        print_side(symbol, snapshot, &asks, "ask", options->depth);
+    }
+
+    totals->bytes_read += reader.bytes_read;
+    book_reader_close(&reader);
+    if (result < 0) fprintf(stderr, "[ERROR] %s is corrupt or truncated\n", path);
+    return result < 0 ? -1 : 0;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "[ERROR] Usage: %s FILE... [--symbol NAME] [--at TIME] [--depth N] [--stats]\n", program);
+}
+
+int main(int argc, char **argv) {
+    QueryOptions options = { NULL, 0, 0, 0, 0 };
+    const char **files = calloc((size_t)argc, sizeof(char *));
+    int file_count = 0;
+    if (!files) return 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stats") == 0) {
+            options.stats = 1;
+        } else if (strcmp(argv[i], "--symbol") == 0 && i + 1 < argc) {
+            options.symbol = argv[++i];
+        } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            options.depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--at") == 0 && i + 1 < argc) {
+            if (parse_time(argv[++i], &options.at_ns) != 0) { usage(argv[0]); return 1; }
+            options.at = 1;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            files[file_count++] = argv[i];
+        }
+    }
+    if (file_count == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    QueryTotals totals;
+    memset(&totals, 0, sizeof(totals));
+    int status = 0;
+    int64_t start = monotonic_ns();
+    if (!options.stats) printf("timestamp_ns,symbol,sequence,side,level,price,qty\n");
+    for (int i = 0; i < file_count; i++) status |= scan_file(files[i], &options, &totals) != 0;
+    double seconds = (double)(monotonic_ns() - start) / 1e9;
+
+    for (size_t i = 0; i < totals.book_count; i++) {
+        const AtBook *book = &totals.books[i];
+        print_side(book->symbol, &book->snapshot, &book->bids, "bid", options.depth);
+        print_side(book->symbol, &book->snapshot, &book->asks, "ask", options.depth);
+    }
+
+    if (options.stats) {
+        printf("%llu of %llu snapshots, %.1f levels per snapshot, %.1f bytes per snapshot\n",
+               (unsigned long long)totals.matched, (unsigned long long)totals.snapshots,
+               totals.matched ? (double)totals.levels / (double)totals.matched : 0.0,
+               totals.snapshots ? (double)totals.bytes_read / (double)totals.snapshots : 0.0);
+        printf("%.1f MB of %.1f MB read in %.3f s (%.0f MB/s, %.0f snapshots/s)\n",
+               (double)totals.bytes_read / 1e6, (double)totals.file_bytes / 1e6, seconds,
+               seconds > 0 ? (double)totals.file_bytes / 1e6 / seconds : 0.0,
+               seconds > 0 ? (double)totals.snapshots / seconds : 0.0);
+    }
+
+    free(totals.books);
+    free(files);
+    return status;
+}
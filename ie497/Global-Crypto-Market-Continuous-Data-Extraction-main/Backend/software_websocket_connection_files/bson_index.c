@@ -0,0 +1,423 @@
+/*
+ * BSON Index
+ *
+ * This module builds and reads the block index kept next to each daily BSON
+ * output file (format in `bson_index.h`). Without it, finding one symbol's
+ * documents for a few minutes means decoding the whole day's file.
+ *
+ * Features:
+ *  - Incremental: `bson_writer.c` reports every appended document; a block entry
+ *    is written once a block holds BSON_INDEX_BLOCK_BYTES of documents, and the
+ *    unfinished block is written when the file is closed.
+ *  - Each entry keeps the block's time range and a Bloom filter of its symbols,
+ *    so a query skips blocks for other symbols or outside its time range.
+ *  - The reader maps both files; ranges without an entry are walked document by document.
+ *  - Backfill: bson_index_rebuild() indexes files written before the index existed.
+ *  - Only the `currency` and `timestamp` strings are looked up in a document; nothing
+ *    else is decoded, and libbson is not needed to read.
+ *
+ * Dependencies:
+ *  - market_record.h: parse_time_iso_field().
+ *  - Standard C libraries (stdio, stdlib, string, errno) and POSIX mmap.
+ *
+ * Usage:
+ *  - Builder calls come from `bson_writer.c` under its sink lock.
+ *  - `bson_lookup` queries and backfills indexes from the command line.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "bson_index.h"
+#include "market_record.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Smallest valid BSON document: length + terminating NUL */
+#define BSON_MIN_DOCUMENT 5
+
+/* ------------------------------ Helpers ------------------------------ */
+
+static uint32_t read_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/* FNV-1a over the symbol bytes */
+static uint64_t symbol_hash(const char *symbol, size_t len) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)symbol[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* Bloom probe `i` for a hash (double hashing) */
+static uint32_t bloom_bit(uint64_t hash, int i) {
+    uint64_t step = (hash >> 32) | 1;
+    return (uint32_t)((hash + (uint64_t)i * step) % BSON_INDEX_BLOOM_BITS);
+}
+
+static void bloom_add(BsonIndexEntry *entry, uint64_t hash) {
+    for (int i = 0; i < BSON_INDEX_HASHES; i++) {
+        uint32_t bit = bloom_bit(hash, i);
+        entry->bloom[bit / 64] |= 1ULL << (bit % 64);
+    }
+}
+
+static int bloom_test(const BsonIndexEntry *entry, uint64_t hash) {
+    for (int i = 0; i < BSON_INDEX_HASHES; i++) {
+        uint32_t bit = bloom_bit(hash, i);
+        if (!(entry->bloom[bit / 64] & (1ULL << (bit % 64)))) return 0;
+    }
+    return 1;
+}
+
+static void index_path(const char *bson_path, char *buf, size_t size) {
+    snprintf(buf, size, "%s%s", bson_path, BSON_INDEX_SUFFIX);
+}
+
+static int header_valid(const BsonIndexHeader *header) {
+    return memcmp(header->magic, BSON_INDEX_MAGIC, BSON_INDEX_MAGIC_LENGTH) == 0 &&
+           header->version == BSON_INDEX_VERSION &&
+           header->bloom_bits == BSON_INDEX_BLOOM_BITS &&
+           header->hashes == BSON_INDEX_HASHES;
+}
+
+static int write_header(FILE *fp) {
+    BsonIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BSON_INDEX_MAGIC, BSON_INDEX_MAGIC_LENGTH);
+    header.block_bytes = BSON_INDEX_BLOCK_BYTES;
+    header.bloom_bits = BSON_INDEX_BLOOM_BITS;
+    header.hashes = BSON_INDEX_HASHES;
+    header.version = BSON_INDEX_VERSION;
+    return fwrite(&header, sizeof(header), 1, fp) == 1 ? 0 : -1;
+}
+
+/* Size of the value of a BSON element of `type` at `p`, or -1 if unknown or out of bounds */
+static long element_size(uint8_t type, const uint8_t *p, size_t remaining) {
+    switch (type) {
+        case 0x01: case 0x09: case 0x11: case 0x12: return 8;        // double, datetime, timestamp, int64
+        case 0x13: return 16;                                        // decimal128
+        case 0x07: return 12;                                        // ObjectId
+        case 0x08: return 1;                                         // bool
+        case 0x10: return 4;                                         // int32
+        case 0x06: case 0x0A: case 0x7F: case 0xFF: return 0;        // undefined, null, max/min key
+        case 0x02: case 0x0D: case 0x0E:                             // string, code, symbol
+            return remaining < 4 ? -1 : 4 + (long)read_le32(p);
+        case 0x03: case 0x04: case 0x0F:                             // document, array, code with scope
+            return remaining < 4 ? -1 : (long)read_le32(p);
+        case 0x05:                                                   // binary
+            return remaining < 4 ? -1 : 5 + (long)read_le32(p);
+        case 0x0C:                                                   // DBPointer
+            return remaining < 4 ? -1 : 4 + (long)read_le32(p) + 12;
+        case 0x0B: {                                                 // regex: two C strings
+            const uint8_t *end = memchr(p, 0, remaining);
+            if (!end) return -1;
+            const uint8_t *second = memchr(end + 1, 0, remaining - (size_t)(end + 1 - p));
+            return second ? (long)(second + 1 - p) : -1;
+        }
+        default:
+            return -1;
+    }
+}
+
+int bson_index_find_string(const uint8_t *doc, uint32_t len, const char *key,
+                           const char **value, uint32_t *value_len) {
+    size_t pos = 4;
+    while (pos < len) {
+        uint8_t type = doc[pos++];
+        if (type == 0x00) return 0;
+
+        const uint8_t *name = doc + pos;
+        const uint8_t *name_end = memchr(name, 0, len - pos);
+        if (!name_end) return 0;
+        pos = (size_t)(name_end + 1 - doc);
+
+        long size = element_size(type, doc + pos, len - pos);
+        if (size < 0 || (size_t)size > len - pos) return 0;
+
+        if (type == 0x02 && strcmp((const char *)name, key) == 0) {
+            uint32_t string_len = read_le32(doc + pos);
+            if (string_len < 1) return 0;
+            *value = (const char *)doc + pos + 4;
+            *value_len = string_len - 1;
+            return 1;
+        }
+        pos += (size_t)size;
+    }
+    return 0;
+}
+
+/* ------------------------------ Builder ------------------------------ */
+
+static void finish_block(BsonIndexBuilder *builder) {
+    if (!builder->block.docs) return;
+
+    if (fwrite(&builder->block, sizeof(builder->block), 1, builder->fp) != 1) {
+        printf("[ERROR] Failed to write BSON index entry: %s\n", strerror(errno));
+        fclose(builder->fp);
+        builder->fp = NULL;
+    }
+    builder->block.docs = 0;
+}
+
+int bson_index_open(BsonIndexBuilder *builder, const char *bson_path) {
+    char path[256];
+    index_path(bson_path, path, sizeof(path));
+    memset(builder, 0, sizeof(*builder));
+
+    /* Keep the entries of an earlier run today; drop a torn last entry */
+    FILE *fp = fopen(path, "r+b");
+    if (fp) {
+        BsonIndexHeader header;
+        struct stat st;
+        if (fread(&header, sizeof(header), 1, fp) == 1 && header_valid(&header) && fstat(fileno(fp), &st) == 0) {
+            off_t entries = (st.st_size - (off_t)sizeof(header)) / (off_t)sizeof(BsonIndexEntry);
+            off_t end = (off_t)sizeof(header) + entries * (off_t)sizeof(BsonIndexEntry);
+            if ((end == st.st_size || ftruncate(fileno(fp), end) == 0) && fseeko(fp, end, SEEK_SET) == 0) {
+                builder->fp = fp;
+                return 0;
+            }
+        }
+        fclose(fp);
+    }
+
+    fp = fopen(path, "wb");
+    if (!fp || write_header(fp) != 0) {
+        printf("[ERROR] Failed to create BSON index %s: %s\n", path, strerror(errno));
+        if (fp) fclose(fp);
+        return -1;
+    }
+    builder->fp = fp;
+    return 0;
+}
+
+void bson_index_add(BsonIndexBuilder *builder, uint64_t offset, uint32_t len, int64_t ts_ns,
+                    const char *symbol, size_t symbol_len) {
+    if (!builder->fp) return;
+
+    BsonIndexEntry *block = &builder->block;
+    if (block->docs && offset != block->offset + block->length) finish_block(builder);
+    if (!builder->fp) return;
+
+    if (!block->docs) {
+        memset(block, 0, sizeof(*block));
+        block->offset = offset;
+        block->ts_min = INT64_MAX;
+        block->ts_max = INT64_MIN;
+    }
+
+    /* Documents carry microseconds; index what a reader will parse back */
+    ts_ns -= ts_ns % 1000;
+    if (ts_ns < block->ts_min) block->ts_min = ts_ns;
+    if (ts_ns > block->ts_max) block->ts_max = ts_ns;
+    bloom_add(block, symbol_hash(symbol, symbol_len));
+    block->length += len;
+    block->docs++;
+
+    if (block->length >= BSON_INDEX_BLOCK_BYTES) finish_block(builder);
+}
+
+void bson_index_flush(BsonIndexBuilder *builder) {
+    if (builder->fp && fflush(builder->fp) != 0)
+        printf("[ERROR] Failed to flush BSON index: %s\n", strerror(errno));
+}
+
+void bson_index_close(BsonIndexBuilder *builder) {
+    if (!builder->fp) return;
+
+    finish_block(builder);
+    if (builder->fp && fclose(builder->fp) != 0)
+        printf("[ERROR] Failed to close BSON index: %s\n", strerror(errno));
+    builder->fp = NULL;
+}
+
+/* ------------------------------ Reader ------------------------------ */
+
+static const void *map_file(const char *path, size_t *size) {
+    *size = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    void *map = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) map = NULL;
+        else *size = (size_t)st.st_size;
+    }
+    close(fd);
+    return map;
+}
+
+int bson_indexed_open(BsonIndexedFile *file, const char *bson_path) {
+    memset(file, 0, sizeof(*file));
+
+    struct stat st;
+    if (stat(bson_path, &st) != 0) {
+        printf("[ERROR] Failed to open %s: %s\n", bson_path, strerror(errno));
+        return -1;
+    }
+    file->data = map_file(bson_path, &file->size);
+    if (!file->data && st.st_size > 0) {
+        printf("[ERROR] Failed to map %s: %s\n", bson_path, strerror(errno));
+        return -1;
+    }
+
+    char path[256];
+    index_path(bson_path, path, sizeof(path));
+    file->index_map = map_file(path, &file->index_size);
+    if (file->index_map) {
+        if (file->index_size < sizeof(BsonIndexHeader) || !header_valid(file->index_map)) {
+            printf("[WARNING] Ignoring invalid BSON index %s\n", path);
+            munmap((void *)file->index_map, file->index_size);
+            file->index_map = NULL;
+            file->index_size = 0;
+        } else {
+            file->entries = (const BsonIndexEntry *)((const uint8_t *)file->index_map + sizeof(BsonIndexHeader));
+            file->entry_count = (file->index_size - sizeof(BsonIndexHeader)) / sizeof(BsonIndexEntry);
+        }
+    }
+    return 0;
+}
+
+void bson_indexed_close(BsonIndexedFile *file) {
+    if (file->data) munmap((void *)file->data, file->size);
+    if (file->index_map) munmap((void *)file->index_map, file->index_size);
+    memset(file, 0, sizeof(*file));
+}
+
+typedef struct {
+    const char *symbol;
+    size_t symbol_len;
+    int64_t from_ns;
+    int64_t to_ns;
+    BsonIndexVisit visit;
+    void *context;
+    BsonQueryStats *stats;
+} QueryState;
+
+static int document_matches(const uint8_t *doc, uint32_t len, const QueryState *query) {
+    const char *value;
+    uint32_t value_len;
+
+    if (query->symbol) {
+        if (!bson_index_find_string(doc, len, "currency", &value, &value_len) ||
+            value_len != query->symbol_len || memcmp(value, query->symbol, value_len) != 0)
+            return 0;
+    }
+    if (query->from_ns == INT64_MIN && query->to_ns == INT64_MAX) return 1;
+
+    int64_t ts_ns;
+    if (!bson_index_find_string(doc, len, "timestamp", &value, &value_len) ||
+        !parse_time_iso_field(value, value_len, &ts_ns))
+        return 0;
+    return ts_ns >= query->from_ns && ts_ns <= query->to_ns;
+}
+
+/* Walks whole documents in [start, end). Returns 1 if the visitor stopped the query. */
+static int scan_range(const BsonIndexedFile *file, size_t start, size_t end, const QueryState *query) {
+    size_t pos = start;
+    while (pos + BSON_MIN_DOCUMENT <= end) {
+        uint32_t len = read_le32(file->data + pos);
+        if (len < BSON_MIN_DOCUMENT || len > end - pos) break;
+
+        const uint8_t *doc = file->data + pos;
+        if (document_matches(doc, len, query)) {
+            query->stats->docs_matched++;
+            if (query->visit && query->visit(doc, len, query->context) != 0) return 1;
+        }
+        pos += len;
+    }
+    query->stats->bytes_scanned += pos - start;
+    return 0;
+}
+
+int bson_index_query(const BsonIndexedFile *file, const char *symbol, int64_t from_ns, int64_t to_ns,
+                     BsonIndexVisit visit, void *context, BsonQueryStats *stats) {
+    QueryState query = { symbol, symbol ? strlen(symbol) : 0, from_ns, to_ns, visit, context, stats };
+    uint64_t hash = symbol ? symbol_hash(symbol, query.symbol_len) : 0;
+    size_t cursor = 0;
+
+    for (size_t i = 0; i < file->entry_count; i++) {
+        const BsonIndexEntry *entry = &file->entries[i];
+
+        /* Entries from a replaced file, or ahead of the flushed documents, are walked as plain ranges */
+        if (entry->offset < cursor || entry->offset > file->size || entry->length > file->size - entry->offset)
+            continue;
+
+        if (entry->offset > cursor && scan_range(file, cursor, (size_t)entry->offset, &query)) return 1;
+
+        if (entry->ts_max < from_ns || entry->ts_min > to_ns || (symbol && !bloom_test(entry, hash))) {
+            stats->blocks_skipped++;
+        } else {
+            stats->blocks_scanned++;
+            if (scan_range(file, (size_t)entry->offset, (size_t)(entry->offset + entry->length), &query)) return 1;
+        }
+        cursor = (size_t)(entry->offset + entry->length);
+    }
+
+    return scan_range(file, cursor, file->size, &query);
+}
+
+/* ------------------------------ Backfill ------------------------------ */
+
+long long bson_index_rebuild(const char *bson_path) {
+    BsonIndexedFile file;
+    if (bson_indexed_open(&file, bson_path) != 0) return -1;
+
+    char path[256], temp[272];
+    index_path(bson_path, path, sizeof(path));
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+
+    BsonIndexBuilder builder;
+    memset(&builder, 0, sizeof(builder));
+    builder.fp = fopen(temp, "wb");
+    if (!builder.fp || write_header(builder.fp) != 0) {
+        printf("[ERROR] Failed to create BSON index %s: %s\n", temp, strerror(errno));
+        if (builder.fp) fclose(builder.fp);
+        bson_indexed_close(&file);
+        return -1;
+    }
+
+    long long docs = 0;
+    size_t pos = 0;
+    while (pos + BSON_MIN_DOCUMENT <= file.size) {
+        uint32_t len = read_le32(file.data + pos);
+        if (len < BSON_MIN_DOCUMENT || len > file.size - pos) break;
+
+        const uint8_t *doc = file.data + pos;
+        const char *symbol = "", *timestamp;
+        uint32_t symbol_len = 0, timestamp_len;
+        int64_t ts_ns = 0;
+        bson_index_find_string(doc, len, "currency", &symbol, &symbol_len);
+        if (bson_index_find_string(doc, len, "timestamp", &timestamp, &timestamp_len))
+            parse_time_iso_field(timestamp, timestamp_len, &ts_ns);
+
+        bson_index_add(&builder, pos, len, ts_ns, symbol, symbol_len);
+        docs++;
+        pos += len;
+    }
+    if (pos < file.size)
+        printf("[WARNING] %s: %zu trailing bytes are not a whole document\n", bson_path, file.size - pos);
+
+    int failed = builder.fp == NULL;
+    bson_index_close(&builder);
+    bson_indexed_close(&file);
+
+    if (failed || rename(temp, path) != 0) {
+        printf("[ERROR] Failed to write BSON index %s\n", path);
+        unlink(temp);
+        return -1;
+    }
+    return docs;
+}
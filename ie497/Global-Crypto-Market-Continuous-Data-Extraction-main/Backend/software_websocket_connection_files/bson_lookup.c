@@ -0,0 +1,149 @@
+/*
+ * BSON Lookup
+ *
+ * Command-line reader for the daily BSON output files. It uses the sidecar
+ * block index (`bson_index.h`) to jump to the blocks that can hold a symbol's
+ * documents in a time range, instead of decoding the whole day.
+ *
+ * Features:
+ *  - Default: Prints every matching document as relaxed extended JSON, one per line.
+ *  - `--stats`: No per-document output; matches, blocks read/skipped, bytes walked, time.
+ *  - `--build`: Backfills (rewrites) the index of existing files, e.g. files written
+ *    before the index existed. Files without an index are still queried, by a full walk.
+ *
+ * Dependencies:
+ *  - bson_index.c, market_record.c / symbol_table.c (timestamp parsing).
+ *  - libbson: JSON output.
+ *
+ * Usage:
+ *  make bson_lookup
+ *  ./bson_lookup FILE.bson... [--symbol NAME] [--from TIME] [--to TIME] [--stats]
+ *  ./bson_lookup --build FILE.bson...
+ *  NAME is the `currency` value of the documents. TIME is epoch nanoseconds or
+ *  UTC "YYYY-MM-DDTHH:MM:SS[.fraction]".
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "bson_index.h"
+#include "market_record.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <bson.h>
+
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Epoch nanoseconds, or a UTC ISO 8601 time */
+static int parse_time(const char *text, int64_t *out) {
+    if (parse_time_iso_field(text, strlen(text), out)) return 0;
+
+    char *rest;
+    long long value = strtoll(text, &rest, 10);
+    if (*text == '\0' || *rest != '\0') return -1;
+    *out = value;
+    return 0;
+}
+
+static int print_document(const uint8_t *doc, uint32_t len, void *context) {
+    (void)context;
+    bson_t bson;
+    if (!bson_init_static(&bson, doc, len)) return 0;
+
+    char *json = bson_as_relaxed_extended_json(&bson, NULL);
+    if (json) {
+        puts(json);
+        bson_free(json);
+    }
+    return 0;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "[ERROR] Usage: %s FILE.bson... [--symbol NAME] [--from TIME] [--to TIME] [--stats]\n"
+                    "        %s --build FILE.bson...\n", program, program);
+}
+
+int main(int argc, char **argv) {
+    const char *symbol = NULL;
+    int64_t from_ns = INT64_MIN, to_ns = INT64_MAX;
+    int build = 0, stats_only = 0;
+    const char **files = calloc((size_t)argc, sizeof(char *));
+    int file_count = 0;
+    if (!files) return 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--build") == 0) {
+            build = 1;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats_only = 1;
+        } else if (strcmp(argv[i], "--symbol") == 0 && i + 1 < argc) {
+            symbol = argv[++i];
+        } else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            if (parse_time(argv[++i], &from_ns) != 0) { usage(argv[0]); return 1; }
+        } else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            if (parse_time(argv[++i], &to_ns) != 0) { usage(argv[0]); return 1; }
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            files[file_count++] = argv[i];
+        }
+    }
+    if (file_count == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int status = 0;
+    if (build) {
+        for (int i = 0; i < file_count; i++) {
+            int64_t start = monotonic_ns();
+            long long docs = bson_index_rebuild(files[i]);
+            if (docs < 0) {
+                status = 1;
+                continue;
+            }
+            printf("[INFO] Indexed %s: %lld documents in %.2f s\n", files[i], docs,
+                   (double)(monotonic_ns() - start) / 1e9);
+        }
+        free(files);
+        return status;
+    }
+
+    BsonQueryStats stats;
+    memset(&stats, 0, sizeof(stats));
+    uint64_t total_bytes = 0;
+    int64_t start = monotonic_ns();
+
+    for (int i = 0; i < file_count; i++) {
+        BsonIndexedFile file;
+        if (bson_indexed_open(&file, files[i]) != 0) {
+            status = 1;
+            continue;
+        }
+        if (!file.index_map)
+            fprintf(stderr, "[WARNING] %s has no index; walking the whole file (see --build)\n", files[i]);
+
+        total_bytes += file.size;
+        bson_index_query(&file, symbol, from_ns, to_ns, stats_only ? NULL : print_document, NULL, &stats);
+        bson_indexed_close(&file);
+    }
+    double seconds = (double)(monotonic_ns() - start) / 1e9;
+
+    if (stats_only) {
+        printf("%llu documents; %llu blocks read, %llu skipped; %.1f MB of %.1f MB walked in %.3f s\n",
+               (unsigned long long)stats.docs_matched, (unsigned long long)stats.blocks_scanned,
+               (unsigned long long)stats.blocks_skipped, (double)stats.bytes_scanned / 1e6,
+               (double)total_bytes / 1e6, seconds);
+    }
+
+    free(files);
+    return status;
+}
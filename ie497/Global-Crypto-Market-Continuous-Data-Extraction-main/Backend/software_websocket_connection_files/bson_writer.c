@@ -0,0 +1,250 @@
+/*
+ * BSON Writer
+ *
+ * This module keeps one open, fully buffered file handle per (exchange, kind)
+ * and appends BSON documents to it, replacing the per-message
+ * gmtime + snprintf + fopen + fwrite + fclose sequence.
+ *
+ * Features:
+ *  - Caches the open file and its UTC day; reopens only when the day rolls over.
+ *  - Batches documents in a large stdio buffer so most appends are a memcpy.
+ *  - Flushes on buffer size, on a time threshold, and on shutdown.
+ *  - Sinks are indexed by exchange ID and kind, so an append does no name lookup.
+ *  - Each sink has its own mutex, so flushing one exchange's file never stalls writers of another.
+ *  - Appends read the wall clock (for the day roll and the flush age) from a second-resolution
+ *    value that the housekeeping flush refreshes, instead of calling time() per document.
+ *  - Tracks each document's file offset and feeds the sidecar block index (`bson_index.c`).
+ *  - Times every queued document from its frame's arrival to the flush that hands it to the
+ *    kernel (`handoff` stage of `latency_stats.c`; the file is not fsynced). A document that would overflow the buffer
+ *    flushes it first, so the time of every write is known.
+ *
+ * Dependencies:
+ *  - bson_index.h: Sidecar index builder.
+ *  - ingest.h / latency_stats.h: Arrival time of the record being written, handoff histograms.
+ *  - Standard C libraries (stdio, stdlib, string, time, errno, pthread).
+ *
+ * Usage:
+ *  - Called by `exchange_websocket.c` for every ticker/trade document, on the ingest writer threads.
+ *  - Flushed by the housekeeping loop in `main.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "bson_writer.h"
+#include "exchange_websocket.h"
+#include "bson_index.h"
+#include "ingest.h"
+#include "latency_stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+
+#define SECONDS_PER_DAY 86400
+
+/* One open output file for an (exchange, kind) pair */
+typedef struct {
+    pthread_mutex_t lock;   // the sink's writer threads append while the main thread flushes
+    const char *exchange;   // exchange_name() of `exchange_id`
+    BsonKind kind;
+    FILE *fp;
+    char *buffer;
+    long day;               // days since epoch of the open file
+    time_t oldest_pending;  // time of the first unflushed write, 0 if clean
+    uint64_t offset;        // file offset of the next document
+    BsonIndexBuilder index;
+    uint16_t exchange_id;   // ExchangeId, for the latency stats
+    size_t buffered;        // bytes written since the last flush
+    int64_t *pending_ns;    // frame arrival of each unflushed document that came through a ring
+    size_t pending_count;
+    size_t pending_capacity;
+} BsonSink;
+
+static BsonSink sinks[EXCHANGE_COUNT][BSON_KIND_COUNT];
+static pthread_once_t sinks_once = PTHREAD_ONCE_INIT;
+
+/* Wall-clock seconds as of the last flush pass; 0 until the first one */
+static time_t wall_clock = 0;
+
+static const char *kind_names[] = { "ticker", "trade" };
+
+static void init_sinks(void) {
+    for (uint16_t id = 0; id < EXCHANGE_COUNT; id++) {
+        for (int kind = 0; kind < BSON_KIND_COUNT; kind++) {
+            BsonSink *sink = &sinks[id][kind];
+            pthread_mutex_init(&sink->lock, NULL);
+            sink->exchange = exchange_name(id);
+            sink->exchange_id = id;
+            sink->kind = (BsonKind)kind;
+            sink->day = -1;
+        }
+    }
+}
+
+static time_t current_time(void) {
+    time_t now = __atomic_load_n(&wall_clock, __ATOMIC_RELAXED);
+    return now ? now : time(NULL);
+}
+
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Remembers the arrival of the document just written; nothing is timed for inline writes */
+static void note_pending(BsonSink *sink) {
+    int64_t received = ingest_record_received();
+    if (!received) return;
+
+    if (sink->pending_count == sink->pending_capacity) {
+        size_t capacity = sink->pending_capacity ? sink->pending_capacity * 2 : 1024;
+        int64_t *grown = realloc(sink->pending_ns, capacity * sizeof(int64_t));
+        if (!grown) return;
+        sink->pending_ns = grown;
+        sink->pending_capacity = capacity;
+    }
+    sink->pending_ns[sink->pending_count++] = received;
+}
+
+/* The sink's buffered documents were handed to the kernel */
+static void record_handoff(BsonSink *sink) {
+    if (sink->pending_count) {
+        int64_t now = monotonic_ns();
+        for (size_t i = 0; i < sink->pending_count; i++)
+            latency_record(LATENCY_HANDOFF, sink->exchange_id, (uint64_t)(now - sink->pending_ns[i]));
+    }
+    sink->pending_count = 0;
+    sink->buffered = 0;
+}
+
+static void close_sink(BsonSink *sink) {
+    if (!sink->fp) return;
+
+    if (fclose(sink->fp) != 0) {
+        printf("[ERROR] Failed to close BSON file for %s: %s\n", sink->exchange, strerror(errno));
+        sink->pending_count = 0;
+    }
+    record_handoff(sink);
+    bson_index_close(&sink->index);
+
+    sink->fp = NULL;
+    sink->oldest_pending = 0;
+}
+
+/* Open (or reopen after UTC midnight) the daily file for a sink */
+static int open_sink(BsonSink *sink, time_t now) {
+    close_sink(sink);
+
+    struct tm tm;
+    gmtime_r(&now, &tm);
+
+    char filename[128];
+    snprintf(filename, sizeof(filename), "bson_output/%s_%s_%04d%02d%02d.bson",
+             sink->exchange, kind_names[sink->kind], tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+
+    sink->fp = fopen(filename, "ab");
+    if (!sink->fp) {
+        printf("[ERROR] Failed to open BSON file %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    if (!sink->buffer) sink->buffer = malloc(BSON_WRITER_BUFFER_SIZE);
+    if (sink->buffer) setvbuf(sink->fp, sink->buffer, _IOFBF, BSON_WRITER_BUFFER_SIZE);
+
+    /* Documents of an earlier run today stay where they are; index offsets continue after them */
+    off_t size = fseeko(sink->fp, 0, SEEK_END) == 0 ? ftello(sink->fp) : -1;
+    if (size < 0) {
+        printf("[ERROR] Failed to size BSON file %s: %s\n", filename, strerror(errno));
+        fclose(sink->fp);
+        sink->fp = NULL;
+        return -1;
+    }
+    sink->offset = (uint64_t)size;
+    bson_index_open(&sink->index, filename);
+
+    sink->day = now / SECONDS_PER_DAY;
+    return 0;
+}
+
+/* The caller holds the sink's lock */
+static int append_locked(BsonSink *sink, int64_t ts_ns, const char *symbol, const uint8_t *data, size_t len) {
+    time_t now = current_time();
+    if (!sink->fp || now / SECONDS_PER_DAY != sink->day) {
+        if (open_sink(sink, now) != 0) return -1;
+    }
+
+    if (sink->buffered && sink->buffered + len > BSON_WRITER_BUFFER_SIZE) {
+        if (fflush(sink->fp) == 0) record_handoff(sink);
+        else printf("[ERROR] Failed to flush BSON file for %s: %s\n", sink->exchange, strerror(errno));
+    }
+
+    if (fwrite(data, 1, len, sink->fp) != len) {
+        printf("[ERROR] Failed to write to BSON file for %s %s\n", sink->exchange, kind_names[sink->kind]);
+        close_sink(sink);   // reopening finds the real end of the file again
+        return -1;
+    }
+
+    bson_index_add(&sink->index, sink->offset, (uint32_t)len, ts_ns, symbol, strlen(symbol));
+    sink->offset += len;
+    sink->buffered += len;
+    note_pending(sink);
+
+    if (!sink->oldest_pending) sink->oldest_pending = now;
+    return 0;
+}
+
+int bson_writer_append(uint16_t exchange_id, BsonKind kind, int64_t ts_ns, const char *symbol,
+                       const uint8_t *data, size_t len) {
+    if (exchange_id >= EXCHANGE_COUNT || kind >= BSON_KIND_COUNT) return -1;
+    pthread_once(&sinks_once, init_sinks);
+
+    BsonSink *sink = &sinks[exchange_id][kind];
+    pthread_mutex_lock(&sink->lock);
+    int result = append_locked(sink, ts_ns, symbol, data, len);
+    pthread_mutex_unlock(&sink->lock);
+    return result;
+}
+
+void bson_writer_flush(int force) {
+    time_t now = time(NULL);
+    __atomic_store_n(&wall_clock, now, __ATOMIC_RELAXED);
+    pthread_once(&sinks_once, init_sinks);
+
+    for (uint16_t id = 0; id < EXCHANGE_COUNT; id++) {
+        for (int kind = 0; kind < BSON_KIND_COUNT; kind++) {
+            BsonSink *sink = &sinks[id][kind];
+            pthread_mutex_lock(&sink->lock);
+            if (sink->fp && sink->oldest_pending &&
+                (force || now - sink->oldest_pending >= BSON_WRITER_FLUSH_INTERVAL)) {
+                if (fflush(sink->fp) == 0) record_handoff(sink);
+                else printf("[ERROR] Failed to flush BSON file for %s: %s\n", sink->exchange, strerror(errno));
+                bson_index_flush(&sink->index);
+                sink->oldest_pending = 0;
+            }
+            pthread_mutex_unlock(&sink->lock);
+        }
+    }
+}
+
+void bson_writer_close_all(void) {
+    pthread_once(&sinks_once, init_sinks);
+    for (uint16_t id = 0; id < EXCHANGE_COUNT; id++) {
+        for (int kind = 0; kind < BSON_KIND_COUNT; kind++) {
+            BsonSink *sink = &sinks[id][kind];
+            pthread_mutex_lock(&sink->lock);
+            close_sink(sink);
+            free(sink->buffer);
+            free(sink->pending_ns);
+            sink->buffer = NULL;
+            sink->pending_ns = NULL;
+            sink->pending_capacity = 0;
+            sink->day = -1;
+            pthread_mutex_unlock(&sink->lock);
+        }
+    }
+}
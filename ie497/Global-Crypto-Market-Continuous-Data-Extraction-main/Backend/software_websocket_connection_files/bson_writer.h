@@ -0,0 +1,55 @@
+/*
+ * BSON Writer Header
+ *
+ * Declares the persistent BSON sink used to append serialized ticker and trade
+ * documents to the daily `bson_output/<exchange>_<kind>_YYYYMMDD.bson` files.
+ *
+ * Features:
+ *  - bson_writer_append(): Appends one document to the (exchange, kind, day) file and
+ *    records it in the file's sidecar index (`bson_index.h`).
+ *  - bson_writer_flush(): Flushes sinks whose buffered data is older than the interval.
+ *  - bson_writer_close_all(): Flushes and closes every open sink on shutdown.
+ *
+ * Dependencies:
+ *  - Standard C libraries (stddef.h, stdint.h).
+ *
+ * Usage:
+ *  - Called by write_ticker_to_bson()/write_trade_to_bson() in `exchange_websocket.c`.
+ *  - Flushed from the housekeeping loop in `main.c`. Safe to call from any thread.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef BSON_WRITER_H
+#define BSON_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* stdio buffer per sink; a full buffer is written out in one call */
+#define BSON_WRITER_BUFFER_SIZE (256 * 1024)
+
+/* Seconds buffered documents may wait before being flushed */
+#define BSON_WRITER_FLUSH_INTERVAL 1
+
+/* Kind of document stored in a sink, used to build the file name */
+typedef enum {
+    BSON_KIND_TICKER,
+    BSON_KIND_TRADE,
+    BSON_KIND_COUNT
+} BsonKind;
+
+/* Appends one serialized BSON document to today's file for the given exchange (ExchangeId) and kind.
+ * `ts_ns` and `symbol` (the document's timestamp and currency) go to the index. */
+int bson_writer_append(uint16_t exchange_id, BsonKind kind, int64_t ts_ns, const char *symbol,
+                       const uint8_t *data, size_t len);
+
+/* Flushes sinks that have unflushed data older than the flush interval (or all, if forced), and
+ * refreshes the clock appends use for the day roll. Call about every second or more often. */
+void bson_writer_flush(int force);
+
+/* Flushes and closes every open sink. */
+void bson_writer_close_all(void);
+
+#endif // BSON_WRITER_H
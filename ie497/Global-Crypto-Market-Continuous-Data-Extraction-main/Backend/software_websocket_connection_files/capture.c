@@ -0,0 +1,208 @@
+/*
+ * Frame Capture
+ *
+ * This module records raw WebSocket frames to disk so a live session can be
+ * replayed later, and reads those recordings back. Frames are stored exactly
+ * as they arrived, before decompression or parsing.
+ *
+ * Features:
+ *  - One append-only capture file shared by every service thread (mutex per frame).
+ *  - Large stdio buffer, flushed from the housekeeping loop once per interval.
+ *  - Reader that grows a single payload buffer instead of allocating per frame.
+ *  - Loader that packs a whole capture into one arena for the replay tools.
+ *
+ * Dependencies:
+ *  - Standard C libraries (stdio, stdlib, string, pthread, time).
+ *
+ * Usage:
+ *  - `crypto_ws --capture FILE` records; `bench_replay` and `replay_server` replay.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "capture.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+/* stdio buffer for the capture file */
+#define CAPTURE_BUFFER_SIZE (1024 * 1024)
+
+static FILE *capture_file = NULL;
+static char *capture_buffer = NULL;
+static time_t capture_last_flush = 0;
+static pthread_mutex_t capture_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int capture_open(const char *path) {
+    capture_file = fopen(path, "ab");
+    if (!capture_file) {
+        printf("[ERROR] Failed to open capture file %s\n", path);
+        return -1;
+    }
+
+    capture_buffer = malloc(CAPTURE_BUFFER_SIZE);
+    if (capture_buffer) setvbuf(capture_file, capture_buffer, _IOFBF, CAPTURE_BUFFER_SIZE);
+
+    /* A fresh file gets the magic; an existing one is appended to */
+    if (ftell(capture_file) == 0) fwrite(CAPTURE_MAGIC, 1, CAPTURE_MAGIC_LENGTH, capture_file);
+
+    capture_last_flush = time(NULL);
+    printf("[INFO] Capturing raw frames to %s\n", path);
+    return 0;
+}
+
+int capture_enabled(void) {
+    return capture_file != NULL;
+}
+
+void capture_frame(uint16_t exchange_id, int connection, const void *data, size_t len) {
+    if (!capture_file) return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    CaptureFrameHeader header;
+    memset(&header, 0, sizeof(header));
+    header.recv_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+    header.exchange_id = exchange_id;
+    header.connection = (uint16_t)((connection < 0) ? UINT16_MAX : connection);
+    header.len = (uint32_t)len;
+
+    pthread_mutex_lock(&capture_lock);
+    fwrite(&header, sizeof(header), 1, capture_file);
+    fwrite(data, 1, len, capture_file);
+    pthread_mutex_unlock(&capture_lock);
+}
+
+void capture_flush(int force) {
+    if (!capture_file) return;
+
+    time_t now = time(NULL);
+    if (!force && now - capture_last_flush < CAPTURE_FLUSH_INTERVAL) return;
+
+    pthread_mutex_lock(&capture_lock);
+    fflush(capture_file);
+    pthread_mutex_unlock(&capture_lock);
+    capture_last_flush = now;
+}
+
+void capture_close(void) {
+    if (!capture_file) return;
+
+    pthread_mutex_lock(&capture_lock);
+    fclose(capture_file);
+    capture_file = NULL;
+    pthread_mutex_unlock(&capture_lock);
+
+    free(capture_buffer);
+    capture_buffer = NULL;
+}
+
+int capture_reader_open(CaptureReader *reader, const char *path) {
+    memset(reader, 0, sizeof(*reader));
+
+    reader->file = fopen(path, "rb");
+    if (!reader->file) {
+        printf("[ERROR] Failed to open capture file %s\n", path);
+        return -1;
+    }
+
+    char magic[CAPTURE_MAGIC_LENGTH];
+    if (fread(magic, 1, sizeof(magic), reader->file) != sizeof(magic) ||
+        memcmp(magic, CAPTURE_MAGIC, CAPTURE_MAGIC_LENGTH) != 0) {
+        printf("[ERROR] %s is not a capture file\n", path);
+        capture_reader_close(reader);
+        return -1;
+    }
+    return 0;
+}
+
+int capture_reader_next(CaptureReader *reader) {
+    if (fread(&reader->header, sizeof(reader->header), 1, reader->file) != 1)
+        return 0;
+
+    if (reader->header.len > CAPTURE_MAX_FRAME) {
+        printf("[ERROR] Capture frame of %u bytes exceeds the limit\n", reader->header.len);
+        return -1;
+    }
+
+    /* One spare byte keeps text frames NUL-terminated for the string helpers */
+    if (reader->header.len + 1 > reader->capacity) {
+        size_t capacity = reader->capacity ? reader->capacity : 4096;
+        while (capacity < reader->header.len + 1) capacity *= 2;
+        unsigned char *data = realloc(reader->data, capacity);
+        if (!data) {
+            printf("[ERROR] Memory allocation failed for capture frame\n");
+            return -1;
+        }
+        reader->data = data;
+        reader->capacity = capacity;
+    }
+
+    if (fread(reader->data, 1, reader->header.len, reader->file) != reader->header.len) {
+        printf("[WARNING] Capture file ends in a truncated frame\n");
+        return 0;
+    }
+    reader->data[reader->header.len] = '\0';
+    return 1;
+}
+
+void capture_reader_close(CaptureReader *reader) {
+    if (reader->file) fclose(reader->file);
+    free(reader->data);
+    memset(reader, 0, sizeof(*reader));
+}
+
+int capture_load(CaptureArchive *archive, const char *path, size_t headroom) {
+    memset(archive, 0, sizeof(*archive));
+
+    CaptureReader reader;
+    if (capture_reader_open(&reader, path) != 0) return -1;
+
+    size_t frame_capacity = 0, arena_capacity = 0, arena_used = 0;
+    int status;
+    while ((status = capture_reader_next(&reader)) == 1) {
+        if (archive->count == frame_capacity) {
+            frame_capacity = frame_capacity ? frame_capacity * 2 : 4096;
+            CaptureFrame *frames = realloc(archive->frames, frame_capacity * sizeof(*frames));
+            if (!frames) break;
+            archive->frames = frames;
+        }
+
+        size_t need = headroom + reader.header.len + 1;
+        if (arena_used + need > arena_capacity) {
+            arena_capacity = arena_capacity ? arena_capacity : (1 << 20);
+            while (arena_used + need > arena_capacity) arena_capacity *= 2;
+            unsigned char *arena = realloc(archive->arena, arena_capacity);
+            if (!arena) break;
+            archive->arena = arena;
+        }
+
+        CaptureFrame *frame = &archive->frames[archive->count++];
+        frame->header = reader.header;
+        frame->offset = arena_used + headroom;
+        memcpy(archive->arena + frame->offset, reader.data, reader.header.len + 1);
+        arena_used += need;
+        archive->bytes += reader.header.len;
+    }
+    capture_reader_close(&reader);
+
+    if (status == 1) {
+        printf("[ERROR] Memory allocation failed while loading %s\n", path);
+        status = -1;
+    }
+    if (status < 0) {
+        capture_archive_free(archive);
+        return -1;
+    }
+    return 0;
+}
+
+void capture_archive_free(CaptureArchive *archive) {
+    free(archive->frames);
+    free(archive->arena);
+    memset(archive, 0, sizeof(*archive));
+}
@@ -0,0 +1,104 @@
+/*
+ * Frame Capture Header
+ *
+ * Declares the raw frame capture file: every WebSocket frame as received
+ * (still gzip-compressed for Huobi), tagged with its receive time, exchange and
+ * connection. Captures are replayed through the normal parse/log/BSON path by
+ * `bench_replay` without any network access.
+ *
+ * File layout:
+ *  - 8-byte magic "CWSCAP01".
+ *  - Repeated CaptureFrameHeader followed by `len` payload bytes (host byte order).
+ *
+ * Features:
+ *  - capture_open() / capture_frame() / capture_close(): Writer used by `crypto_ws --capture`.
+ *  - capture_reader_open() / capture_reader_next(): Sequential reader for replay tools.
+ *  - capture_load(): Whole capture in one arena, with optional headroom (LWS_PRE) per frame.
+ *
+ * Dependencies:
+ *  - Standard C libraries (stdio.h, stddef.h, stdint.h).
+ *
+ * Usage:
+ *  - Enabled from `main.c`; frames recorded in `exchange_websocket.c`.
+ *  - Read by `bench_replay.c` and `replay_server.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CAPTURE_MAGIC "CWSCAP01"
+#define CAPTURE_MAGIC_LENGTH 8
+
+/* Largest frame accepted by the reader; anything bigger means a corrupt file */
+#define CAPTURE_MAX_FRAME (16 * 1024 * 1024)
+
+/* Seconds between flushes of the capture file */
+#define CAPTURE_FLUSH_INTERVAL 1
+
+/* Header written before every captured frame */
+typedef struct {
+    int64_t recv_ns;            // CLOCK_REALTIME at receive, nanoseconds
+    uint16_t exchange_id;       // ExchangeId
+    uint16_t connection;        // protocols[] index
+    uint32_t len;               // payload bytes that follow
+} CaptureFrameHeader;
+
+/* Sequential reader over a capture file; `data` is reused between frames */
+typedef struct {
+    FILE *file;
+    CaptureFrameHeader header;
+    unsigned char *data;
+    size_t capacity;
+} CaptureReader;
+
+/* One frame of a loaded capture; its payload is at arena + offset */
+typedef struct {
+    CaptureFrameHeader header;
+    size_t offset;
+} CaptureFrame;
+
+/* A capture loaded into memory */
+typedef struct {
+    CaptureFrame *frames;
+    size_t count;
+    unsigned char *arena;
+    size_t bytes;               // payload bytes, excluding headroom
+} CaptureArchive;
+
+/* Starts recording frames to `path` (appends if the file already has a valid header). */
+int capture_open(const char *path);
+
+/* Non-zero once capture_open() succeeded. */
+int capture_enabled(void);
+
+/* Records one frame; a no-op when capture is off. Safe to call from any thread. */
+void capture_frame(uint16_t exchange_id, int connection, const void *data, size_t len);
+
+/* Flushes buffered frames if due; `force` flushes immediately. */
+void capture_flush(int force);
+
+/* Flushes and closes the capture file. */
+void capture_close(void);
+
+/* Opens a capture for reading and checks its magic. */
+int capture_reader_open(CaptureReader *reader, const char *path);
+
+/* Reads the next frame into reader->header / reader->data. Returns 1, 0 at end of file, -1 on error. */
+int capture_reader_next(CaptureReader *reader);
+
+void capture_reader_close(CaptureReader *reader);
+
+/* Loads every frame of a capture. Each payload is preceded by `headroom` spare bytes
+ * and followed by a NUL. Returns 0, or -1 with `archive` left empty. */
+int capture_load(CaptureArchive *archive, const char *path, size_t headroom);
+
+void capture_archive_free(CaptureArchive *archive);
+
+#endif // CAPTURE_H
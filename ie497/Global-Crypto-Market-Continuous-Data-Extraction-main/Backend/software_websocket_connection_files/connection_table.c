@@ -0,0 +1,551 @@
+/*
+ * Connection Table
+ *
+ * This module decides which WebSocket connections exist and which symbols each
+ * one subscribes to. The layout is generated at startup from the product lists
+ * in `currency_text_files/` and the per-symbol message rates saved by the
+ * previous run, and is adjusted while running when one connection carries
+ * more than its share.
+ *
+ * Features:
+ *  - Coinbase, Kraken and Bitfinex keep one connection each.
+ *  - Binance, Huobi and OKX are chunked. Without saved rates the symbols are split
+ *    CONNECTION_DEFAULT_CHUNK per connection in file order, as before. With saved rates
+ *    the hottest symbols are placed first, each on the least loaded connection, so hot
+ *    symbols end up on different sockets and cold ones fill the remaining room.
+ *  - CONNECTION_SPARE_SLOTS spare entries per chunked exchange are registered as lws
+ *    protocols up front (protocols must exist when the contexts are created).
+ *  - Every CONNECTION_REBALANCE_INTERVAL seconds each service thread samples the rates of
+ *    its own connections. A connection above CONNECTION_SATURATION_RATE has half of its
+ *    load moved to a spare on the same service thread. The source keeps every symbol
+ *    until the spare is up, then unsubscribes the moved ones on its live socket, so
+ *    neither half goes uncovered. Both get their subscription frames recompiled
+ *    (`subscription_cache.c`) for their next connect.
+ *
+ * Notes:
+ *  - Rates count parsed records (tickers + trades) per symbol, not raw frames.
+ *  - A single symbol above the saturation rate cannot be split further.
+ *  - The rates are saved every CONNECTION_RATES_SAVE_INTERVAL seconds and at shutdown, so a
+ *    crash loses at most that much of them.
+ *
+ * Dependencies:
+ *  - jansson: Reading the product lists.
+ *  - libwebsockets: lws_sul_schedule() timers on the service thread contexts.
+ *  - Standard C libraries (stdio, stdlib, string, ctype, time).
+ *
+ * Usage:
+ *  - `connection_table_build()` runs in `main.c` before `build_protocols()` and `ingest_init()`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "connection_table.h"
+#include "symbol_table.h"
+#include "ingest.h"
+#include "exchange_reconnect.h"
+#include "subscription_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <jansson.h>
+#include <libwebsockets.h>
+
+#define CONNECTION_NAME_LENGTH 32
+
+/* Weight of the newest sample in a symbol's smoothed rate */
+#define RATE_SMOOTHING 0.5
+
+/* One product of a chunked exchange */
+typedef struct {
+    char name[MAX_SYMBOL_LENGTH];       // as subscribed ("btcusdt", "BTC-USDT")
+    uint16_t symbol_id;                 // as reported in records (upper-cased for Binance)
+    int known;                          // rate loaded from the last run or sampled in this one
+    int sampled;                        // rate measured in this run
+    uint32_t last_count;
+    double rate;                        // records per second, smoothed
+} TableSymbol;
+
+/* An exchange whose symbols are spread over several connections */
+typedef struct {
+    ExchangeId exchange;
+    const char *prefix;                 // protocol names are "<prefix>-<chunk>"
+    const char *file;                   // product list written by fetch_currency_id
+    int uppercase;                      // records carry the symbol upper-cased
+    int max_chunk;                      // most symbols on one connection (subscription limits)
+    TableSymbol *symbols;
+    int count;
+} ChunkedExchange;
+
+typedef struct {
+    char name[CONNECTION_NAME_LENGTH];
+    ExchangeId exchange;
+    int chunk;
+    int spare;                          // registered but not given any symbols yet
+    int split_from;                     // source to reconnect once this one is up, -1 if none
+    uint16_t *members;                  // indices into the exchange's symbols
+    int member_count;
+    int member_capacity;
+    double rate;                        // sum of the members' rates
+} ConnectionEntry;
+
+/* Periodic rate sampler, one per service thread */
+typedef struct {
+    lws_sorted_usec_list_t sul;
+    struct lws_context *context;
+    int64_t last_ns;
+} RebalanceTimer;
+
+static ChunkedExchange chunked[] = {
+    { EXCHANGE_BINANCE, "binance-websocket", "binance_currency_ids_trades.txt", 1, 400, NULL, 0 },   // 2 streams per symbol, 1024 per socket
+    { EXCHANGE_HUOBI, "huobi-websocket", "huobi_currency_ids.txt", 0, 200, NULL, 0 },
+    { EXCHANGE_OKX, "okx-websocket", "okx_currency_ids.txt", 0, 200, NULL, 0 },
+};
+
+#define CHUNKED_COUNT ((int)(sizeof(chunked) / sizeof(chunked[0])))
+
+static ConnectionEntry entries[MAX_CONNECTIONS];
+static int entry_count = 0;
+
+static RebalanceTimer rebalance_timers[INGEST_MAX_SERVICE_THREADS];
+
+/* Records per (exchange, symbol); written from the service threads, read by the sampler */
+static uint32_t record_counts[EXCHANGE_COUNT][MAX_SYMBOLS];
+
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static ChunkedExchange *chunked_for(ExchangeId exchange) {
+    for (int i = 0; i < CHUNKED_COUNT; i++) {
+        if (chunked[i].exchange == exchange) return &chunked[i];
+    }
+    return NULL;
+}
+
+/* Symbol ID a product is reported under in records */
+static uint16_t record_symbol_id(const ChunkedExchange *ex, const char *name) {
+    char buf[MAX_SYMBOL_LENGTH];
+    size_t len = strlen(name);
+    if (len >= sizeof(buf)) len = sizeof(buf) - 1;
+    for (size_t c = 0; c < len; c++)
+        buf[c] = ex->uppercase ? (char)toupper((unsigned char)name[c]) : name[c];
+    return symbol_intern(buf, len);
+}
+
+/* ---------------------------------- Layout ---------------------------------- */
+
+/* Reads an exchange's product list (strings, or objects with "instId") */
+static void load_products(ChunkedExchange *ex, const char *dir) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, ex->file);
+
+    json_error_t error;
+    json_t *array = json_load_file(path, 0, &error);
+    if (!array || !json_is_array(array)) {
+        printf("[WARNING] Could not load symbols from %s; no %s connections\n", path, exchange_name(ex->exchange));
+        if (array) json_decref(array);
+        return;
+    }
+
+    ex->symbols = calloc(json_array_size(array) + 1, sizeof(TableSymbol));
+    if (!ex->symbols) {
+        printf("[ERROR] Memory allocation failed for %s symbols\n", exchange_name(ex->exchange));
+        json_decref(array);
+        return;
+    }
+
+    size_t i;
+    json_t *item;
+    json_array_foreach(array, i, item) {
+        const char *name = json_is_object(item) ? json_string_value(json_object_get(item, "instId"))
+                                                : json_string_value(item);
+        if (!name || !*name || strlen(name) >= MAX_SYMBOL_LENGTH) continue;
+
+        TableSymbol *symbol = &ex->symbols[ex->count++];
+        strcpy(symbol->name, name);
+        symbol->symbol_id = record_symbol_id(ex, name);
+    }
+    json_decref(array);
+}
+
+/* Applies the rates saved by the last run ("<exchange> <symbol> <records/s>" per line) */
+static void load_rates(ChunkedExchange *ex, const char *dir) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, CONNECTION_RATES_FILE);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return;
+
+    /* Symbol ID -> product index, so each line is one lookup */
+    int *index_of = malloc(MAX_SYMBOLS * sizeof(int));
+    if (!index_of) {
+        fclose(fp);
+        return;
+    }
+    for (int i = 0; i < MAX_SYMBOLS; i++) index_of[i] = -1;
+    for (int i = 0; i < ex->count; i++) index_of[ex->symbols[i].symbol_id] = i;
+
+    char exchange[32], name[MAX_SYMBOL_LENGTH];
+    double rate;
+    while (fscanf(fp, "%31s %31s %lf", exchange, name, &rate) == 3) {
+        if (strcmp(exchange, exchange_name(ex->exchange)) != 0 || rate < 0) continue;
+        int index = index_of[record_symbol_id(ex, name)];
+        if (index < 0) continue;
+        ex->symbols[index].rate = rate;
+        ex->symbols[index].known = 1;
+    }
+
+    free(index_of);
+    fclose(fp);
+}
+
+static ConnectionEntry *add_entry(ExchangeId exchange, const char *prefix, int chunk, int chunked_exchange, int capacity) {
+    if (entry_count == MAX_CONNECTIONS) {
+        printf("[ERROR] Connection table full (%d), dropping %s-%d\n", MAX_CONNECTIONS, prefix, chunk);
+        return NULL;
+    }
+
+    ConnectionEntry *entry = &entries[entry_count];
+    memset(entry, 0, sizeof(*entry));
+    if (chunked_exchange) {
+        entry->members = malloc((size_t)capacity * sizeof(uint16_t));
+        if (!entry->members) {
+            printf("[ERROR] Memory allocation failed for %s-%d\n", prefix, chunk);
+            return NULL;
+        }
+        snprintf(entry->name, sizeof(entry->name), "%s-%d", prefix, chunk);
+    } else {
+        snprintf(entry->name, sizeof(entry->name), "%s", prefix);
+    }
+    entry->exchange = exchange;
+    entry->chunk = chunk;
+    entry->split_from = -1;
+    entry->member_capacity = capacity;
+    entry_count++;
+    return entry;
+}
+
+typedef struct {
+    double rate;
+    int index;
+} RankedSymbol;
+
+/* Hottest first; ties keep file order so layouts are stable between runs */
+static int compare_ranked(const void *a, const void *b) {
+    const RankedSymbol *x = a, *y = b;
+    if (x->rate != y->rate) return (x->rate < y->rate) ? 1 : -1;
+    return x->index - y->index;
+}
+
+static void layout_chunked(ChunkedExchange *ex) {
+    if (ex->count == 0) return;
+
+    int known = 0;
+    double total = 0.0;
+    for (int i = 0; i < ex->count; i++) {
+        if (!ex->symbols[i].known) continue;
+        known++;
+        total += ex->symbols[i].rate;
+    }
+
+    int chunks;
+    if (!known) {
+        chunks = (ex->count + CONNECTION_DEFAULT_CHUNK - 1) / CONNECTION_DEFAULT_CHUNK;
+    } else {
+        chunks = (int)(total / CONNECTION_TARGET_RATE + 0.999);
+        int least = (ex->count + ex->max_chunk - 1) / ex->max_chunk;
+        if (chunks < least) chunks = least;
+        if (chunks > ex->count) chunks = ex->count;
+    }
+    if (chunks < 1) chunks = 1;
+
+    if (chunks > CONNECTION_MAX_CHUNKS) {
+        printf("[WARNING] %s rates ask for %d connections, using %d\n", exchange_name(ex->exchange), chunks, CONNECTION_MAX_CHUNKS);
+        chunks = CONNECTION_MAX_CHUNKS;
+    }
+
+    int capacity = (ex->count + chunks - 1) / chunks;
+    if (capacity < ex->max_chunk) capacity = ex->max_chunk;
+
+    int first = entry_count;
+    for (int c = 0; c < chunks; c++) {
+        if (!add_entry(ex->exchange, ex->prefix, c, 1, capacity)) return;
+    }
+
+    if (!known) {
+        for (int i = 0; i < ex->count; i++) {
+            ConnectionEntry *entry = &entries[first + i / CONNECTION_DEFAULT_CHUNK];
+            entry->members[entry->member_count++] = (uint16_t)i;
+        }
+    } else {
+        RankedSymbol *ranked = malloc((size_t)ex->count * sizeof(RankedSymbol));
+        if (!ranked) {
+            printf("[ERROR] Memory allocation failed while packing %s\n", exchange_name(ex->exchange));
+            return;
+        }
+        for (int i = 0; i < ex->count; i++) {
+            ranked[i].rate = ex->symbols[i].rate;
+            ranked[i].index = i;
+        }
+        qsort(ranked, (size_t)ex->count, sizeof(RankedSymbol), compare_ranked);
+
+        for (int i = 0; i < ex->count; i++) {
+            ConnectionEntry *best = NULL;
+            for (int c = first; c < first + chunks; c++) {
+                ConnectionEntry *entry = &entries[c];
+                if (entry->member_count >= entry->member_capacity) continue;
+                if (!best || entry->rate < best->rate ||
+                    (entry->rate == best->rate && entry->member_count < best->member_count))
+                    best = entry;
+            }
+            best->members[best->member_count++] = (uint16_t)ranked[i].index;
+            best->rate += ranked[i].rate;
+        }
+        free(ranked);
+    }
+
+    for (int s = 0; s < CONNECTION_SPARE_SLOTS; s++) {
+        ConnectionEntry *entry = add_entry(ex->exchange, ex->prefix, chunks + s, 1, capacity);
+        if (!entry) break;
+        entry->spare = 1;
+    }
+
+    printf("[INFO] %s: %d symbols on %d connection(s) (%s), %d spare\n", exchange_name(ex->exchange), ex->count, chunks,
+           known ? "packed by saved rates" : "default chunks", CONNECTION_SPARE_SLOTS);
+}
+
+int connection_table_build(const char *dir) {
+    for (int i = 0; i < CHUNKED_COUNT; i++) {
+        load_products(&chunked[i], dir);
+        load_rates(&chunked[i], dir);
+    }
+
+    /* Same order as the old fixed table: Binance, the single connections, Huobi, OKX */
+    layout_chunked(chunked_for(EXCHANGE_BINANCE));
+    add_entry(EXCHANGE_COINBASE, "coinbase-websocket", 0, 0, 0);
+    add_entry(EXCHANGE_KRAKEN, "kraken-websocket", 0, 0, 0);
+    add_entry(EXCHANGE_BITFINEX, "bitfinex-websocket", 0, 0, 0);
+    layout_chunked(chunked_for(EXCHANGE_HUOBI));
+    layout_chunked(chunked_for(EXCHANGE_OKX));
+
+    printf("[INFO] Connection table: %d connections\n", entry_count);
+    return entry_count ? entry_count : -1;
+}
+
+/* ---------------------------------- Lookups --------------------------------- */
+
+int connection_count(void) {
+    return entry_count;
+}
+
+const char *connection_name(int index) {
+    return (index >= 0 && index < entry_count) ? entries[index].name : "";
+}
+
+ExchangeId connection_exchange(int index) {
+    return (index >= 0 && index < entry_count) ? entries[index].exchange : EXCHANGE_UNKNOWN;
+}
+
+int connection_chunk(int index) {
+    return (index >= 0 && index < entry_count) ? entries[index].chunk : 0;
+}
+
+int connection_find(const char *name) {
+    for (int i = 0; i < entry_count; i++) {
+        if (strcmp(entries[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+int connection_is_spare(int index) {
+    return (index >= 0 && index < entry_count) ? entries[index].spare : 0;
+}
+
+int connection_symbol_count(int index) {
+    return (index >= 0 && index < entry_count) ? entries[index].member_count : 0;
+}
+
+const char *connection_symbol(int index, int i) {
+    const ConnectionEntry *entry = &entries[index];
+    return chunked_for(entry->exchange)->symbols[entry->members[i]].name;
+}
+
+void connection_table_count(uint16_t exchange_id, uint16_t symbol_id) {
+    if (exchange_id >= EXCHANGE_COUNT || symbol_id >= MAX_SYMBOLS) return;
+    __atomic_fetch_add(&record_counts[exchange_id][symbol_id], 1, __ATOMIC_RELAXED);
+}
+
+/* -------------------------------- Rebalancing ------------------------------- */
+
+/* Updates the smoothed rate of every symbol on a connection and the connection's total */
+static void sample_rates(ConnectionEntry *entry, double seconds) {
+    ChunkedExchange *ex = chunked_for(entry->exchange);
+    entry->rate = 0.0;
+
+    for (int i = 0; i < entry->member_count; i++) {
+        TableSymbol *symbol = &ex->symbols[entry->members[i]];
+        uint32_t count = __atomic_load_n(&record_counts[entry->exchange][symbol->symbol_id], __ATOMIC_RELAXED);
+        double rate = (double)(count - symbol->last_count) / seconds;
+        symbol->last_count = count;
+
+        /* rate and known are also read by connection_table_save() on the main thread */
+        double smoothed = symbol->sampled ? symbol->rate + RATE_SMOOTHING * (rate - symbol->rate) : rate;
+        __atomic_store(&symbol->rate, &smoothed, __ATOMIC_RELAXED);
+        __atomic_store_n(&symbol->known, 1, __ATOMIC_RELAXED);
+        symbol->sampled = 1;
+        entry->rate += smoothed;
+    }
+}
+
+/* A connection with a split in flight, as source or as target, is left alone */
+static int split_pending(int index) {
+    if (entries[index].split_from >= 0) return 1;
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].split_from == index) return 1;
+    }
+    return 0;
+}
+
+/* Moves about half of a connection's load to a spare on the same service thread */
+static void split_connection(int source, struct lws_context *context) {
+    ConnectionEntry *from = &entries[source];
+    ChunkedExchange *ex = chunked_for(from->exchange);
+
+    int target = -1;
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].exchange == from->exchange && entries[i].spare && ingest_context(i) == context) {
+            target = i;
+            break;
+        }
+    }
+    if (target < 0) {
+        printf("[WARNING] %s is saturated (%.0f records/s) but no spare connection is left on its service thread\n",
+               from->name, from->rate);
+        return;
+    }
+    ConnectionEntry *to = &entries[target];
+
+    RankedSymbol *ranked = malloc((size_t)from->member_count * sizeof(RankedSymbol));
+    if (!ranked) return;
+    for (int i = 0; i < from->member_count; i++) {
+        ranked[i].rate = ex->symbols[from->members[i]].rate;
+        ranked[i].index = from->members[i];
+    }
+    qsort(ranked, (size_t)from->member_count, sizeof(RankedSymbol), compare_ranked);
+
+    /* Hottest first, each to whichever side carries less so far (fewer symbols on a tie) */
+    int total = from->member_count;
+    double keep_rate = 0.0, move_rate = 0.0;
+    from->member_count = 0;
+    to->member_count = 0;
+    for (int i = 0; i < total; i++) {
+        int keep = (keep_rate < move_rate) || (keep_rate == move_rate && from->member_count <= to->member_count);
+        if (keep) {
+            from->members[from->member_count++] = (uint16_t)ranked[i].index;
+            keep_rate += ranked[i].rate;
+        } else {
+            to->members[to->member_count++] = (uint16_t)ranked[i].index;
+            move_rate += ranked[i].rate;
+        }
+    }
+    free(ranked);
+
+    printf("[INFO] %s at %.0f records/s: moving %d of %d symbols (%.0f records/s) to %s\n",
+           from->name, from->rate, to->member_count, total, move_rate, to->name);
+    from->rate = keep_rate;
+    to->rate = move_rate;
+    to->spare = 0;
+    to->split_from = source;
+    subscription_cache_rebuild(target);
+
+    if (reconnect_open(target) != 0)
+        reconnect_lost(target);
+}
+
+static void rebalance_tick(lws_sorted_usec_list_t *sul) {
+    RebalanceTimer *timer = lws_container_of(sul, RebalanceTimer, sul);
+    int64_t now = monotonic_ns();
+    double seconds = (double)(now - timer->last_ns) / 1e9;
+    timer->last_ns = now;
+
+    for (int i = 0; i < entry_count; i++) {
+        if (ingest_context(i) != timer->context || entries[i].member_count == 0) continue;
+        sample_rates(&entries[i], seconds);
+    }
+
+    for (int i = 0; i < entry_count; i++) {
+        if (ingest_context(i) != timer->context || entries[i].member_count < 2) continue;
+        if (entries[i].rate > CONNECTION_SATURATION_RATE && !split_pending(i))
+            split_connection(i, timer->context);
+    }
+
+    lws_sul_schedule(timer->context, 0, &timer->sul, rebalance_tick,
+                     (lws_usec_t)CONNECTION_REBALANCE_INTERVAL * LWS_US_PER_SEC);
+}
+
+void connection_table_established(int index) {
+    if (index < 0 || index >= entry_count) return;
+    int source = entries[index].split_from;
+    if (source < 0) return;
+
+    entries[index].split_from = -1;
+    subscription_cache_rebuild(source);
+
+    /* The source stays up; a reconnect would leave its remaining symbols uncovered meanwhile */
+    struct lws *wsi = reconnect_socket(source);
+    if (!wsi) return;
+    if (subscription_cache_unsubscribe(wsi, index) != 0) {
+        printf("[WARNING] Failed to unsubscribe %s from the symbols moved to %s\n",
+               entries[source].name, entries[index].name);
+        return;
+    }
+    printf("[INFO] %s is up; unsubscribed %s from its %d symbols, %d remain\n",
+           entries[index].name, entries[source].name, entries[index].member_count,
+           entries[source].member_count);
+}
+
+void connection_rebalance_start(void) {
+    int shards = ingest_service_threads();
+    int64_t now = monotonic_ns();
+    for (int shard = 0; shard < shards; shard++) {
+        rebalance_timers[shard].context = ingest_context(shard);
+        rebalance_timers[shard].last_ns = now;
+        lws_sul_schedule(rebalance_timers[shard].context, 0, &rebalance_timers[shard].sul, rebalance_tick,
+                         (lws_usec_t)CONNECTION_REBALANCE_INTERVAL * LWS_US_PER_SEC);
+    }
+}
+
+void connection_table_save(const char *dir) {
+    char path[256], temp[264];
+    snprintf(path, sizeof(path), "%s/%s", dir, CONNECTION_RATES_FILE);
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+
+    FILE *fp = fopen(temp, "w");
+    if (!fp) {
+        printf("[WARNING] Could not write symbol rates to %s\n", temp);
+        return;
+    }
+
+    int written = 0;
+    for (int e = 0; e < CHUNKED_COUNT; e++) {
+        const ChunkedExchange *ex = &chunked[e];
+        for (int i = 0; i < ex->count; i++) {
+            if (!__atomic_load_n(&ex->symbols[i].known, __ATOMIC_RELAXED)) continue;
+            double rate;
+            __atomic_load(&ex->symbols[i].rate, &rate, __ATOMIC_RELAXED);
+            fprintf(fp, "%s %s %.3f\n", exchange_name(ex->exchange), ex->symbols[i].name, rate);
+            written++;
+        }
+    }
+
+    if (fclose(fp) != 0 || rename(temp, path) != 0) {
+        printf("[WARNING] Could not write symbol rates to %s\n", path);
+        return;
+    }
+    printf("[INFO] Saved message rates of %d symbols to %s\n", written, path);
+}
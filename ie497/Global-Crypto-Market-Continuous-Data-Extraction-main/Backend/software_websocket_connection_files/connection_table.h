@@ -0,0 +1,103 @@
+/*
+ * Connection Table Header
+ *
+ * Declares the connection layout: one entry per WebSocket connection (lws
+ * protocol), generated at startup from the product lists written by
+ * `fetch_currency_id` instead of hard-coded protocol names. Chunked exchanges
+ * (Binance, Huobi, OKX) have their symbols packed by the message rate each
+ * symbol showed in earlier runs, and get spare entries that a saturated
+ * connection is split into while running.
+ *
+ * Features:
+ *  - connection_table_build(): Lays out every connection; call before the lws contexts exist.
+ *  - connection_name() / connection_exchange() / connection_chunk() / connection_find(): Lookups by index or name.
+ *  - connection_symbol_count() / connection_symbol(): Products a chunked connection subscribes to.
+ *  - connection_table_count(): Per-record counter behind the per-symbol message rates.
+ *  - connection_rebalance_start(): Per-service-thread timer that splits saturated connections.
+ *  - connection_table_save(): Persists per-symbol rates for the next startup's packing.
+ *
+ * Dependencies:
+ *  - market_record.h: ExchangeId.
+ *  - libwebsockets: lws timers on the service thread contexts.
+ *
+ * Usage:
+ *  - Built from `main.c`; read by `exchange_websocket.c`, `exchange_connect.c` and `exchange_reconnect.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef CONNECTION_TABLE_H
+#define CONNECTION_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "market_record.h"
+
+/* Most connections (lws protocols) the table can hold, spares included */
+#define MAX_CONNECTIONS 160
+
+/* Most active connections per chunked exchange, whatever the rates ask for */
+#define CONNECTION_MAX_CHUNKS 40
+
+/* Symbols per connection while no rates are known for an exchange (the old fixed split) */
+#define CONNECTION_DEFAULT_CHUNK 100
+
+/* Unused entries per chunked exchange that saturated connections are split into */
+#define CONNECTION_SPARE_SLOTS 8
+
+/* Records per second a connection is packed up to at startup */
+#define CONNECTION_TARGET_RATE 200.0
+
+/* Records per second above which a running connection is split in two */
+#define CONNECTION_SATURATION_RATE 400.0
+
+/* Seconds between rate samples (and split decisions) on each service thread */
+#define CONNECTION_REBALANCE_INTERVAL 30
+
+/* Per-symbol rates kept between runs, inside the currency files directory */
+#define CONNECTION_RATES_FILE "symbol_rates.txt"
+
+/* Seconds between saves of the rates while running */
+#define CONNECTION_RATES_SAVE_INTERVAL 300
+
+/* Lays out every connection from the product lists in `dir` and the saved rates.
+ * Returns the number of connections, or -1 if none could be laid out. */
+int connection_table_build(const char *dir);
+
+/* Number of connections, spares included; valid indices are [0, count). */
+int connection_count(void);
+
+/* Protocol name of a connection ("okx-websocket-3"), "" if out of range. */
+const char *connection_name(int index);
+
+ExchangeId connection_exchange(int index);
+
+/* Chunk number within its exchange (0 for single-connection exchanges). */
+int connection_chunk(int index);
+
+/* Index of the connection with this protocol name, or -1. */
+int connection_find(const char *name);
+
+/* Non-zero for a spare entry that has not been given any symbols yet. */
+int connection_is_spare(int index);
+
+/* Symbols a chunked connection subscribes to, in the exchange's own spelling. Read on its service thread. */
+int connection_symbol_count(int index);
+const char *connection_symbol(int index, int i);
+
+/* Counts one record for a symbol. Called for every record submitted to ingest. */
+void connection_table_count(uint16_t exchange_id, uint16_t symbol_id);
+
+/* A connection came up; a split target then unsubscribes its source from the moved symbols. */
+void connection_table_established(int index);
+
+/* Arms the rate sampler on every service thread; call before ingest_start(). */
+void connection_rebalance_start(void);
+
+/* Writes the per-symbol rates to `dir`/CONNECTION_RATES_FILE. Call from the main thread: every
+ * CONNECTION_RATES_SAVE_INTERVAL while running, and once the service threads stopped. */
+void connection_table_save(const char *dir);
+
+#endif // CONNECTION_TABLE_H
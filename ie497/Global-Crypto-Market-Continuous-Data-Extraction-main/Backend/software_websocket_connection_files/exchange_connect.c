@@ -9,6 +9,11 @@
  *  - Initializes WebSocket connections for real-time market data.
  *  - Supports multiple cryptocurrency exchanges.
  *  - Uses libwebsockets to establish secure connections.
+ *  - Places each connection on the lws context of its ingest service thread.
+ *  - connect_to_*() return 0 when the attempt started, -1 otherwise, so reconnects can retry.
+ *  - Chunked exchanges open the connections laid out by the connection table.
+ *  - Optional local endpoint override (`--endpoint HOST:PORT`) for replaying captures
+ *    from `replay_server`; each connection then asks for `/replay/<connection index>`.
  * 
  * Dependencies:
  *  - libwebsockets: Handles WebSocket communication.
@@ -19,33 +24,74 @@
  *  - Called by `exchange_reconnect.c` to reconnect upon failure.
  * 
  * Created: 3/11/2025
- * Updated: 5/12/2025
+ * Updated: 10/18/2026
  */
 
 #include "exchange_connect.h"
 #include "exchange_websocket.h"
 #include "utils.h"
+#include "ingest.h"
+#include "exchange_reconnect.h"
+#include "connection_table.h"
 #include <libwebsockets.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
 
-/* Global context reference from main.c */
-extern struct lws_context *context;
+/* Local endpoint replacing every exchange address when set (replay/load testing) */
+static char endpoint_host[128];
+static int endpoint_port = 0;
+
+int exchange_connect_set_endpoint(const char *endpoint) {
+    const char *colon = strrchr(endpoint, ':');
+    size_t host_len = colon ? (size_t)(colon - endpoint) : 0;
+    int port = colon ? atoi(colon + 1) : 0;
+    if (host_len == 0 || host_len >= sizeof(endpoint_host) || port <= 0 || port > 65535) {
+        printf("[ERROR] Invalid endpoint %s, expected HOST:PORT\n", endpoint);
+        return -1;
+    }
+
+    memcpy(endpoint_host, endpoint, host_len);
+    endpoint_host[host_len] = '\0';
+    endpoint_port = port;
+    printf("[INFO] All exchange connections redirected to ws://%s:%d\n", endpoint_host, endpoint_port);
+    return 0;
+}
 
+/* Points a connection at the override endpoint, if any, and opens it. The subprotocol header
+ * is dropped (the replay server has one protocol) and the connection index goes in the path. */
+static struct lws *open_connection(struct lws_client_connect_info *ccinfo) {
+    char path[64];
+    if (endpoint_port) {
+        snprintf(path, sizeof(path), "/replay/%d", get_exchange_index(ccinfo->protocol));
+        ccinfo->address = endpoint_host;
+        ccinfo->host = endpoint_host;
+        ccinfo->origin = endpoint_host;
+        ccinfo->port = endpoint_port;
+        ccinfo->path = path;
+        ccinfo->ssl_connection = 0;
+        ccinfo->local_protocol_name = ccinfo->protocol;
+        ccinfo->protocol = NULL;
+    }
+    return lws_client_connect_via_info(ccinfo);
+}
+
+/* Opens every connection the table gives an exchange, skipping spares */
+static void connect_chunks(ExchangeId exchange, int (*connect)(int index)) {
+    for (int i = 0; i < connection_count(); i++) {
+        if (connection_exchange(i) != exchange || connection_is_spare(i)) continue;
+        connect(connection_chunk(i));
+        usleep(50000);
+    }
+}
 
 /* Thread function to connect to each exchange */
 void* connect_to_exchange_thread(void* exchange_name) {
     const char* exchange = (const char*) exchange_name;
 
     if (strcmp(exchange, "binance") == 0) {
-        int total_symbols_binance = count_symbols_in_file("currency_text_files/binance_currency_ids_trades.txt");
-        int num_chunks_binance = (total_symbols_binance + 99) / 100;
-        for (int i = 0; i < num_chunks_binance; i++) {
-            connect_to_binance(i);
-            usleep(50000);
-        }   
+        connect_chunks(EXCHANGE_BINANCE, connect_to_binance);
     } else if (strcmp(exchange, "coinbase") == 0) {
         connect_to_coinbase();
         usleep(50000);
@@ -53,19 +99,9 @@ void* connect_to_exchange_thread(void* exchange_name) {
         connect_to_kraken();
         usleep(50000);
     } else if (strcmp(exchange, "huobi") == 0) {
-        int total_symbols_huobi = count_symbols_in_file("currency_text_files/huobi_currency_ids.txt");
-        int num_chunks_huobi = (total_symbols_huobi + 99) / 100;
-        for (int i = 0; i < num_chunks_huobi; i++) {
-            connect_to_huobi(i);
-            usleep(50000);
-        }    
+        connect_chunks(EXCHANGE_HUOBI, connect_to_huobi);
     } else if (strcmp(exchange, "okx") == 0) {
-        int total_symbols_okx = count_symbols_in_file("currency_text_files/okx_currency_ids.txt");
-        int num_chunks_okx = (total_symbols_okx + 99) / 100;
-        for (int i = 0; i < num_chunks_okx; i++) {
-            connect_to_okx(i);
-            usleep(50000);
-        }    
+        connect_chunks(EXCHANGE_OKX, connect_to_okx);
     }
 
     return NULL;
@@ -90,117 +126,129 @@ void start_exchange_connections() {
 }
 
 
-void connect_to_binance(int index) {
+int connect_to_binance(int index) {
     struct lws_client_connect_info ccinfo = {0};
-    ccinfo.context = context;
     ccinfo.address = "stream.binance.us";
     ccinfo.port = 9443;
     ccinfo.path = "/ws";
     ccinfo.host = "stream.binance.us";
     ccinfo.origin = "stream.binance.us";
 
-    static char protocol_name[32];
+    char protocol_name[32];   // lws copies connect strings; no static buffer shared between service threads
     snprintf(protocol_name, sizeof(protocol_name), "binance-websocket-%d", index);
     ccinfo.protocol = protocol_name;
+    ccinfo.context = ingest_context(get_exchange_index(ccinfo.protocol));
 
     ccinfo.ssl_connection = LCCSCF_USE_SSL;
 
-    if (!lws_client_connect_via_info(&ccinfo))
+    if (!open_connection(&ccinfo)) {
         printf("[ERROR] Failed to connect to Binance WebSocket server\n");
-    else
-        printf("[INFO] Connecting to Binance WebSocket...\n");
+        return -1;
+    }
+    printf("[INFO] Connecting to Binance WebSocket...\n");
+    return 0;
 }
 
-void connect_to_coinbase() {
+int connect_to_coinbase(void) {
     struct lws_client_connect_info ccinfo = {0};
-    ccinfo.context = context;
     ccinfo.address = "ws-feed.exchange.coinbase.com";
     ccinfo.port = 443;
     ccinfo.path = "/";
     ccinfo.host = "ws-feed.exchange.coinbase.com";
     ccinfo.origin = "ws-feed.exchange.coinbase.com";
     ccinfo.protocol = "coinbase-websocket";
+    ccinfo.context = ingest_context(get_exchange_index(ccinfo.protocol));
     ccinfo.ssl_connection = LCCSCF_USE_SSL;
 
-    if (!lws_client_connect_via_info(&ccinfo))
+    if (!open_connection(&ccinfo)) {
         printf("[ERROR] Failed to connect to Coinbase WebSocket server\n");
-    else
-        printf("[INFO] Connecting to Coinbase WebSocket...\n");
+        return -1;
+    }
+    printf("[INFO] Connecting to Coinbase WebSocket...\n");
+    return 0;
 }
 
-void connect_to_kraken() {
+int connect_to_kraken(void) {
     struct lws_client_connect_info ccinfo = {0};
-    ccinfo.context = context;
     ccinfo.address = "ws.kraken.com";
     ccinfo.port = 443;
     ccinfo.path = "/";
     ccinfo.host = "ws.kraken.com";
     ccinfo.origin = "ws.kraken.com";
     ccinfo.protocol = "kraken-websocket";
+    ccinfo.context = ingest_context(get_exchange_index(ccinfo.protocol));
     ccinfo.ssl_connection = LCCSCF_USE_SSL;
 
-    if (!lws_client_connect_via_info(&ccinfo))
+    if (!open_connection(&ccinfo)) {
         printf("[ERROR] Failed to connect to Kraken WebSocket server\n");
-    else
-        printf("[INFO] Connecting to Kraken WebSocket...\n");
+        return -1;
+    }
+    printf("[INFO] Connecting to Kraken WebSocket...\n");
+    return 0;
 }
 
-void connect_to_bitfinex() {
+int connect_to_bitfinex(void) {
     struct lws_client_connect_info ccinfo = {0};
-    ccinfo.context = context;
     ccinfo.address = "api-pub.bitfinex.com";
     ccinfo.port = 443;
     ccinfo.path = "/ws/2";
     ccinfo.host = "api-pub.bitfinex.com";
     ccinfo.origin = "api-pub.bitfinex.com";
     ccinfo.protocol = "bitfinex-websocket";
+    ccinfo.context = ingest_context(get_exchange_index(ccinfo.protocol));
     ccinfo.ssl_connection = LCCSCF_USE_SSL;
 
-    if (!lws_client_connect_via_info(&ccinfo))
+    if (!open_connection(&ccinfo)) {
         printf("[ERROR] Failed to connect to Bitfinex WebSocket server\n");
-    else
-        printf("[INFO] Connecting to Bitfinex WebSocket...\n");
+        return -1;
+    }
+    printf("[INFO] Connecting to Bitfinex WebSocket...\n");
+    return 0;
 }
 
-void connect_to_huobi(int index) {
+int connect_to_huobi(int index) {
     struct lws_client_connect_info ccinfo = {0};
-    ccinfo.context = context;
     ccinfo.address = "api.huobi.pro";
     ccinfo.port = 443;
     ccinfo.path = "/ws";
     ccinfo.host = "api.huobi.pro";
     ccinfo.origin = "api.huobi.pro";
     
-    static char protocol_name[32];
+    char protocol_name[32];   // lws copies connect strings; no static buffer shared between service threads
     snprintf(protocol_name, sizeof(protocol_name), "huobi-websocket-%d", index);
     ccinfo.protocol = protocol_name;
+    ccinfo.context = ingest_context(get_exchange_index(ccinfo.protocol));
 
     ccinfo.ssl_connection = LCCSCF_USE_SSL;
 
-    if (!lws_client_connect_via_info(&ccinfo))
+    if (!open_connection(&ccinfo)) {
         printf("[ERROR] Failed to connect to Huobi WebSocket [%s]\n", protocol_name);
-    else
-        printf("[INFO] Connecting to Huobi WebSocket [%s]...\n", protocol_name);
+        return -1;
+    }
+    printf("[INFO] Connecting to Huobi WebSocket [%s]...\n", protocol_name);
+    return 0;
 }
 
-void connect_to_okx(int index) {
+int connect_to_okx(int index) {
     struct lws_client_connect_info ccinfo = {0};
-    ccinfo.context = context;
     ccinfo.address = "ws.okx.com";
     ccinfo.port = 8443;
     ccinfo.path = "/ws/v5/public";
     ccinfo.host = "ws.okx.com";
     ccinfo.origin = "ws.okx.com";
 
-    static char protocol_name[32];
+    char protocol_name[32];   // lws copies connect strings; no static buffer shared between service threads
     snprintf(protocol_name, sizeof(protocol_name), "okx-websocket-%d", index);
     ccinfo.protocol = protocol_name;
+    ccinfo.context = ingest_context(get_exchange_index(ccinfo.protocol));
 
 
     ccinfo.ssl_connection = LCCSCF_USE_SSL;
 
-    if (!lws_client_connect_via_info(&ccinfo))
+    if (!open_connection(&ccinfo)) {
         printf("[ERROR] Failed to connect to OKX WebSocket server\n");
-    else
-        printf("[INFO] Connecting to OKX WebSocket...\n");
+        return -1;
+    }
+    printf("[INFO] Connecting to OKX WebSocket...\n");
+    return 0;
 }
@@ -7,6 +7,7 @@
  * Functionality:
  *  - Provides function prototypes for initiating WebSocket connections 
  *    for supported exchanges.
+ *  - exchange_connect_set_endpoint(): Redirects every connection to a local replay server.
  * 
  * Dependencies:
  *  - libwebsockets: Handles WebSocket connections.
@@ -16,7 +17,7 @@
  *  - Included in `main.c` and `exchange_reconnect.c` for connection handling.
  * 
  * Created: 3/11/2025
- * Updated: 5/12/2025
+ * Updated: 10/18/2026
  */
 
 #ifndef EXCHANGE_CONNECT_H
@@ -24,13 +25,16 @@
 
 #include <libwebsockets.h>
 
-/* Function prototypes for establishing WebSocket connections */
-void connect_to_binance();
-void connect_to_coinbase();
-void connect_to_kraken();
-void connect_to_bitfinex();
-void connect_to_huobi();
-void connect_to_okx();
+/* Function prototypes for establishing WebSocket connections; 0 if the attempt started, -1 if not */
+int connect_to_binance(int index);
+int connect_to_coinbase(void);
+int connect_to_kraken(void);
+int connect_to_bitfinex(void);
+int connect_to_huobi(int index);
+int connect_to_okx(int index);
 void start_exchange_connections();
 
+/* Sends every later connection to ws://HOST:PORT instead of the exchange. Returns 0, or -1 if malformed. */
+int exchange_connect_set_endpoint(const char *endpoint);
+
 #endif // EXCHANGE_CONNECT_H
@@ -0,0 +1,163 @@
+/*
+ * Exchange Field Tables
+ *
+ * This module holds the per-exchange FieldSpec tables that map JSON keys in
+ * ticker and trade messages onto `TickerData` / `TradeData` fields. Each table
+ * is handed to extract_fields() so a message is scanned only once, and each
+ * entry names the parser that turns the text into a fixed-point value,
+ * epoch-ns timestamp, boolean or interned symbol ID.
+ *
+ * Features:
+ *  - One table per (exchange, message kind) for Binance, Coinbase, Huobi and OKX.
+ *  - Kraken tables use JSON-pointer keys for extract_pointer_fields().
+ *  - Required fields decide whether a message is logged at all.
+ *  - String-only fields keep numeric keys of the same name from being captured.
+ *
+ * Dependencies:
+ *  - json_parser.h for FieldSpec.
+ *  - market_record.h for TickerData / TradeData and the field parsers.
+ *
+ * Usage:
+ *  - Used by `callback_combined()` in `exchange_websocket.c` and by `bench_json_parser.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "exchange_fields.h"
+
+#define FIELD_COUNT(table) (sizeof(table) / sizeof((table)[0]))
+
+const FieldSpec binance_trade_fields[] = {
+    TIME_MS_FIELD("E", TradeData, ts_ns,        FIELD_REQUIRED),
+    SYMBOL_FIELD("s",  TradeData, symbol_id,    FIELD_REQUIRED | FIELD_STRING),
+    FIXED_FIELD("p",   TradeData, price,        FIELD_REQUIRED | FIELD_STRING),
+    FIXED_FIELD("q",   TradeData, size,         FIELD_REQUIRED | FIELD_STRING),
+    FIXED_FIELD("t",   TradeData, trade_id,     FIELD_REQUIRED),
+    BOOL_FIELD("m",    TradeData, market_maker, FIELD_REQUIRED),
+};
+
+const FieldSpec binance_ticker_fields[] = {
+    TIME_MS_FIELD("E", TickerData, ts_ns,            FIELD_REQUIRED),
+    SYMBOL_FIELD("s",  TickerData, symbol_id,        FIELD_REQUIRED | FIELD_STRING),
+    FIXED_FIELD("c",   TickerData, price,            FIELD_REQUIRED | FIELD_STRING),
+    FIXED_FIELD("b",   TickerData, bid,              FIELD_STRING),
+    FIXED_FIELD("B",   TickerData, bid_qty,          FIELD_STRING),
+    FIXED_FIELD("a",   TickerData, ask,              FIELD_STRING),
+    FIXED_FIELD("A",   TickerData, ask_qty,          FIELD_STRING),
+    FIXED_FIELD("o",   TickerData, open_price,       FIELD_STRING),
+    FIXED_FIELD("h",   TickerData, high_price,       FIELD_STRING),
+    FIXED_FIELD("l",   TickerData, low_price,        FIELD_STRING),
+    FIXED_FIELD("v",   TickerData, volume_24h,       FIELD_STRING),
+    FIXED_FIELD("q",   TickerData, quote_volume,     FIELD_STRING),
+    FIXED_FIELD("t",   TickerData, last_trade_time,  FIELD_STRING),
+    FIXED_FIELD("p",   TickerData, last_trade_price, FIELD_STRING),
+    FIXED_FIELD("C",   TickerData, close_price,      FIELD_STRING),
+};
+
+const FieldSpec coinbase_trade_fields[] = {
+    TIME_ISO_FIELD("time",     TradeData, ts_ns,     FIELD_REQUIRED | FIELD_STRING),
+    SYMBOL_FIELD("product_id", TradeData, symbol_id, FIELD_REQUIRED | FIELD_STRING),
+    FIXED_FIELD("price",       TradeData, price,     FIELD_REQUIRED | FIELD_STRING),
+    FIXED_FIELD("size",        TradeData, size,      FIELD_REQUIRED | FIELD_STRING),
+    FIXED_FIELD("trade_id",    TradeData, trade_id,  0),
+};
+
+const FieldSpec coinbase_ticker_fields[] = {
+    TIME_ISO_FIELD("time",       TickerData, ts_ns,           FIELD_REQUIRED | FIELD_STRING),
+    SYMBOL_FIELD("product_id",   TickerData, symbol_id,       FIELD_REQUIRED | FIELD_STRING),
+    FIXED_FIELD("price",         TickerData, price,           FIELD_REQUIRED | FIELD_STRING),
+    FIXED_FIELD("best_bid",      TickerData, bid,             FIELD_STRING),
+    FIXED_FIELD("best_ask",      TickerData, ask,             FIELD_STRING),
+    FIXED_FIELD("best_bid_size", TickerData, bid_qty,         FIELD_STRING),
+    FIXED_FIELD("best_ask_size", TickerData, ask_qty,         FIELD_STRING),
+    FIXED_FIELD("open_24h",      TickerData, open_price,      FIELD_STRING),
+    FIXED_FIELD("high_24h",      TickerData, high_price,      FIELD_STRING),
+    FIXED_FIELD("low_24h",       TickerData, low_price,       FIELD_STRING),
+    FIXED_FIELD("volume_24h",    TickerData, volume_24h,      FIELD_STRING),
+    FIXED_FIELD("volume_30d",    TickerData, volume_30d,      FIELD_STRING),
+    FIXED_FIELD("trade_id",      TickerData, trade_id,        0),
+    FIXED_FIELD("last_size",     TickerData, last_trade_size, FIELD_STRING),
+};
+
+/* Huobi sends numbers unquoted; "ts" is the top-level message time in ms */
+const FieldSpec huobi_ticker_fields[] = {
+    FIXED_FIELD("close",   TickerData, price,      FIELD_REQUIRED),
+    TIME_MS_FIELD("ts",    TickerData, ts_ns,      0),
+    FIXED_FIELD("bid",     TickerData, bid,        0),
+    FIXED_FIELD("bidSize", TickerData, bid_qty,    0),
+    FIXED_FIELD("ask",     TickerData, ask,        0),
+    FIXED_FIELD("askSize", TickerData, ask_qty,    0),
+    FIXED_FIELD("open",    TickerData, open_price, 0),
+    FIXED_FIELD("high",    TickerData, high_price, 0),
+    FIXED_FIELD("low",     TickerData, low_price,  0),
+    FIXED_FIELD("amount",  TickerData, volume_24h, 0),
+};
+
+const FieldSpec huobi_trade_fields[] = {
+    FIXED_FIELD("price",  TradeData, price,    0),
+    FIXED_FIELD("amount", TradeData, size,     0),
+    TIME_MS_FIELD("ts",   TradeData, ts_ns,    0),
+    FIXED_FIELD("id",     TradeData, trade_id, 0),
+};
+
+const FieldSpec okx_ticker_fields[] = {
+    FIXED_FIELD("last",    TickerData, price,      FIELD_REQUIRED | FIELD_STRING),
+    SYMBOL_FIELD("instId", TickerData, symbol_id,  FIELD_REQUIRED | FIELD_STRING),
+    FIXED_FIELD("bidPx",   TickerData, bid,        FIELD_STRING),
+    FIXED_FIELD("bidSz",   TickerData, bid_qty,    FIELD_STRING),
+    FIXED_FIELD("askPx",   TickerData, ask,        FIELD_STRING),
+    FIXED_FIELD("askSz",   TickerData, ask_qty,    FIELD_STRING),
+    FIXED_FIELD("open24h", TickerData, open_price, FIELD_STRING),
+    FIXED_FIELD("high24h", TickerData, high_price, FIELD_STRING),
+    FIXED_FIELD("low24h",  TickerData, low_price,  FIELD_STRING),
+    FIXED_FIELD("vol24h",  TickerData, volume_24h, FIELD_STRING),
+    TIME_MS_FIELD("ts",    TickerData, ts_ns,      FIELD_STRING),
+};
+
+const FieldSpec okx_trade_fields[] = {
+    FIXED_FIELD("px",      TradeData, price,     FIELD_REQUIRED | FIELD_STRING),
+    SYMBOL_FIELD("instId", TradeData, symbol_id, FIELD_REQUIRED | FIELD_STRING),
+    FIXED_FIELD("sz",      TradeData, size,      FIELD_STRING),
+    FIXED_FIELD("tradeId", TradeData, trade_id,  FIELD_STRING),
+    TIME_MS_FIELD("ts",    TradeData, ts_ns,     FIELD_STRING),
+};
+
+/* Kraken messages are positional; keys are JSON pointers below the payload element */
+const FieldSpec kraken_ticker_fields[] = {
+    FIXED_FIELD("/c/0", TickerData, price,      FIELD_REQUIRED | FIELD_STRING),
+    FIXED_FIELD("/c/1", TickerData, last_vol,   FIELD_STRING),
+    FIXED_FIELD("/b/0", TickerData, bid,        FIELD_STRING),
+    FIXED_FIELD("/b/1", TickerData, bid_whole,  0),
+    FIXED_FIELD("/b/2", TickerData, bid_qty,    FIELD_STRING),
+    FIXED_FIELD("/a/0", TickerData, ask,        FIELD_STRING),
+    FIXED_FIELD("/a/1", TickerData, ask_whole,  0),
+    FIXED_FIELD("/a/2", TickerData, ask_qty,    FIELD_STRING),
+    FIXED_FIELD("/v/0", TickerData, vol_today,  FIELD_STRING),
+    FIXED_FIELD("/v/1", TickerData, volume_24h, FIELD_STRING),
+    FIXED_FIELD("/p/0", TickerData, vwap_today, FIELD_STRING),
+    FIXED_FIELD("/p/1", TickerData, vwap_24h,   FIELD_STRING),
+    FIXED_FIELD("/l/0", TickerData, low_today,  FIELD_STRING),
+    FIXED_FIELD("/l/1", TickerData, low_price,  FIELD_STRING),
+    FIXED_FIELD("/h/0", TickerData, high_today, FIELD_STRING),
+    FIXED_FIELD("/h/1", TickerData, high_price, FIELD_STRING),
+    FIXED_FIELD("/o/0", TickerData, open_today, FIELD_STRING),
+};
+
+/* One element of the trade list: [price, volume, time, side, orderType, misc] */
+const FieldSpec kraken_trade_fields[] = {
+    FIXED_FIELD("/0",        TradeData, price, FIELD_REQUIRED | FIELD_STRING),
+    FIXED_FIELD("/1",        TradeData, size,  FIELD_STRING),
+    TIME_SECONDS_FIELD("/2", TradeData, ts_ns, FIELD_STRING),
+};
+
+const size_t binance_trade_field_count = FIELD_COUNT(binance_trade_fields);
+const size_t binance_ticker_field_count = FIELD_COUNT(binance_ticker_fields);
+const size_t coinbase_trade_field_count = FIELD_COUNT(coinbase_trade_fields);
+const size_t coinbase_ticker_field_count = FIELD_COUNT(coinbase_ticker_fields);
+const size_t huobi_ticker_field_count = FIELD_COUNT(huobi_ticker_fields);
+const size_t huobi_trade_field_count = FIELD_COUNT(huobi_trade_fields);
+const size_t okx_ticker_field_count = FIELD_COUNT(okx_ticker_fields);
+const size_t okx_trade_field_count = FIELD_COUNT(okx_trade_fields);
+const size_t kraken_ticker_field_count = FIELD_COUNT(kraken_ticker_fields);
+const size_t kraken_trade_field_count = FIELD_COUNT(kraken_trade_fields);
@@ -0,0 +1,57 @@
+/*
+ * Exchange Field Tables Header
+ *
+ * Declares the per-exchange FieldSpec tables used with extract_fields() to
+ * fill `TickerData` and `TradeData` records in a single pass per message.
+ *
+ * Dependencies:
+ *  - json_parser.h: FieldSpec and extract_fields().
+ *  - market_record.h: TickerData, TradeData and the field parsers.
+ *
+ * Usage:
+ *  - Included by `exchange_websocket.c` and `bench_json_parser.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef EXCHANGE_FIELDS_H
+#define EXCHANGE_FIELDS_H
+
+#include <stddef.h>
+
+#include "json_parser.h"
+#include "market_record.h"
+
+/* Per-exchange ticker/trade field tables and their entry counts */
+extern const FieldSpec binance_trade_fields[];
+extern const size_t binance_trade_field_count;
+
+extern const FieldSpec binance_ticker_fields[];
+extern const size_t binance_ticker_field_count;
+
+extern const FieldSpec coinbase_trade_fields[];
+extern const size_t coinbase_trade_field_count;
+
+extern const FieldSpec coinbase_ticker_fields[];
+extern const size_t coinbase_ticker_field_count;
+
+extern const FieldSpec huobi_ticker_fields[];
+extern const size_t huobi_ticker_field_count;
+
+extern const FieldSpec huobi_trade_fields[];
+extern const size_t huobi_trade_field_count;
+
+extern const FieldSpec okx_ticker_fields[];
+extern const size_t okx_ticker_field_count;
+
+extern const FieldSpec okx_trade_fields[];
+extern const size_t okx_trade_field_count;
+
+extern const FieldSpec kraken_ticker_fields[];
+extern const size_t kraken_ticker_field_count;
+
+extern const FieldSpec kraken_trade_fields[];
+extern const size_t kraken_trade_field_count;
+
+#endif // EXCHANGE_FIELDS_H
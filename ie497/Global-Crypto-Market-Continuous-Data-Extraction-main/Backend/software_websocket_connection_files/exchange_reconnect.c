@@ -1,153 +1,292 @@
 /*
  * Exchange Reconnection Handler
  * 
- * This module monitors WebSocket health for each exchange and manages reconnection logic
- * using retry counters and time-based checks to maintain stable data streams.
+ * This module monitors WebSocket health for each exchange and manages reconnection logic.
+ * Everything runs on lws timers (sorted usec lists) of the service thread that owns the
+ * connection, so no thread sleeps and every connection backs off independently.
  * 
  * Features:
  *  - Tracks last message timestamp per exchange.
- *  - Performs reconnection with retry backoff on data loss or disconnection.
- *  - Runs a background health-check thread to ensure real-time connectivity.
+ *  - Reconnects with jittered exponential backoff (RECONNECT_BASE_MS doubling up to RECONNECT_MAX_MS).
+ *  - Spaces connection attempts per exchange to stay inside its connection-rate limit.
+ *  - Periodic no-data check per service thread; stale sockets are closed and reconnected.
+ *  - Reports how long it took for every lost connection to come back after an outage.
+ *  - Connections and their names come from the connection table (`connection_table.c`).
+ *  - Each scheduled attempt is counted in the connection's latency stats (`latency_stats.c`).
  * 
  * Dependencies:
- *  - Standard C libraries (stdio, string, time, unistd, pthread).
+ *  - libwebsockets: lws_sul_schedule() timers, lws_set_timeout() to drop stale sockets.
+ *  - Standard C libraries (stdio, string, stdlib, time, pthread).
  * 
  * Usage:
- *  - Called by `exchange_websocket.c` when connections drop or time out.
+ *  - Called by `exchange_websocket.c` when connections come up, drop or fail.
  *  - Relies on `exchange_connect.c` to reinitiate WebSocket sessions.
+ *  - `start_health_monitor()` is called from `main.c` before the service threads start.
  * 
  * Created: 3/11/2025
- * Updated: 5/8/2025
+ * Updated: 10/18/2026
  */
 
  #include "exchange_reconnect.h"
  #include "exchange_connect.h"
+ #include "market_record.h"
+ #include "ingest.h"
+ #include "connection_table.h"
+ #include "latency_stats.h"
  
  #include <stdio.h>
  #include <string.h>
- #include <unistd.h>
  #include <stdlib.h>
+ #include <stddef.h>
  #include <time.h>
  #include <pthread.h>
  
  #define NO_DATA_TIMEOUT 60              // seconds without data before reconnect
- #define HEALTH_CHECK_INTERVAL 30        // interval between health checks (seconds)
+ #define HEALTH_CHECK_INTERVAL 5         // interval between health checks (seconds)
+
+ /* Backoff: a random delay in [d/2, d], d = RECONNECT_BASE_MS * 2^retries capped at RECONNECT_MAX_MS */
+ #define RECONNECT_BASE_MS 500
+ #define RECONNECT_MAX_MS 30000
  
- /* Track retry count for each exchange */
- ExchangeRetry retry_counts[MAX_EXCHANGES] = {
-     {"binance-websocket-0", 0},
-     {"binance-websocket-1", 0},
-     {"binance-websocket-2", 0},
-     {"binance-websocket-3", 0},
-     {"binance-websocket-4", 0},
-     {"binance-websocket-5", 0},
-     {"coinbase-websocket", 0},
-     {"kraken-websocket", 0},
-     {"bitfinex-websocket", 0},
-     {"huobi-websocket-0", 0},
-     {"huobi-websocket-1", 0},
-     {"huobi-websocket-2", 0},
-     {"huobi-websocket-3", 0},
-     {"huobi-websocket-4", 0},
-     {"huobi-websocket-5", 0},
-     {"huobi-websocket-6", 0},
-     {"huobi-websocket-7", 0},
-     {"huobi-websocket-8", 0},
-     {"huobi-websocket-9", 0},
-     {"huobi-websocket-10", 0},
-     {"huobi-websocket-11", 0},
-     {"huobi-websocket-12", 0},
-     {"huobi-websocket-13", 0},
-     {"huobi-websocket-14", 0},
-     {"huobi-websocket-15", 0},
-     {"huobi-websocket-16", 0},
-     {"huobi-websocket-17", 0},
-     {"huobi-websocket-18", 0},
-     {"huobi-websocket-19", 0},
-     {"okx-websocket-0", 0},
-     {"okx-websocket-1", 0},
-     {"okx-websocket-2", 0},
-     {"okx-websocket-3", 0},
-     {"okx-websocket-4", 0},
-     {"okx-websocket-5", 0},
-     {"okx-websocket-6", 0},
-     {"okx-websocket-7", 0}
- };
+ /* Retry count per connection, filled from the connection table by reconnect_init() */
+ ExchangeRetry retry_counts[MAX_EXCHANGES];
  
- /* Background monitor thread */
- pthread_t health_check_thread;
+ /* Minimum gap between connection attempts to one exchange (ms), from each exchange's connect limits */
+ static const int connect_spacing_ms[EXCHANGE_COUNT] = {
+     [EXCHANGE_UNKNOWN] = 1000,
+     [EXCHANGE_BINANCE] = 200,
+     [EXCHANGE_COINBASE] = 500,
+     [EXCHANGE_KRAKEN] = 500,
+     [EXCHANGE_BITFINEX] = 500,
+     [EXCHANGE_HUOBI] = 200,
+     [EXCHANGE_OKX] = 350,
+ };
+
+ /* Reconnect state of one connection; only touched on its own service thread */
+ typedef struct {
+     lws_sorted_usec_list_t sul;         // reconnect timer on the connection's context
+     struct lws *wsi;                    // live socket, NULL while down
+     int pending;                        // a reconnect timer is armed
+     int established_once;               // outages are only timed after the first connect
+     int64_t down_ns;                    // when the connection was lost, 0 while up
+ } ConnectionState;
+
+ /* Periodic no-data check, one per service thread */
+ typedef struct {
+     lws_sorted_usec_list_t sul;
+     struct lws_context *context;
+ } HealthTimer;
 
  time_t last_message_time[MAX_EXCHANGES] = {0};
+
+ static ConnectionState connection_state[MAX_EXCHANGES];
+ static HealthTimer health_timers[INGEST_MAX_SERVICE_THREADS];
+
+ /* Shared between service threads: per-exchange attempt slots and outage accounting */
+ static pthread_mutex_t reconnect_lock = PTHREAD_MUTEX_INITIALIZER;
+ static int64_t next_connect_ns[EXCHANGE_COUNT];
+ static int connections_down = 0;
+ static int outage_peak = 0;
+ static int64_t outage_start_ns = 0;
+ static ReconnectStats stats;
+ static volatile int reconnect_disabled = 0;
+
+ static __thread uint64_t jitter_state = 0;
+
+ static int64_t monotonic_ns(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+ }
+
+ /* xorshift64, seeded per thread */
+ static uint64_t jitter_next(void) {
+     if (!jitter_state) jitter_state = (uint64_t)monotonic_ns() | 1;
+     jitter_state ^= jitter_state << 13;
+     jitter_state ^= jitter_state >> 7;
+     jitter_state ^= jitter_state << 17;
+     return jitter_state;
+ }
  
  /* Find retry count index for an exchange */
  int get_exchange_index(const char *exchange) {
-     for (int i = 0; i < MAX_EXCHANGES; i++) {
-         if (strcmp(retry_counts[i].exchange, exchange) == 0) {
-             return i;
+     return connection_find(exchange);
+ }
+
+ /* Chunk number at the end of a protocol name ("okx-websocket-7" -> 7), 0 if there is none */
+ int get_chunk_index(const char *exchange) {
+     const char *dash = strrchr(exchange, '-');
+     return (dash && dash[1] >= '0' && dash[1] <= '9') ? atoi(dash + 1) : 0;
+ }
+
+ void reconnect_init(void) {
+     for (int i = 0; i < connection_count(); i++) {
+         retry_counts[i].exchange = connection_name(i);
+         retry_counts[i].retry_count = 0;
+     }
+ }
+
+ /* Opens the connection with this index; returns 0 if the attempt started */
+ int reconnect_open(int index) {
+     int chunk = connection_chunk(index);
+
+     switch (connection_exchange(index)) {
+         case EXCHANGE_BINANCE:  return connect_to_binance(chunk);
+         case EXCHANGE_COINBASE: return connect_to_coinbase();
+         case EXCHANGE_KRAKEN:   return connect_to_kraken();
+         case EXCHANGE_BITFINEX: return connect_to_bitfinex();
+         case EXCHANGE_HUOBI:    return connect_to_huobi(chunk);
+         case EXCHANGE_OKX:      return connect_to_okx(chunk);
+         default:                return -1;
+     }
+ }
+
+ /* Backoff for the next attempt, then pushed back to the exchange's next free connect slot */
+ static int64_t reconnect_delay_ns(int index, int64_t now) {
+     int retries = retry_counts[index].retry_count;
+     int64_t backoff_ms = (retries >= 6) ? RECONNECT_MAX_MS : (int64_t)RECONNECT_BASE_MS << retries;
+     if (backoff_ms > RECONNECT_MAX_MS) backoff_ms = RECONNECT_MAX_MS;
+     int64_t backoff_ns = backoff_ms * 1000000LL;
+     backoff_ns = backoff_ns / 2 + (int64_t)(jitter_next() % (uint64_t)(backoff_ns / 2 + 1));
+
+     ExchangeId exchange = connection_exchange(index);
+     int64_t at = now + backoff_ns;
+
+     pthread_mutex_lock(&reconnect_lock);
+     if (at < next_connect_ns[exchange]) at = next_connect_ns[exchange];
+     next_connect_ns[exchange] = at + (int64_t)connect_spacing_ms[exchange] * 1000000LL;
+     pthread_mutex_unlock(&reconnect_lock);
+
+     return at - now;
+ }
+
+ static void reconnect_fire(lws_sorted_usec_list_t *sul) {
+     ConnectionState *state = lws_container_of(sul, ConnectionState, sul);
+     int index = (int)(state - connection_state);
+     state->pending = 0;
+
+     pthread_mutex_lock(&reconnect_lock);
+     stats.attempts++;
+     pthread_mutex_unlock(&reconnect_lock);
+
+     if (reconnect_open(index) != 0)
+         reconnect_lost(index);
+ }
+
+ void reconnect_lost(int index) {
+     if (index < 0 || index >= connection_count()) return;
+     ConnectionState *state = &connection_state[index];
+     state->wsi = NULL;
+     if (state->pending || reconnect_disabled) return;   // CLOSED and CONNECTION_ERROR can both report one attempt
+
+     int64_t now = monotonic_ns();
+     if (state->established_once && !state->down_ns) {
+         state->down_ns = now;
+         pthread_mutex_lock(&reconnect_lock);
+         if (connections_down++ == 0) {
+             outage_start_ns = now;
+             outage_peak = 0;
          }
+         if (connections_down > outage_peak) outage_peak = connections_down;
+         pthread_mutex_unlock(&reconnect_lock);
      }
-     return -1;
+
+     int64_t delay = reconnect_delay_ns(index, now);
+     retry_counts[index].retry_count++;
+     latency_reconnect(index, retry_counts[index].retry_count);
+     state->pending = 1;
+
+     printf("[INFO] Reconnecting %s in %lld ms (attempt %d)\n", retry_counts[index].exchange,
+            (long long)(delay / 1000000), retry_counts[index].retry_count);
+     lws_sul_schedule(ingest_context(index), 0, &state->sul, reconnect_fire, delay / 1000);
  }
- 
- /* Schedule reconnection with per-exchange retry count */
+
+ void reconnect_connected(int index, struct lws *wsi) {
+     if (index < 0 || index >= connection_count()) return;
+     ConnectionState *state = &connection_state[index];
+     state->wsi = wsi;
+     state->established_once = 1;
+     retry_counts[index].retry_count = 0;
+     last_message_time[index] = time(NULL);
+
+     if (!state->down_ns) return;
+
+     int64_t now = monotonic_ns();
+     int64_t recovery = now - state->down_ns;
+     state->down_ns = 0;
+
+     pthread_mutex_lock(&reconnect_lock);
+     stats.recoveries++;
+     stats.recovery_total_ns += (uint64_t)recovery;
+     if ((uint64_t)recovery > stats.recovery_max_ns) stats.recovery_max_ns = (uint64_t)recovery;
+
+     int all_back = (--connections_down == 0);
+     int peak = outage_peak;
+     if (all_back) stats.last_outage_ns = (uint64_t)(now - outage_start_ns);
+     pthread_mutex_unlock(&reconnect_lock);
+
+     if (all_back)
+         printf("[INFO] All %d lost connection(s) recovered in %.1f ms\n", peak, (double)(now - outage_start_ns) / 1e6);
+ }
+
+ /* Schedule reconnection for a connection by protocol name */
  void schedule_reconnect(const char *exchange) {
      int index = get_exchange_index(exchange);
      if (index == -1) {
          printf("[ERROR] Unknown exchange: %s\n", exchange);
          return;
      }
- 
-     int wait_time = retry_counts[index].retry_count;
-     if (wait_time > 10) wait_time = 10;
- 
-     printf("[INFO] Attempting to reconnect to %s in %d seconds...\n", exchange, wait_time);
-     sleep(wait_time);
-     retry_counts[index].retry_count++;
- 
-    if (strncmp(exchange, "binance-websocket-", 18) == 0) {
-        int chunk_index_binance = atoi(exchange + 18);
-        connect_to_okx(chunk_index_binance);
-     } else if (strcmp(exchange, "coinbase-websocket") == 0) {
-         connect_to_coinbase();
-     } else if (strcmp(exchange, "kraken-websocket") == 0) {
-         connect_to_kraken();
-     } else if (strcmp(exchange, "bitfinex-websocket") == 0) {
-         connect_to_bitfinex();
-     } else if (strncmp(exchange, "huobi-websocket-", 17) == 0) {
-         int chunk_index_huobi = atoi(exchange + 17);
-         connect_to_huobi(chunk_index_huobi);
-     } else if (strncmp(exchange, "okx-websocket-", 15) == 0) {
-         int chunk_index_okx = atoi(exchange + 15);
-         connect_to_okx(chunk_index_okx);
-     }
+     reconnect_lost(index);
  }
- 
- /* Monitor thread to detect no-data timeouts */
- void* monitor_exchange_health(void *arg) {
-    (void)arg;
-     while (1) {
-         time_t now = time(NULL);
-         for (int i = 0; i < MAX_EXCHANGES; i++) {
-             if (last_message_time[i] == 0) continue;
- 
-             if (now - last_message_time[i] > NO_DATA_TIMEOUT) {
-                 printf("[WARNING] No data from %s in %ld seconds. Reconnecting...\n",
-                        retry_counts[i].exchange, now - last_message_time[i]);
- 
-                 schedule_reconnect(retry_counts[i].exchange);
-                 last_message_time[i] = now;
-             }
+
+ void reconnect_recycle(int index) {
+     if (index < 0 || index >= connection_count() || !connection_state[index].wsi) return;
+     lws_set_timeout(connection_state[index].wsi, PENDING_TIMEOUT_USER_OK, LWS_TO_KILL_ASYNC);
+ }
+
+ struct lws *reconnect_socket(int index) {
+     if (index < 0 || index >= connection_count()) return NULL;
+     return connection_state[index].wsi;
+ }
+
+ /* Closes sockets of this service thread that went quiet; their CLOSED callback reconnects them */
+ static void health_check(lws_sorted_usec_list_t *sul) {
+     HealthTimer *timer = lws_container_of(sul, HealthTimer, sul);
+     time_t now = time(NULL);
+
+     for (int i = 0; i < connection_count(); i++) {
+         if (ingest_context(i) != timer->context) continue;
+         if (!connection_state[i].wsi || last_message_time[i] == 0) continue;
+
+         if (now - last_message_time[i] > NO_DATA_TIMEOUT) {
+             printf("[WARNING] No data from %s in %ld seconds. Reconnecting...\n",
+                    retry_counts[i].exchange, (long)(now - last_message_time[i]));
+             reconnect_recycle(i);
+             last_message_time[i] = now;
          }
-         sleep(HEALTH_CHECK_INTERVAL);
      }
-     return NULL;
+
+     lws_sul_schedule(timer->context, 0, &timer->sul, health_check, (lws_usec_t)HEALTH_CHECK_INTERVAL * LWS_US_PER_SEC);
  }
- 
- /* Start background health monitor */
+
+ /* Arms the health check on every service thread's context; call before the service threads start */
  void start_health_monitor() {
-     if (pthread_create(&health_check_thread, NULL, monitor_exchange_health, NULL) != 0) {
-         fprintf(stderr, "[ERROR] Failed to start exchange health monitor thread\n");
-     } else {
-         printf("[INFO] Exchange health monitor thread started\n");
+     int shards = ingest_service_threads();
+     for (int shard = 0; shard < shards; shard++) {
+         health_timers[shard].context = ingest_context(shard);
+         lws_sul_schedule(health_timers[shard].context, 0, &health_timers[shard].sul, health_check,
+                          (lws_usec_t)HEALTH_CHECK_INTERVAL * LWS_US_PER_SEC);
      }
- } 
\ No newline at end of file
+     printf("[INFO] Exchange health monitor armed on %d service thread(s)\n", shards);
+ }
+
+ void reconnect_shutdown(void) {
+     reconnect_disabled = 1;
+ }
+
+ void reconnect_stats(ReconnectStats *out) {
+     pthread_mutex_lock(&reconnect_lock);
+     *out = stats;
+     out->down = connections_down;
+     pthread_mutex_unlock(&reconnect_lock);
+ }
@@ -5,27 +5,34 @@
  * endpoints for cryptocurrency exchanges after timeouts or failures.
  * 
  * Features:
- *  - Tracks retry attempts and message timestamps per exchange.
- *  - Supports scheduled reconnection with incremental backoff.
- *  - Launches a health monitor thread to check connection status.
+ *  - Tracks retry attempts and message timestamps per connection (connection table index).
+ *  - Reconnects on the owning service thread's lws timers with jittered exponential backoff.
+ *  - Per-exchange spacing of connection attempts (connection-rate budget).
+ *  - Arms a periodic no-data check on every service thread.
+ *  - Outage recovery statistics (time until every lost connection is back).
  * 
  * Dependencies:
- *  - Standard C libraries (time.h).
+ *  - libwebsockets: lws timers and socket handles.
+ *  - Standard C libraries (time.h, stdint.h).
  * 
  * Usage:
- *  - Included by `exchange_reconnect.c` and used in `exchange_websocket.c`.
+ *  - Included by `exchange_reconnect.c` and used in `exchange_websocket.c` and `main.c`.
  * 
  * Created: 3/11/2025
- * Updated: 5/4/2025
+ * Updated: 10/18/2026
  */
 
 #include <time.h>
+#include <stdint.h>
+#include <libwebsockets.h>
+
+#include "connection_table.h"
 
 #ifndef EXCHANGE_RECONNECT_H
 #define EXCHANGE_RECONNECT_H
 
-/* Maximum number of supported exchanges */
-#define MAX_EXCHANGES 37
+/* Capacity of the per-connection arrays; connection_count() of them are in use */
+#define MAX_EXCHANGES MAX_CONNECTIONS
 
 /* Structure to store retry count per exchange */
 typedef struct {
@@ -33,17 +40,52 @@ typedef struct {
     int retry_count;
 } ExchangeRetry;
 
+/* Reconnect counters over every connection */
+typedef struct {
+    uint64_t attempts;          // reconnect attempts started
+    uint64_t recoveries;        // lost connections that came back
+    uint64_t recovery_total_ns; // loss to re-establish, summed over `recoveries`
+    uint64_t recovery_max_ns;
+    uint64_t last_outage_ns;    // first loss to last recovery of the most recent outage
+    int down;                   // connections currently lost
+} ReconnectStats;
+
 /* Declare retry_counts as a global variable */
 extern ExchangeRetry retry_counts[MAX_EXCHANGES];
 
 /* Track last message time */
 extern time_t last_message_time[MAX_EXCHANGES];
 
+/* Names retry_counts[] after the connection table; call once the table is built. */
+void reconnect_init(void);
+
 /* Function prototypes */
 int get_exchange_index(const char *exchange);
+int get_chunk_index(const char *exchange);
 void schedule_reconnect(const char *exchange);
 
-/* Global WebSocket context */
+/* A connection came up: resets its backoff and records recovery time. Call on its service thread. */
+void reconnect_connected(int index, struct lws *wsi);
+
+/* A connection closed or failed: schedules the next attempt. Call on its service thread. */
+void reconnect_lost(int index);
+
+/* Opens a connection by index. Returns 0 if the attempt started. Call on its service thread. */
+int reconnect_open(int index);
+
+/* Closes a live connection so that it reconnects (and resubscribes). Call on its service thread. */
+void reconnect_recycle(int index);
+
+/* A connection's live socket, or NULL while it is down. Use on its service thread. */
+struct lws *reconnect_socket(int index);
+
+/* Stops scheduling reconnects (shutdown). */
+void reconnect_shutdown(void);
+
+/* Snapshot of the reconnect counters. */
+void reconnect_stats(ReconnectStats *stats);
+
+/* Arms the no-data check on every service thread; call before ingest_start(). */
 void start_health_monitor();
 
 #endif // EXCHANGE_RECONNECT_H
@@ -6,11 +6,24 @@
  * 
  * Features:
  *  - Unified callback (`callback_combined`) for all supported exchanges.
+ *  - Dispatches on per-session state (exchange ID, connection index) instead of protocol names.
  *  - Exchange-specific message handling for Binance, Coinbase, Kraken, OKX, Huobi, and Bitfinex.
- *  - Parses JSON (including nested arrays) and decompresses gzip payloads.
- *  - Logs parsed trades and tickers to JSON output and BSON files for storage.
- *  - Supports chunked subscription logic and multi-channel stream merging.
- *  - Robust reconnection and heartbeat handling across all protocols.
+ *  - Parses JSON (including nested arrays) and decompresses gzip payloads with a
+ *    reusable per-connection inflate stream (`inflate_stream.c`).
+ *  - Per-exchange field tables (`exchange_fields.c`) fed to the single-pass extractor.
+ *  - Fills binary fixed-point records; text is produced only when writing BSON/JSON.
+ *  - Hands parsed trades and tickers to the ingest writer threads for JSON/BSON output.
+ *  - `handle_exchange_message()` is callable without a socket, for capture replay benchmarks.
+ *  - Optionally records every raw frame to a capture file (`capture.c`); messages split
+ *    across receive callbacks are reassembled first.
+ *  - Parses depth channels into the local order books (`order_book.c`) when enabled.
+ *  - Times every frame through the callback and counts frames, bytes and parse failures
+ *    per connection (`latency_stats.c`).
+ *  - Supports chunked subscription logic and multi-channel stream merging; Binance, Huobi
+ *    and OKX chunks subscribe to the symbols the connection table gives them.
+ *  - Sends subscriptions precompiled by `subscription_cache.c` and times each connection's first record.
+ *  - Robust reconnection and heartbeat handling across all protocols; reconnects are
+ *    scheduled on the service thread's timers by `exchange_reconnect.c`.
  * 
  * Dependencies:
  *  - libwebsockets: WebSocket communication.
@@ -20,11 +33,12 @@
  *  - Standard C libraries (stdio, string, stdlib, errno).
  * 
  * Usage:
- *  - Entry point for WebSocket activity in `main.c`, registered via `protocols[]`.
- *  - Requires ID lists in `currency_text_files/` for building subscriptions.
+ *  - Entry point for WebSocket activity in `main.c`, registered via `protocols[]`
+ *    (built from the connection table by `build_protocols()`).
+ *  - Subscriptions come from the cache built at startup from `currency_text_files/`.
  * 
  * Created: 3/7/2025
- * Updated: 5/11/2025
+ * Updated: 10/18/2026
  */
 
 #include "exchange_websocket.h"
@@ -32,11 +46,21 @@
 #include "utils.h"
 #include "exchange_connect.h"
 #include "exchange_reconnect.h"
+#include "bson_writer.h"
+#include "exchange_fields.h"
+#include "json_scan.h"
+#include "capture.h"
+#include "ingest.h"
+#include "connection_table.h"
+#include "subscription_cache.h"
+#include "order_book.h"
+#include "latency_stats.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 
 #include <jansson.h>
 #include <stdbool.h>
@@ -46,857 +70,573 @@
 #include <bson/bson.h>
 
 
-/* Build a subscription message by reading a single file and formatting it into a template string */
-char* build_subscription_from_file(const char *filename, const char *template_fmt) {
-    FILE *fp = fopen(filename, "r");
-    if (!fp) {
-        fprintf(stderr, "[ERROR] Could not open %s\n", filename);
-        return NULL;
-    }
+/* Depth message levels, parsed on each service thread into its own buffers */
+static __thread BookLevel depth_bids[BOOK_MAX_LEVELS];
+static __thread BookLevel depth_asks[BOOK_MAX_LEVELS];
 
-    fseek(fp, 0, SEEK_END);
-    long fsize = ftell(fp);
-    rewind(fp);
+/* Builds the structural index of a frame on the stack, or in a heap buffer for large frames
+ * (`*positions` then differs from `stack` and must be freed). Returns 0 or -1. */
+static int index_message(JsonIndex *ix, const void *in, size_t len, uint32_t *stack, uint32_t **positions) {
+    *positions = stack;
+    if (json_index_build(ix, in, len, stack, JSON_INDEX_STACK_CAPACITY) == 0) return 0;
 
-    char *list = malloc(fsize + 1);
-    if (!list) {
-        fclose(fp);
-        fprintf(stderr, "[ERROR] Memory allocation failed\n");
-        return NULL;
+    *positions = malloc(len * sizeof(uint32_t));
+    if (!*positions) {
+        printf("[ERROR] Memory allocation failed for message index\n");
+        return -1;
     }
+    return json_index_build(ix, in, len, *positions, len);
+}
 
-    fread(list, 1, fsize, fp);
-    list[fsize] = '\0';
-    fclose(fp);
+static uint64_t lookup_u64(const JsonIndex *ix, size_t node, const char *pointer) {
+    const char *value;
+    size_t value_len;
+    if (!json_index_lookup(ix, node, pointer, &value, &value_len)) return 0;
+    uint64_t result = 0;
+    for (size_t i = 0; i < value_len && value[i] >= '0' && value[i] <= '9'; i++) result = result * 10 + (uint64_t)(value[i] - '0');
+    return result;
+}
 
-    size_t msg_len = strlen(template_fmt) + (2 * strlen(list)) + 128;
-    char *subscribe_msg = malloc(msg_len);
-    if (!subscribe_msg) {
-        free(list);
-        fprintf(stderr, "[ERROR] Memory allocation failed\n");
-        return NULL;
+/* Applies a parsed depth message and resubscribes the symbol's book if it lost sync */
+static void submit_depth(struct lws *wsi, BookMessage *message) {
+    if (order_book_apply(message) && wsi) {
+        printf("[WARNING] %s %s book out of sync, resubscribing\n", exchange_name(message->exchange_id),
+               symbol_name(message->symbol_id));
+        subscription_book_resubscribe(wsi, message->exchange_id, message->symbol_id);
     }
-
-    snprintf(subscribe_msg, msg_len, template_fmt, list, list);
-    free(list);
-    return subscribe_msg;
 }
 
-/* Send chunked subscription messages to Kraken using pairs from a JSON file and LWS connection */
-int build_kraken_subscription_from_file(struct lws *wsi, const char *filename, size_t chunk_size) {
-    FILE *fp = fopen(filename, "r");
-    if (!fp) {
-        fprintf(stderr, "[ERROR] Could not open %s\n", filename);
-        return -1;
+/* Binance diff: {"e":"depthUpdate","E":ms,"s":"BTCUSDT","U":first,"u":last,"b":[[p,q],..],"a":[..]} */
+static int handle_binance_depth(const void *in, size_t len) {
+    uint32_t stack_positions[JSON_INDEX_STACK_CAPACITY];
+    uint32_t *positions;
+    JsonIndex ix;
+    if (index_message(&ix, in, len, stack_positions, &positions) != 0) return -1;
+
+    const char *value;
+    size_t value_len;
+    BookMessage message = { .exchange_id = EXCHANGE_BINANCE };
+    if (json_index_lookup(&ix, JSON_INDEX_NONE, "/s", &value, &value_len))
+        message.symbol_id = symbol_intern(value, value_len);
+    if (order_book_wants(message.symbol_id)) {
+        if (json_index_lookup(&ix, JSON_INDEX_NONE, "/E", &value, &value_len))
+            parse_time_ms_field(value, value_len, &message.ts_ns);
+        message.first_seq = lookup_u64(&ix, JSON_INDEX_NONE, "/U");
+        message.last_seq = lookup_u64(&ix, JSON_INDEX_NONE, "/u");
+        message.bids = depth_bids;
+        message.bid_count = order_book_parse_levels(&ix, json_index_node(&ix, JSON_INDEX_NONE, "/b"), 0,
+                                                    depth_bids, BOOK_MAX_LEVELS);
+        message.asks = depth_asks;
+        message.ask_count = order_book_parse_levels(&ix, json_index_node(&ix, JSON_INDEX_NONE, "/a"), 0,
+                                                    depth_asks, BOOK_MAX_LEVELS);
+        if (message.last_seq) order_book_apply(&message);    // Binance books resync over REST
     }
 
-    fseek(fp, 0, SEEK_END);
-    long fsize = ftell(fp);
-    rewind(fp);
+    if (positions != stack_positions) free(positions);
+    return 0;
+}
 
-    char *file_data = malloc(fsize + 1);
-    if (!file_data) {
-        fclose(fp);
-        fprintf(stderr, "[ERROR] Memory allocation failed\n");
-        return -1;
+/* Coinbase level2_batch: {"type":"snapshot","product_id",..,"bids":[[p,q],..],"asks":[..]} or
+ * {"type":"l2update","product_id",..,"changes":[["buy"|"sell",p,q],..],"time":ISO} */
+static int handle_coinbase_depth(const void *in, size_t len, int snapshot) {
+    uint32_t stack_positions[JSON_INDEX_STACK_CAPACITY];
+    uint32_t *positions;
+    JsonIndex ix;
+    if (index_message(&ix, in, len, stack_positions, &positions) != 0) return -1;
+
+    const char *value;
+    size_t value_len;
+    BookMessage message = { .exchange_id = EXCHANGE_COINBASE, .snapshot = snapshot,
+                            .bids = depth_bids, .asks = depth_asks };
+    if (json_index_lookup(&ix, JSON_INDEX_NONE, "/product_id", &value, &value_len))
+        message.symbol_id = symbol_intern(value, value_len);
+    if (order_book_wants(message.symbol_id)) {
+        if (snapshot) {
+            message.bid_count = order_book_parse_levels(&ix, json_index_node(&ix, JSON_INDEX_NONE, "/bids"), 0,
+                                                        depth_bids, BOOK_MAX_LEVELS);
+            message.ask_count = order_book_parse_levels(&ix, json_index_node(&ix, JSON_INDEX_NONE, "/asks"), 0,
+                                                        depth_asks, BOOK_MAX_LEVELS);
+        } else {
+            if (json_index_lookup(&ix, JSON_INDEX_NONE, "/time", &value, &value_len))
+                parse_time_iso_field(value, value_len, &message.ts_ns);
+
+            /* Changes mix both sides, so each one's side is read before its level */
+            size_t changes = json_index_node(&ix, JSON_INDEX_NONE, "/changes");
+            for (size_t c = changes == JSON_INDEX_NONE ? JSON_INDEX_NONE : json_index_child(&ix, changes);
+                 c != JSON_INDEX_NONE; c = json_index_sibling(&ix, c)) {
+                BookLevel level;
+                if (!json_index_lookup(&ix, c, "/0", &value, &value_len)) continue;
+                int bid = value_len == 3 && memcmp(value, "buy", 3) == 0;
+                if (!json_index_lookup(&ix, c, "/1", &value, &value_len) || !fixed_parse(value, value_len, &level.price) ||
+                    !json_index_lookup(&ix, c, "/2", &value, &value_len) || !fixed_parse(value, value_len, &level.qty))
+                    continue;
+                if (bid && message.bid_count < BOOK_MAX_LEVELS) depth_bids[message.bid_count++] = level;
+                else if (!bid && message.ask_count < BOOK_MAX_LEVELS) depth_asks[message.ask_count++] = level;
+            }
+        }
+        order_book_apply(&message);
     }
 
-    fread(file_data, 1, fsize, fp);
-    file_data[fsize] = '\0';
-    fclose(fp);
-
-    json_error_t error;
-    json_t *pair_array = json_loads(file_data, 0, &error);
-    free(file_data);
+    if (positions != stack_positions) free(positions);
+    return 0;
+}
 
-    if (!pair_array || !json_is_array(pair_array)) {
-        fprintf(stderr, "[ERROR] Failed to parse JSON array: %s\n", error.text);
-        if (pair_array) json_decref(pair_array);
-        return -1;
+/* Kraken book-N: [channelID, {"as":[..],"bs":[..]}, "book-N", pair] for the snapshot, then
+ * [channelID, {"a":[..]}, {"b":[..],"c":"crc"}, "book-N", pair] with one or both payloads */
+static void handle_kraken_depth(struct lws *wsi, const JsonIndex *ix, size_t payload, size_t second, uint16_t symbol_id) {
+    if (!order_book_wants(symbol_id) || payload == JSON_INDEX_NONE) return;
+
+    BookMessage message = { .exchange_id = EXCHANGE_KRAKEN, .symbol_id = symbol_id,
+                            .bids = depth_bids, .asks = depth_asks };
+    size_t asks = json_index_node(ix, payload, "/as");
+    if (asks != JSON_INDEX_NONE || json_index_node(ix, payload, "/bs") != JSON_INDEX_NONE) {
+        message.snapshot = 1;
+        message.ask_count = order_book_parse_levels(ix, asks, 0, depth_asks, BOOK_MAX_LEVELS);
+        message.bid_count = order_book_parse_levels(ix, json_index_node(ix, payload, "/bs"), 0,
+                                                    depth_bids, BOOK_MAX_LEVELS);
+    } else {
+        size_t payloads[2] = { payload, second };
+        for (int p = 0; p < 2 && payloads[p] != JSON_INDEX_NONE; p++) {
+            const char *value;
+            size_t value_len;
+            message.ask_count += order_book_parse_levels(ix, json_index_node(ix, payloads[p], "/a"), 0,
+                                                         depth_asks + message.ask_count,
+                                                         BOOK_MAX_LEVELS - message.ask_count);
+            message.bid_count += order_book_parse_levels(ix, json_index_node(ix, payloads[p], "/b"), 0,
+                                                         depth_bids + message.bid_count,
+                                                         BOOK_MAX_LEVELS - message.bid_count);
+            if (json_index_lookup(ix, payloads[p], "/c", &value, &value_len)) {
+                message.has_checksum = 1;
+                message.checksum = (uint32_t)strtoul(value, NULL, 10);
+            }
+        }
     }
+    submit_depth(wsi, &message);
+}
 
-    size_t total = json_array_size(pair_array);
+/* OKX books: {"arg":{"channel":"books","instId":..},"action":"snapshot"|"update",
+ *             "data":[{"asks":[[p,q,"0",n],..],"bids":[..],"ts":ms,"seqId":n,"prevSeqId":n}]} */
+static int handle_okx_depth(struct lws *wsi, const void *in, size_t len) {
+    uint32_t stack_positions[JSON_INDEX_STACK_CAPACITY];
+    uint32_t *positions;
+    JsonIndex ix;
+    if (index_message(&ix, in, len, stack_positions, &positions) != 0) return -1;
+
+    const char *value;
+    size_t value_len;
+    BookMessage message = { .exchange_id = EXCHANGE_OKX, .bids = depth_bids, .asks = depth_asks };
+    size_t data = json_index_node(&ix, JSON_INDEX_NONE, "/data/0");
+    if (json_index_lookup(&ix, JSON_INDEX_NONE, "/arg/instId", &value, &value_len))
+        message.symbol_id = symbol_intern(value, value_len);
+    if (data != JSON_INDEX_NONE && order_book_wants(message.symbol_id) &&
+        json_index_lookup(&ix, JSON_INDEX_NONE, "/action", &value, &value_len)) {
+        message.snapshot = value_len == 8 && memcmp(value, "snapshot", 8) == 0;
+        if (json_index_lookup(&ix, data, "/ts", &value, &value_len))
+            parse_time_ms_field(value, value_len, &message.ts_ns);
+        message.last_seq = lookup_u64(&ix, data, "/seqId");
+        message.prev_seq = lookup_u64(&ix, data, "/prevSeqId");
+        message.ask_count = order_book_parse_levels(&ix, json_index_node(&ix, data, "/asks"), 0,
+                                                    depth_asks, BOOK_MAX_LEVELS);
+        message.bid_count = order_book_parse_levels(&ix, json_index_node(&ix, data, "/bids"), 0,
+                                                    depth_bids, BOOK_MAX_LEVELS);
+        submit_depth(wsi, &message);
+    }
 
-    for (size_t i = 0; i < total; i += chunk_size) {
-        json_t *chunk = json_array();
-        size_t end = (i + chunk_size > total) ? total : i + chunk_size;
+    if (positions != stack_positions) free(positions);
+    return 0;
+}
 
-        for (size_t j = i; j < end; j++) {
-            json_array_append(chunk, json_array_get(pair_array, j));
+/* Parse one received frame and hand the resulting records to the ingest pipeline.
+ * `wsi` may be NULL (replay), in which case protocol replies such as Huobi pongs are skipped. */
+int handle_exchange_message(struct lws *wsi, SessionData *session, void *in, size_t len) {
+    if (session->exchange_id == EXCHANGE_BINANCE) {
+        // printf("[DATA][Binance] %.*s\n", (int)len, (char *)in);
+        if (order_book_enabled() && json_find(in, len, "\"e\":\"depthUpdate\"")) {
+            return handle_binance_depth(in, len);
         }
+        else if (json_find(in, len, "\"e\":\"trade\"")) {
+            TradeData binance_trade;
+            trade_init(&binance_trade, EXCHANGE_BINANCE);
+
+            if (extract_fields(in, len, binance_trade_fields, binance_trade_field_count, &binance_trade)) {
+                trade_finish(&binance_trade);
+                ingest_submit_trade(&binance_trade);
+                // printf("[TRADE] %s | %s | Price: %s | Size: %s | ID: %s | MM: %s\n", binance_trade.exchange, binance_trade.currency, binance_trade.price, binance_trade.size, binance_trade.trade_id, binance_trade.market_maker);
+            } else {
+                latency_parse_failure();
+            }
+        } 
+        else {
+            // printf("[DEBUG] '\"e\":\"trade\"' not found in input\n");
+            TickerData binance_ticker;
+            ticker_init(&binance_ticker, EXCHANGE_BINANCE);
 
-        char *pair_list_str = json_dumps(chunk, JSON_ENSURE_ASCII);
-        json_decref(chunk);
-        if (!pair_list_str) {
-            json_decref(pair_array);
-            fprintf(stderr, "[ERROR] Failed to serialize chunk JSON\n");
-            return -1;
-        }
+            if (extract_fields(in, len, binance_ticker_fields, binance_ticker_field_count, &binance_ticker)) {
+                ticker_finish(&binance_ticker);
+                ingest_submit_ticker(&binance_ticker);
 
-        const char *channels[] = { "ticker", "trade" };
-        for (int c = 0; c < 2; c++) {
-            size_t msg_size = strlen(pair_list_str) + 128;
-            char *subscribe_msg = malloc(msg_size);
-            if (!subscribe_msg) {
-                free(pair_list_str);
-                json_decref(pair_array);
-                fprintf(stderr, "[ERROR] Memory allocation failed for subscribe_msg\n");
-                return -1;
             }
-
-            snprintf(subscribe_msg, msg_size,
-                "{\"event\": \"subscribe\", \"pair\": %s, \"subscription\": {\"name\": \"%s\"}}",
-                pair_list_str, channels[c]);
-
-            unsigned char buf[LWS_PRE + 2048];
-            size_t len = strlen(subscribe_msg);
-            memcpy(&buf[LWS_PRE], subscribe_msg, len);
-
-            int n = lws_write(wsi, &buf[LWS_PRE], len, LWS_WRITE_TEXT);
-            if (n < 0) {
-                fprintf(stderr, "[ERROR] Failed to send %s subscription\n", channels[c]);
-                free(subscribe_msg);
-                free(pair_list_str);
-                json_decref(pair_array);
-                return -1;
+        }
+    }
+    else if (session->exchange_id == EXCHANGE_COINBASE) {
+        // printf("[DATA][Coinbase] %.*s\n", (int)len, (char *)in);
+        if (json_find(in, len, "\"type\":\"match\"") && !json_find(in, len, "\"type\":\"last_match\"")) {
+            TradeData coinbase_trade;
+            trade_init(&coinbase_trade, EXCHANGE_COINBASE);
+
+            if (extract_fields(in, len, coinbase_trade_fields, coinbase_trade_field_count, &coinbase_trade)) {
+                trade_finish(&coinbase_trade);
+                ingest_submit_trade(&coinbase_trade);
+                // printf("[TRADE] %s | %s | Price: %s | Size: %s | ID: %s\n", coinbase_trade.exchange, coinbase_trade.currency, coinbase_trade.price, coinbase_trade.size, coinbase_trade.trade_id);
+            } else {
+                latency_parse_failure();
+            }
+        }
+        else if (order_book_enabled() && json_find(in, len, "\"type\":\"l2update\"")) {
+            return handle_coinbase_depth(in, len, 0);
+        }
+        else if (order_book_enabled() && json_find(in, len, "\"type\":\"snapshot\"")) {
+            return handle_coinbase_depth(in, len, 1);
+        }
+        else if (json_find(in, len, "\"type\":\"ticker\"")) {
+            TickerData coinbase_ticker;
+            ticker_init(&coinbase_ticker, EXCHANGE_COINBASE);
+
+            if (extract_fields(in, len, coinbase_ticker_fields, coinbase_ticker_field_count, &coinbase_ticker)) {
+                ticker_finish(&coinbase_ticker);
+                // printf("[TICKER] Coinbase | %s | Price: %s\n", coinbase_ticker.currency, coinbase_ticker.price);
+                ingest_submit_ticker(&coinbase_ticker);
+            } else {
+                latency_parse_failure();
             }
-
-            // printf("[DEBUG] Sent Kraken %s chunk: %s\n", channels[c], subscribe_msg);
-            free(subscribe_msg);
         }
-
-        free(pair_list_str);
     }
+    else if (session->exchange_id == EXCHANGE_KRAKEN) {
+        if (json_find(in, len, "\"event\":\"heartbeat\"")) {
+            return 0;
+        }
 
-    json_decref(pair_array);
-    return 0;
-}
+        /* Kraken frames are positional: [channelID, payload, channelName, pair]; book updates
+         * may carry a second payload before the channel name */
+        uint32_t stack_positions[JSON_INDEX_STACK_CAPACITY];
+        uint32_t *positions;
+        JsonIndex ix;
+        if (index_message(&ix, in, len, stack_positions, &positions) != 0) return -1;
+
+        char channel[16] = {0};
+        const char *pair;
+        size_t pair_len;
+        uint16_t symbol_id = 0;
+        size_t payload = json_index_node(&ix, JSON_INDEX_NONE, "/1");
+        size_t second = JSON_INDEX_NONE;
+        if (json_index_lookup(&ix, JSON_INDEX_NONE, "/4", &pair, &pair_len)) {
+            second = json_index_node(&ix, JSON_INDEX_NONE, "/2");
+            json_index_copy(&ix, JSON_INDEX_NONE, "/3", channel, sizeof(channel));
+            symbol_id = symbol_intern(pair, pair_len);
+        } else {
+            json_index_copy(&ix, JSON_INDEX_NONE, "/2", channel, sizeof(channel));
+            if (json_index_lookup(&ix, JSON_INDEX_NONE, "/3", &pair, &pair_len))
+                symbol_id = symbol_intern(pair, pair_len);
+        }
 
-/* Build a Huobi subscription message by parsing a plain text file of symbols into JSON requests */
-char* build_huobi_subscription_from_file(const char *filename) {
-    FILE *fp = fopen(filename, "r");
-    if (!fp) {
-        fprintf(stderr, "[ERROR] Could not open %s\n", filename);
-        return NULL;
-    }
+        // Handle Kraken trade messages
+        if (strcmp(channel, "trade") == 0 && payload != JSON_INDEX_NONE) {
+            for (size_t t = json_index_child(&ix, payload); t != JSON_INDEX_NONE; t = json_index_sibling(&ix, t)) {
+                TradeData kraken_trade;
+                trade_init(&kraken_trade, EXCHANGE_KRAKEN);
+                kraken_trade.symbol_id = symbol_id;
 
-    fseek(fp, 0, SEEK_END);
-    long fsize = ftell(fp);
-    rewind(fp);
+                if (!extract_pointer_fields(&ix, t, kraken_trade_fields, kraken_trade_field_count, &kraken_trade)) {
+                    latency_parse_failure();
+                    continue;
+                }
 
-    char *symbols_raw = malloc(fsize + 1);
-    if (!symbols_raw) {
-        fclose(fp);
-        fprintf(stderr, "[ERROR] Memory allocation failed\n");
-        return NULL;
-    }
+                trade_finish(&kraken_trade);
+                ingest_submit_trade(&kraken_trade);
+                // printf("[TRADE] %s | %s | Price: %s | Size: %s\n", kraken_trade.exchange, kraken_trade.currency, kraken_trade.price, kraken_trade.size);
+            }
+        }
+        // printf("[TICKER][Kraken] %.*s\n", (int)len, (char *)in);
+        else if (strcmp(channel, "ticker") == 0 && payload != JSON_INDEX_NONE) {
+            TickerData kraken_ticker;
+            ticker_init(&kraken_ticker, EXCHANGE_KRAKEN);
+            kraken_ticker.symbol_id = symbol_id;
+
+            if (extract_pointer_fields(&ix, payload, kraken_ticker_fields, kraken_ticker_field_count, &kraken_ticker)) {
+                ticker_finish(&kraken_ticker);
+                ingest_submit_ticker(&kraken_ticker);
+            } else {
+                latency_parse_failure();
+            }
+        }
+        else if (strncmp(channel, "book-", 5) == 0) {
+            handle_kraken_depth(wsi, &ix, payload, second, symbol_id);
+        }
 
-    fread(symbols_raw, 1, fsize, fp);
-    symbols_raw[fsize] = '\0';
-    fclose(fp);
-
-    // Allocate enough space for the full message
-    size_t estimated_size = fsize * 3 + 256;
-    char *subscribe_msg = malloc(estimated_size);
-    if (!subscribe_msg) {
-        free(symbols_raw);
-        fprintf(stderr, "[ERROR] Memory allocation failed\n");
-        return NULL;
+        if (positions != stack_positions) free(positions);
     }
+    // else if (strcmp(protocol, "bitfinex-websocket") == 0) {
+    //     if (strstr((char *)in, "\"hb\"")) {
+    //         return 0;
+    //     }
+    //     // printf("[TICKER][Bitfinex] %.*s\n", (int)len, (char *)in);
+    //     {
+    //         char price[32] = {0}, timestamp[32] = {0};
+    //         char bid[32] = {0}, ask[32] = {0}, bid_qty[32] = {0}, ask_qty[32] = {0};
+    //         if (extract_bitfinex_price((char *)in, price, sizeof(price)) 
+    //         /* &&
+    //             extract_bitfinex_price((char *)in, "\"BID\":\"", bid, sizeof(bid)) &&
+    //             extract_bitfinex_price((char *)in, "\"BID_SIZE\":\"", bid_qty, sizeof(bid_qty)) &&
+    //             extract_bitfinex_price((char *)in, "\"ASK\":\"", ask, sizeof(ask)) &&
+    //             extract_bitfinex_price((char *)in, "\"ASK_SIZE\":\"", ask_qty, sizeof(ask_qty))*/) {
+
+    //             get_timestamp(timestamp, sizeof(timestamp));
+    //             // log_ticker_price(timestamp, "Bitfinex", "tBTCUSD", price, bid, bid_qty, ask, ask_qty);
+    //         }
+    //     }
+    // }
+    else if (session->exchange_id == EXCHANGE_HUOBI) {
+        const char *decompressed;
+        long decompressed_len = inflate_frame(&session->inflate, in, len, &decompressed);
+        if (decompressed_len > 0) {
+            // printf("[TICKER][Huobi] %.*s\n", decompressed_len, decompressed);
+
+            /* Handle Huobi ping-pong */
+            char ping_value[32] = {0};
+            if (wsi && extract_numeric(decompressed, "\"ping\":", ping_value, sizeof(ping_value))) {
+                char pong_msg[64];
+                snprintf(pong_msg, sizeof(pong_msg), "{\"pong\": %s}", ping_value);
+                unsigned char *buf = malloc(LWS_PRE + strlen(pong_msg));
+                if (!buf) {
+                    printf("[ERROR] Memory allocation failed for Huobi pong\n");
+                    return -1;
+                }
+                memcpy(buf + LWS_PRE, pong_msg, strlen(pong_msg));
+                lws_write(wsi, buf + LWS_PRE, strlen(pong_msg), LWS_WRITE_TEXT);
+                // printf("[INFO] Sent Huobi Pong: %s\n", pong_msg);
 
-    strcpy(subscribe_msg, "[");
-
-    char *token = strtok(symbols_raw, "[\",\n ]");
-    int first = 1;
-
-    while (token) {
-        if (!first) strcat(subscribe_msg, ",");
-        first = 0;
+                free(buf);
+            }
+            TickerData huobi_ticker;
+            ticker_init(&huobi_ticker, EXCHANGE_HUOBI);
+            char huobi_currency[MAX_SYMBOL_LENGTH];
 
-        char entry[128];
-        snprintf(entry, sizeof(entry),
-            "{\"sub\": \"market.%s.ticker\", \"id\": \"huobi_%s\"}",
-            token, token);
-        strcat(subscribe_msg, entry);
+            if (extract_fields(decompressed, decompressed_len, huobi_ticker_fields, huobi_ticker_field_count, &huobi_ticker) &&
+                extract_huobi_currency(decompressed, huobi_currency, sizeof(huobi_currency))) {
 
-        token = strtok(NULL, "[\",\n ]");
-    }
+                huobi_ticker.symbol_id = symbol_intern(huobi_currency, strlen(huobi_currency));
+                huobi_ticker.close_price = huobi_ticker.price;
+                ticker_finish(&huobi_ticker);
+                ingest_submit_ticker(&huobi_ticker);
+            }
+            else if (strstr(decompressed, "\"ch\":\"market.") && strstr(decompressed, ".trade.detail\"")) {
+                TradeData huobi_trade;
+                trade_init(&huobi_trade, EXCHANGE_HUOBI);
 
-    strcat(subscribe_msg, "]");
+                // Extract symbol from channel string
+                extract_huobi_currency(decompressed, huobi_currency, sizeof(huobi_currency));
+                huobi_trade.symbol_id = symbol_intern(huobi_currency, strlen(huobi_currency));
 
-    free(symbols_raw);
-    return subscribe_msg;
-}
+                // Extract trade details
+                extract_fields(decompressed, decompressed_len, huobi_trade_fields, huobi_trade_field_count, &huobi_trade);
 
-/* Build a subscription message using data from two JSON files */
-char* build_subscription_from_two_files(const char *file1, const char *file2, const char *template_fmt) {
-    FILE *fp1 = fopen(file1, "r");
-    FILE *fp2 = fopen(file2, "r");
-    if (!fp1 || !fp2) {
-        fprintf(stderr, "[ERROR] Could not open %s or %s\n", file1, file2);
-        if (fp1) fclose(fp1);
-        if (fp2) fclose(fp2);
-        return NULL;
+                trade_finish(&huobi_trade);
+                ingest_submit_trade(&huobi_trade);
+                // printf("[TRADE] %s | %s | Price: %s | Size: %s | ID: %s\n", huobi_trade.exchange, huobi_trade.currency, huobi_trade.price, huobi_trade.size, huobi_trade.trade_id);
+            }
+        } else if (decompressed_len < 0) {
+            latency_parse_failure();
+        }
     }
+    else if (session->exchange_id == EXCHANGE_OKX) {
+        // printf("[TICKER][OKX] %.*s\n", (int)len, (char *)in);
+        if (order_book_enabled() && json_find(in, len, "\"arg\":{\"channel\":\"books\"")) {
+            return handle_okx_depth(wsi, in, len);
+        }
 
-    // Read entire content of both files
-    fseek(fp1, 0, SEEK_END);
-    long size1 = ftell(fp1);
-    rewind(fp1);
-    char *data1 = malloc(size1 + 1);
-    fread(data1, 1, size1, fp1);
-    data1[size1] = '\0';
-    fclose(fp1);
-
-    fseek(fp2, 0, SEEK_END);
-    long size2 = ftell(fp2);
-    rewind(fp2);
-    char *data2 = malloc(size2 + 1);
-    fread(data2, 1, size2, fp2);
-    data2[size2] = '\0';
-    fclose(fp2);
-
-    // Allocate space for the final combined args array
-    char *combined = malloc(size1 + size2 + 128); // extra buffer room
-    if (!combined) {
-        fprintf(stderr, "[ERROR] Memory allocation failed\n");
-        free(data1);
-        free(data2);
-        return NULL;
-    }
-    strcpy(combined, "[");
-
-    // Helper macro for appending full JSON object lists from each file
-    #define APPEND_ENTRIES(data)                             \
-        do {                                                 \
-            char *p = data + 1;                              \
-            while (*p && *p != ']') {                        \
-                strncat(combined, p, 1);                     \
-                p++;                                         \
-            }                                                \
-        } while (0)
-
-    APPEND_ENTRIES(data1);
-    if (combined[strlen(combined) - 1] != '[') strcat(combined, ",");
-
-    APPEND_ENTRIES(data2);
-    strcat(combined, "]");
-
-    #undef APPEND_ENTRIES
-
-    // Build final subscription message
-    size_t msg_len = strlen(template_fmt) + strlen(combined) + 64;
-    char *subscribe_msg = malloc(msg_len);
-    if (!subscribe_msg) {
-        fprintf(stderr, "[ERROR] Memory allocation for final message failed\n");
-        free(data1);
-        free(data2);
-        free(combined);
-        return NULL;
+        TickerData okx_ticker;
+        ticker_init(&okx_ticker, EXCHANGE_OKX);
+
+        if (extract_fields(in, len, okx_ticker_fields, okx_ticker_field_count, &okx_ticker)) {
+            ticker_finish(&okx_ticker);
+            ingest_submit_ticker(&okx_ticker);
+        } else if (json_find(in, len, "\"arg\":{\"channel\":\"trades\"")) {
+            TradeData okx_trade;
+            trade_init(&okx_trade, EXCHANGE_OKX);
+
+            if (extract_fields(in, len, okx_trade_fields, okx_trade_field_count, &okx_trade)) {
+                trade_finish(&okx_trade);
+                ingest_submit_trade(&okx_trade);
+                // printf("[TRADE] %s | %s | Price: %s | Time: %s\n", okx_trade.exchange, okx_trade.currency, okx_trade.price, okx_trade.timestamp);
+            } else {
+                latency_parse_failure();
+            }
+        }
     }
+    return 0;
+}
 
-    snprintf(subscribe_msg, msg_len, template_fmt, combined);
-
-    free(data1);
-    free(data2);
-    free(combined);
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
 
-    return subscribe_msg;
+/* Per-session state, filled on the first callback of a connection so later ones skip name lookups */
+static SessionData *session_get(const struct lws_protocols *protocol, void *user, SessionData *fallback) {
+    SessionData *session = user ? (SessionData *)user : fallback;
+    if (!session->ready) {
+        session->connection = (protocol && (int)protocol->id < connection_count()) ? (int)protocol->id : -1;
+        session->exchange_id = connection_exchange(session->connection);
+        session->ready = 1;
+    }
+    return session;
 }
 
+/* Appends a received piece of a message. Returns 1 once the message is complete, 0 otherwise. */
+static int session_reassemble(struct lws *wsi, SessionData *session, const void *in, size_t len) {
+    int complete = lws_is_final_fragment(wsi) && lws_remaining_packet_payload(wsi) == 0;
+    size_t needed = session->message_len + len;
 
-/* Build a Binance combined stream subscription message from a file of symbols and format for WebSocket */
-char *build_binance_combined_subscription(const char *filename) {
-    FILE *fp = fopen(filename, "r");
-    if (!fp) {
-        fprintf(stderr, "[ERROR] Could not open %s\n", filename);
-        return NULL;
+    if (!session->message_dropped && needed > SESSION_MESSAGE_MAX) {
+        printf("[WARNING] Dropping message over %d bytes\n", SESSION_MESSAGE_MAX);
+        session->message_dropped = 1;
+    }
+    if (!session->message_dropped && needed > session->message_capacity) {
+        size_t capacity = session->message_capacity ? session->message_capacity : 64 * 1024;
+        while (capacity < needed) capacity *= 2;
+        char *grown = realloc(session->message, capacity);
+        if (!grown) {
+            printf("[ERROR] Memory allocation failed for message reassembly\n");
+            session->message_dropped = 1;
+        } else {
+            session->message = grown;
+            session->message_capacity = capacity;
+        }
+    }
+    if (!session->message_dropped) {
+        memcpy(session->message + session->message_len, in, len);
+        session->message_len = needed;
     }
 
-    // Allocate dynamic buffer
-    size_t capacity = 8192;
-    char *params = malloc(capacity);
-    if (!params) {
-        fclose(fp);
-        return NULL;
+    if (complete && session->message_dropped) {
+        session->message_len = 0;
+        session->message_dropped = 0;
+        return 0;
     }
-    params[0] = '\0';
-
-    int first = 1;
-    char line[64];
-    while (fgets(line, sizeof(line), fp)) {
-        line[strcspn(line, "\r\n")] = 0;
-
-        if (strlen(line) == 0)
-            continue;
-
-        // Prepare entry string
-        char entry[160];
-        snprintf(entry, sizeof(entry), "\"%s@ticker\",\"%s@trade\"", line, line);
-
-        // Expand buffer if needed
-        size_t needed = strlen(params) + strlen(entry) + 2;
-        if (needed >= capacity) {
-            capacity *= 2;
-            char *new_params = realloc(params, capacity);
-            if (!new_params) {
-                free(params);
-                fclose(fp);
-                return NULL;
-            }
-            params = new_params;
-        }
+    return complete;
+}
 
-        if (!first)
-            strcat(params, ",");
+static void session_release(SessionData *session) {
+    inflate_stream_release(&session->inflate);
+    free(session->message);
+    session->message = NULL;
+    session->message_len = session->message_capacity = 0;
+    session->message_dropped = 0;
+}
 
-        strcat(params, entry);
-        first = 0;
+/* Sends the cached subscription frames and marks the connection as up. Returns 0 or -1. */
+static int session_subscribe(struct lws *wsi, SessionData *session, const char *protocol) {
+    /* Frames were compiled at startup (subscription_cache.c); nothing is read or built here */
+    int frames = subscription_cache_send(wsi, session->connection);
+    if (frames < 0) {
+        printf("[ERROR] Failed to send %s subscription message\n", protocol);
+        return -1;
     }
-    fclose(fp);
-
-    // Final message JSON
-    size_t final_len = strlen(params) + 64;
-    char *subscribe_msg = malloc(final_len);
-    if (!subscribe_msg) {
-        free(params);
-        return NULL;
+    if (frames > 0) {
+        printf("[INFO] Sent %d subscription message(s) to %s\n", frames, protocol);
     }
+    session->subscribed_ns = monotonic_ns();
 
-    snprintf(subscribe_msg, final_len, "{\"method\": \"SUBSCRIBE\", \"params\": [%s], \"id\": 1}", params);
-    free(params);
-    return subscribe_msg;
+    /* Reset retry count on successful connection */
+    reconnect_connected(session->connection, wsi);
+    connection_table_established(session->connection);
+    printf("[INFO] %s WebSocket Connection Established! Retry count reset.\n", protocol);
+    return 0;
+}
+
+/* Delay timer of a Kraken subscription: asks for a writeable callback, where the frames are sent */
+static void session_subscribe_due(lws_sorted_usec_list_t *sul) {
+    SessionData *session = lws_container_of(sul, SessionData, subscribe_sul);
+    if (session->subscribe_pending && session->wsi) lws_callback_on_writable(session->wsi);
 }
 
 /* Unified Callback for all exchanges */
 int callback_combined(struct lws *wsi, enum lws_callback_reasons reason,
-    void *user __attribute__((unused)), void *in, size_t len) {
+    void *user, void *in, size_t len) {
     const struct lws_protocols *protocol_struct = lws_get_protocol(wsi);
     const char *protocol = (protocol_struct) ? protocol_struct->name : "unknown";
+    SessionData fallback_session = {0};
+    SessionData *session = session_get(protocol_struct, user, &fallback_session);
     
     switch (reason) {
         case LWS_CALLBACK_CLIENT_ESTABLISHED: {
             printf("[INFO] %s WebSocket Connection Established!\n", protocol);
-            char *subscribe_msg = NULL;
-            if (strncmp(protocol, "binance-websocket-", 18) == 0) {
-                int chunk_index = atoi(protocol + 19);
-            
-                char filename[64];
-                snprintf(filename, sizeof(filename), "currency_text_files/binance_currency_chunk_trades_%d.txt", chunk_index);
-            
-                subscribe_msg = build_binance_combined_subscription(filename);
-            }            
-            else if (strcmp(protocol, "coinbase-websocket") == 0) {
-                subscribe_msg = build_subscription_from_file(
-                    "currency_text_files/coinbase_currency_ids.txt",
-                        "{\"type\": \"subscribe\", \"channels\": ["
-                        "{ \"name\": \"ticker\", \"product_ids\": %s },"
-                        "{ \"name\": \"matches\", \"product_ids\": %s } ]}"
-                    );
-
-                if (!subscribe_msg) return -1;
-            }
-            else if (strcmp(protocol, "kraken-websocket") == 0) {
-                usleep(200000);
-                if (build_kraken_subscription_from_file(wsi, "currency_text_files/kraken_currency_ids.txt", 100) != 0) {
-                    return -1;
-                }
-            }
-            else if (strcmp(protocol, "bitfinex-websocket") == 0) {
-                subscribe_msg =
-                    "{\"event\": \"subscribe\", \"channel\": \"ticker\", \"symbol\": \"tBTCUSD\"}";
-            }
-            else if ((strncmp(protocol, "huobi-websocket-", 16) == 0)) {
-                // printf("[DEBUG] Protocol name is: %s\n", protocol);
-                int chunk_index = atoi(protocol + 17);
-                char filename[64];
-                snprintf(filename, sizeof(filename), "currency_text_files/huobi_currency_chunk_%d.txt", chunk_index);
-            
-                FILE *fp = fopen(filename, "r");
-                if (!fp) {
-                    fprintf(stderr, "[ERROR] Could not open %s\n", filename);
-                    return -1;
-                }
-            
-                fseek(fp, 0, SEEK_END);
-                long fsize = ftell(fp);
-                rewind(fp);
-            
-                char *file_buf = malloc(fsize + 1);
-                if (!file_buf) {
-                    fclose(fp);
-                    fprintf(stderr, "[ERROR] Memory allocation failed\n");
-                    return -1;
-                }
-            
-                fread(file_buf, 1, fsize, fp);
-                file_buf[fsize] = '\0';
-                fclose(fp);
-            
-                char *token = strtok(file_buf, "[\", \n]");
-                while (token) {
-                    char ticker_msg[128];
-                    char trade_msg[128];
-                
-                    snprintf(ticker_msg, sizeof(ticker_msg),
-                             "{\"sub\": \"market.%s.ticker\", \"id\": \"huobi_%s_ticker\"}",
-                             token, token);
-                    snprintf(trade_msg, sizeof(trade_msg),
-                             "{\"sub\": \"market.%s.trade.detail\", \"id\": \"huobi_%s_trade\"}",
-                             token, token);
-                
-                    for (int i = 0; i < 2; i++) {
-                        const char *msg = (i == 0) ? ticker_msg : trade_msg;
-                        size_t msg_len = strlen(msg);
-                        unsigned char *buf = malloc(LWS_PRE + msg_len);
-                        if (!buf) {
-                            fprintf(stderr, "[ERROR] Memory allocation failed for Huobi message\n");
-                            free(file_buf);
-                            return -1;
-                        }
-                        memcpy(buf + LWS_PRE, msg, msg_len);
-                        lws_write(wsi, buf + LWS_PRE, msg_len, LWS_WRITE_TEXT);
-                        free(buf);
-                    }
-                
-                    token = strtok(NULL, "[\", \n]");
-                }                
-            
-                free(file_buf);
-            }            
-            else if (strncmp(protocol, "okx-websocket-", 14) == 0) {
-                int chunk_index = atoi(protocol + 15);
-            
-                char file1[64], file2[64];
-                snprintf(file1, sizeof(file1), "currency_text_files/okx_currency_chunk_%d.txt", chunk_index);
-                snprintf(file2, sizeof(file2), "currency_text_files/okx_currency_chunk_trades_%d.txt", chunk_index);
-            
-                subscribe_msg = build_subscription_from_two_files(
-                    file1,
-                    file2,
-                    "{\"op\": \"subscribe\", \"args\": %s}"
-                );
-                if (!subscribe_msg) return -1;
-                // printf("[DEBUG] OKX Subscription Message:\n%s\n", subscribe_msg);
-            }            
-            
-            if (subscribe_msg) {
-                size_t msg_len = strlen(subscribe_msg);
-                unsigned char *buf = malloc(LWS_PRE + msg_len);
-                if (!buf) {
-                    printf("[ERROR] Memory allocation failed for %s message\n", protocol);
-                    return -1;
-                }
-                memcpy(buf + LWS_PRE, subscribe_msg, msg_len);
-                int bytes_sent = lws_write(wsi, buf + LWS_PRE, msg_len, LWS_WRITE_TEXT);
-                if (bytes_sent < 0)
-                    printf("[ERROR] Failed to send %s subscription message\n", protocol);
-                else
-                    printf("[INFO] Sent subscription message to %s\n", protocol);
-                free(buf);
-            }
-            
-            /* Reset retry count on successful connection */
-            {
-                int index = get_exchange_index(protocol);
-                if (index != -1) {
-                    retry_counts[index].retry_count = 0;
-                }
+
+            /* Kraken's delay runs on a service-loop timer so the thread's other connections keep going */
+            if (session->exchange_id == EXCHANGE_KRAKEN && session != &fallback_session) {
+                session->wsi = wsi;
+                session->subscribe_pending = 1;
+                lws_sul_schedule(lws_get_context(wsi), 0, &session->subscribe_sul, session_subscribe_due,
+                                 KRAKEN_SUBSCRIBE_DELAY_US);
+                break;
             }
-            printf("[INFO] %s WebSocket Connection Established! Retry count reset.\n", protocol);
+            if (session_subscribe(wsi, session, protocol) != 0) return -1;
+            break;
+        }
+        case LWS_CALLBACK_CLIENT_WRITEABLE: {
+            if (!session->subscribe_pending) break;
+            session->subscribe_pending = 0;
+            if (session_subscribe(wsi, session, protocol) != 0) return -1;
             break;
         }
     
         // (Comment in printf statements below to see full ticker outputs in terminal)
         case LWS_CALLBACK_CLIENT_RECEIVE: {
-            int idx = get_exchange_index(protocol);
-            if (idx != -1) {
-                last_message_time[idx] = time(NULL);
+            if (session->connection != -1) {
+                last_message_time[session->connection] = time(NULL);
             }
 
-            if (strncmp(protocol, "binance-websocket", 17) == 0) {
-                // printf("[DATA][Binance] %.*s\n", (int)len, (char *)in);
-                char *msg = malloc(len + 1);
-                memcpy(msg, in, len);
-                msg[len] = '\0';
-                if (strstr(msg, "\"e\":\"trade\"")) {
-                    TradeData binance_trade = {0}; 
-                    strncpy(binance_trade.exchange, "Binance", sizeof(binance_trade.exchange) - 1);
-
-                    char trade_time[32] = {0};
-                    if (extract_order_data(msg, "\"E\":", trade_time, sizeof(trade_time)) && 
-                        extract_order_data(msg, "\"s\":\"", binance_trade.currency, sizeof(binance_trade.currency)) && 
-                        extract_order_data(msg, "\"p\":\"", binance_trade.price, sizeof(binance_trade.price)) && 
-                        extract_order_data(msg, "\"q\":\"", binance_trade.size, sizeof(binance_trade.size)) && 
-                        extract_order_data(msg, "\"t\":", binance_trade.trade_id, sizeof(binance_trade.trade_id)) && 
-                        extract_order_data(msg, "\"m\":", binance_trade.market_maker, sizeof(binance_trade.market_maker))) {
-
-                        convert_binance_timestamp(binance_trade.timestamp, sizeof(binance_trade.timestamp), trade_time);
-                        log_trade_price(binance_trade.timestamp, binance_trade.exchange, binance_trade.currency,
-                                        binance_trade.price, binance_trade.size, binance_trade.trade_id, binance_trade.market_maker);
-                        write_trade_to_bson(&binance_trade);
-                        // printf("[TRADE] %s | %s | Price: %s | Size: %s | ID: %s | MM: %s\n", binance_trade.exchange, binance_trade.currency, binance_trade.price, binance_trade.size, binance_trade.trade_id, binance_trade.market_maker);
-                    }
-                } 
-                else {
-                    // printf("[DEBUG] '\"e\":\"trade\"' not found in input\n");
-                    TickerData binance_ticker = {0}; 
-                    strncpy(binance_ticker.exchange, "Binance", MAX_EXCHANGE_NAME_LENGTH - 1);
-                    binance_ticker.exchange[MAX_EXCHANGE_NAME_LENGTH - 1] = '\0'; 
-
-                    if (extract_order_data(in, "\"E\":", binance_ticker.time_ms, sizeof(binance_ticker.time_ms)) &&
-                        extract_order_data(in, "\"s\":\"", binance_ticker.currency, sizeof(binance_ticker.currency)) &&
-                        extract_order_data(in, "\"c\":\"", binance_ticker.price, sizeof(binance_ticker.price))) {
-
-                        extract_order_data(in, "\"b\":\"", binance_ticker.bid, sizeof(binance_ticker.bid));
-                        extract_order_data(in, "\"B\":\"", binance_ticker.bid_qty, sizeof(binance_ticker.bid_qty));
-                        extract_order_data(in, "\"a\":\"", binance_ticker.ask, sizeof(binance_ticker.ask));
-                        extract_order_data(in, "\"A\":\"", binance_ticker.ask_qty, sizeof(binance_ticker.ask_qty));
-                        extract_order_data(in, "\"o\":\"", binance_ticker.open_price, sizeof(binance_ticker.open_price));
-                        extract_order_data(in, "\"h\":\"", binance_ticker.high_price, sizeof(binance_ticker.high_price));
-                        extract_order_data(in, "\"l\":\"", binance_ticker.low_price, sizeof(binance_ticker.low_price));
-                        extract_order_data(in, "\"v\":\"", binance_ticker.volume_24h, sizeof(binance_ticker.volume_24h));
-                        extract_order_data(in, "\"q\":\"", binance_ticker.quote_volume, sizeof(binance_ticker.quote_volume));
-                        extract_order_data(in, "\"t\":\"", binance_ticker.last_trade_time, sizeof(binance_ticker.last_trade_time)); 
-                        extract_order_data(in, "\"p\":\"", binance_ticker.last_trade_price, sizeof(binance_ticker.last_trade_price)); 
-                        extract_order_data(in, "\"C\":\"", binance_ticker.close_price, sizeof(binance_ticker.close_price));
-                        extract_order_data(in, "\"S\":\"", binance_ticker.symbol, sizeof(binance_ticker.symbol));
-                        
-                        convert_binance_timestamp(binance_ticker.timestamp, sizeof(binance_ticker.timestamp), binance_ticker.time_ms);
-    
-                        log_ticker_price(&binance_ticker);
-                        write_ticker_to_bson(&binance_ticker);
-
-                    }
-                }
-                free(msg);
+            /* Messages larger than the rx buffer arrive over several callbacks; parse them whole */
+            int reassembled = 0;
+            if (session->message_len || session->message_dropped || !lws_is_final_fragment(wsi) ||
+                lws_remaining_packet_payload(wsi)) {
+                if (!session_reassemble(wsi, session, in, len)) return 0;
+                in = session->message;
+                len = session->message_len;
+                reassembled = 1;
             }
-            else if (strcmp(protocol, "coinbase-websocket") == 0) {
-                // printf("[DATA][Coinbase] %.*s\n", (int)len, (char *)in);
-                if (strstr((char *)in, "\"type\":\"match\"") && !strstr((char *)in, "\"type\":\"last_match\"")) {
-                    TradeData coinbase_trade = {0};
-                    strncpy(coinbase_trade.exchange, "Coinbase", sizeof(coinbase_trade.exchange) - 1);
-
-                    if (extract_order_data((char *)in, "\"time\":\"", coinbase_trade.timestamp, sizeof(coinbase_trade.timestamp)) &&
-                        extract_order_data((char *)in, "\"product_id\":\"", coinbase_trade.currency, sizeof(coinbase_trade.currency)) &&
-                        extract_order_data((char *)in, "\"price\":\"", coinbase_trade.price, sizeof(coinbase_trade.price)) &&
-                        extract_order_data((char *)in, "\"size\":\"", coinbase_trade.size, sizeof(coinbase_trade.size))) {
 
-                        extract_order_data((char *)in, "\"trade_id\":", coinbase_trade.trade_id, sizeof(coinbase_trade.trade_id));
-
-                        log_trade_price(coinbase_trade.timestamp, coinbase_trade.exchange, coinbase_trade.currency,
-                                        coinbase_trade.price, coinbase_trade.size, coinbase_trade.trade_id, coinbase_trade.market_maker);
-
-                        write_trade_to_bson(&coinbase_trade);
-                        // printf("[TRADE] %s | %s | Price: %s | Size: %s | ID: %s\n", coinbase_trade.exchange, coinbase_trade.currency, coinbase_trade.price, coinbase_trade.size, coinbase_trade.trade_id);
-                    }
-                }
-                else if (strstr((char *)in, "\"type\":\"ticker\"")) {
-                    TickerData coinbase_ticker = {0};
-                    strncpy(coinbase_ticker.exchange, "Coinbase", MAX_EXCHANGE_NAME_LENGTH - 1);
-                    coinbase_ticker.exchange[MAX_EXCHANGE_NAME_LENGTH - 1] = '\0'; 
-
-                    if (extract_order_data((char *)in, "\"time\":\"", coinbase_ticker.timestamp, sizeof(coinbase_ticker.timestamp)) &&
-                        extract_order_data((char *)in, "\"product_id\":\"", coinbase_ticker.currency, sizeof(coinbase_ticker.currency)) &&
-                        extract_order_data((char *)in, "\"price\":\"", coinbase_ticker.price, sizeof(coinbase_ticker.price))) {
-                        // printf("[TICKER] Coinbase | %s | Price: %s\n", coinbase_ticker.currency, coinbase_ticker.price);
-
-                        extract_order_data((char *)in, "\"best_bid\":\"", coinbase_ticker.bid, sizeof(coinbase_ticker.bid));
-                        extract_order_data((char *)in, "\"best_ask\":\"", coinbase_ticker.ask, sizeof(coinbase_ticker.ask));
-                        extract_order_data((char *)in, "\"best_bid_size\":\"", coinbase_ticker.bid_qty, sizeof(coinbase_ticker.bid_qty));
-                        extract_order_data((char *)in, "\"best_ask_size\":\"", coinbase_ticker.ask_qty, sizeof(coinbase_ticker.ask_qty));
-
-                        extract_order_data((char *)in, "\"open_24h\":\"", coinbase_ticker.open_price, sizeof(coinbase_ticker.open_price));
-                        extract_order_data((char *)in, "\"high_24h\":\"", coinbase_ticker.high_price, sizeof(coinbase_ticker.high_price));
-                        extract_order_data((char *)in, "\"low_24h\":\"", coinbase_ticker.low_price, sizeof(coinbase_ticker.low_price));
-                        extract_order_data((char *)in, "\"volume_24h\":\"", coinbase_ticker.volume_24h, sizeof(coinbase_ticker.volume_24h));
-                        extract_order_data((char *)in, "\"volume_30d\":\"", coinbase_ticker.volume_30d, sizeof(coinbase_ticker.volume_30d));  
-                        extract_order_data((char *)in, "\"trade_id\":", coinbase_ticker.trade_id, sizeof(coinbase_ticker.trade_id)); 
-                        extract_order_data((char *)in, "\"last_size\":\"", coinbase_ticker.last_trade_size, sizeof(coinbase_ticker.last_trade_size));
-                        log_ticker_price(&coinbase_ticker);
-                        
-                        write_ticker_to_bson(&coinbase_ticker);
-
-                    }
-                }
-            }
-            else if (strcmp(protocol, "kraken-websocket") == 0) {
-                // Handle Kraken trade messages
-                if (strstr((char *)in, "\"trade\"")) {
-                    json_error_t err;
-                    json_t *root = json_loads((char *)in, 0, &err);
-                    if (root && json_is_array(root) && json_array_size(root) >= 4) {
-                        json_t *trades = json_array_get(root, 1);  // array of trades
-                        json_t *meta = json_array_get(root, json_array_size(root) - 1);
-                        const char *pair = json_string_value(meta);
-                        if (json_is_array(trades)) {
-                            for (size_t i = 0; i < json_array_size(trades); i++) {
-                                json_t *t = json_array_get(trades, i);
-                                if (json_is_array(t) && json_array_size(t) >= 3) {
-                                    TradeData kraken_trade = {0};
-                                    strncpy(kraken_trade.exchange, "Kraken", sizeof(kraken_trade.exchange) - 1);
-                                    if (pair)
-                                        strncpy(kraken_trade.currency, pair, sizeof(kraken_trade.currency) - 1);
-                                    
-                                    const char *price = json_string_value(json_array_get(t, 0));
-                                    const char *size = json_string_value(json_array_get(t, 1));
-                                    const char *time = json_string_value(json_array_get(t, 2));
-
-                                    if (price) strncpy(kraken_trade.price, price, sizeof(kraken_trade.price) - 1);
-                                    if (size) strncpy(kraken_trade.size, size, sizeof(kraken_trade.size) - 1);
-                                    if (time) strncpy(kraken_trade.timestamp, time, sizeof(kraken_trade.timestamp) - 1);
-                                    else get_timestamp(kraken_trade.timestamp, sizeof(kraken_trade.timestamp));
-
-                                    log_trade_price(kraken_trade.timestamp, kraken_trade.exchange, kraken_trade.currency,
-                                                    kraken_trade.price, kraken_trade.size, kraken_trade.trade_id, kraken_trade.market_maker);
-                                    write_trade_to_bson(&kraken_trade);
-                                    // printf("[TRADE] %s | %s | Price: %s | Size: %s\n", kraken_trade.exchange, kraken_trade.currency, kraken_trade.price, kraken_trade.size);
-                                }
-                            }
-                        }
-                        json_decref(root);
-                        return 0;
-                    }
-                }
-                if (strstr((char *)in, "\"event\":\"heartbeat\"")) {
-                    return 0;
-                }
-                // printf("[TICKER][Kraken] %.*s\n", (int)len, (char *)in);
-                {
-                    TickerData kraken_ticker = {0};
-                    strncpy(kraken_ticker.exchange, "Kraken", MAX_EXCHANGE_NAME_LENGTH - 1);
-                    kraken_ticker.exchange[MAX_EXCHANGE_NAME_LENGTH - 1] = '\0'; 
-
-                   json_t *root, *obj, *b, *a, *c, *v, *p, *l, *h, *o;
-                   json_error_t err;
-                   bool qty_found = true;
-
-                    root = json_loads(in, 0, &err);
-                    if (!root) {
-                        qty_found = false;
-                    }
-                    else {
-                        if (!json_is_array(root) || json_array_size(root) < 4) {
-                            qty_found = false;
-                        }
-                        else { 
-                            obj = json_array_get(root, 1);  
-                            b = json_object_get(obj, "b");
-                            a = json_object_get(obj, "a");
-                            c = json_object_get(obj, "c");
-                            v = json_object_get(obj, "v");
-                            p = json_object_get(obj, "p");
-                            // t = json_object_get(obj, "t");
-                            l = json_object_get(obj, "l");
-                            h = json_object_get(obj, "h");
-                            o = json_object_get(obj, "o");
-                            
-                            if  (json_is_string(json_array_get(b, 0)))
-                                strncpy(kraken_ticker.bid,        json_string_value(json_array_get(b, 0)), sizeof(kraken_ticker.bid) - 1);
-                            if  (json_is_string(json_array_get(a, 0)))
-                                strncpy(kraken_ticker.ask,        json_string_value(json_array_get(a, 0)), sizeof(kraken_ticker.ask) - 1);
-                            if  (json_is_string(json_array_get(b, 1)))
-                                strncpy(kraken_ticker.bid_whole,  json_string_value(json_array_get(b, 1)), sizeof(kraken_ticker.bid_whole) - 1);
-                            if  (json_is_string(json_array_get(b, 2)))
-                                strncpy(kraken_ticker.bid_qty,    json_string_value(json_array_get(b, 2)), sizeof(kraken_ticker.bid_qty) - 1);
-                            if  (json_is_string(json_array_get(a, 1)))
-                                strncpy(kraken_ticker.ask_whole,  json_string_value(json_array_get(a, 1)), sizeof(kraken_ticker.ask_whole) - 1);
-                            if  (json_is_string(json_array_get(a, 2)))
-                                strncpy(kraken_ticker.ask_qty,    json_string_value(json_array_get(a, 2)), sizeof(kraken_ticker.ask_qty) - 1);
-                            if  (json_is_string(json_array_get(c, 0)))
-                                strncpy(kraken_ticker.price,      json_string_value(json_array_get(c, 0)), sizeof(kraken_ticker.price) - 1);                   
-                            if  (json_is_string(json_array_get(c, 1)))
-                                strncpy(kraken_ticker.last_vol,   json_string_value(json_array_get(c, 1)), sizeof(kraken_ticker.last_vol) - 1);
-                            if  (json_is_string(json_array_get(v, 0)))
-                                strncpy(kraken_ticker.vol_today,  json_string_value(json_array_get(v, 0)), sizeof(kraken_ticker.vol_today) - 1);
-                            if  (json_is_string(json_array_get(v, 1)))
-                                strncpy(kraken_ticker.volume_24h,    json_string_value(json_array_get(v, 1)), sizeof(kraken_ticker.volume_24h) - 1);
-                            if  (json_is_string(json_array_get(p, 0)))
-                                strncpy(kraken_ticker.vwap_today, json_string_value(json_array_get(p, 0)), sizeof(kraken_ticker.vwap_today) - 1);
-                            if  (json_is_string(json_array_get(p, 1)))
-                                strncpy(kraken_ticker.vwap_24h,   json_string_value(json_array_get(p, 1)), sizeof(kraken_ticker.vwap_24h) - 1);
-                            if  (json_is_string(json_array_get(l, 0)))
-                                strncpy(kraken_ticker.low_today,  json_string_value(json_array_get(l, 0)), sizeof(kraken_ticker.low_today) - 1);
-                            if  (json_is_string(json_array_get(l, 1)))
-                                strncpy(kraken_ticker.low_price,    json_string_value(json_array_get(l, 1)), sizeof(kraken_ticker.low_price) - 1);
-                            if  (json_is_string(json_array_get(h, 0)))
-                                strncpy(kraken_ticker.high_today, json_string_value(json_array_get(h, 0)), sizeof(kraken_ticker.high_today) - 1);
-                            if  (json_is_string(json_array_get(h, 1)))
-                                strncpy(kraken_ticker.high_price,   json_string_value(json_array_get(h, 1)), sizeof(kraken_ticker.high_price) - 1);
-                            if  (json_is_string(json_object_get(o, "o")))
-                                strncpy(kraken_ticker.open_today, json_string_value(json_object_get(o, "o")), sizeof(kraken_ticker.open_today) - 1);       
-        
-                        }
-                    }
-                    if (extract_order_data((char *)in, "\"c\":[\"", kraken_ticker.price, sizeof(kraken_ticker.price)) &&
-                        qty_found ) {
-                        const char *last_quote = strrchr((char *)in, '"');
-                        if (last_quote) {
-                            const char *start = last_quote - 1;
-                            while (start > (char *)in && *start != '"') {
-                                start--;
-                            }
-                            start++;
-                            size_t len = last_quote - start;
-                            if (len < sizeof(kraken_ticker.currency)) {
-                                strncpy(kraken_ticker.currency, start, len);
-                                kraken_ticker.currency[len] = '\0';
-                            }
-                        }
-                        get_timestamp(kraken_ticker.timestamp, sizeof(kraken_ticker.timestamp));   
-                        log_ticker_price(&kraken_ticker);
-                        write_ticker_to_bson(&kraken_ticker);
-                    }
-                }
+            ingest_frame_received();
+            latency_frame_begin(session->connection);
+            capture_frame(session->exchange_id, session->connection, in, len);
+            uint64_t records = ingest_thread_records();
+            int result = handle_exchange_message(wsi, session, in, len);
+            latency_frame_end(len, result < 0);
+            if (reassembled) session->message_len = 0;
+
+            /* Time to first tick: the first frame after subscribing that produced a record */
+            if (session->subscribed_ns && ingest_thread_records() != records) {
+                subscription_first_tick(session->connection, monotonic_ns() - session->subscribed_ns);
+                session->subscribed_ns = 0;
             }
-            // else if (strcmp(protocol, "bitfinex-websocket") == 0) {
-            //     if (strstr((char *)in, "\"hb\"")) {
-            //         return 0;
-            //     }
-            //     // printf("[TICKER][Bitfinex] %.*s\n", (int)len, (char *)in);
-            //     {
-            //         char price[32] = {0}, timestamp[32] = {0};
-            //         char bid[32] = {0}, ask[32] = {0}, bid_qty[32] = {0}, ask_qty[32] = {0};
-            //         if (extract_bitfinex_price((char *)in, price, sizeof(price)) 
-            //         /* &&
-            //             extract_bitfinex_price((char *)in, "\"BID\":\"", bid, sizeof(bid)) &&
-            //             extract_bitfinex_price((char *)in, "\"BID_SIZE\":\"", bid_qty, sizeof(bid_qty)) &&
-            //             extract_bitfinex_price((char *)in, "\"ASK\":\"", ask, sizeof(ask)) &&
-            //             extract_bitfinex_price((char *)in, "\"ASK_SIZE\":\"", ask_qty, sizeof(ask_qty))*/) {
-
-            //             get_timestamp(timestamp, sizeof(timestamp));
-            //             // log_ticker_price(timestamp, "Bitfinex", "tBTCUSD", price, bid, bid_qty, ask, ask_qty);
-            //         }
-            //     }
-            // }
-            else if (strncmp(protocol, "huobi-websocket", 15) == 0) {
-                char decompressed[8192] = {0};
-                int decompressed_len = decompress_gzip((char *)in, len, decompressed, sizeof(decompressed));
-                if (decompressed_len > 0) {
-                    // printf("[TICKER][Huobi] %.*s\n", decompressed_len, decompressed);
-
-                    /* Handle Huobi ping-pong */
-                    char ping_value[32] = {0};
-                    if (extract_numeric(decompressed, "\"ping\":", ping_value, sizeof(ping_value))) {
-                        char pong_msg[64];
-                        snprintf(pong_msg, sizeof(pong_msg), "{\"pong\": %s}", ping_value);
-                        unsigned char *buf = malloc(LWS_PRE + strlen(pong_msg));
-                        if (!buf) {
-                            printf("[ERROR] Memory allocation failed for Huobi pong\n");
-                            return -1;
-                        }
-                        memcpy(buf + LWS_PRE, pong_msg, strlen(pong_msg));
-                        lws_write(wsi, buf + LWS_PRE, strlen(pong_msg), LWS_WRITE_TEXT);
-                        // printf("[INFO] Sent Huobi Pong: %s\n", pong_msg);
-
-                        free(buf);
-                    }
-                    TickerData huobi_ticker = {0};
-                    strncpy(huobi_ticker.exchange, "Huobi", MAX_EXCHANGE_NAME_LENGTH - 1);
-                    huobi_ticker.exchange[MAX_EXCHANGE_NAME_LENGTH - 1] = '\0'; 
-
-                    if (extract_numeric(decompressed, "\"close\":", huobi_ticker.price, sizeof(huobi_ticker.price)) &&
-                        extract_huobi_currency(decompressed, huobi_ticker.currency, sizeof(huobi_ticker.currency))) {
-
-                        extract_numeric(decompressed, "\"bid\":\"", huobi_ticker.bid, sizeof(huobi_ticker.bid));
-                        extract_numeric(decompressed, "\"bidSize\":\"", huobi_ticker.bid_qty, sizeof(huobi_ticker.bid_qty));
-                        extract_numeric(decompressed, "\"ask\":\"", huobi_ticker.ask, sizeof(huobi_ticker.ask));
-                        extract_numeric(decompressed, "\"askSize\":\"", huobi_ticker.ask_qty, sizeof(huobi_ticker.ask_qty));
-
-                        extract_numeric(decompressed, "\"open\":\"", huobi_ticker.open_price, sizeof(huobi_ticker.open_price));
-                        extract_numeric(decompressed, "\"high\":\"", huobi_ticker.high_price, sizeof(huobi_ticker.high_price));
-                        extract_numeric(decompressed, "\"low\":\"", huobi_ticker.low_price, sizeof(huobi_ticker.low_price));
-                        extract_numeric(decompressed, "\"close\":\"", huobi_ticker.close_price, sizeof(huobi_ticker.close_price));
-
-                        extract_numeric(decompressed, "\"amount\":\"", huobi_ticker.volume_24h, sizeof(huobi_ticker.volume_24h));
-                        
-                        char ts_str[32] = {0};
-                        if (extract_numeric(decompressed, "\"ts\":", ts_str, sizeof(ts_str))) {
-                            convert_binance_timestamp(huobi_ticker.timestamp, sizeof(huobi_ticker.timestamp), ts_str);
-                        } else {
-                            get_timestamp(huobi_ticker.timestamp, sizeof(huobi_ticker.timestamp));
-                        }    
-                        log_ticker_price(&huobi_ticker);
-                        write_ticker_to_bson(&huobi_ticker);           
-                    }
-                    else if (strstr(decompressed, "\"ch\":\"market.") && strstr(decompressed, ".trade.detail\"")) {
-                        TradeData huobi_trade = {0};
-                        strncpy(huobi_trade.exchange, "Huobi", sizeof(huobi_trade.exchange) - 1);
-
-                        // Extract symbol from channel string
-                        extract_huobi_currency(decompressed, huobi_trade.currency, sizeof(huobi_trade.currency));
-
-                        // Extract trade details
-                        extract_numeric(decompressed, "\"price\":", huobi_trade.price, sizeof(huobi_trade.price));
-                        extract_numeric(decompressed, "\"amount\":", huobi_trade.size, sizeof(huobi_trade.size));
-                        extract_numeric(decompressed, "\"ts\":", huobi_trade.timestamp, sizeof(huobi_trade.timestamp));
-                        extract_numeric(decompressed, "\"id\":", huobi_trade.trade_id, sizeof(huobi_trade.trade_id));
-
-                        char iso_ts[64] = {0};
-                        convert_binance_timestamp(iso_ts, sizeof(iso_ts), huobi_trade.timestamp);
-                        strncpy(huobi_trade.timestamp, iso_ts, sizeof(huobi_trade.timestamp) - 1);
-
-                        log_trade_price(huobi_trade.timestamp, huobi_trade.exchange, huobi_trade.currency,
-                                        huobi_trade.price, huobi_trade.size, huobi_trade.trade_id, huobi_trade.market_maker);
-
-                        write_trade_to_bson(&huobi_trade);
-                        // printf("[TRADE] %s | %s | Price: %s | Size: %s | ID: %s\n", huobi_trade.exchange, huobi_trade.currency, huobi_trade.price, huobi_trade.size, huobi_trade.trade_id);
-                    }
-                }
-            }
-            else if (strncmp(protocol, "okx-websocket", 13) == 0) {            
-                // printf("[TICKER][OKX] %.*s\n", (int)len, (char *)in);
-
-                TickerData okx_ticker = {0};
-                strncpy(okx_ticker.exchange, "OKX", MAX_EXCHANGE_NAME_LENGTH - 1);
-                okx_ticker.exchange[MAX_EXCHANGE_NAME_LENGTH - 1] = '\0'; 
-                
-                if (extract_order_data((char *)in, "\"last\":\"", okx_ticker.price, sizeof(okx_ticker.price)) &&
-                    extract_order_data((char *)in, "\"instId\":\"", okx_ticker.currency, sizeof(okx_ticker.currency))) {
-
-                    extract_order_data((char *)in, "\"bidPx\":\"", okx_ticker.bid, sizeof(okx_ticker.bid));
-                    extract_order_data((char *)in, "\"bidSz\":\"", okx_ticker.bid_qty, sizeof(okx_ticker.bid_qty));
-                    extract_order_data((char *)in, "\"askPx\":\"", okx_ticker.ask, sizeof(okx_ticker.ask));
-                    extract_order_data((char *)in, "\"askSz\":\"", okx_ticker.ask_qty, sizeof(okx_ticker.ask_qty));
-
-                    extract_order_data((char *)in, "\"open24h\":\"", okx_ticker.open_price, sizeof(okx_ticker.open_price));
-                    extract_order_data((char *)in, "\"high24h\":\"", okx_ticker.high_price, sizeof(okx_ticker.high_price));
-                    extract_order_data((char *)in, "\"low24h\":\"", okx_ticker.low_price, sizeof(okx_ticker.low_price));
-                    extract_order_data((char *)in, "\"vol24h\":\"", okx_ticker.volume_24h, sizeof(okx_ticker.volume_24h));
-
-                    if (!extract_order_data((char *)in, "\"ts\":\"", okx_ticker.timestamp, sizeof(okx_ticker.timestamp)))
-                        get_timestamp(okx_ticker.timestamp, sizeof(okx_ticker.timestamp));
-                    
-                    log_ticker_price(&okx_ticker);
-                    write_ticker_to_bson(&okx_ticker);
-                } else if (strstr((char *)in, "\"arg\":{\"channel\":\"trades\"")) {
-                    TradeData okx_trade = {0};
-                    strncpy(okx_trade.exchange, "OKX", sizeof(okx_trade.exchange) - 1);
-
-                    if (extract_order_data((char *)in, "\"px\":\"", okx_trade.price, sizeof(okx_trade.price)) &&
-                        extract_order_data((char *)in, "\"instId\":\"", okx_trade.currency, sizeof(okx_trade.currency))) {
-
-                        if (!extract_order_data((char *)in, "\"ts\":\"", okx_trade.timestamp, sizeof(okx_trade.timestamp))) {
-                            get_timestamp(okx_trade.timestamp, sizeof(okx_trade.timestamp));
-                        }
-
-                        log_trade_price(okx_trade.timestamp, okx_trade.exchange, okx_trade.currency,
-                                        okx_trade.price, okx_trade.size, okx_trade.trade_id, okx_trade.market_maker);
-                        write_trade_to_bson(&okx_trade);
-                        // printf("[TRADE] %s | %s | Price: %s | Time: %s\n", okx_trade.exchange, okx_trade.currency, okx_trade.price, okx_trade.timestamp);
-                    }
-                }
-            }
-            break;
+
+            // A stack fallback session does not outlive this callback
+            if (session == &fallback_session) session_release(&fallback_session);
+            return result;
         }
         case LWS_CALLBACK_CLIENT_CLOSED: {
             printf("[WARNING] %s WebSocket Connection Closed. Attempting Reconnect...\n", protocol);
-            schedule_reconnect(protocol);
+            lws_sul_cancel(&session->subscribe_sul);
+            session->subscribe_pending = 0;
+            session->wsi = NULL;
+            session_release(session);
+            reconnect_lost(session->connection);
             break;
         }
         case LWS_CALLBACK_CLIENT_CONNECTION_ERROR: {
             printf("[ERROR] %s WebSocket Connection Error! Attempting Reconnect...\n", protocol);
-            schedule_reconnect(protocol);
+            reconnect_lost(session->connection);
             break;
         }
         default: {
@@ -909,141 +649,100 @@ int callback_combined(struct lws *wsi, enum lws_callback_reasons reason,
 
 
 
-/* Write TickerData to a BSON file */
+/* Fixed-point values are stored as their decimal text, as before */
+static void append_fixed_to_bson(bson_t *doc, const char *key, Fixed value) {
+    char text[FIXED_TEXT_SIZE];
+    fixed_format(value, text, sizeof(text));
+    BSON_APPEND_UTF8(doc, key, text);
+}
+
+/* Write TickerData to the buffered daily BSON file for its exchange */
 void write_ticker_to_bson(const TickerData *ticker) {
-    time_t now = time(NULL);
-    struct tm *tm = gmtime(&now);
-    char filename[128];
-    snprintf(filename, sizeof(filename), "bson_output/%s_ticker_%04d%02d%02d.bson",
-             ticker->exchange, tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday);
-
-    FILE *fp = fopen(filename, "ab");
-    if (!fp) {
-        printf("[ERROR] Failed to open BSON file %s: %s\n", filename, strerror(errno));
-        return;
-    }
+    char timestamp[40], time_ms[24];
+    format_timestamp_ns(ticker->ts_ns, 1, timestamp, sizeof(timestamp));
+    snprintf(time_ms, sizeof(time_ms), "%lld", (long long)(ticker->ts_ns / 1000000));
 
     bson_t doc;
     bson_init(&doc);
-    
-    BSON_APPEND_UTF8(&doc, "exchange", ticker->exchange);
-    BSON_APPEND_UTF8(&doc, "price", ticker->price);
-    BSON_APPEND_UTF8(&doc, "currency", ticker->currency);
-    BSON_APPEND_UTF8(&doc, "time_ms", ticker->time_ms);
-    BSON_APPEND_UTF8(&doc, "timestamp", ticker->timestamp);
-    BSON_APPEND_UTF8(&doc, "bid", ticker->bid);
-    BSON_APPEND_UTF8(&doc, "ask", ticker->ask);
-    BSON_APPEND_UTF8(&doc, "bid_qty", ticker->bid_qty);
-    BSON_APPEND_UTF8(&doc, "ask_qty", ticker->ask_qty);
-    BSON_APPEND_UTF8(&doc, "open_price", ticker->open_price);
-    BSON_APPEND_UTF8(&doc, "high_price", ticker->high_price);
-    BSON_APPEND_UTF8(&doc, "low_price", ticker->low_price);
-    BSON_APPEND_UTF8(&doc, "close_price", ticker->close_price);
-    BSON_APPEND_UTF8(&doc, "volume_24h", ticker->volume_24h);
-    BSON_APPEND_UTF8(&doc, "volume_30d", ticker->volume_30d);
-    BSON_APPEND_UTF8(&doc, "quote_volume", ticker->quote_volume);
-    BSON_APPEND_UTF8(&doc, "symbol", ticker->symbol);
-    BSON_APPEND_UTF8(&doc, "last_trade_time", ticker->last_trade_time);
-    BSON_APPEND_UTF8(&doc, "last_trade_price", ticker->last_trade_price);
-    BSON_APPEND_UTF8(&doc, "last_trade_size", ticker->last_trade_size);
-    BSON_APPEND_UTF8(&doc, "trade_id", ticker->trade_id);
-    BSON_APPEND_UTF8(&doc, "sequence", ticker->sequence);
-    
-    // relatively new fields
-    BSON_APPEND_UTF8(&doc, "bid_whole", ticker->bid_whole);
-    BSON_APPEND_UTF8(&doc, "ask_whole", ticker->ask_whole);
-    BSON_APPEND_UTF8(&doc, "last_vol", ticker->last_vol);
-    BSON_APPEND_UTF8(&doc, "vol_today", ticker->vol_today);
-    BSON_APPEND_UTF8(&doc, "vwap_today", ticker->vwap_today);
-    BSON_APPEND_UTF8(&doc, "vwap_24h", ticker->vwap_24h);
-    BSON_APPEND_UTF8(&doc, "low_today", ticker->low_today);
-    BSON_APPEND_UTF8(&doc, "high_today", ticker->high_today);
-    BSON_APPEND_UTF8(&doc, "open_today", ticker->open_today);
-
-
-    const uint8_t *data = bson_get_data(&doc);
-    if (fwrite(data, 1, doc.len, fp) != doc.len) {
-        printf("[ERROR] Failed to write to BSON file %s\n", filename);
-    // } else {
-        // printf("[INFO] Wrote TickerData to %s\n", filename);
-    }
 
+    BSON_APPEND_UTF8(&doc, "exchange", exchange_name(ticker->exchange_id));
+    append_fixed_to_bson(&doc, "price", ticker->price);
+    BSON_APPEND_UTF8(&doc, "currency", symbol_name(ticker->symbol_id));
+    BSON_APPEND_UTF8(&doc, "time_ms", time_ms);
+    BSON_APPEND_UTF8(&doc, "timestamp", timestamp);
+    append_fixed_to_bson(&doc, "bid", ticker->bid);
+    append_fixed_to_bson(&doc, "ask", ticker->ask);
+    append_fixed_to_bson(&doc, "bid_qty", ticker->bid_qty);
+    append_fixed_to_bson(&doc, "ask_qty", ticker->ask_qty);
+    append_fixed_to_bson(&doc, "open_price", ticker->open_price);
+    append_fixed_to_bson(&doc, "high_price", ticker->high_price);
+    append_fixed_to_bson(&doc, "low_price", ticker->low_price);
+    append_fixed_to_bson(&doc, "close_price", ticker->close_price);
+    append_fixed_to_bson(&doc, "volume_24h", ticker->volume_24h);
+    append_fixed_to_bson(&doc, "volume_30d", ticker->volume_30d);
+    append_fixed_to_bson(&doc, "quote_volume", ticker->quote_volume);
+    BSON_APPEND_UTF8(&doc, "symbol", symbol_name(ticker->symbol_id));
+    append_fixed_to_bson(&doc, "last_trade_time", ticker->last_trade_time);
+    append_fixed_to_bson(&doc, "last_trade_price", ticker->last_trade_price);
+    append_fixed_to_bson(&doc, "last_trade_size", ticker->last_trade_size);
+    append_fixed_to_bson(&doc, "trade_id", ticker->trade_id);
+    append_fixed_to_bson(&doc, "sequence", ticker->sequence);
+
+    // relatively new fields
+    append_fixed_to_bson(&doc, "bid_whole", ticker->bid_whole);
+    append_fixed_to_bson(&doc, "ask_whole", ticker->ask_whole);
+    append_fixed_to_bson(&doc, "last_vol", ticker->last_vol);
+    append_fixed_to_bson(&doc, "vol_today", ticker->vol_today);
+    append_fixed_to_bson(&doc, "vwap_today", ticker->vwap_today);
+    append_fixed_to_bson(&doc, "vwap_24h", ticker->vwap_24h);
+    append_fixed_to_bson(&doc, "low_today", ticker->low_today);
+    append_fixed_to_bson(&doc, "high_today", ticker->high_today);
+    append_fixed_to_bson(&doc, "open_today", ticker->open_today);
+
+    bson_writer_append(ticker->exchange_id, BSON_KIND_TICKER, ticker->ts_ns,
+                       symbol_name(ticker->symbol_id), bson_get_data(&doc), doc.len);
     bson_destroy(&doc);
-    fclose(fp);
 }
 
-/* Write TradeData to a BSON file */
+/* Write TradeData to the buffered daily BSON file for its exchange */
 void write_trade_to_bson(const TradeData *trade) {
-    time_t now = time(NULL);
-    struct tm *tm = gmtime(&now);
-    char filename[128];
-    snprintf(filename, sizeof(filename), "bson_output/%s_trade_%04d%02d%02d.bson",
-             trade->exchange, tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday);
-
-    FILE *fp = fopen(filename, "ab");
-    if (!fp) {
-        printf("[ERROR] Failed to open BSON file %s: %s\n", filename, strerror(errno));
-        return;
-    }
+    char timestamp[40];
+    format_timestamp_ns(trade->ts_ns, 1, timestamp, sizeof(timestamp));
 
     bson_t doc;
     bson_init(&doc);
 
-    BSON_APPEND_UTF8(&doc, "exchange", trade->exchange);
-    BSON_APPEND_UTF8(&doc, "price", trade->price);
-    BSON_APPEND_UTF8(&doc, "size", trade->size);
-    BSON_APPEND_UTF8(&doc, "currency", trade->currency);
-    BSON_APPEND_UTF8(&doc, "timestamp", trade->timestamp);
-    BSON_APPEND_UTF8(&doc, "trade_id", trade->trade_id);
-    BSON_APPEND_UTF8(&doc, "market_maker", trade->market_maker);
-
-    const uint8_t *data = bson_get_data(&doc);
-    if (fwrite(data, 1, doc.len, fp) != doc.len) {
-        printf("[ERROR] Failed to write to BSON file %s\n", filename);
-    }
+    BSON_APPEND_UTF8(&doc, "exchange", exchange_name(trade->exchange_id));
+    append_fixed_to_bson(&doc, "price", trade->price);
+    append_fixed_to_bson(&doc, "size", trade->size);
+    BSON_APPEND_UTF8(&doc, "currency", symbol_name(trade->symbol_id));
+    BSON_APPEND_UTF8(&doc, "timestamp", timestamp);
+    append_fixed_to_bson(&doc, "trade_id", trade->trade_id);
+    BSON_APPEND_UTF8(&doc, "market_maker", trade->market_maker < 0 ? "" : (trade->market_maker ? "true" : "false"));
 
+    bson_writer_append(trade->exchange_id, BSON_KIND_TRADE, trade->ts_ns,
+                       symbol_name(trade->symbol_id), bson_get_data(&doc), doc.len);
     bson_destroy(&doc);
-    fclose(fp);
 }
 
-/* Define the protocols array for use in the context. */
-struct lws_protocols protocols[] = {
-    { "binance-websocket-0", callback_combined, 0, 4096, 0, 0, 0 },
-    { "binance-websocket-1", callback_combined, 0, 4096, 0, 0, 0 },
-    { "binance-websocket-2", callback_combined, 0, 4096, 0, 0, 0 },
-    { "binance-websocket-3", callback_combined, 0, 4096, 0, 0, 0 },
-    { "binance-websocket-4", callback_combined, 0, 4096, 0, 0, 0 },
-    { "binance-websocket-5", callback_combined, 0, 4096, 0, 0, 0 },
-    { "coinbase-websocket", callback_combined, 0, 4096, 0, 0, 0 },
-    { "kraken-websocket", callback_combined, 0, 4096, 0, 0, 0 },
-    { "bitfinex-websocket", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-0", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-1", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-2", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-3", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-4", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-5", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-6", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-7", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-8", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-9", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-10", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-11", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-12", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-13", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-14", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-15", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-16", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-17", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-18", callback_combined, 0, 4096, 0, 0, 0 },
-    { "huobi-websocket-19", callback_combined, 0, 4096, 0, 0, 0 },
-    { "okx-websocket-0", callback_combined, 0, 4096, 0, 0, 0 },
-    { "okx-websocket-1", callback_combined, 0, 4096, 0, 0, 0 },
-    { "okx-websocket-2", callback_combined, 0, 4096, 0, 0, 0 },
-    { "okx-websocket-3", callback_combined, 0, 4096, 0, 0, 0 },
-    { "okx-websocket-4", callback_combined, 0, 4096, 0, 0, 0 },
-    { "okx-websocket-5", callback_combined, 0, 4096, 0, 0, 0 },
-    { "okx-websocket-6", callback_combined, 0, 4096, 0, 0, 0 },
-    { "okx-websocket-7", callback_combined, 0, 4096, 0, 0, 0 },
-    { NULL, NULL, 0, 0, 0, 0, 0 }
-};
+/* Protocols array for use in the contexts, one entry per connection table entry.
+ * The id of each entry is its connection index, shared with retry_counts[]. */
+struct lws_protocols *protocols = NULL;
+
+int build_protocols(void) {
+    int count = connection_count();
+    protocols = calloc((size_t)count + 1, sizeof(struct lws_protocols));
+    if (!protocols) {
+        printf("[ERROR] Memory allocation failed for protocols\n");
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        protocols[i].name = connection_name(i);
+        protocols[i].callback = callback_combined;
+        protocols[i].per_session_data_size = sizeof(SessionData);
+        protocols[i].rx_buffer_size = 4096;
+        protocols[i].id = (unsigned int)i;
+    }
+    return 0;
+}
@@ -5,9 +5,11 @@
  * from multiple cryptocurrency exchanges.
  * 
  * Features:
- *  - Unified `TickerData` structure for standardized market fields.
+ *  - Unified `TickerData` / `TradeData` records (defined in `market_record.h`).
  *  - WebSocket callback handler for message and event processing.
- *  - Subscription builders for different exchange formats.
+ *  - `protocols[]`: built at startup from the connection table.
+ *  - `SessionData`: per-connection state kept in lws per-session user data, including
+ *    the reassembly buffer for messages split across receive callbacks.
  *  - BSON writing support for serialized market data.
  * 
  * Dependencies:
@@ -18,7 +20,7 @@
  *  - Included in `exchange_websocket.c` and `main.c`.
  * 
  * Created: 3/7/2025
- * Updated: 5/8/2025
+ * Updated: 10/18/2026
  */
 
 #ifndef EXCHANGE_WEBSOCKET_H
@@ -28,78 +30,49 @@
 
 #include <libwebsockets.h>
 
-typedef struct {
-    char price[32];
-    char currency[32];
-    char time_ms[32]; // Binance specific field to allow for different format (this was already here)
-    char timestamp[64];
-
-    char bid[32];
-    char ask[32];
-    char bid_qty[32];
-    char ask_qty[32];
-
-    char open_price[32];
-    char high_price[32];
-    char low_price[32];
-
-    char close_price[32];
-    char volume_24h[32];
-    char volume_30d[32];
-    char quote_volume[32];
-
-    char symbol[32];
-    char last_trade_time[32];
-    char last_trade_price[32];
-    char last_trade_size[32];
-
-    char trade_id[64];
+#include "market_record.h"
+#include "inflate_stream.h"
 
-    char sequence[64];
+/* Largest message reassembled from fragments (Coinbase level2 snapshots run to several MB) */
+#define SESSION_MESSAGE_MAX (64 * 1024 * 1024)
 
-    char exchange[32];
-
-    // new fields
-
-    char bid_whole[32];
-    char ask_whole[32];
-    char last_vol[32];
-    char vol_today[32];
-    char vwap_today[32];
-    char low_today[32];
-    char vwap_24h[32]; 
-    char high_today[32];
-    char open_today[32];
-    
-} TickerData;
+/* Kraken drops subscriptions sent straight after the handshake; they go out this much later */
+#define KRAKEN_SUBSCRIBE_DELAY_US 200000
 
+/* Per-connection state held in lws per-session user data, resolved once per connection */
 typedef struct {
-    char exchange[32];
-    char currency[32];
-    char price[32];
-    char size[32];
-    char trade_id[64];
-    char timestamp[64];
-    char market_maker[32];
-} TradeData;
-
-/* Function to build the subscription messsages for each exchange */
-char* build_subscription_from_file(const char *filename, const char *template_fmt);
-
-char* build_huobi_subscription_from_file(const char *filename);
+    int connection;             // index shared by protocols[] and retry_counts[]
+    uint16_t exchange_id;       // ExchangeId
+    int ready;
+    InflateStream inflate;      // gzip state and output buffer (Huobi), released on close
+    int64_t subscribed_ns;      // when the subscription was sent, until the first record arrives
+    char *message;              // fragments of a message larger than the rx buffer, released on close
+    size_t message_len;
+    size_t message_capacity;
+    int message_dropped;        // the current message outgrew SESSION_MESSAGE_MAX
+    struct lws *wsi;            // set while a delayed subscription is pending
+    lws_sorted_usec_list_t subscribe_sul;   // fires the delayed subscription (Kraken)
+    int subscribe_pending;      // subscription frames go out on the next writeable callback
+} SessionData;
 
 /* Callback function for handling WebSocket events. */
 int callback_combined(struct lws *wsi, enum lws_callback_reasons reason,
                       void *user, void *in, size_t len);
 
+/* Parses one received frame and submits its records. `wsi` may be NULL when replaying captures. */
+int handle_exchange_message(struct lws *wsi, SessionData *session, void *in, size_t len);
+
 /* Function to write data to bson file after extracted to struct */
 void write_ticker_to_bson(const TickerData *ticker);
 
 /* Function to write data to bson file after extracted to struct */
 void write_trade_to_bson(const TradeData *trade);
 
-/* Global protocols array (defined in exchange_websocket.c) */
-extern struct lws_protocols protocols[];
+/* Global protocols array (defined in exchange_websocket.c), NULL-terminated, one entry per connection */
+extern struct lws_protocols *protocols;
+
+/* Builds protocols[] from the connection table; call after connection_table_build(). */
+int build_protocols(void);
 
 /* Global file pointer for writing market data. */
 extern FILE *ticker_data_file;
@@ -1,705 +1,587 @@
 /*
  * Exchange Product ID Fetcher
- * 
+ *
  * This utility gathers available trading pairs from multiple crypto exchange REST APIs
  * and outputs product IDs in WebSocket-compatible JSON formats for both tickers and trades.
- * 
+ *
  * Features:
- *  - Fetches product data via REST API endpoints.
- *  - Writes formatted symbol lists to JSON-style .txt files.
- *  - Outputs chunked or full listings depending on exchange (e.g., Huobi).
+ *  - Fetches every exchange's product list at once with the curl multi interface, one request
+ *    per endpoint (OKX and Binance lists used to be downloaded several times each).
+ *  - Keeps a versioned on-disk cache of each response with its ETag / Last-Modified, and
+ *    sends conditional requests: an unchanged list costs a 304 and no download.
+ *  - Falls back to the cached response when an exchange is unreachable or returns bad JSON.
+ *  - Writes formatted symbol lists to JSON-style .txt files, rewriting only files whose
+ *    contents (symbol membership) changed, so unchanged files keep their mtime.
+ *  - Outputs chunked or full listings depending on exchange (e.g., Huobi); stale chunk
+ *    files left over from a longer list are removed.
  *  - Handles both ticker and trade subscription formats (e.g., OKX, Binance).
- * 
+ *  - `--endpoint HOST:PORT` sends every request to a local HTTP stand-in (same paths, plain HTTP).
+ *
  * Dependencies:
- *  - libcurl: HTTP client for API requests.
+ *  - libcurl: HTTP client for API requests (multi interface, 7.66+ for curl_multi_poll).
  *  - jansson: JSON parsing and generation.
- *  - Standard C libraries (stdio, stdlib, string).
- * 
+ *  - Standard C libraries (stdio, stdlib, string, strings, ctype, time, sys/stat, unistd).
+ *
  * Build & Run:
  *  sudo apt install libcurl4-openssl-dev libjansson-dev build-essential
  *  dos2unix fetch_currency_id.c
  *  gcc fetch_currency_id.c -o fetch_currency_id -lcurl -ljansson
- *  ./fetch_currency_id
- * 
+ *  ./fetch_currency_id [--endpoint HOST:PORT]
+ *
  * Output Directory:
  *  - Writes all exchange product ID files to `currency_text_files/`.
- * 
+ *  - Cached responses live in `currency_text_files/.fetch_cache/`.
+ *
  * Created: 4/29/2025
- * Updated: 5/8/2025
+ * Updated: 10/18/2026
  */
 
- #include <stdio.h>
- #include <stdlib.h>
- #include <string.h>
- #include <ctype.h>
- #include <curl/curl.h>
- #include <jansson.h>
-
- 
- struct MemoryStruct {
-     char *memory;
-     size_t size;
- };
- 
- static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp) {
-     size_t realsize = size * nmemb;
-     struct MemoryStruct *mem = (struct MemoryStruct *)userp;
- 
-     char *ptr = realloc(mem->memory, mem->size + realsize + 1);
-     if (!ptr) {
-         fprintf(stderr, "Not enough memory\n");
-         return 0;
-     }
- 
-     mem->memory = ptr;
-     memcpy(&(mem->memory[mem->size]), contents, realsize);
-     mem->size += realsize;
-     mem->memory[mem->size] = '\0';
- 
-     return realsize;
- }
- 
- void fetch_coinbase_product_ids() {
-     CURL *curl;
-     CURLcode res;
- 
-     struct MemoryStruct chunk = {0};
-     chunk.memory = malloc(1);
-     chunk.size = 0;
- 
-     curl = curl_easy_init();
-     if (curl) {
-         curl_easy_setopt(curl, CURLOPT_URL, "https://api.exchange.coinbase.com/products");
-         curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
-         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-         curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-         res = curl_easy_perform(curl);
- 
-         if (res == CURLE_OK) {
-             json_error_t error;
-             json_t *root = json_loads(chunk.memory, 0, &error);
-             if (root && json_is_array(root)) {
-                 FILE *fp = fopen("currency_text_files/coinbase_currency_ids.txt", "w");
-                 if (!fp) {
-                     fprintf(stderr, "Failed to open output file\n");
-                     json_decref(root);
-                     return;
-                 }
- 
-                 fprintf(fp, "[");
-                 for (size_t i = 0; i < json_array_size(root); i++) {
-                     json_t *product = json_array_get(root, i);
-                     json_t *id_val = json_object_get(product, "id");
-                     if (json_is_string(id_val)) {
-                         const char *id = json_string_value(id_val);
-                         fprintf(fp, "\"%s\"", id);
-                         if (i < json_array_size(root) - 1) {
-                             fprintf(fp, ", ");
-                         }
-                     }
-                 }
-                 fprintf(fp, "]\n");
-                 fclose(fp);
- 
-                 printf("Coinbase Product IDs saved to coinbase_currency_ids.txt\n");
-                 json_decref(root);
-             } else {
-                 fprintf(stderr, "JSON parse error: %s\n", error.text);
-             }
-         } else {
-             fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-         }
- 
-         curl_easy_cleanup(curl);
-         free(chunk.memory);
-     }
- }
-
- void fetch_huobi_product_ids() {
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <curl/curl.h>
+#include <jansson.h>
+
+#define OUTPUT_DIR "currency_text_files"
+#define CACHE_DIR OUTPUT_DIR "/.fetch_cache"
+
+/* Bump when the cache layout changes; older caches are ignored */
+#define FETCH_CACHE_VERSION 1
+
+/* Symbols per chunk file */
+#define CHUNK_SIZE 100
+
+/* Whole-transfer limit per exchange, in seconds */
+#define FETCH_TIMEOUT 30
+
+struct MemoryStruct {
+    char *memory;
+    size_t size;
+};
+
+/* One REST endpoint, fetched once and shared by every file derived from it */
+typedef struct {
+    const char *name;               // cache file stem and log name
+    const char *host;               // scheme and host of the real API
+    const char *path;               // path and query, also used against --endpoint
     CURL *curl;
-    CURLcode res;
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-
-    curl = curl_easy_init();
-    if (curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, "https://api.huobi.pro/v1/common/symbols");
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-        res = curl_easy_perform(curl);
-
-        if (res == CURLE_OK) {
-            json_error_t error;
-            json_t *root = json_loads(chunk.memory, 0, &error);
-            json_t *data = json_object_get(root, "data");
-
-            if (data && json_is_array(data)) {
-                size_t total = json_array_size(data);
-                size_t chunk_size = 100;
-                size_t chunk_index = 0;
-
-                for (size_t i = 0; i < total; i += chunk_size) {
-                    char filename[64];
-                    snprintf(filename, sizeof(filename), "currency_text_files/huobi_currency_chunk_%zu.txt", chunk_index++);
-                    FILE *fp = fopen(filename, "w");
-                    if (!fp) {
-                        fprintf(stderr, "[ERROR] Could not open %s for writing\n", filename);
-                        continue;
-                    }
-
-                    fprintf(fp, "[");
-                    size_t written = 0;
-
-                    for (size_t j = i; j < i + chunk_size && j < total; j++) {
-                        json_t *item = json_array_get(data, j);
-                        const char *base = json_string_value(json_object_get(item, "base-currency"));
-                        const char *quote = json_string_value(json_object_get(item, "quote-currency"));
-                        if (base && quote) {
-                            if (written > 0)
-                                fprintf(fp, ", ");
-                            fprintf(fp, "\"%s%s\"", base, quote);
-                            written++;
-                        }
-                    }
-
-                    fprintf(fp, "]\n");
-                    fclose(fp);
-                    // printf("[INFO] Wrote %zu symbols to %s\n", written, filename);
-                }
-                printf("Huobi Product IDs saved to huobi_currency_ids_XX.txt\n");
-                json_decref(root);
-            } else {
-                fprintf(stderr, "[ERROR] Invalid or missing 'data' array\n");
-            }
-        } else {
-            fprintf(stderr, "[ERROR] curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-        }
+    struct curl_slist *headers;
+    struct MemoryStruct body;
+    char etag[256];                 // validators of the cached copy, then of the response
+    char last_modified[128];
+    CURLcode result;
+    long status;
+    double seconds;
+    json_t *root;                   // parsed list, NULL when neither network nor cache had one
+} Source;
+
+enum { SOURCE_COINBASE, SOURCE_HUOBI, SOURCE_KRAKEN, SOURCE_OKX, SOURCE_BINANCE, SOURCE_COUNT };
+
+static Source sources[SOURCE_COUNT] = {
+    { .name = "coinbase", .host = "https://api.exchange.coinbase.com", .path = "/products" },
+    { .name = "huobi", .host = "https://api.huobi.pro", .path = "/v1/common/symbols" },
+    { .name = "kraken", .host = "https://api.kraken.com", .path = "/0/public/AssetPairs" },
+    { .name = "okx", .host = "https://www.okx.com", .path = "/api/v5/public/instruments?instType=SPOT" },
+    { .name = "binance", .host = "https://api.binance.us", .path = "/api/v3/exchangeInfo" },
+};
+
+static int files_written = 0;
+static int files_unchanged = 0;
+
+static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    struct MemoryStruct *mem = (struct MemoryStruct *)userp;
+
+    char *ptr = realloc(mem->memory, mem->size + realsize + 1);
+    if (!ptr) {
+        fprintf(stderr, "Not enough memory\n");
+        return 0;
+    }
+
+    mem->memory = ptr;
+    memcpy(&(mem->memory[mem->size]), contents, realsize);
+    mem->size += realsize;
+    mem->memory[mem->size] = '\0';
+
+    return realsize;
+}
+
+/* Copies a response header value, without the trailing CRLF, when its name matches */
+static void copy_header(const char *line, size_t len, const char *name, char *out, size_t out_size) {
+    size_t name_len = strlen(name);
+    if (len <= name_len || strncasecmp(line, name, name_len) != 0) return;
 
-        curl_easy_cleanup(curl);
-        free(chunk.memory);
+    const char *value = line + name_len;
+    size_t value_len = len - name_len;
+    while (value_len && (*value == ' ' || *value == '\t')) { value++; value_len--; }
+    while (value_len && (value[value_len - 1] == '\r' || value[value_len - 1] == '\n')) value_len--;
+    if (value_len >= out_size) return;
+
+    memcpy(out, value, value_len);
+    out[value_len] = '\0';
+}
+
+static size_t HeaderCallback(char *buffer, size_t size, size_t nitems, void *userp) {
+    Source *source = (Source *)userp;
+    size_t len = size * nitems;
+
+    /* A new status line (redirects) starts a new header block */
+    if (len > 5 && strncmp(buffer, "HTTP/", 5) == 0) {
+        source->etag[0] = '\0';
+        source->last_modified[0] = '\0';
     }
+    copy_header(buffer, len, "ETag:", source->etag, sizeof(source->etag));
+    copy_header(buffer, len, "Last-Modified:", source->last_modified, sizeof(source->last_modified));
+    return len;
 }
 
-void fetch_huobi_product_ids_full() {
-    CURL *curl;
-    CURLcode res;
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-
-    curl = curl_easy_init();
-    if (curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, "https://api.huobi.pro/v1/common/symbols");
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-        res = curl_easy_perform(curl);
-
-        if (res == CURLE_OK) {
-            json_error_t error;
-            json_t *root = json_loads(chunk.memory, 0, &error);
-            json_t *data = json_object_get(root, "data");
-
-            if (data && json_is_array(data)) {
-                FILE *fp = fopen("currency_text_files/huobi_currency_ids.txt", "w");
-                if (!fp) {
-                    fprintf(stderr, "Failed to open output file\n");
-                    json_decref(root);
-                    return;
-                }
-
-                fprintf(fp, "[");
-                for (size_t i = 0; i < json_array_size(data); i++) {
-                    json_t *item = json_array_get(data, i);
-                    const char *base = json_string_value(json_object_get(item, "base-currency"));
-                    const char *quote = json_string_value(json_object_get(item, "quote-currency"));
-                    if (base && quote) {
-                        fprintf(fp, "\"%s%s\"", base, quote);
-                        if (i < json_array_size(data) - 1) {
-                            fprintf(fp, ", ");
-                        }
-                    }
-                }
-                fprintf(fp, "]\n");
-                fclose(fp);
-
-                printf("Huobi Product IDs saved to huobi_currency_ids.txt\n");
-                json_decref(root);
-            } else {
-                fprintf(stderr, "Invalid or missing 'data' array\n");
-            }
-        } else {
-            fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-        }
+/* ------------------------------- Response cache ------------------------------- */
+
+static void cache_path(char *out, size_t size, const Source *source, const char *ext) {
+    snprintf(out, size, "%s/%s.%s", CACHE_DIR, source->name, ext);
+}
 
-        curl_easy_cleanup(curl);
-        free(chunk.memory);
+static char *read_file(const char *path, size_t *len) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return NULL;
+
+    fseek(fp, 0, SEEK_END);
+    long fsize = ftell(fp);
+    rewind(fp);
+    char *data = (fsize >= 0) ? malloc((size_t)fsize + 1) : NULL;
+    if (!data) {
+        fclose(fp);
+        return NULL;
     }
+    size_t n = fread(data, 1, (size_t)fsize, fp);
+    fclose(fp);
+    data[n] = '\0';
+    *len = n;
+    return data;
 }
 
-void fetch_kraken_product_ids() {
-    CURL *curl;
-    CURLcode res;
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-
-    curl = curl_easy_init();
-    if (curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, "https://api.kraken.com/0/public/AssetPairs");
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-        res = curl_easy_perform(curl);
-
-        if (res == CURLE_OK) {
-            json_error_t error;
-            json_t *root = json_loads(chunk.memory, 0, &error);
-            json_t *result = json_object_get(root, "result");
-
-            if (result && json_is_object(result)) {
-                FILE *fp = fopen("currency_text_files/kraken_currency_ids.txt", "w");
-                if (!fp) {
-                    fprintf(stderr, "Failed to open output file\n");
-                    json_decref(root);
-                    return;
-                }
-
-                fprintf(fp, "[");
-
-                const char *key;
-                json_t *value;
-                int first = 1;
-
-                json_object_foreach(result, key, value) {
-                    const char *base = json_string_value(json_object_get(value, "base"));
-                    const char *quote = json_string_value(json_object_get(value, "quote"));
-
-                    if (base && quote) {
-                        if (!first) {
-                            fprintf(fp, ",");
-                        }
-                        fprintf(fp, "\"%s/%s\"", base, quote);
-                        first = 0;
-                    }
-                }
-
-                fprintf(fp, "]\n");
-                fclose(fp);
-
-                printf("Kraken Product IDs saved to kraken_currency_ids.txt\n");
-                json_decref(root);
-            } else {
-                fprintf(stderr, "Invalid or missing 'result' object\n");
-            }
-        } else {
-            fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-        }
+/* Writes through a temporary file so a reader never sees a partial list */
+static int replace_file(const char *path, const char *data, size_t len) {
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        fprintf(stderr, "[ERROR] Could not open %s for writing\n", tmp);
+        return -1;
+    }
+    size_t written = fwrite(data, 1, len, fp);
+    if (fclose(fp) != 0 || written != len || rename(tmp, path) != 0) {
+        fprintf(stderr, "[ERROR] Could not write %s\n", path);
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
 
-        curl_easy_cleanup(curl);
-        free(chunk.memory);
+/* Loads the validators of the cached copy; a missing or older-version cache leaves them empty */
+static void cache_load_meta(Source *source) {
+    char path[256], line[512];
+    cache_path(path, sizeof(path), source, "meta");
+    FILE *fp = fopen(path, "r");
+    if (!fp) return;
+
+    int version = 0;
+    if (!fgets(line, sizeof(line), fp) || sscanf(line, "fetch_cache %d", &version) != 1 ||
+        version != FETCH_CACHE_VERSION) {
+        fclose(fp);
+        return;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (strncmp(line, "etag ", 5) == 0)
+            snprintf(source->etag, sizeof(source->etag), "%s", line + 5);
+        else if (strncmp(line, "last_modified ", 14) == 0)
+            snprintf(source->last_modified, sizeof(source->last_modified), "%s", line + 14);
     }
+    fclose(fp);
 }
 
+static void cache_store(const Source *source) {
+    char path[256], meta[512];
+    cache_path(path, sizeof(path), source, "body");
+    if (replace_file(path, source->body.memory, source->body.size) != 0) return;
 
- void fetch_okx_product_ids_full() {
-    CURL *curl;
-    CURLcode res;
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-
-    curl = curl_easy_init();
-    if (curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, "https://www.okx.com/api/v5/public/instruments?instType=SPOT");
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-        res = curl_easy_perform(curl);
-
-        if (res == CURLE_OK) {
-            json_error_t error;
-            json_t *root = json_loads(chunk.memory, 0, &error);
-            json_t *data = json_object_get(root, "data");
-
-            if (data && json_is_array(data)) {
-                FILE *fp = fopen("currency_text_files/okx_currency_ids.txt", "w");
-                if (!fp) {
-                    fprintf(stderr, "Failed to open output file\n");
-                    json_decref(root);
-                    return;
-                }
-
-                fprintf(fp, "[");
-                for (size_t i = 0; i < json_array_size(data); i++) {
-                    json_t *item = json_array_get(data, i);
-                    const char *instId = json_string_value(json_object_get(item, "instId"));
-                    if (instId) {
-                        fprintf(fp, "{\"channel\": \"tickers\", \"instId\": \"%s\"}", instId);
-                        if (i < json_array_size(data) - 1) {
-                            fprintf(fp, ", ");
-                        }
-                    }
-                }
-                fprintf(fp, "]\n");
-                fclose(fp);
-
-                printf("OKX Product IDs saved to okx_currency_ids_trades.txt\n");
-                json_decref(root);
-            } else {
-                fprintf(stderr, "Invalid or missing 'data' array\n");
-            }
-        } else {
-            fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-        }
+    int len = snprintf(meta, sizeof(meta), "fetch_cache %d\netag %s\nlast_modified %s\n",
+                       FETCH_CACHE_VERSION, source->etag, source->last_modified);
+    cache_path(path, sizeof(path), source, "meta");
+    replace_file(path, meta, (size_t)len);
+}
+
+static json_t *cache_load_body(const Source *source) {
+    char path[256];
+    size_t len;
+    cache_path(path, sizeof(path), source, "body");
+    char *data = read_file(path, &len);
+    if (!data) return NULL;
+
+    json_error_t error;
+    json_t *root = json_loadb(data, len, 0, &error);
+    free(data);
+    return root;
+}
+
+/* ---------------------------------- Fetching ---------------------------------- */
 
-        curl_easy_cleanup(curl);
-        free(chunk.memory);
+static int start_request(CURLM *multi, Source *source, const char *endpoint) {
+    char url[512];
+    if (endpoint)
+        snprintf(url, sizeof(url), "http://%s%s", endpoint, source->path);
+    else
+        snprintf(url, sizeof(url), "%s%s", source->host, source->path);
+
+    source->curl = curl_easy_init();
+    if (!source->curl) return -1;
+
+    /* Conditional request against the cached copy */
+    cache_load_meta(source);
+    char header[512];
+    if (source->etag[0]) {
+        snprintf(header, sizeof(header), "If-None-Match: %s", source->etag);
+        source->headers = curl_slist_append(source->headers, header);
+    }
+    if (source->last_modified[0]) {
+        snprintf(header, sizeof(header), "If-Modified-Since: %s", source->last_modified);
+        source->headers = curl_slist_append(source->headers, header);
     }
+
+    curl_easy_setopt(source->curl, CURLOPT_URL, url);
+    curl_easy_setopt(source->curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
+    curl_easy_setopt(source->curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
+    curl_easy_setopt(source->curl, CURLOPT_WRITEDATA, (void *)&source->body);
+    curl_easy_setopt(source->curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+    curl_easy_setopt(source->curl, CURLOPT_HEADERDATA, (void *)source);
+    curl_easy_setopt(source->curl, CURLOPT_HTTPHEADER, source->headers);
+    curl_easy_setopt(source->curl, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(source->curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(source->curl, CURLOPT_TIMEOUT, (long)FETCH_TIMEOUT);
+    curl_easy_setopt(source->curl, CURLOPT_PRIVATE, (void *)source);
+
+    if (curl_multi_add_handle(multi, source->curl) != CURLM_OK) {
+        curl_easy_cleanup(source->curl);
+        source->curl = NULL;
+        return -1;
+    }
+    return 0;
 }
 
-void fetch_okx_product_ids() {
-    CURL *curl;
-    CURLcode res;
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-
-    curl = curl_easy_init();
-    if (curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, "https://www.okx.com/api/v5/public/instruments?instType=SPOT");
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-        res = curl_easy_perform(curl);
-
-        if (res == CURLE_OK) {
-            json_error_t error;
-            json_t *root = json_loads(chunk.memory, 0, &error);
-            json_t *data = json_object_get(root, "data");
-
-            if (data && json_is_array(data)) {
-                size_t total = json_array_size(data);
-                size_t chunk_size = 100;
-                size_t chunk_index = 0;
-
-                for (size_t i = 0; i < total; i += chunk_size) {
-                    char filename[64];
-                    snprintf(filename, sizeof(filename), "currency_text_files/okx_currency_chunk_%zu.txt", chunk_index++);
-                    FILE *fp = fopen(filename, "w");
-                    if (!fp) {
-                        fprintf(stderr, "[ERROR] Could not open %s for writing\n", filename);
-                        continue;
-                    }
-
-                    fprintf(fp, "[");
-                    size_t written = 0;
-
-                    for (size_t j = i; j < i + chunk_size && j < total; j++) {
-                        json_t *item = json_array_get(data, j);
-                        const char *instId = json_string_value(json_object_get(item, "instId"));
-                        if (instId) {
-                            if (written > 0)
-                                fprintf(fp, ", ");
-                            fprintf(fp, "{\"channel\": \"tickers\", \"instId\": \"%s\"}", instId);
-                            written++;
-                        }
-                    }
-
-                    fprintf(fp, "]\n");
-                    fclose(fp);
-                    // printf("[INFO] Wrote %zu instruments to %s\n", written, filename);
-                }
-
-                printf("OKX Product IDs saved to okx_currency_chunk_XX.txt\n");
-                json_decref(root);
-            } else {
-                fprintf(stderr, "[ERROR] Invalid or missing 'data' array\n");
-            }
-        } else {
-            fprintf(stderr, "[ERROR] curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+/* Turns a finished transfer into `root`: fresh (and cached), cached (304), or cached as a fallback */
+static void finish_request(Source *source) {
+    if (source->result == CURLE_OK && source->status == 200) {
+        json_error_t error;
+        source->root = json_loadb(source->body.memory ? source->body.memory : "", source->body.size, 0, &error);
+        if (source->root) {
+            cache_store(source);
+            printf("[INFO] %s: fetched %zu bytes in %.0f ms\n", source->name, source->body.size, source->seconds * 1000.0);
+            return;
         }
-
-        curl_easy_cleanup(curl);
-        free(chunk.memory);
+        fprintf(stderr, "[ERROR] %s: JSON parse error: %s\n", source->name, error.text);
+    } else if (source->result == CURLE_OK && source->status == 304) {
+        source->root = cache_load_body(source);
+        if (source->root) {
+            printf("[INFO] %s: not modified (%.0f ms), using cached list\n", source->name, source->seconds * 1000.0);
+            return;
+        }
+        fprintf(stderr, "[ERROR] %s: not modified but the cached list is missing\n", source->name);
+    } else if (source->result != CURLE_OK) {
+        fprintf(stderr, "[ERROR] %s: request failed: %s\n", source->name, curl_easy_strerror(source->result));
+    } else {
+        fprintf(stderr, "[ERROR] %s: HTTP %ld\n", source->name, source->status);
     }
+
+    source->root = cache_load_body(source);
+    if (source->root)
+        printf("[WARNING] %s: using the cached list from an earlier run\n", source->name);
+    else
+        fprintf(stderr, "[ERROR] %s: no list available; its files are left as they are\n", source->name);
 }
 
-void fetch_okx_product_ids_trades_full() {
-    CURL *curl;
-    CURLcode res;
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-
-    curl = curl_easy_init();
-    if (curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, "https://www.okx.com/api/v5/public/instruments?instType=SPOT");
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-        res = curl_easy_perform(curl);
-
-        if (res == CURLE_OK) {
-            json_error_t error;
-            json_t *root = json_loads(chunk.memory, 0, &error);
-            json_t *data = json_object_get(root, "data");
-
-            if (data && json_is_array(data)) {
-                FILE *fp = fopen("currency_text_files/okx_currency_ids_trades.txt", "w");
-                if (!fp) {
-                    fprintf(stderr, "Failed to open output file\n");
-                    json_decref(root);
-                    return;
-                }
-
-                fprintf(fp, "[");
-                for (size_t i = 0; i < json_array_size(data); i++) {
-                    json_t *item = json_array_get(data, i);
-                    const char *instId = json_string_value(json_object_get(item, "instId"));
-                    if (instId) {
-                        fprintf(fp, "{\"channel\": \"trades\", \"instId\": \"%s\"}", instId);
-                        if (i < json_array_size(data) - 1) {
-                            fprintf(fp, ", ");
-                        }
-                    }
-                }
-                fprintf(fp, "]\n");
-                fclose(fp);
-
-                printf("OKX Product IDs saved to okx_currency_ids.txt\n");
-                json_decref(root);
-            } else {
-                fprintf(stderr, "Invalid or missing 'data' array\n");
-            }
-        } else {
-            fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+static void fetch_all(const char *endpoint) {
+    CURLM *multi = curl_multi_init();
+    if (!multi) {
+        fprintf(stderr, "[ERROR] curl_multi_init() failed\n");
+        return;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int i = 0; i < SOURCE_COUNT; i++) {
+        if (start_request(multi, &sources[i], endpoint) != 0) {
+            sources[i].result = CURLE_FAILED_INIT;
+            finish_request(&sources[i]);
         }
+    }
+
+    int running = 0;
+    do {
+        CURLMcode mc = curl_multi_perform(multi, &running);
+        if (mc == CURLM_OK && running) mc = curl_multi_poll(multi, NULL, 0, 1000, NULL);
+        if (mc != CURLM_OK) {
+            fprintf(stderr, "[ERROR] curl multi: %s\n", curl_multi_strerror(mc));
+            break;
+        }
+    } while (running);
+
+    CURLMsg *msg;
+    int left;
+    while ((msg = curl_multi_info_read(multi, &left))) {
+        if (msg->msg != CURLMSG_DONE) continue;
+        Source *source = NULL;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&source);
+        source->result = msg->data.result;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &source->status);
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_TOTAL_TIME, &source->seconds);
+        finish_request(source);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("[INFO] Fetched %d exchange lists in %.0f ms\n", SOURCE_COUNT,
+           (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6);
 
-        curl_easy_cleanup(curl);
-        free(chunk.memory);
+    for (int i = 0; i < SOURCE_COUNT; i++) {
+        if (!sources[i].curl) continue;
+        curl_multi_remove_handle(multi, sources[i].curl);
+        curl_easy_cleanup(sources[i].curl);
+        curl_slist_free_all(sources[i].headers);
+        free(sources[i].body.memory);
     }
+    curl_multi_cleanup(multi);
 }
 
-void fetch_okx_product_ids_trades() {
-    CURL *curl;
-    CURLcode res;
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-
-    curl = curl_easy_init();
-    if (curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, "https://www.okx.com/api/v5/public/instruments?instType=SPOT");
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-        res = curl_easy_perform(curl);
-
-        if (res == CURLE_OK) {
-            json_error_t error;
-            json_t *root = json_loads(chunk.memory, 0, &error);
-            json_t *data = json_object_get(root, "data");
-
-            if (data && json_is_array(data)) {
-                size_t total = json_array_size(data);
-                size_t chunk_size = 100;
-                size_t chunk_index = 0;
-
-                for (size_t i = 0; i < total; i += chunk_size) {
-                    char filename[64];
-                    snprintf(filename, sizeof(filename), "currency_text_files/okx_currency_chunk_trades_%zu.txt", chunk_index++);
-                    FILE *fp = fopen(filename, "w");
-                    if (!fp) {
-                        fprintf(stderr, "[ERROR] Could not open %s for writing\n", filename);
-                        continue;
-                    }
-
-                    fprintf(fp, "[");
-                    size_t written = 0;
-
-                    for (size_t j = i; j < i + chunk_size && j < total; j++) {
-                        json_t *item = json_array_get(data, j);
-                        const char *instId = json_string_value(json_object_get(item, "instId"));
-                        if (instId) {
-                            if (written > 0)
-                                fprintf(fp, ", ");
-                            fprintf(fp, "{\"channel\": \"trades\", \"instId\": \"%s\"}", instId);
-                            written++;
-                        }
-                    }
-
-                    fprintf(fp, "]\n");
-                    fclose(fp);
-                    // printf("[INFO] Wrote %zu trade instruments to %s\n", written, filename);
-                }
-
-                printf("OKX Trade Product IDs saved to okx_currency_chunk_trades_XX.txt\n");
-                json_decref(root);
-            } else {
-                fprintf(stderr, "[ERROR] Invalid or missing 'data' array\n");
-            }
-        } else {
-            fprintf(stderr, "[ERROR] curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-        }
+/* ---------------------------------- Output ---------------------------------- */
+
+static void append(struct MemoryStruct *out, const char *text) {
+    WriteMemoryCallback((void *)text, 1, strlen(text), out);
+}
 
-        curl_easy_cleanup(curl);
-        free(chunk.memory);
+/* Rewrites a list only when its contents changed, so unchanged files keep their mtime */
+static void write_if_changed(const char *path, const struct MemoryStruct *out) {
+    size_t len;
+    char *current = read_file(path, &len);
+    int same = current && len == out->size && memcmp(current, out->memory, len) == 0;
+    free(current);
+
+    if (same) {
+        files_unchanged++;
+        return;
+    }
+    if (replace_file(path, out->memory ? out->memory : "", out->size) == 0) {
+        files_written++;
+        printf("[INFO] Updated %s\n", path);
     }
-}    
+}
 
+/* Formatted entries of one list, in API order */
+typedef struct {
+    char **items;
+    size_t count;
+    size_t capacity;
+} EntryList;
+
+static void entry_add(EntryList *list, const char *fmt, const char *a, const char *b) {
+    char entry[256];
+    snprintf(entry, sizeof(entry), fmt, a, b);
+    if (list->count == list->capacity) {
+        size_t grown = list->capacity ? list->capacity * 2 : 256;
+        char **items = realloc(list->items, grown * sizeof(char *));
+        if (!items) return;
+        list->items = items;
+        list->capacity = grown;
+    }
+    list->items[list->count] = strdup(entry);
+    if (list->items[list->count]) list->count++;
+}
 
-void fetch_binance_product_ids_trades_full() {
-    CURL *curl;
-    CURLcode res;
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-
-    curl = curl_easy_init();
-    if (curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, "https://api.binance.us/api/v3/exchangeInfo");
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-        res = curl_easy_perform(curl);
-
-        if (res == CURLE_OK) {
-            json_error_t error;
-            json_t *root = json_loads(chunk.memory, 0, &error);        
-            json_t *symbols = json_object_get(root, "symbols");
-
-            if (symbols && json_is_array(symbols)) {
-                FILE *fp = fopen("currency_text_files/binance_currency_ids_trades.txt", "w");
-                if (!fp) {
-                    fprintf(stderr, "Failed to open output file\n");
-                    json_decref(root);
-                    return;
-                }
-
-                fprintf(fp, "[");
-                for (size_t i = 0; i < json_array_size(symbols); i++) {
-                    json_t *entry = json_array_get(symbols, i);
-                    const char *symbol = json_string_value(json_object_get(entry, "symbol"));
-                    if (symbol) {
-                        char lower_symbol[64];
-                        strncpy(lower_symbol, symbol, sizeof(lower_symbol) - 1);
-                        lower_symbol[sizeof(lower_symbol) - 1] = '\0';
-                        for (char *p = lower_symbol; *p; ++p) *p = tolower(*p);
-
-                        fprintf(fp, "\"%s\"", lower_symbol);
-                        if (i < json_array_size(symbols) - 1)
-                            fprintf(fp, ", ");
-                    }
-                }
-                fprintf(fp, "]\n");
-                fclose(fp);
-
-                printf("Binance trade stream symbols saved to binance_currency_ids_trades.txt\n");
-                json_decref(root);
-            } else {
-                fprintf(stderr, "JSON parse error or missing 'symbols' array\n");
-            }
-        } else {
-            fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+static void entry_free(EntryList *list) {
+    for (size_t i = 0; i < list->count; i++) free(list->items[i]);
+    free(list->items);
+    memset(list, 0, sizeof(*list));
+}
+
+/* `[a<sep>b<sep>c]\n` for entries [from, to) */
+static void write_array(const char *path, const EntryList *list, size_t from, size_t to, const char *sep) {
+    struct MemoryStruct out = {0};
+    append(&out, "[");
+    for (size_t i = from; i < to; i++) {
+        if (i > from) append(&out, sep);
+        append(&out, list->items[i]);
+    }
+    append(&out, "]\n");
+    write_if_changed(path, &out);
+    free(out.memory);
+}
+
+/* CHUNK_SIZE entries per `<stem>_<n>.txt`; bracketed arrays, or one entry per line when `sep` is NULL.
+ * Chunk files beyond the new count are removed. */
+static void write_chunks(const char *stem, const EntryList *list, const char *sep) {
+    char path[256];
+    size_t chunk_index = 0;
+    for (size_t i = 0; i < list->count; i += CHUNK_SIZE, chunk_index++) {
+        size_t end = (i + CHUNK_SIZE < list->count) ? i + CHUNK_SIZE : list->count;
+        snprintf(path, sizeof(path), "%s/%s_%zu.txt", OUTPUT_DIR, stem, chunk_index);
+        if (sep) {
+            write_array(path, list, i, end, sep);
+            continue;
         }
 
-        curl_easy_cleanup(curl);
-        free(chunk.memory);
+        struct MemoryStruct out = {0};
+        for (size_t j = i; j < end; j++) {
+            append(&out, list->items[j]);
+            append(&out, "\n");
+        }
+        write_if_changed(path, &out);
+        free(out.memory);
+    }
+
+    for (;; chunk_index++) {
+        snprintf(path, sizeof(path), "%s/%s_%zu.txt", OUTPUT_DIR, stem, chunk_index);
+        if (unlink(path) != 0) break;
+        printf("[INFO] Removed stale %s\n", path);
     }
 }
 
-void fetch_binance_product_ids_trades() {
-    CURL *curl;
-    CURLcode res;
-
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-
-    curl = curl_easy_init();
-    if (curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, "https://api.binance.us/api/v3/exchangeInfo");
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-        res = curl_easy_perform(curl);
-
-        if (res == CURLE_OK) {
-            json_error_t error;
-            json_t *root = json_loads(chunk.memory, 0, &error);
-            json_t *symbols = json_object_get(root, "symbols");
-
-            if (symbols && json_is_array(symbols)) {
-                size_t total = json_array_size(symbols);
-                size_t chunk_size = 100;
-                size_t chunk_index = 0;
-
-                for (size_t i = 0; i < total; i += chunk_size) {
-                    char filename[64];
-                    snprintf(filename, sizeof(filename), "currency_text_files/binance_currency_chunk_trades_%zu.txt", chunk_index++);
-                    FILE *fp = fopen(filename, "w");
-                    if (!fp) {
-                        fprintf(stderr, "[ERROR] Could not open %s for writing\n", filename);
-                        continue;
-                    }
-
-                    size_t written = 0;
-                    for (size_t j = i; j < i + chunk_size && j < total; j++) {
-                        json_t *entry = json_array_get(symbols, j);
-                        const char *symbol = json_string_value(json_object_get(entry, "symbol"));
-                        if (symbol) {
-                            char lower_symbol[64];
-                            strncpy(lower_symbol, symbol, sizeof(lower_symbol) - 1);
-                            lower_symbol[sizeof(lower_symbol) - 1] = '\0';
-                            for (char *p = lower_symbol; *p; ++p) *p = tolower(*p);
-                        
-                            fprintf(fp, "%s\n", lower_symbol);
-                            written++;
-                        }                        
-                    }
-
-                    fclose(fp);
-                    // printf("[INFO] Wrote %zu symbols to %s\n", written, filename);
-                }
-
-                printf("Binance trade stream symbols saved to binance_currency_chunk_trades_XX.txt\n");
-                json_decref(root);
-            } else {
-                fprintf(stderr, "JSON parse error or missing 'symbols' array\n");
-            }
+static void write_coinbase_product_ids(json_t *root) {
+    if (!json_is_array(root)) {
+        fprintf(stderr, "[ERROR] Coinbase: expected a JSON array\n");
+        return;
+    }
+
+    EntryList ids = {0};
+    for (size_t i = 0; i < json_array_size(root); i++) {
+        const char *id = json_string_value(json_object_get(json_array_get(root, i), "id"));
+        if (id) entry_add(&ids, "\"%s\"", id, NULL);
+    }
+    write_array(OUTPUT_DIR "/coinbase_currency_ids.txt", &ids, 0, ids.count, ", ");
+    entry_free(&ids);
+}
+
+static void write_huobi_product_ids(json_t *root) {
+    json_t *data = json_object_get(root, "data");
+    if (!json_is_array(data)) {
+        fprintf(stderr, "[ERROR] Huobi: invalid or missing 'data' array\n");
+        return;
+    }
+
+    EntryList ids = {0};
+    for (size_t i = 0; i < json_array_size(data); i++) {
+        json_t *item = json_array_get(data, i);
+        const char *base = json_string_value(json_object_get(item, "base-currency"));
+        const char *quote = json_string_value(json_object_get(item, "quote-currency"));
+        if (base && quote) entry_add(&ids, "\"%s%s\"", base, quote);
+    }
+    write_chunks("huobi_currency_chunk", &ids, ", ");
+    write_array(OUTPUT_DIR "/huobi_currency_ids.txt", &ids, 0, ids.count, ", ");
+    entry_free(&ids);
+}
+
+static void write_kraken_product_ids(json_t *root) {
+    json_t *result = json_object_get(root, "result");
+    if (!json_is_object(result)) {
+        fprintf(stderr, "[ERROR] Kraken: invalid or missing 'result' object\n");
+        return;
+    }
+
+    EntryList pairs = {0};
+    const char *key;
+    json_t *value;
+    json_object_foreach(result, key, value) {
+        const char *base = json_string_value(json_object_get(value, "base"));
+        const char *quote = json_string_value(json_object_get(value, "quote"));
+        if (base && quote) entry_add(&pairs, "\"%s/%s\"", base, quote);
+    }
+    write_array(OUTPUT_DIR "/kraken_currency_ids.txt", &pairs, 0, pairs.count, ",");
+    entry_free(&pairs);
+}
+
+static void write_okx_product_ids(json_t *root) {
+    json_t *data = json_object_get(root, "data");
+    if (!json_is_array(data)) {
+        fprintf(stderr, "[ERROR] OKX: invalid or missing 'data' array\n");
+        return;
+    }
+
+    EntryList tickers = {0}, trades = {0};
+    for (size_t i = 0; i < json_array_size(data); i++) {
+        const char *instId = json_string_value(json_object_get(json_array_get(data, i), "instId"));
+        if (!instId) continue;
+        entry_add(&tickers, "{\"channel\": \"%s\", \"instId\": \"%s\"}", "tickers", instId);
+        entry_add(&trades, "{\"channel\": \"%s\", \"instId\": \"%s\"}", "trades", instId);
+    }
+    write_chunks("okx_currency_chunk", &tickers, ", ");
+    write_chunks("okx_currency_chunk_trades", &trades, ", ");
+    write_array(OUTPUT_DIR "/okx_currency_ids.txt", &tickers, 0, tickers.count, ", ");
+    write_array(OUTPUT_DIR "/okx_currency_ids_trades.txt", &trades, 0, trades.count, ", ");
+    entry_free(&tickers);
+    entry_free(&trades);
+}
+
+static void write_binance_product_ids(json_t *root) {
+    json_t *symbols = json_object_get(root, "symbols");
+    if (!json_is_array(symbols)) {
+        fprintf(stderr, "[ERROR] Binance: missing 'symbols' array\n");
+        return;
+    }
+
+    EntryList quoted = {0}, plain = {0};
+    for (size_t i = 0; i < json_array_size(symbols); i++) {
+        const char *symbol = json_string_value(json_object_get(json_array_get(symbols, i), "symbol"));
+        if (!symbol) continue;
+
+        char lower_symbol[64];
+        strncpy(lower_symbol, symbol, sizeof(lower_symbol) - 1);
+        lower_symbol[sizeof(lower_symbol) - 1] = '\0';
+        for (char *p = lower_symbol; *p; ++p) *p = tolower((unsigned char)*p);
+
+        entry_add(&quoted, "\"%s\"", lower_symbol, NULL);
+        entry_add(&plain, "%s", lower_symbol, NULL);
+    }
+    write_chunks("binance_currency_chunk_trades", &plain, NULL);
+    write_array(OUTPUT_DIR "/binance_currency_ids_trades.txt", &quoted, 0, quoted.count, ", ");
+    entry_free(&quoted);
+    entry_free(&plain);
+}
+
+int main(int argc, char **argv) {
+    const char *endpoint = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--endpoint") == 0 && i + 1 < argc) {
+            endpoint = argv[++i];
         } else {
-            fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+            printf("[ERROR] Usage: %s [--endpoint HOST:PORT]\n", argv[0]);
+            return 1;
         }
+    }
 
-        curl_easy_cleanup(curl);
-        free(chunk.memory);
+    mkdir(OUTPUT_DIR, 0755);
+    mkdir(CACHE_DIR, 0755);
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    fetch_all(endpoint);
+    curl_global_cleanup();
+
+    void (*writers[SOURCE_COUNT])(json_t *) = {
+        [SOURCE_COINBASE] = write_coinbase_product_ids,
+        [SOURCE_HUOBI] = write_huobi_product_ids,
+        [SOURCE_KRAKEN] = write_kraken_product_ids,
+        [SOURCE_OKX] = write_okx_product_ids,
+        [SOURCE_BINANCE] = write_binance_product_ids,
+    };
+    for (int i = 0; i < SOURCE_COUNT; i++) {
+        if (!sources[i].root) continue;
+        writers[i](sources[i].root);
+        json_decref(sources[i].root);
     }
-}
 
- 
- int main() {
-     fetch_coinbase_product_ids();
-     fetch_huobi_product_ids();
-     fetch_okx_product_ids();
-     fetch_okx_product_ids_trades();
-     fetch_kraken_product_ids();
-     fetch_binance_product_ids_trades();
-
-     fetch_huobi_product_ids_full();
-     fetch_okx_product_ids_full();
-     fetch_okx_product_ids_trades_full();
-     fetch_binance_product_ids_trades_full();
-     return 0;
- }
- 
\ No newline at end of file
+    printf("[INFO] Product lists: %d file(s) updated, %d unchanged\n", files_written, files_unchanged);
+    return 0;
+}
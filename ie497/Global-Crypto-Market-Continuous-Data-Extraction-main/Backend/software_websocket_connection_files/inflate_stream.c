@@ -0,0 +1,126 @@
+/*
+ * Inflate Stream
+ *
+ * This module decompresses gzip WebSocket frames (Huobi) with one long-lived
+ * zlib stream per connection. inflateInit2() runs once; each frame only pays
+ * for inflateReset2(). Output goes to a buffer owned by the stream that
+ * doubles when a frame does not fit, so large snapshots are no longer cut off.
+ *
+ * Features:
+ *  - Lazy setup on the first frame of a connection.
+ *  - Growable output buffer up to INFLATE_MAX_OUTPUT, kept between frames.
+ *  - Lock-free counters for compression ratio, oversize and failed frames.
+ *
+ * Dependencies:
+ *  - zlib (`-lz`).
+ *  - Standard C libraries (stdio, stdlib, string, stdatomic).
+ *
+ * Usage:
+ *  - `exchange_websocket.c` calls inflate_frame() per Huobi frame and
+ *    inflate_stream_release() when the connection goes away.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "inflate_stream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+/* gzip wrapper, default window */
+#define INFLATE_WINDOW_BITS (16 + MAX_WBITS)
+
+static atomic_uint_fast64_t stat_frames = 0;
+static atomic_uint_fast64_t stat_bytes_in = 0;
+static atomic_uint_fast64_t stat_bytes_out = 0;
+static atomic_uint_fast64_t stat_oversize = 0;
+static atomic_uint_fast64_t stat_failed = 0;
+static atomic_uint_fast64_t stat_largest = 0;
+
+/* Doubles the output buffer, keeping what has been inflated so far */
+static int grow_buffer(InflateStream *stream) {
+    size_t capacity = stream->capacity ? stream->capacity * 2 : INFLATE_INITIAL_CAPACITY;
+    if (capacity > INFLATE_MAX_OUTPUT + 1) return -1;
+
+    char *buffer = realloc(stream->buffer, capacity);
+    if (!buffer) {
+        printf("[ERROR] Memory allocation failed for inflate buffer\n");
+        return -1;
+    }
+    stream->buffer = buffer;
+    stream->capacity = capacity;
+    return 0;
+}
+
+static long inflate_failed(void) {
+    atomic_fetch_add_explicit(&stat_failed, 1, memory_order_relaxed);
+    return -1;
+}
+
+long inflate_frame(InflateStream *stream, const void *input, size_t input_len, const char **out) {
+    if (!stream->initialized) {
+        memset(&stream->zs, 0, sizeof(stream->zs));
+        if (inflateInit2(&stream->zs, INFLATE_WINDOW_BITS) != Z_OK) {
+            printf("[ERROR] Failed to initialize inflate stream\n");
+            return inflate_failed();
+        }
+        stream->initialized = 1;
+    } else if (inflateReset2(&stream->zs, INFLATE_WINDOW_BITS) != Z_OK) {
+        return inflate_failed();
+    }
+
+    if (!stream->buffer && grow_buffer(stream) != 0) return inflate_failed();
+
+    z_stream *zs = &stream->zs;
+    zs->next_in = (Bytef *)input;
+    zs->avail_in = (uInt)input_len;
+
+    size_t produced = 0;
+    int result;
+    while (1) {
+        /* Keep one byte for the terminating NUL */
+        zs->next_out = (Bytef *)stream->buffer + produced;
+        zs->avail_out = (uInt)(stream->capacity - 1 - produced);
+
+        result = inflate(zs, Z_FINISH);
+        produced = stream->capacity - 1 - zs->avail_out;
+
+        if (result == Z_STREAM_END) break;
+        if ((result != Z_BUF_ERROR && result != Z_OK) || zs->avail_out != 0) return inflate_failed();
+        if (grow_buffer(stream) != 0) return inflate_failed();
+    }
+    stream->buffer[produced] = '\0';
+
+    atomic_fetch_add_explicit(&stat_frames, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stat_bytes_in, input_len, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stat_bytes_out, produced, memory_order_relaxed);
+    if (produced >= INFLATE_INITIAL_CAPACITY)
+        atomic_fetch_add_explicit(&stat_oversize, 1, memory_order_relaxed);
+
+    uint64_t largest = atomic_load_explicit(&stat_largest, memory_order_relaxed);
+    while (produced > largest &&
+           !atomic_compare_exchange_weak_explicit(&stat_largest, &largest, produced,
+                                                  memory_order_relaxed, memory_order_relaxed))
+        ;
+
+    *out = stream->buffer;
+    return (long)produced;
+}
+
+void inflate_stream_release(InflateStream *stream) {
+    if (stream->initialized) inflateEnd(&stream->zs);
+    free(stream->buffer);
+    memset(stream, 0, sizeof(*stream));
+}
+
+void inflate_stats(InflateStats *stats) {
+    stats->frames = atomic_load_explicit(&stat_frames, memory_order_relaxed);
+    stats->bytes_in = atomic_load_explicit(&stat_bytes_in, memory_order_relaxed);
+    stats->bytes_out = atomic_load_explicit(&stat_bytes_out, memory_order_relaxed);
+    stats->oversize = atomic_load_explicit(&stat_oversize, memory_order_relaxed);
+    stats->failed = atomic_load_explicit(&stat_failed, memory_order_relaxed);
+    stats->largest = atomic_load_explicit(&stat_largest, memory_order_relaxed);
+}
@@ -0,0 +1,65 @@
+/*
+ * Inflate Stream Header
+ *
+ * Declares the per-connection gzip decompression context used for Huobi
+ * frames. The zlib state is set up once per connection and reset between
+ * frames, and output goes to a per-connection buffer that grows to fit the
+ * largest frame seen instead of a fixed stack array.
+ *
+ * Features:
+ *  - inflate_frame(): Decompresses one gzip frame into the stream's NUL-terminated buffer.
+ *  - inflate_stream_release(): Frees the zlib state and buffer when the connection closes.
+ *  - inflate_stats(): Frame count, compression ratio, oversize and failed frames (all connections).
+ *
+ * Dependencies:
+ *  - zlib: inflateInit2() / inflateReset2() / inflate().
+ *
+ * Usage:
+ *  - Embedded in `SessionData`; used by the Huobi branch of `exchange_websocket.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef INFLATE_STREAM_H
+#define INFLATE_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zlib.h>
+
+/* Output buffer size on first use; frames above it grow the buffer and count as oversize */
+#define INFLATE_INITIAL_CAPACITY 8192
+
+/* Largest decompressed frame accepted; bigger frames are dropped and counted as failed */
+#define INFLATE_MAX_OUTPUT (8 * 1024 * 1024)
+
+/* Decompression context for one connection; zero-initialized means "not set up yet" */
+typedef struct {
+    z_stream zs;
+    int initialized;
+    char *buffer;
+    size_t capacity;
+} InflateStream;
+
+/* Totals over every connection */
+typedef struct {
+    uint64_t frames;            // frames decompressed
+    uint64_t bytes_in;          // compressed bytes
+    uint64_t bytes_out;         // decompressed bytes
+    uint64_t oversize;          // frames larger than INFLATE_INITIAL_CAPACITY
+    uint64_t failed;            // corrupt frames or frames over INFLATE_MAX_OUTPUT
+    uint64_t largest;           // biggest decompressed frame
+} InflateStats;
+
+/* Decompresses one gzip frame. Returns its length with `*out` pointing at the stream's
+ * NUL-terminated buffer (valid until the next call), or -1 on error. */
+long inflate_frame(InflateStream *stream, const void *input, size_t input_len, const char **out);
+
+/* Frees the zlib state and buffer; the stream can be reused afterwards. */
+void inflate_stream_release(InflateStream *stream);
+
+/* Snapshot of the counters. */
+void inflate_stats(InflateStats *stats);
+
+#endif // INFLATE_STREAM_H
@@ -0,0 +1,409 @@
+/*
+ * Ingest Pipeline
+ *
+ * This module splits message handling across threads so a slow disk write no
+ * longer stalls every exchange socket. Each service thread runs lws_service()
+ * on its own context; the callback parses into a binary record and drops it
+ * into a ring owned by (service thread, writer thread). Writer threads drain
+ * their rings and do the JSON snapshot append and BSON write.
+ *
+ * Features:
+ *  - One lws context per service thread; connections assigned round-robin by index.
+ *  - Lock-free SPSC rings: the producer never blocks, a full ring drops and counts.
+ *  - Records of one exchange always go to the same writer, keeping their order.
+ *  - Drains every ring before shutdown so no accepted record is lost.
+ *  - Measures latency from frame arrival to the JSON/BSON write for every queued record.
+ *  - Writer threads also feed the columnar tick archive (`archive_writer.c`) when it is enabled.
+ *  - Tickers update the shared-memory best bid/offer (`quote_book.c`) on the service thread,
+ *    before they are queued, so readers see a quote without waiting for the disk writers.
+ *  - Writer threads fold trades into OHLCV/VWAP bars (`bar_engine.c`) when they are enabled.
+ *  - Feeds the latency histograms (`latency_stats.c`): event-to-arrival time of every record on
+ *    the service thread, arrival-to-write time per exchange on the writer threads.
+ *  - Writer threads drop trades whose ID was already written (`trade_dedup.c`); records of one
+ *    exchange stay on one writer, so its table needs no lock.
+ *
+ * Dependencies:
+ *  - libwebsockets, jansson (hash seed set before threads start).
+ *  - Standard C libraries (stdio, stdlib, string, pthread, stdatomic, time).
+ *
+ * Usage:
+ *  - main.c: ingest_init() -> connect -> ingest_start() -> housekeeping loop -> ingest_stop().
+ *  - exchange_websocket.c: ingest_submit_ticker() / ingest_submit_trade().
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "ingest.h"
+#include "exchange_websocket.h"
+#include "utils.h"
+#include "connection_table.h"
+#include "archive_writer.h"
+#include "quote_book.h"
+#include "bar_engine.h"
+#include "latency_stats.h"
+#include "trade_dedup.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <jansson.h>
+
+#define INGEST_CACHE_LINE 64
+
+/* Writer sleep when every ring is empty */
+#define INGEST_IDLE_NS 200000
+
+typedef enum {
+    INGEST_TICKER,
+    INGEST_TRADE
+} IngestKind;
+
+typedef struct {
+    uint8_t kind;               // IngestKind
+    int64_t recv_ns;            // CLOCK_MONOTONIC arrival of the frame that produced the record
+    union {
+        TickerData ticker;
+        TradeData trade;
+    } data;
+} IngestRecord;
+
+/* Single producer (service thread) / single consumer (writer thread) ring */
+typedef struct {
+    _Alignas(INGEST_CACHE_LINE) atomic_size_t tail;        // written by the producer
+    size_t cached_head;                                     // producer's last view of head
+    atomic_uint_fast64_t submitted;
+    atomic_uint_fast64_t dropped;
+    atomic_size_t max_depth;
+
+    _Alignas(INGEST_CACHE_LINE) atomic_size_t head;        // written by the consumer
+    atomic_uint_fast64_t written;
+    atomic_uint_fast64_t latency_total_ns;
+    atomic_uint_fast64_t latency_max_ns;
+
+    IngestRecord *slots;
+} IngestRing;
+
+static int service_count = 0;
+static int writer_count = 0;
+static struct lws_context *contexts[INGEST_MAX_SERVICE_THREADS];
+static pthread_t service_threads[INGEST_MAX_SERVICE_THREADS];
+static pthread_t writer_threads[INGEST_MAX_WRITER_THREADS];
+static IngestRing *rings = NULL;        // service_count * writer_count, row per service thread
+static int services_started = 0;
+static int writers_started = 0;
+
+static atomic_int services_stopping = 0;
+static atomic_int writers_stopping = 0;
+static atomic_int services_running = 0;
+
+/* Service thread index of the calling thread, -1 off the service threads */
+static __thread int current_shard = -1;
+
+/* Arrival time of the frame being handled on this service thread */
+static __thread int64_t current_frame_ns = 0;
+
+/* Arrival time of the record being written on this writer thread, 0 elsewhere */
+static __thread int64_t current_record_ns = 0;
+
+/* Records submitted from this thread, so a caller can tell whether a frame produced any */
+static __thread uint64_t thread_records = 0;
+
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Requested count, else the environment variable, else the default; clamped to [1, max] */
+static int thread_count(int requested, const char *env, int fallback, int max) {
+    if (requested <= 0) {
+        const char *value = getenv(env);
+        requested = value ? atoi(value) : 0;
+    }
+    if (requested <= 0) requested = fallback;
+    return (requested > max) ? max : requested;
+}
+
+static IngestRing *ring_for(int shard, uint16_t exchange_id) {
+    return &rings[shard * writer_count + exchange_id % writer_count];
+}
+
+/* Slot for the next record, or NULL if the ring is full */
+static IngestRecord *ring_reserve(IngestRing *ring) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (tail - ring->cached_head == INGEST_RING_CAPACITY) {
+        ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail - ring->cached_head == INGEST_RING_CAPACITY) {
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+            return NULL;
+        }
+    }
+    return &ring->slots[tail & (INGEST_RING_CAPACITY - 1)];
+}
+
+/* Publish the reserved slot to the consumer */
+static void ring_commit(IngestRing *ring) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed) + 1;
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    atomic_fetch_add_explicit(&ring->submitted, 1, memory_order_relaxed);
+
+    size_t depth = tail - ring->cached_head;   // upper bound; head only moves forward
+    if (depth > atomic_load_explicit(&ring->max_depth, memory_order_relaxed))
+        atomic_store_explicit(&ring->max_depth, depth, memory_order_relaxed);
+}
+
+static void write_record(const IngestRecord *record) {
+    if (record->kind == INGEST_TICKER) {
+        log_ticker_price(&record->data.ticker);
+        write_ticker_to_bson(&record->data.ticker);
+        archive_writer_ticker(&record->data.ticker);
+    } else {
+        if (!trade_dedup_accept(&record->data.trade)) return;
+        log_trade_price(&record->data.trade);
+        write_trade_to_bson(&record->data.trade);
+        archive_writer_trade(&record->data.trade);
+        bar_engine_trade(&record->data.trade);
+    }
+}
+
+/* Drain whatever is queued on one ring; returns the number of records written */
+static size_t ring_drain(IngestRing *ring) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t count = tail - head;
+
+    uint64_t latency_total = 0, latency_max = 0;
+    for (; head != tail; head++) {
+        const IngestRecord *record = &ring->slots[head & (INGEST_RING_CAPACITY - 1)];
+        current_record_ns = record->recv_ns;
+        write_record(record);
+
+        uint64_t latency = (uint64_t)(monotonic_ns() - record->recv_ns);
+        latency_record(LATENCY_WRITE, record->kind == INGEST_TICKER ? record->data.ticker.exchange_id
+                                                                    : record->data.trade.exchange_id, latency);
+        latency_total += latency;
+        if (latency > latency_max) latency_max = latency;
+        atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    }
+    current_record_ns = 0;
+
+    if (count) {
+        atomic_fetch_add_explicit(&ring->written, count, memory_order_relaxed);
+        atomic_fetch_add_explicit(&ring->latency_total_ns, latency_total, memory_order_relaxed);
+        if (latency_max > atomic_load_explicit(&ring->latency_max_ns, memory_order_relaxed))
+            atomic_store_explicit(&ring->latency_max_ns, latency_max, memory_order_relaxed);
+    }
+    return count;
+}
+
+static void *writer_thread(void *arg) {
+    int writer = (int)(intptr_t)arg;
+    struct timespec idle = { 0, INGEST_IDLE_NS };
+
+    while (1) {
+        /* Read the flag before draining so a final empty pass proves every ring is empty */
+        int stopping = atomic_load(&writers_stopping);
+        size_t drained = 0;
+        for (int shard = 0; shard < service_count; shard++)
+            drained += ring_drain(&rings[shard * writer_count + writer]);
+
+        if (!drained) {
+            if (stopping) break;
+            nanosleep(&idle, NULL);
+        }
+    }
+    return NULL;
+}
+
+static void *service_thread(void *arg) {
+    int shard = (int)(intptr_t)arg;
+    current_shard = shard;
+
+    while (!atomic_load(&services_stopping) && lws_service(contexts[shard], 10) >= 0)
+        ;
+
+    atomic_fetch_sub(&services_running, 1);
+    printf("[INFO] Ingest service thread %d stopped\n", shard);
+    return NULL;
+}
+
+int ingest_init(struct lws_context_creation_info *info, int service_threads_requested, int writer_threads_requested) {
+    service_count = thread_count(service_threads_requested, INGEST_SERVICE_THREADS_ENV,
+                                 INGEST_DEFAULT_SERVICE_THREADS, INGEST_MAX_SERVICE_THREADS);
+    writer_count = thread_count(writer_threads_requested, INGEST_WRITER_THREADS_ENV,
+                                INGEST_DEFAULT_WRITER_THREADS, INGEST_MAX_WRITER_THREADS);
+
+    size_t ring_bytes = (size_t)service_count * writer_count * sizeof(IngestRing);
+    rings = aligned_alloc(INGEST_CACHE_LINE, ring_bytes);
+    if (!rings) {
+        printf("[ERROR] Memory allocation failed for ingest rings\n");
+        return -1;
+    }
+    memset(rings, 0, ring_bytes);
+
+    for (int i = 0; i < service_count * writer_count; i++) {
+        rings[i].slots = malloc(INGEST_RING_CAPACITY * sizeof(IngestRecord));
+        if (!rings[i].slots) {
+            printf("[ERROR] Memory allocation failed for ingest ring %d\n", i);
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < service_count; i++) {
+        contexts[i] = lws_create_context(info);
+        if (!contexts[i]) {
+            printf("[ERROR] Failed to create WebSocket context %d\n", i);
+            return -1;
+        }
+    }
+
+    printf("[INFO] Ingest: %d service thread(s), %d writer thread(s), %d records per ring\n",
+           service_count, writer_count, INGEST_RING_CAPACITY);
+    return 0;
+}
+
+struct lws_context *ingest_context(int connection) {
+    if (service_count == 0) return NULL;
+    if (connection < 0) connection = 0;
+    return contexts[connection % service_count];
+}
+
+int ingest_service_threads(void) {
+    return service_count;
+}
+
+int ingest_start(void) {
+    /* jansson seeds its hash function lazily; do it once before objects are built on several threads */
+    json_object_seed(0);
+
+    for (int i = 0; i < writer_count; i++) {
+        if (pthread_create(&writer_threads[i], NULL, writer_thread, (void *)(intptr_t)i) != 0) {
+            printf("[ERROR] Failed to start ingest writer thread %d\n", i);
+            return -1;
+        }
+        writers_started++;
+    }
+
+    for (int i = 0; i < service_count; i++) {
+        atomic_fetch_add(&services_running, 1);
+        if (pthread_create(&service_threads[i], NULL, service_thread, (void *)(intptr_t)i) != 0) {
+            atomic_fetch_sub(&services_running, 1);
+            printf("[ERROR] Failed to start ingest service thread %d\n", i);
+            return -1;
+        }
+        services_started++;
+    }
+    return 0;
+}
+
+void ingest_frame_received(void) {
+    current_frame_ns = monotonic_ns();
+}
+
+int64_t ingest_record_received(void) {
+    return current_record_ns;
+}
+
+uint64_t ingest_thread_records(void) {
+    return thread_records;
+}
+
+void ingest_submit_ticker(const TickerData *ticker) {
+    connection_table_count(ticker->exchange_id, ticker->symbol_id);
+    quote_book_ticker(ticker);
+    latency_record_event(ticker->ts_ns);
+    thread_records++;
+    if (current_shard < 0) {
+        log_ticker_price(ticker);
+        write_ticker_to_bson(ticker);
+        archive_writer_ticker(ticker);
+        return;
+    }
+
+    IngestRing *ring = ring_for(current_shard, ticker->exchange_id);
+    IngestRecord *slot = ring_reserve(ring);
+    if (!slot) return;
+
+    slot->kind = INGEST_TICKER;
+    slot->recv_ns = current_frame_ns;
+    slot->data.ticker = *ticker;
+    ring_commit(ring);
+}
+
+void ingest_submit_trade(const TradeData *trade) {
+    connection_table_count(trade->exchange_id, trade->symbol_id);
+    latency_record_event(trade->ts_ns);
+    thread_records++;
+    if (current_shard < 0) {
+        if (!trade_dedup_accept(trade)) return;
+        log_trade_price(trade);
+        write_trade_to_bson(trade);
+        archive_writer_trade(trade);
+        bar_engine_trade(trade);
+        return;
+    }
+
+    IngestRing *ring = ring_for(current_shard, trade->exchange_id);
+    IngestRecord *slot = ring_reserve(ring);
+    if (!slot) return;
+
+    slot->kind = INGEST_TRADE;
+    slot->recv_ns = current_frame_ns;
+    slot->data.trade = *trade;
+    ring_commit(ring);
+}
+
+int ingest_running(void) {
+    return atomic_load(&services_running);
+}
+
+void ingest_stop(void) {
+    atomic_store(&services_stopping, 1);
+    for (int i = 0; i < services_started; i++) {
+        lws_cancel_service(contexts[i]);
+        pthread_join(service_threads[i], NULL);
+    }
+    services_started = 0;
+
+    atomic_store(&writers_stopping, 1);
+    for (int i = 0; i < writers_started; i++)
+        pthread_join(writer_threads[i], NULL);
+    writers_started = 0;
+
+    for (int i = 0; i < service_count; i++) {
+        if (contexts[i]) lws_context_destroy(contexts[i]);
+        contexts[i] = NULL;
+    }
+
+    if (rings) {
+        for (int i = 0; i < service_count * writer_count; i++)
+            free(rings[i].slots);
+        free(rings);
+        rings = NULL;
+    }
+}
+
+void ingest_stats(IngestStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (!rings) return;
+
+    for (int i = 0; i < service_count * writer_count; i++) {
+        IngestRing *ring = &rings[i];
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        size_t max_depth = atomic_load_explicit(&ring->max_depth, memory_order_relaxed);
+        uint64_t latency_max = atomic_load_explicit(&ring->latency_max_ns, memory_order_relaxed);
+
+        stats->submitted += atomic_load_explicit(&ring->submitted, memory_order_relaxed);
+        stats->written += atomic_load_explicit(&ring->written, memory_order_relaxed);
+        stats->dropped += atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+        stats->depth += tail - head;
+        stats->latency_total_ns += atomic_load_explicit(&ring->latency_total_ns, memory_order_relaxed);
+        if (max_depth > stats->max_depth) stats->max_depth = max_depth;
+        if (latency_max > stats->latency_max_ns) stats->latency_max_ns = latency_max;
+    }
+}
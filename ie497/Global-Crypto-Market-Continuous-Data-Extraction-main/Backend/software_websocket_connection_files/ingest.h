@@ -0,0 +1,99 @@
+/*
+ * Ingest Pipeline Header
+ *
+ * Declares the multi-threaded ingest pipeline: N libwebsockets service threads,
+ * each owning its own context and a subset of the exchange connections, hand
+ * parsed records over single-producer/single-consumer rings to M writer threads
+ * that format JSON snapshot entries and BSON documents.
+ *
+ * Features:
+ *  - ingest_init(): Creates one lws context per service thread and the rings.
+ *  - ingest_context(): Context a connection (protocols[] index) is assigned to.
+ *  - ingest_submit_ticker() / ingest_submit_trade(): Non-blocking handoff from the callback.
+ *  - ingest_stats(): Queue depth, high-water mark, dropped-record counters and
+ *    frame-arrival-to-write latency.
+ *  - ingest_record_received(): Arrival time of the record a writer thread is writing.
+ *  - Thread counts from INGEST_SERVICE_THREADS / INGEST_WRITER_THREADS.
+ *
+ * Dependencies:
+ *  - libwebsockets: One context per service thread.
+ *  - market_record.h: TickerData / TradeData.
+ *
+ * Usage:
+ *  - Set up and started from `main.c`; records are submitted from `exchange_websocket.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <libwebsockets.h>
+
+#include "market_record.h"
+
+/* Default and maximum thread counts (override with the environment variables below) */
+#define INGEST_DEFAULT_SERVICE_THREADS 2
+#define INGEST_DEFAULT_WRITER_THREADS 1
+#define INGEST_MAX_SERVICE_THREADS 8
+#define INGEST_MAX_WRITER_THREADS 4
+
+#define INGEST_SERVICE_THREADS_ENV "INGEST_SERVICE_THREADS"
+#define INGEST_WRITER_THREADS_ENV "INGEST_WRITER_THREADS"
+
+/* Records per ring; must be a power of two */
+#define INGEST_RING_CAPACITY 4096
+
+/* Seconds between queue statistics lines from the main loop */
+#define INGEST_STATS_INTERVAL 60
+
+/* Counters summed over every ring */
+typedef struct {
+    uint64_t submitted;         // records accepted into a ring
+    uint64_t written;           // records handed to the JSON/BSON writers
+    uint64_t dropped;           // records lost because a ring was full
+    size_t depth;               // records currently queued
+    size_t max_depth;           // highest depth seen on any single ring
+    uint64_t latency_total_ns;  // frame arrival to JSON/BSON write, summed over `written`
+    uint64_t latency_max_ns;
+} IngestStats;
+
+/* Creates the contexts and rings. Thread counts <= 0 select the environment or the default. */
+int ingest_init(struct lws_context_creation_info *info, int service_threads, int writer_threads);
+
+/* Context owning a connection; connections are spread round-robin over the service threads. */
+struct lws_context *ingest_context(int connection);
+
+/* Number of service threads (and contexts); context `i` is ingest_context(i). */
+int ingest_service_threads(void);
+
+/* Starts the writer threads and then the service threads. */
+int ingest_start(void);
+
+/* Stamps the arrival of the frame about to be parsed on this thread (used for write latency). */
+void ingest_frame_received(void);
+
+/* Frame arrival (CLOCK_MONOTONIC ns) of the record being written on the calling writer thread,
+ * 0 outside a writer thread's drain (used to time the BSON flush). */
+int64_t ingest_record_received(void);
+
+/* Queues a record for the writer threads. Called on a service thread; elsewhere it writes inline. */
+void ingest_submit_ticker(const TickerData *ticker);
+void ingest_submit_trade(const TradeData *trade);
+
+/* Records submitted so far from the calling thread. */
+uint64_t ingest_thread_records(void);
+
+/* Number of service threads still running their lws loop. */
+int ingest_running(void);
+
+/* Stops the service threads, drains every ring, joins the writers and destroys the contexts. */
+void ingest_stop(void);
+
+/* Snapshot of the queue counters. */
+void ingest_stats(IngestStats *stats);
+
+#endif // INGEST_H
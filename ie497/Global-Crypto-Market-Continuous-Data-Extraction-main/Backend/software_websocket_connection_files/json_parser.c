@@ -9,21 +9,27 @@
  *  - Extracts numeric values from JSON messages.
  *  - Parses Bitfinex ticker price from an array-based JSON response.
  *  - Extracts currency symbols from Huobi's WebSocket channel format.
+ *  - Single-pass, allocation-free extraction of a whole field table per message,
+ *    driven by the structural index from `json_scan.c`.
+ *  - Field tables may name a parser, so values are stored in binary form directly.
  * 
  * Dependencies:
  *  - Standard C libraries (string.h, stdlib.h).
+ *  - `json_scan.c` for the structural index.
  * 
  * Usage:
  *  - Called by `exchange_websocket.c` to process market data in WebSocket responses.
  *  - Helps transform raw WebSocket JSON messages into structured price and timestamp data.
  * 
  * Created: 3/7/2025
- * Updated: 4/14/2025
+ * Updated: 10/18/2026
  */
 
 #include "json_parser.h"
+#include "json_scan.h"
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 /* Extract a quoted value from JSON using key */
 int extract_order_data(const char *json, const char *key, char *dest, size_t dest_size) {
@@ -134,3 +140,214 @@ int extract_huobi_currency(const char *json, char *dest, size_t dest_size) {
 
     return 1;
 }
+
+static int is_json_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/* Find the next '"' eight bytes at a time (SWAR zero-byte test on little-endian words) */
+static inline const char *find_quote(const char *pos, const char *end) {
+    while (end - pos >= 8) {
+        uint64_t word;
+        memcpy(&word, pos, sizeof(word));
+        uint64_t x = word ^ 0x2222222222222222ULL;
+        uint64_t hit = (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+        if (hit) return pos + (__builtin_ctzll(hit) >> 3);
+        pos += 8;
+    }
+    while (pos < end && *pos != '"') pos++;
+    return (pos < end) ? pos : NULL;
+}
+
+/* Return the closing quote of a string whose body starts at `pos`, or NULL */
+static inline const char *skip_string(const char *pos, const char *end) {
+    for (;;) {
+        const char *quote = find_quote(pos, end);
+        if (!quote) return NULL;
+
+        /* A quote preceded by an odd number of backslashes is escaped */
+        const char *back = quote;
+        while (back > pos && back[-1] == '\\') back--;
+        if (((quote - back) & 1) == 0) return quote;
+        pos = quote + 1;
+    }
+}
+
+/* Find the text of one scalar value starting at `pos`; returns the position after it */
+static inline const char *value_span(const char *pos, const char *end, const char **start, size_t *len) {
+    const char *stop;
+
+    if (*pos == '"') {
+        *start = pos + 1;
+        stop = skip_string(*start, end);
+        if (!stop) stop = end;
+        pos = (stop < end) ? stop + 1 : end;
+    } else {
+        *start = pos;
+        while (pos < end && *pos != ',' && *pos != '}' && *pos != ']' && !is_json_space(*pos)) pos++;
+        stop = pos;
+    }
+
+    *len = stop - *start;
+    return pos;
+}
+
+/* Store a value through the field's parser, or copy its text; returns 1 if the field is now set */
+static inline int store_value(const FieldSpec *field, const char *value, size_t len, void *record) {
+    char *dest = (char *)record + field->offset;
+    if (field->parse) return field->parse(value, len, dest);
+
+    if (len >= field->size) len = field->size - 1;
+    memcpy(dest, value, len);
+    dest[len] = '\0';
+    return len > 0;
+}
+
+/* Set when every FIELD_REQUIRED entry has been found */
+static int required_found(const FieldSpec *fields, size_t count, uint64_t found) {
+    for (size_t i = 0; i < count; i++) {
+        if ((fields[i].flags & FIELD_REQUIRED) && !(found & ((uint64_t)1 << i)))
+            return 0;
+    }
+    return 1;
+}
+
+/* Byte-wise walk, used when a payload has more structurals than the stack index holds */
+static int extract_fields_scalar(const char *json, size_t len, const FieldSpec *fields, size_t count, void *record) {
+    uint64_t found = 0;
+    uint64_t all = (count == 64) ? UINT64_MAX : ((uint64_t)1 << count) - 1;
+    const char *pos = json;
+    const char *end = json + len;
+
+    while (pos < end && found != all) {
+        pos = find_quote(pos, end);
+        if (!pos) break;
+
+        /* Scan the string; it is a key only if a ':' follows it */
+        const char *key = pos + 1;
+        const char *key_end = skip_string(key, end);
+        if (!key_end) break;
+        size_t key_len = key_end - key;
+        pos = key_end + 1;
+
+        while (pos < end && is_json_space(*pos)) pos++;
+        if (pos >= end || *pos != ':') continue;
+        pos++;
+        while (pos < end && is_json_space(*pos)) pos++;
+        if (pos >= end) break;
+
+        for (size_t i = 0; i < count; i++) {
+            const FieldSpec *field = &fields[i];
+            uint64_t bit = (uint64_t)1 << i;
+            if (field->key_len != key_len || field->key[0] != key[0] || (found & bit) ||
+                memcmp(field->key, key, key_len) != 0)
+                continue;
+
+            /* Objects and arrays are not captured; their members are scanned as usual */
+            if (*pos == '{' || *pos == '[') break;
+            if ((field->flags & FIELD_STRING) && *pos != '"') break;
+
+            const char *value;
+            size_t value_len;
+            pos = value_span(pos, end, &value, &value_len);
+            if (store_value(field, value, value_len, record)) found |= bit;
+            break;
+        }
+    }
+
+    return required_found(fields, count, found);
+}
+
+/* Walk the structural index once; every "key": pair is matched against the field table */
+int extract_fields(const char *json, size_t len, const FieldSpec *fields, size_t count, void *record) {
+    if (count > MAX_FIELD_SPECS) count = MAX_FIELD_SPECS;
+
+    uint32_t positions[JSON_INDEX_STACK_CAPACITY];
+    JsonIndex ix;
+    if (json_index_build(&ix, json, len, positions, JSON_INDEX_STACK_CAPACITY) != 0)
+        return extract_fields_scalar(json, len, fields, count, record);
+
+    uint64_t found = 0;
+    uint64_t all = (count == 64) ? UINT64_MAX : ((uint64_t)1 << count) - 1;
+    const uint32_t *at = ix.pos;
+    size_t i = 0;
+
+    while (i + 2 < ix.count && found != all) {
+        /* A string is a key only if the next structural is ':' */
+        if (json[at[i]] != '"') { i++; continue; }
+        const char *key = json + at[i] + 1;
+        size_t key_len = at[i + 1] - at[i] - 1;
+        if (json[at[i + 2]] != ':') { i += 2; continue; }
+
+        size_t colon = i + 2;
+        i = colon + 1;
+
+        size_t start = at[colon] + 1;
+        while (start < len && is_json_space(json[start])) start++;
+        if (start >= len) break;
+
+        for (size_t f = 0; f < count; f++) {
+            const FieldSpec *field = &fields[f];
+            uint64_t bit = (uint64_t)1 << f;
+            if (field->key_len != key_len || field->key[0] != key[0] || (found & bit) ||
+                memcmp(field->key, key, key_len) != 0)
+                continue;
+
+            /* Objects and arrays are not captured; their members are walked as usual */
+            char c = json[start];
+            if (c == '{' || c == '[') break;
+            if ((field->flags & FIELD_STRING) && c != '"') break;
+
+            size_t stop;
+            if (c == '"') {
+                start++;
+                stop = (colon + 2 < ix.count) ? at[colon + 2] : len;
+                i = colon + 3;
+            } else {
+                stop = (colon + 1 < ix.count) ? at[colon + 1] : len;
+                while (stop > start && is_json_space(json[stop - 1])) stop--;
+            }
+
+            if (store_value(field, json + start, stop - start, record)) found |= bit;
+            break;
+        }
+    }
+
+    return required_found(fields, count, found);
+}
+
+/* Resolve each pointer path in the table against the index */
+int extract_pointer_fields(const JsonIndex *ix, size_t node, const FieldSpec *fields, size_t count, void *record) {
+    if (count > MAX_FIELD_SPECS) count = MAX_FIELD_SPECS;
+
+    uint64_t found = 0;
+    for (size_t i = 0; i < count; i++) {
+        const FieldSpec *field = &fields[i];
+        const char *value;
+        size_t value_len;
+        if (!json_index_lookup(ix, node, field->key, &value, &value_len)) continue;
+
+        /* A quoted value's opening quote sits just before the returned span */
+        if ((field->flags & FIELD_STRING) && (value == ix->json || value[-1] != '"')) continue;
+        if (*value == '{' || *value == '[') continue;
+
+        if (store_value(field, value, value_len, record)) found |= (uint64_t)1 << i;
+    }
+
+    return required_found(fields, count, found);
+}
+
+/* Bounded substring search, safe on payloads that are not NUL-terminated */
+int json_find(const char *json, size_t len, const char *needle) {
+    size_t needle_len = strlen(needle);
+    if (needle_len == 0) return 1;
+    if (needle_len > len) return 0;
+
+    const char *last = json + len - needle_len;
+    for (const char *pos = json; pos <= last; pos++) {
+        pos = memchr(pos, needle[0], last - pos + 1);
+        if (!pos) return 0;
+        if (memcmp(pos, needle, needle_len) == 0) return 1;
+    }
+    return 0;
+}
@@ -9,16 +9,19 @@
  *  - `extract_numeric()`: Extracts a numeric (unquoted) value from JSON.
  *  - `extract_bitfinex_price()`: Extracts ticker price from a Bitfinex array message.
  *  - `extract_huobi_currency()`: Extracts currency identifiers from Huobi's channel string.
+ *  - `extract_fields()`: Fills every field in a per-exchange table in one pass over a message.
+ *  - `extract_pointer_fields()`: Fills a table of JSON-pointer paths from a structural index.
+ *  - `json_find()`: Bounded substring search over a (possibly unterminated) payload.
  * 
  * Dependencies:
- *  - Standard C library (stddef.h) for size definitions.
+ *  - Standard C library (stddef.h) for size definitions and offsetof.
  * 
  * Usage:
  *  - Implemented in `json_parser.c`.
  *  - Used in `exchange_websocket.c` for parsing WebSocket market data.
  * 
  * Created: 3/7/2025
- * Updated: 5/7/2025
+ * Updated: 10/18/2026
  */
 
 #ifndef JSON_PARSER_H
@@ -26,6 +29,8 @@
 
 #include <stddef.h>
 
+#include "json_scan.h"
+
 /* Extract a quoted value from JSON using the specified key */
 int extract_order_data(const char *json, const char *key, char *dest, size_t dest_size);
 
@@ -38,4 +43,42 @@ int extract_bitfinex_price(const char *json, char *dest, size_t dest_size);
 /* Extract currency from Huobi channel string */
 int extract_huobi_currency(const char *json, char *dest, size_t dest_size);
 
+/* Maximum number of entries in a single FieldSpec table */
+#define MAX_FIELD_SPECS 64
+
+/* FieldSpec flags */
+#define FIELD_REQUIRED 0x1  // message is unusable without this field
+#define FIELD_STRING   0x2  // only accept a quoted value
+
+/* Converts a value's text (quotes stripped) into the destination field; returns 1 on success */
+typedef int (*FieldParser)(const char *value, size_t len, void *dest);
+
+/* Describes one key to capture into a field of a record */
+typedef struct {
+    const char *key;        // exact key name, without quotes
+    size_t key_len;         // strlen(key)
+    size_t offset;          // offsetof() the destination field in the record
+    size_t size;            // sizeof() the destination field
+    int flags;              // FIELD_REQUIRED / FIELD_STRING
+    FieldParser parse;      // NULL: copy the text into a char[] field
+} FieldSpec;
+
+/* Build a FieldSpec entry that stores `member` of `type` through `parser` */
+#define FIELD_PARSE_SPEC(key, type, member, flags, parser) \
+    { key, sizeof(key) - 1, offsetof(type, member), sizeof(((type *)0)->member), flags, parser }
+
+/* Build a FieldSpec entry that copies the text into the char[] `member` of `type` */
+#define FIELD_SPEC(key, type, member, flags) FIELD_PARSE_SPEC(key, type, member, flags, NULL)
+
+/* Fill each field of `record` named in `fields` with one pass over `json`.
+   The first occurrence of each key wins. Returns 1 if all required fields were found. */
+int extract_fields(const char *json, size_t len, const FieldSpec *fields, size_t count, void *record);
+
+/* Like extract_fields(), but each key is a JSON pointer ("/b/0") resolved below `node`
+   of an already built structural index. Used for positional (array-shaped) messages. */
+int extract_pointer_fields(const JsonIndex *ix, size_t node, const FieldSpec *fields, size_t count, void *record);
+
+/* Return non-zero if `needle` occurs within the first `len` bytes of `json` */
+int json_find(const char *json, size_t len, const char *needle);
+
 #endif // JSON_PARSER_H
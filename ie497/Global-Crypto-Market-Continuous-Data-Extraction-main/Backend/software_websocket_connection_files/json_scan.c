@@ -0,0 +1,463 @@
+/*
+ * JSON Structural Scanner
+ *
+ * This module classifies a payload 64 bytes at a time into bitmasks of quotes,
+ * backslashes and structural operators, removes escaped quotes and anything
+ * inside strings, and emits the remaining offsets as a compact index. Exchange
+ * parsers then work on the index instead of re-reading the payload byte by byte.
+ *
+ * Features:
+ *  - AVX2 and SSE2 classifiers selected at runtime, with a portable scalar fallback.
+ *  - In-string masking with a prefix-XOR over quote bits (no per-byte branches).
+ *  - Escape handling only in the rare blocks that contain a backslash.
+ *  - JSON-pointer lookups over the index for array-shaped messages (Kraken).
+ *
+ * Dependencies:
+ *  - Standard C libraries (string, stdlib, stdint).
+ *  - <immintrin.h> on x86 for the SSE2/AVX2 paths.
+ *
+ * Usage:
+ *  - json_scan_init() is called once from `main.c`; lookups lazily initialize too.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "json_scan.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JSON_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+#define BLOCK_SIZE 64
+
+/* Per-block classification: one bit per byte */
+typedef struct {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t op;            // : , { } [ ]
+} BlockMasks;
+
+typedef int (*BuildFn)(JsonIndex *ix, uint32_t *buf, size_t capacity);
+
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+
+/* ------------------------------ Classifiers ------------------------------ */
+
+ALWAYS_INLINE void classify_scalar(const uint8_t *block, BlockMasks *m) {
+    uint64_t quote = 0, backslash = 0, op = 0;
+    for (int i = 0; i < BLOCK_SIZE; i++) {
+        uint8_t c = block[i];
+        uint8_t folded = c | 0x20;  // '[' -> '{', ']' -> '}'
+        quote |= (uint64_t)(c == '"') << i;
+        backslash |= (uint64_t)(c == '\\') << i;
+        op |= (uint64_t)(c == ':' || c == ',' || folded == '{' || folded == '}') << i;
+    }
+    m->quote = quote;
+    m->backslash = backslash;
+    m->op = op;
+}
+
+#ifdef JSON_SCAN_X86
+__attribute__((target("sse2")))
+ALWAYS_INLINE void classify_sse2(const uint8_t *block, BlockMasks *m) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    const __m128i fold = _mm_set1_epi8(0x20);
+
+    uint64_t q = 0, b = 0, o = 0;
+    for (int i = 0; i < BLOCK_SIZE; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(block + i));
+        __m128i f = _mm_or_si128(v, fold);
+        __m128i ops = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(f, open), _mm_cmpeq_epi8(f, close)));
+        q |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << i;
+        b |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)) << i;
+        o |= (uint64_t)(uint16_t)_mm_movemask_epi8(ops) << i;
+    }
+    m->quote = q;
+    m->backslash = b;
+    m->op = o;
+}
+
+__attribute__((target("avx2")))
+ALWAYS_INLINE void classify_avx2(const uint8_t *block, BlockMasks *m) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i open = _mm256_set1_epi8('{');
+    const __m256i close = _mm256_set1_epi8('}');
+    const __m256i fold = _mm256_set1_epi8(0x20);
+
+    uint64_t q = 0, b = 0, o = 0;
+    for (int i = 0; i < BLOCK_SIZE; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(block + i));
+        __m256i f = _mm256_or_si256(v, fold);
+        __m256i ops = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, colon), _mm256_cmpeq_epi8(v, comma)),
+                                      _mm256_or_si256(_mm256_cmpeq_epi8(f, open), _mm256_cmpeq_epi8(f, close)));
+        q |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)) << i;
+        b |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)) << i;
+        o |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ops) << i;
+    }
+    m->quote = q;
+    m->backslash = b;
+    m->op = o;
+}
+#endif
+
+/* ----------------------------- Index builder ----------------------------- */
+
+/* Bits of quotes that are escaped by an odd run of backslashes (rare, so done per byte) */
+ALWAYS_INLINE uint64_t escaped_quotes(const uint8_t *block, uint64_t backslash, uint64_t *carry) {
+    if (!backslash && !*carry) return 0;
+
+    uint64_t escaped = 0;
+    int pending = (int)*carry;
+    for (int i = 0; i < BLOCK_SIZE; i++) {
+        if (pending) {
+            escaped |= (uint64_t)1 << i;
+            pending = 0;
+        } else if (block[i] == '\\') {
+            pending = 1;
+        }
+    }
+    *carry = (uint64_t)pending;
+    return escaped;
+}
+
+/* Bit i = XOR of bits 0..i: marks bytes from an opening quote up to its closing quote */
+ALWAYS_INLINE uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/* Stage-one loop; instantiated once per classifier so each copy is compiled for its target */
+#define DEFINE_BUILD(name, classify_block)                                                  \
+static int name(JsonIndex *ix, uint32_t *buf, size_t capacity) {                            \
+    const char *json = ix->json;                                                            \
+    size_t len = ix->len;                                                                   \
+    uint64_t escape_carry = 0;                                                              \
+    uint64_t in_string = 0;     /* all ones if the previous block ended inside a string */  \
+    size_t count = 0;                                                                       \
+                                                                                            \
+    for (size_t base = 0; base < len; base += BLOCK_SIZE) {                                 \
+        const uint8_t *block = (const uint8_t *)json + base;                                \
+        uint8_t tail[BLOCK_SIZE];                                                           \
+        if (len - base < BLOCK_SIZE) {                                                      \
+            memset(tail, ' ', sizeof(tail));                                                \
+            memcpy(tail, block, len - base);                                                \
+            block = tail;                                                                   \
+        }                                                                                   \
+                                                                                            \
+        BlockMasks m;                                                                       \
+        classify_block(block, &m);                                                          \
+                                                                                            \
+        uint64_t quotes = m.quote & ~escaped_quotes(block, m.backslash, &escape_carry);     \
+        uint64_t inside = prefix_xor(quotes) ^ in_string;                                   \
+        in_string = (uint64_t)0 - (inside >> 63);                                           \
+                                                                                            \
+        uint64_t structural = (m.op & ~inside) | quotes;                                    \
+        size_t found = (size_t)__builtin_popcountll(structural);                            \
+        if (capacity - count < BLOCK_SIZE) {                                                \
+            if (count + found > capacity) return -1;                                        \
+            while (structural) {                                                            \
+                buf[count++] = (uint32_t)(base + __builtin_ctzll(structural));              \
+                structural &= structural - 1;                                               \
+            }                                                                               \
+            continue;                                                                       \
+        }                                                                                   \
+                                                                                            \
+        /* Four writes per step; extra slots past `found` are overwritten by the next block */ \
+        uint32_t *out = buf + count;                                                        \
+        while (structural) {                                                                \
+            out[0] = (uint32_t)(base + __builtin_ctzll(structural));                        \
+            structural &= structural - 1;                                                   \
+            out[1] = (uint32_t)(base + __builtin_ctzll(structural | ((uint64_t)1 << 63)));  \
+            structural &= structural - 1;                                                   \
+            out[2] = (uint32_t)(base + __builtin_ctzll(structural | ((uint64_t)1 << 63)));  \
+            structural &= structural - 1;                                                   \
+            out[3] = (uint32_t)(base + __builtin_ctzll(structural | ((uint64_t)1 << 63)));  \
+            structural &= structural - 1;                                                   \
+            out += 4;                                                                       \
+        }                                                                                   \
+        count += found;                                                                     \
+    }                                                                                       \
+                                                                                            \
+    ix->count = count;                                                                      \
+    return 0;                                                                               \
+}
+
+DEFINE_BUILD(build_scalar, classify_scalar)
+
+#ifdef JSON_SCAN_X86
+__attribute__((target("sse2")))
+DEFINE_BUILD(build_sse2, classify_sse2)
+
+/* BMI/POPCNT give single-instruction tzcnt, blsr and popcnt for the bit loop */
+__attribute__((target("avx2,bmi,popcnt")))
+DEFINE_BUILD(build_avx2, classify_avx2)
+#endif
+
+/* ------------------------------- Dispatch -------------------------------- */
+
+static BuildFn build = NULL;
+static const char *build_name = "none";
+
+#ifdef JSON_SCAN_X86
+static int cpu_has_avx2(void) {
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("popcnt");
+}
+#endif
+
+void json_scan_init(void) {
+    if (build) return;
+#ifdef JSON_SCAN_X86
+    __builtin_cpu_init();
+    if (cpu_has_avx2()) {
+        build_name = "avx2";
+        build = build_avx2;
+        return;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        build_name = "sse2";
+        build = build_sse2;
+        return;
+    }
+#endif
+    build_name = "scalar";
+    build = build_scalar;
+}
+
+int json_scan_set_impl(const char *name) {
+    if (strcmp(name, "scalar") == 0) {
+        build = build_scalar;
+        build_name = "scalar";
+        return 0;
+    }
+#ifdef JSON_SCAN_X86
+    __builtin_cpu_init();
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) {
+        build = build_sse2;
+        build_name = "sse2";
+        return 0;
+    }
+    if (strcmp(name, "avx2") == 0 && cpu_has_avx2()) {
+        build = build_avx2;
+        build_name = "avx2";
+        return 0;
+    }
+#endif
+    return -1;
+}
+
+const char *json_scan_impl_name(void) {
+    json_scan_init();
+    return build_name;
+}
+
+int json_index_build(JsonIndex *ix, const char *json, size_t len, uint32_t *buf, size_t capacity) {
+    json_scan_init();
+
+    ix->json = json;
+    ix->len = len;
+    ix->pos = buf;
+    ix->count = 0;
+    return build(ix, buf, capacity);
+}
+
+/* ------------------------------- Navigator ------------------------------- */
+
+static inline char at(const JsonIndex *ix, size_t i) {
+    return ix->json[ix->pos[i]];
+}
+
+/* Index of the bracket closing the container opened at structural `i` */
+static size_t match_close(const JsonIndex *ix, size_t i) {
+    int depth = 0;
+    for (size_t j = i; j < ix->count; j++) {
+        char c = at(ix, j);
+        if (c == '{' || c == '[') depth++;
+        else if (c == '}' || c == ']') {
+            if (--depth == 0) return j;
+        }
+    }
+    return ix->count;
+}
+
+/* Compare a pointer segment (up to '/' or end) with a key span */
+static int segment_equals(const char *seg, size_t seg_len, const char *key, size_t key_len) {
+    return seg_len == key_len && memcmp(seg, key, key_len) == 0;
+}
+
+/* Offset of the first non-whitespace byte after structural `sep` */
+static size_t value_start(const JsonIndex *ix, size_t sep) {
+    size_t start = ix->pos[sep] + 1;
+    while (start < ix->len && (ix->json[start] == ' ' || ix->json[start] == '\t' ||
+                               ix->json[start] == '\n' || ix->json[start] == '\r'))
+        start++;
+    return start;
+}
+
+/* Given a separator ('[', '{', ',' or ':'), return the structural that ends its value */
+static size_t skip_value(const JsonIndex *ix, size_t sep) {
+    size_t v = sep + 1;
+    if (v >= ix->count) return ix->count;
+
+    if (ix->pos[v] != value_start(ix, sep)) return v;      // scalar: ends at the next structural
+    char c = at(ix, v);
+    if (c == '"') return v + 2;
+    if (c == '{' || c == '[') return match_close(ix, v) + 1;
+    return v;                               // empty element, e.g. "[]"
+}
+
+/* Structural index of the container that is the value after `sep`, or JSON_INDEX_NONE */
+static size_t container_after(const JsonIndex *ix, size_t sep) {
+    size_t v = sep + 1;
+    if (v >= ix->count || ix->pos[v] != value_start(ix, sep)) return JSON_INDEX_NONE;
+    return (at(ix, v) == '{' || at(ix, v) == '[') ? v : JSON_INDEX_NONE;
+}
+
+size_t json_index_root(const JsonIndex *ix) {
+    for (size_t i = 0; i < ix->count; i++) {
+        if (at(ix, i) == '{' || at(ix, i) == '[') return i;
+    }
+    return JSON_INDEX_NONE;
+}
+
+size_t json_index_child(const JsonIndex *ix, size_t node) {
+    if (node >= ix->count || at(ix, node) != '[') return JSON_INDEX_NONE;
+    return container_after(ix, node);
+}
+
+size_t json_index_sibling(const JsonIndex *ix, size_t node) {
+    size_t close = match_close(ix, node);
+    if (close + 1 >= ix->count || at(ix, close + 1) != ',') return JSON_INDEX_NONE;
+    return container_after(ix, close + 1);
+}
+
+int json_index_lookup(const JsonIndex *ix, size_t node, const char *pointer, const char **value, size_t *value_len) {
+    if (node == JSON_INDEX_NONE) node = json_index_root(ix);
+    if (node >= ix->count) return 0;
+
+    /* `sep` is the structural just before the current value; a bare node has none */
+    size_t sep = JSON_INDEX_NONE;
+
+    const char *seg = pointer;
+    while (*seg == '/') {
+        seg++;
+        size_t seg_len = strcspn(seg, "/");
+
+        char c = at(ix, node);
+        if (c == '[') {
+            long n = strtol(seg, NULL, 10);
+            size_t s = node;
+            for (long k = 0; k < n; k++) {
+                s = skip_value(ix, s);
+                if (s >= ix->count || at(ix, s) != ',') return 0;
+            }
+            sep = s;
+        } else if (c == '{') {
+            size_t s = node;
+            for (;;) {
+                size_t k = s + 1;
+                if (k + 2 >= ix->count || at(ix, k) != '"' || at(ix, k + 2) != ':') return 0;
+                const char *key = ix->json + ix->pos[k] + 1;
+                size_t key_len = ix->pos[k + 1] - ix->pos[k] - 1;
+                if (segment_equals(seg, seg_len, key, key_len)) {
+                    sep = k + 2;
+                    break;
+                }
+                s = skip_value(ix, k + 2);
+                if (s >= ix->count || at(ix, s) != ',') return 0;
+            }
+        } else {
+            return 0;
+        }
+
+        seg += seg_len;
+        if (*seg == '/') {
+            /* Descend: the value must itself be a container */
+            node = container_after(ix, sep);
+            if (node == JSON_INDEX_NONE) return 0;
+        }
+    }
+
+    if (sep == JSON_INDEX_NONE) {
+        size_t close = match_close(ix, node);
+        if (close >= ix->count) return 0;
+        *value = ix->json + ix->pos[node];
+        *value_len = ix->pos[close] - ix->pos[node] + 1;
+        return 1;
+    }
+
+    size_t start = value_start(ix, sep);
+    size_t v = sep + 1;
+    if (v < ix->count && ix->pos[v] == start) {
+        char c = at(ix, v);
+        if (c == '"') {
+            if (v + 1 >= ix->count) return 0;
+            *value = ix->json + start + 1;
+            *value_len = ix->pos[v + 1] - start - 1;
+            return 1;
+        }
+        if (c == '{' || c == '[') {
+            size_t close = match_close(ix, v);
+            if (close >= ix->count) return 0;
+            *value = ix->json + start;
+            *value_len = ix->pos[close] - start + 1;
+            return 1;
+        }
+        return 0;                           // separator directly after separator
+    }
+
+    size_t end = (v < ix->count) ? ix->pos[v] : ix->len;
+    while (end > start && (ix->json[end - 1] == ' ' || ix->json[end - 1] == '\t' ||
+                           ix->json[end - 1] == '\n' || ix->json[end - 1] == '\r'))
+        end--;
+    *value = ix->json + start;
+    *value_len = end - start;
+    return 1;
+}
+
+size_t json_index_node(const JsonIndex *ix, size_t node, const char *pointer) {
+    const char *value;
+    size_t value_len;
+    if (!json_index_lookup(ix, node, pointer, &value, &value_len)) return JSON_INDEX_NONE;
+    if (*value != '{' && *value != '[') return JSON_INDEX_NONE;
+
+    /* Offsets are sorted, so the container's opening bracket is found by bisection */
+    uint32_t offset = (uint32_t)(value - ix->json);
+    size_t lo = 0, hi = ix->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ix->pos[mid] < offset) lo = mid + 1;
+        else hi = mid;
+    }
+    return (lo < ix->count && ix->pos[lo] == offset) ? lo : JSON_INDEX_NONE;
+}
+
+int json_index_copy(const JsonIndex *ix, size_t node, const char *pointer, char *dest, size_t dest_size) {
+    const char *value;
+    size_t value_len;
+    if (!json_index_lookup(ix, node, pointer, &value, &value_len)) return 0;
+
+    if (value_len >= dest_size) value_len = dest_size - 1;
+    memcpy(dest, value, value_len);
+    dest[value_len] = '\0';
+    return value_len > 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * JSON Structural Scanner Header
+ *
+ * Declares a vectorized scanner that records the offsets of every structural
+ * character ('"' pairs, ':', ',', '{', '}', '[', ']') outside of strings in a
+ * WebSocket payload, plus a small navigator that answers JSON-pointer style
+ * lookups ("/1/b/0") over that index without building a DOM.
+ *
+ * Features:
+ *  - json_index_build(): Builds the structural index into a caller-provided buffer.
+ *  - json_index_lookup(): Finds the value at a pointer path such as "/data/0/px".
+ *  - json_index_copy(): Copies a looked-up value into a fixed-size field.
+ *  - json_index_child() / json_index_sibling(): Walks arrays of arrays (Kraken trades).
+ *  - json_scan_init() / json_scan_set_impl(): Runtime AVX2 / SSE2 / scalar selection.
+ *
+ * Dependencies:
+ *  - Standard C libraries (stddef.h, stdint.h).
+ *
+ * Usage:
+ *  - Used by `json_parser.c` (extract_fields) and the Kraken path in `exchange_websocket.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef JSON_SCAN_H
+#define JSON_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Positions kept on the stack by callers; a payload can never need more than one per byte */
+#define JSON_INDEX_STACK_CAPACITY 8192
+
+/* "No such node"; also selects the root when passed as a starting node */
+#define JSON_INDEX_NONE ((size_t)-1)
+
+/* Structural index over one payload */
+typedef struct {
+    const char *json;
+    size_t len;
+    uint32_t *pos;          // offsets of structural characters, in order
+    size_t count;
+} JsonIndex;
+
+/* Picks the fastest scanner the CPU supports. Safe to call more than once. */
+void json_scan_init(void);
+
+/* Forces a scanner ("avx2", "sse2" or "scalar"); returns 0 on success. Used by the benchmark. */
+int json_scan_set_impl(const char *name);
+
+/* Name of the scanner currently in use. */
+const char *json_scan_impl_name(void);
+
+/* Builds the structural index of `json` into `buf`. Returns 0, or -1 if `capacity` is too small. */
+int json_index_build(JsonIndex *ix, const char *json, size_t len, uint32_t *buf, size_t capacity);
+
+/* Structural index of the outermost '{' or '[', or JSON_INDEX_NONE. */
+size_t json_index_root(const JsonIndex *ix);
+
+/* First element of the array at `node`, if that element is itself an array or object. */
+size_t json_index_child(const JsonIndex *ix, size_t node);
+
+/* Next array/object element after `node` in the same parent array. */
+size_t json_index_sibling(const JsonIndex *ix, size_t node);
+
+/* Finds the value at `pointer` ("/key/0/key") below `node` (JSON_INDEX_NONE for the root).
+ * Strings are returned without their quotes. */
+int json_index_lookup(const JsonIndex *ix, size_t node, const char *pointer, const char **value, size_t *value_len);
+
+/* Structural index of the array/object at `pointer` below `node`, or JSON_INDEX_NONE. */
+size_t json_index_node(const JsonIndex *ix, size_t node, const char *pointer);
+
+/* Looks up `pointer` below `node` and copies the value into `dest`. Returns 1 if a non-empty value was copied. */
+int json_index_copy(const JsonIndex *ix, size_t node, const char *pointer, char *dest, size_t dest_size);
+
+#endif // JSON_SCAN_H
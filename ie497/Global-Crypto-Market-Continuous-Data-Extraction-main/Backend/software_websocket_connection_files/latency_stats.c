@@ -0,0 +1,651 @@
+/*
+ * Latency Stats
+ *
+ * This module times every record from the exchange to the disk and serves the
+ * result to monitoring. Service threads, writer threads and the BSON flush add
+ * samples with relaxed atomic increments into fixed arrays, and a separate
+ * endpoint thread reads those arrays to render Prometheus text, so a scrape
+ * never takes a lock that ingest waits on.
+ *
+ * Features:
+ *  - Log-linear histograms: exact below 16 ns, then 16 buckets per power of two up to ~18 min.
+ *  - Wire and parse histograms per connection (protocol); write and handoff histograms per exchange.
+ *  - Per-connection frames, bytes, records, parse failures, reconnects and the current retry attempt.
+ *  - Frame and byte rates over the last LATENCY_RATE_WINDOW seconds, sampled by the endpoint thread.
+ *  - Unix socket (the text is written on connect) and HTTP on 127.0.0.1 (any GET path).
+ *  - Per-exchange summaries are quantiles over the merged connection histograms.
+ *
+ * Dependencies:
+ *  - connection_table.h: Connection names and exchanges.
+ *  - Standard C libraries (stdio, stdlib, string, stdarg, stdatomic, pthread, time, errno)
+ *    and POSIX sockets (poll, sys/socket, sys/un, netinet/in).
+ *
+ * Usage:
+ *  - ./crypto_ws --stats-socket /tmp/crypto_ws.sock   then   socat - UNIX-CONNECT:/tmp/crypto_ws.sock
+ *  - ./crypto_ws --stats-port 9464                     then   curl http://127.0.0.1:9464/metrics
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#define _GNU_SOURCE
+#include "latency_stats.h"
+#include "connection_table.h"
+#include "market_record.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+
+#define LATENCY_CACHE_LINE 64
+#define LATENCY_SUB_COUNT (1u << LATENCY_SUB_BITS)
+
+/* Endpoint thread: poll timeout (also the shutdown delay) and per-client socket timeout */
+#define LATENCY_POLL_MS 250
+#define LATENCY_CLIENT_TIMEOUT_S 1
+#define LATENCY_REQUEST_MAX 4096
+
+typedef struct {
+    atomic_uint_fast64_t buckets[LATENCY_BUCKETS];
+    atomic_uint_fast64_t total_ns;
+    atomic_uint_fast64_t max_ns;
+} LatencyHistogram;
+
+/* Plain copy of one or more histograms, taken by a reader */
+typedef struct {
+    uint64_t buckets[LATENCY_BUCKETS];
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} HistogramSnapshot;
+
+/* Written by the service thread that owns the connection (reconnects too) */
+typedef struct {
+    _Alignas(LATENCY_CACHE_LINE) atomic_uint_fast64_t frames;
+    atomic_uint_fast64_t bytes;
+    atomic_uint_fast64_t records;
+    atomic_uint_fast64_t untimed;
+    atomic_uint_fast64_t parse_failures;
+    atomic_uint_fast64_t reconnects;
+    atomic_int retry_attempt;
+    LatencyHistogram wire;
+    LatencyHistogram parse;
+} ConnectionLatency;
+
+/* Counters of one connection as rendered */
+typedef struct {
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t records;
+    uint64_t untimed;
+    uint64_t parse_failures;
+    uint64_t reconnects;
+    int retry_attempt;
+    double frames_per_second;
+    double bytes_per_second;
+} ConnectionCounters;
+
+typedef enum {
+    COUNTER_U64,
+    COUNTER_INT,
+    COUNTER_DOUBLE
+} CounterValue;
+
+/* One per-connection metric of the endpoint, read from a ConnectionCounters field */
+typedef struct {
+    const char *name;
+    const char *help;
+    size_t offset;
+    CounterValue value;         // COUNTER_U64 is rendered as a counter, the others as gauges
+} CounterFamily;
+
+static const CounterFamily counter_families[] = {
+    { "crypto_ws_frames_total", "WebSocket frames received.", offsetof(ConnectionCounters, frames), COUNTER_U64 },
+    { "crypto_ws_bytes_total", "WebSocket payload bytes received.", offsetof(ConnectionCounters, bytes), COUNTER_U64 },
+    { "crypto_ws_records_total", "Ticker and trade records parsed.", offsetof(ConnectionCounters, records), COUNTER_U64 },
+    { "crypto_ws_untimed_records_total", "Records without an exchange event time before frame arrival.",
+      offsetof(ConnectionCounters, untimed), COUNTER_U64 },
+    { "crypto_ws_parse_failures_total", "Frames or messages that could not be parsed.",
+      offsetof(ConnectionCounters, parse_failures), COUNTER_U64 },
+    { "crypto_ws_reconnects_total", "Reconnect attempts scheduled.", offsetof(ConnectionCounters, reconnects), COUNTER_U64 },
+    { "crypto_ws_retry_attempt", "Reconnect attempt of the current outage, 0 while frames arrive.",
+      offsetof(ConnectionCounters, retry_attempt), COUNTER_INT },
+    { "crypto_ws_frames_per_second", "Frames per second over the last rate window.",
+      offsetof(ConnectionCounters, frames_per_second), COUNTER_DOUBLE },
+    { "crypto_ws_bytes_per_second", "Payload bytes per second over the last rate window.",
+      offsetof(ConnectionCounters, bytes_per_second), COUNTER_DOUBLE },
+};
+
+/* Endpoint thread's history of the frame and byte totals, one sample per second */
+typedef struct {
+    int64_t at_ns[LATENCY_RATE_WINDOW + 1];
+    uint64_t frames[LATENCY_RATE_WINDOW + 1][MAX_CONNECTIONS];
+    uint64_t bytes[LATENCY_RATE_WINDOW + 1][MAX_CONNECTIONS];
+    uint64_t taken;
+} RateHistory;
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+    int failed;
+} TextBuffer;
+
+static ConnectionLatency connections[MAX_CONNECTIONS];
+static LatencyHistogram exchange_write[EXCHANGE_COUNT];
+static LatencyHistogram exchange_handoff[EXCHANGE_COUNT];
+
+/* Frame being handled on this service thread; -1 outside latency_frame_begin/end */
+static __thread int frame_connection = -1;
+static __thread int64_t frame_start_ns = 0;
+static __thread int64_t frame_wall_ns = 0;
+
+static pthread_t server_thread;
+static int server_started = 0;
+static atomic_int server_stopping = 0;
+static int unix_fd = -1;
+static int http_fd = -1;
+static char unix_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static RateHistory rates;
+
+static const char *stage_names[LATENCY_STAGE_COUNT] = { "wire", "parse", "write", "handoff" };
+
+static int64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* ------------------------------ Histograms -------------------------------- */
+
+static size_t bucket_index(uint64_t value) {
+    if (value >> LATENCY_MAX_BITS) value = (1ULL << LATENCY_MAX_BITS) - 1;
+    if (value < LATENCY_SUB_COUNT) return (size_t)value;
+
+    int shift = 63 - __builtin_clzll(value) - LATENCY_SUB_BITS;
+    return ((size_t)(shift + 1) << LATENCY_SUB_BITS) + (size_t)((value >> shift) - LATENCY_SUB_COUNT);
+}
+
+/* Highest value that falls into a bucket */
+static uint64_t bucket_upper(size_t index) {
+    if (index < LATENCY_SUB_COUNT) return index;
+
+    int shift = (int)(index >> LATENCY_SUB_BITS) - 1;
+    uint64_t low = ((uint64_t)(index & (LATENCY_SUB_COUNT - 1)) + LATENCY_SUB_COUNT) << shift;
+    return low + (1ULL << shift) - 1;
+}
+
+static void histogram_add(LatencyHistogram *histogram, uint64_t value) {
+    atomic_fetch_add_explicit(&histogram->buckets[bucket_index(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->total_ns, value, memory_order_relaxed);
+
+    uint_fast64_t max = atomic_load_explicit(&histogram->max_ns, memory_order_relaxed);
+    while (value > max && !atomic_compare_exchange_weak_explicit(&histogram->max_ns, &max, value,
+                                                                 memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+/* Adds a histogram into a snapshot; the count is taken from the buckets so quantiles stay consistent */
+static void histogram_merge(HistogramSnapshot *snapshot, LatencyHistogram *histogram) {
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        uint64_t n = atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+        snapshot->buckets[i] += n;
+        snapshot->count += n;
+    }
+    snapshot->total_ns += atomic_load_explicit(&histogram->total_ns, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&histogram->max_ns, memory_order_relaxed);
+    if (max > snapshot->max_ns) snapshot->max_ns = max;
+}
+
+/* Smallest bucket bound that covers a `q` share of the samples, capped at the maximum */
+static uint64_t snapshot_quantile(const HistogramSnapshot *snapshot, double q) {
+    if (!snapshot->count) return 0;
+
+    uint64_t target = (uint64_t)(q * (double)snapshot->count);
+    if ((double)target < q * (double)snapshot->count || target == 0) target++;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += snapshot->buckets[i];
+        if (seen >= target) {
+            uint64_t value = bucket_upper(i);
+            return value < snapshot->max_ns ? value : snapshot->max_ns;
+        }
+    }
+    return snapshot->max_ns;
+}
+
+/* Wire or parse histograms of every connection of one exchange, or the exchange's own write/handoff one */
+static void stage_snapshot(LatencyStage stage, uint16_t exchange_id, HistogramSnapshot *snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    if (exchange_id >= EXCHANGE_COUNT) return;
+
+    if (stage == LATENCY_WRITE) {
+        histogram_merge(snapshot, &exchange_write[exchange_id]);
+    } else if (stage == LATENCY_HANDOFF) {
+        histogram_merge(snapshot, &exchange_handoff[exchange_id]);
+    } else {
+        int count = connection_count();
+        for (int i = 0; i < count && i < MAX_CONNECTIONS; i++) {
+            if (connection_exchange(i) != exchange_id) continue;
+            histogram_merge(snapshot, stage == LATENCY_WIRE ? &connections[i].wire : &connections[i].parse);
+        }
+    }
+}
+
+/* ------------------------------ Recording --------------------------------- */
+
+void latency_frame_begin(int connection) {
+    frame_connection = (connection >= 0 && connection < MAX_CONNECTIONS) ? connection : -1;
+    frame_start_ns = clock_ns(CLOCK_MONOTONIC);
+    frame_wall_ns = clock_ns(CLOCK_REALTIME);
+}
+
+void latency_frame_end(size_t bytes, int failed) {
+    if (frame_connection < 0) return;
+    ConnectionLatency *connection = &connections[frame_connection];
+    frame_connection = -1;
+
+    histogram_add(&connection->parse, (uint64_t)(clock_ns(CLOCK_MONOTONIC) - frame_start_ns));
+    atomic_fetch_add_explicit(&connection->frames, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&connection->bytes, bytes, memory_order_relaxed);
+    if (failed) atomic_fetch_add_explicit(&connection->parse_failures, 1, memory_order_relaxed);
+    if (atomic_load_explicit(&connection->retry_attempt, memory_order_relaxed))
+        atomic_store_explicit(&connection->retry_attempt, 0, memory_order_relaxed);
+}
+
+void latency_record_event(int64_t event_ns) {
+    if (frame_connection < 0) return;
+    ConnectionLatency *connection = &connections[frame_connection];
+
+    atomic_fetch_add_explicit(&connection->records, 1, memory_order_relaxed);
+    /* Records without an event time were stamped after the frame arrived */
+    if (event_ns <= 0 || event_ns > frame_wall_ns) {
+        atomic_fetch_add_explicit(&connection->untimed, 1, memory_order_relaxed);
+        return;
+    }
+    histogram_add(&connection->wire, (uint64_t)(frame_wall_ns - event_ns));
+}
+
+void latency_parse_failure(void) {
+    if (frame_connection < 0) return;
+    atomic_fetch_add_explicit(&connections[frame_connection].parse_failures, 1, memory_order_relaxed);
+}
+
+void latency_reconnect(int connection, int attempt) {
+    if (connection < 0 || connection >= MAX_CONNECTIONS) return;
+    atomic_fetch_add_explicit(&connections[connection].reconnects, 1, memory_order_relaxed);
+    atomic_store_explicit(&connections[connection].retry_attempt, attempt, memory_order_relaxed);
+}
+
+void latency_record(LatencyStage stage, uint16_t exchange_id, uint64_t latency_ns) {
+    if (exchange_id >= EXCHANGE_COUNT) return;
+    if (stage == LATENCY_WRITE) histogram_add(&exchange_write[exchange_id], latency_ns);
+    else if (stage == LATENCY_HANDOFF) histogram_add(&exchange_handoff[exchange_id], latency_ns);
+}
+
+static void connection_counters(int index, ConnectionCounters *out) {
+    ConnectionLatency *connection = &connections[index];
+    memset(out, 0, sizeof(*out));
+    out->frames = atomic_load_explicit(&connection->frames, memory_order_relaxed);
+    out->bytes = atomic_load_explicit(&connection->bytes, memory_order_relaxed);
+    out->records = atomic_load_explicit(&connection->records, memory_order_relaxed);
+    out->untimed = atomic_load_explicit(&connection->untimed, memory_order_relaxed);
+    out->parse_failures = atomic_load_explicit(&connection->parse_failures, memory_order_relaxed);
+    out->reconnects = atomic_load_explicit(&connection->reconnects, memory_order_relaxed);
+    out->retry_attempt = atomic_load_explicit(&connection->retry_attempt, memory_order_relaxed);
+}
+
+void latency_stats_exchange(uint16_t exchange_id, ExchangeLatency *out) {
+    memset(out, 0, sizeof(*out));
+    int count = connection_count();
+    for (int i = 0; i < count && i < MAX_CONNECTIONS; i++) {
+        if (connection_exchange(i) != exchange_id) continue;
+        ConnectionCounters counters;
+        connection_counters(i, &counters);
+        out->frames += counters.frames;
+        out->bytes += counters.bytes;
+        out->records += counters.records;
+        out->untimed += counters.untimed;
+        out->parse_failures += counters.parse_failures;
+        out->reconnects += counters.reconnects;
+    }
+
+    static HistogramSnapshot snapshot;     // main thread only; too large for comfort on the stack
+    for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+        stage_snapshot((LatencyStage)stage, exchange_id, &snapshot);
+        out->stage[stage].count = snapshot.count;
+        out->stage[stage].p50_ns = snapshot_quantile(&snapshot, 0.5);
+        out->stage[stage].p99_ns = snapshot_quantile(&snapshot, 0.99);
+        out->stage[stage].max_ns = snapshot.max_ns;
+    }
+}
+
+/* ------------------------------- Endpoint --------------------------------- */
+
+static void text_printf(TextBuffer *text, const char *format, ...) {
+    if (text->failed) return;
+    while (1) {
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(text->data ? text->data + text->len : NULL,
+                                text->data ? text->capacity - text->len : 0, format, args);
+        va_end(args);
+        if (written < 0) {
+            text->failed = 1;
+            return;
+        }
+        if (text->data && (size_t)written < text->capacity - text->len) {
+            text->len += (size_t)written;
+            return;
+        }
+
+        size_t capacity = text->capacity ? text->capacity * 2 : 64 * 1024;
+        while (capacity < text->len + (size_t)written + 1) capacity *= 2;
+        char *grown = realloc(text->data, capacity);
+        if (!grown) {
+            printf("[ERROR] Memory allocation failed for latency stats text\n");
+            text->failed = 1;
+            return;
+        }
+        text->data = grown;
+        text->capacity = capacity;
+    }
+}
+
+/* One sample of every connection's totals; called about once per second */
+static void sample_rates(int64_t now) {
+    size_t slot = rates.taken % (LATENCY_RATE_WINDOW + 1);
+    int count = connection_count();
+    rates.at_ns[slot] = now;
+    for (int i = 0; i < count && i < MAX_CONNECTIONS; i++) {
+        rates.frames[slot][i] = atomic_load_explicit(&connections[i].frames, memory_order_relaxed);
+        rates.bytes[slot][i] = atomic_load_explicit(&connections[i].bytes, memory_order_relaxed);
+    }
+    rates.taken++;
+}
+
+/* Frames and bytes per second between the oldest and newest samples in the window */
+static void connection_rates(int index, ConnectionCounters *out) {
+    if (rates.taken < 2) return;
+    size_t newest = (rates.taken - 1) % (LATENCY_RATE_WINDOW + 1);
+    size_t oldest = rates.taken > LATENCY_RATE_WINDOW ? rates.taken % (LATENCY_RATE_WINDOW + 1) : 0;
+    double seconds = (double)(rates.at_ns[newest] - rates.at_ns[oldest]) / 1e9;
+    if (seconds <= 0) return;
+
+    out->frames_per_second = (double)(rates.frames[newest][index] - rates.frames[oldest][index]) / seconds;
+    out->bytes_per_second = (double)(rates.bytes[newest][index] - rates.bytes[oldest][index]) / seconds;
+}
+
+static void render_summary(TextBuffer *text, const char *name, const char *labels, const HistogramSnapshot *snapshot) {
+    static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    for (size_t i = 0; i < sizeof(quantiles) / sizeof(quantiles[0]); i++) {
+        text_printf(text, "%s{%s,quantile=\"%g\"} %.9f\n", name, labels, quantiles[i],
+                    (double)snapshot_quantile(snapshot, quantiles[i]) / 1e9);
+    }
+    text_printf(text, "%s_sum{%s} %.9f\n", name, labels, (double)snapshot->total_ns / 1e9);
+    text_printf(text, "%s_count{%s} %llu\n", name, labels, (unsigned long long)snapshot->count);
+}
+
+/* Prometheus text exposition of every counter and histogram */
+static void render_stats(TextBuffer *text) {
+    static ConnectionCounters counters[MAX_CONNECTIONS];
+    static HistogramSnapshot snapshot;
+    int count = connection_count();
+    if (count > MAX_CONNECTIONS) count = MAX_CONNECTIONS;
+
+    for (int i = 0; i < count; i++) {
+        connection_counters(i, &counters[i]);
+        connection_rates(i, &counters[i]);
+    }
+
+    for (size_t f = 0; f < sizeof(counter_families) / sizeof(counter_families[0]); f++) {
+        const CounterFamily *family = &counter_families[f];
+        text_printf(text, "# HELP %s %s\n# TYPE %s %s\n", family->name, family->help, family->name,
+                    family->value == COUNTER_U64 ? "counter" : "gauge");
+        for (int i = 0; i < count; i++) {
+            const ConnectionCounters *c = &counters[i];
+            if (!c->frames && !c->reconnects) continue;
+
+            const char *field = (const char *)c + family->offset;
+            text_printf(text, "%s{exchange=\"%s\",connection=\"%s\"} ", family->name,
+                        exchange_name(connection_exchange(i)), connection_name(i));
+            if (family->value == COUNTER_U64) text_printf(text, "%llu\n", (unsigned long long)*(const uint64_t *)field);
+            else if (family->value == COUNTER_INT) text_printf(text, "%d\n", *(const int *)field);
+            else text_printf(text, "%.1f\n", *(const double *)field);
+        }
+    }
+
+    text_printf(text, "# HELP crypto_ws_connection_latency_seconds Wire (event to arrival) and parse "
+                      "(callback) latency per connection.\n# TYPE crypto_ws_connection_latency_seconds summary\n");
+    for (int i = 0; i < count; i++) {
+        for (int stage = LATENCY_WIRE; stage <= LATENCY_PARSE; stage++) {
+            memset(&snapshot, 0, sizeof(snapshot));
+            histogram_merge(&snapshot, stage == LATENCY_WIRE ? &connections[i].wire : &connections[i].parse);
+            if (!snapshot.count) continue;
+
+            char labels[160];
+            snprintf(labels, sizeof(labels), "exchange=\"%s\",connection=\"%s\",stage=\"%s\"",
+                     exchange_name(connection_exchange(i)), connection_name(i), stage_names[stage]);
+            render_summary(text, "crypto_ws_connection_latency_seconds", labels, &snapshot);
+        }
+    }
+
+    text_printf(text, "# HELP crypto_ws_latency_seconds Latency per exchange: wire (event to arrival), parse "
+                      "(callback), write (arrival to writer), handoff (arrival to BSON fflush, not fsync).\n"
+                      "# TYPE crypto_ws_latency_seconds summary\n");
+    for (uint16_t exchange = 1; exchange < EXCHANGE_COUNT; exchange++) {
+        for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+            stage_snapshot((LatencyStage)stage, exchange, &snapshot);
+            if (!snapshot.count) continue;
+
+            char labels[96];
+            snprintf(labels, sizeof(labels), "exchange=\"%s\",stage=\"%s\"", exchange_name(exchange), stage_names[stage]);
+            render_summary(text, "crypto_ws_latency_seconds", labels, &snapshot);
+            text_printf(text, "crypto_ws_latency_max_seconds{%s} %.9f\n", labels, (double)snapshot.max_ns / 1e9);
+        }
+    }
+}
+
+static int send_all(int fd, const char *data, size_t len) {
+    while (len) {
+        ssize_t sent = send(fd, data, len, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return -1;
+        data += sent;
+        len -= (size_t)sent;
+    }
+    return 0;
+}
+
+/* Reads an HTTP request head; returns 1 for GET/HEAD, 0 for another method, -1 if none arrived */
+static int read_request(int fd, int *head) {
+    char request[LATENCY_REQUEST_MAX + 1];
+    size_t len = 0;
+    while (len < LATENCY_REQUEST_MAX) {
+        ssize_t got = recv(fd, request + len, LATENCY_REQUEST_MAX - len, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        len += (size_t)got;
+        request[len] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) break;
+    }
+    if (len == 0) return -1;
+
+    request[len] = '\0';
+    *head = strncmp(request, "HEAD ", 5) == 0;
+    return strncmp(request, "GET ", 4) == 0 || *head;
+}
+
+static void serve_client(int fd, int http) {
+    struct timeval timeout = { LATENCY_CLIENT_TIMEOUT_S, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    int head = 0;
+    if (http) {
+        int method = read_request(fd, &head);
+        if (method < 0) {
+            close(fd);
+            return;
+        }
+        if (method == 0) {
+            static const char reply[] = "HTTP/1.0 405 Method Not Allowed\r\nAllow: GET, HEAD\r\n"
+                                        "Content-Length: 0\r\nConnection: close\r\n\r\n";
+            send_all(fd, reply, sizeof(reply) - 1);
+            close(fd);
+            return;
+        }
+    }
+
+    TextBuffer text = { NULL, 0, 0, 0 };
+    render_stats(&text);
+    if (!text.failed) {
+        if (http) {
+            char header[160];
+            int header_len = snprintf(header, sizeof(header),
+                                      "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                      "Content-Length: %zu\r\nConnection: close\r\n\r\n", text.len);
+            if (send_all(fd, header, (size_t)header_len) == 0 && !head) send_all(fd, text.data, text.len);
+        } else {
+            send_all(fd, text.data, text.len);
+        }
+    }
+    free(text.data);
+    close(fd);
+}
+
+static void *server_main(void *arg) {
+    (void)arg;
+    struct pollfd fds[2];
+    int http[2];
+    int nfds = 0;
+    if (unix_fd >= 0) {
+        fds[nfds] = (struct pollfd){ .fd = unix_fd, .events = POLLIN };
+        http[nfds++] = 0;
+    }
+    if (http_fd >= 0) {
+        fds[nfds] = (struct pollfd){ .fd = http_fd, .events = POLLIN };
+        http[nfds++] = 1;
+    }
+
+    int64_t next_sample = 0;
+    while (!atomic_load(&server_stopping)) {
+        int64_t now = clock_ns(CLOCK_MONOTONIC);
+        if (now >= next_sample) {
+            sample_rates(now);
+            next_sample = now + 1000000000LL;
+        }
+
+        if (poll(fds, (nfds_t)nfds, LATENCY_POLL_MS) <= 0) continue;
+        for (int i = 0; i < nfds; i++) {
+            if (!(fds[i].revents & POLLIN)) continue;
+            int client = accept4(fds[i].fd, NULL, NULL, SOCK_CLOEXEC);
+            if (client >= 0) serve_client(client, http[i]);
+        }
+    }
+    return NULL;
+}
+
+static int listen_unix(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("[ERROR] Stats socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    /* A socket left by an earlier run is replaced; anything else at the path is not touched */
+    struct stat st;
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            printf("[ERROR] Stats socket path %s exists and is not a socket\n", path);
+            return -1;
+        }
+        unlink(path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        printf("[ERROR] Failed to listen on stats socket %s: %s\n", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    snprintf(unix_path, sizeof(unix_path), "%s", path);
+    return fd;
+}
+
+static int listen_http(int port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        printf("[ERROR] Failed to listen for stats on 127.0.0.1:%d: %s\n", port, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int latency_stats_serve(const char *socket_path, int http_port) {
+    if (!socket_path && http_port <= 0) return 0;
+    if (http_port > 65535) {
+        printf("[ERROR] Invalid stats port %d\n", http_port);
+        return -1;
+    }
+
+    if (socket_path && (unix_fd = listen_unix(socket_path)) < 0) return -1;
+    if (http_port > 0 && (http_fd = listen_http(http_port)) < 0) {
+        latency_stats_close();
+        return -1;
+    }
+
+    atomic_store(&server_stopping, 0);
+    if (pthread_create(&server_thread, NULL, server_main, NULL) != 0) {
+        printf("[ERROR] Failed to start the stats endpoint thread\n");
+        latency_stats_close();
+        return -1;
+    }
+    server_started = 1;
+
+    if (socket_path) printf("[INFO] Latency stats on unix:%s\n", socket_path);
+    if (http_port > 0) printf("[INFO] Latency stats on http://127.0.0.1:%d/metrics\n", http_port);
+    return 0;
+}
+
+void latency_stats_close(void) {
+    if (server_started) {
+        atomic_store(&server_stopping, 1);
+        pthread_join(server_thread, NULL);
+        server_started = 0;
+    }
+    if (unix_fd >= 0) {
+        close(unix_fd);
+        unlink(unix_path);
+        unix_fd = -1;
+    }
+    if (http_fd >= 0) {
+        close(http_fd);
+        http_fd = -1;
+    }
+}
@@ -0,0 +1,106 @@
+/*
+ * Latency Stats Header
+ *
+ * Declares the per-exchange, per-connection latency instrumentation. Every
+ * record is timed at three points: the exchange's event time, the arrival of
+ * its frame and the moment its BSON document reaches the OS. The differences go
+ * into lock-free log-linear (HDR-style) histograms, next to per-connection
+ * frame, byte, parse-failure and reconnect counters.
+ *
+ * Stages:
+ *  - wire:    exchange event time ("E", "ts", "time") to frame arrival, wall clock; per connection.
+ *  - parse:   time spent in callback_combined() on a frame (capture, parse, hand-off); per connection.
+ *  - write:   frame arrival to the writer thread's JSON/BSON/archive calls; per exchange.
+ *  - handoff: frame arrival to the fflush() that hands the record's BSON document to the kernel;
+ *             per exchange. Not a durability figure: nothing is fsynced.
+ *
+ * Features:
+ *  - latency_frame_begin() / latency_frame_end(): Bracket one frame on a service thread.
+ *  - latency_record_event(): Wire latency of a record parsed from the current frame.
+ *  - latency_stats_serve(): Prometheus text over a Unix socket and/or HTTP on 127.0.0.1,
+ *    rendered from the atomics on a thread of its own; ingest is never paused.
+ *  - latency_stats_exchange(): Counters and quantiles of one exchange for the stats line.
+ *
+ * Dependencies:
+ *  - connection_table.h: Connection names and exchanges.
+ *  - Standard C libraries (stdint, stddef).
+ *
+ * Usage:
+ *  - Frames are timed in `exchange_websocket.c`, records in `ingest.c`, flushes in `bson_writer.c`.
+ *  - `crypto_ws --stats-socket PATH` / `--stats-port PORT` start the endpoint from `main.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Values below 2^LATENCY_SUB_BITS ns are exact; every power of two above is split into
+ * 2^LATENCY_SUB_BITS linear buckets (about 6% relative error). Values clamp at 2^LATENCY_MAX_BITS ns (~18 min). */
+#define LATENCY_SUB_BITS 4
+#define LATENCY_MAX_BITS 40
+#define LATENCY_BUCKETS ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS)
+
+/* Frame and byte rates served by the endpoint are averaged over this many seconds */
+#define LATENCY_RATE_WINDOW 10
+
+typedef enum {
+    LATENCY_WIRE,
+    LATENCY_PARSE,
+    LATENCY_WRITE,
+    LATENCY_HANDOFF,
+    LATENCY_STAGE_COUNT
+} LatencyStage;
+
+typedef struct {
+    uint64_t count;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t max_ns;
+} LatencyQuantiles;
+
+/* One exchange, summed over its connections */
+typedef struct {
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t records;
+    uint64_t parse_failures;
+    uint64_t reconnects;
+    uint64_t untimed;           // records without an event time before their frame's arrival (none sent,
+                                // or clock skew); left out of `wire`
+    LatencyQuantiles stage[LATENCY_STAGE_COUNT];
+} ExchangeLatency;
+
+/* A frame of `connection` arrived and is about to be handled on this thread. */
+void latency_frame_begin(int connection);
+
+/* The current frame (`bytes` long) is handled; `failed` counts it as a parse failure. */
+void latency_frame_end(size_t bytes, int failed);
+
+/* A record with exchange event time `event_ns` (epoch ns) was parsed from the current frame. */
+void latency_record_event(int64_t event_ns);
+
+/* The current frame held a message that could not be parsed. */
+void latency_parse_failure(void);
+
+/* Reconnect `attempt` (retry_counts[]) of `connection` was scheduled. */
+void latency_reconnect(int connection, int attempt);
+
+/* Adds one sample to an exchange's `write` or `handoff` histogram. */
+void latency_record(LatencyStage stage, uint16_t exchange_id, uint64_t latency_ns);
+
+/* Starts the endpoint thread: a Unix socket at `socket_path` (written on connect) and/or
+ * HTTP on 127.0.0.1:`http_port` (any GET). Either may be NULL / 0. Returns 0 or -1. */
+int latency_stats_serve(const char *socket_path, int http_port);
+
+/* Stops the endpoint thread and removes the socket file. */
+void latency_stats_close(void);
+
+/* Snapshot of one exchange. */
+void latency_stats_exchange(uint16_t exchange_id, ExchangeLatency *out);
+
+#endif // LATENCY_STATS_H
@@ -22,9 +22,35 @@
  *  - Extracts and logs ticker and trade price data from incoming JSON messages.
  *  - Converts Binance millisecond timestamps to ISO 8601 format.
  *  - Supports multiple concurrent WebSocket connections.
- *  - Automatic reconnection with exponential backoff on connection failures.
+ *  - Automatic reconnection with jittered exponential backoff, run on the service threads' timers.
  *  - Periodic health monitoring for each exchange's connection.
  *  - Logs data into separate `.json` and `.bson` files for tickers and trades.
+ *  - Rewrites the rolling 10-minute `.json` snapshots on a timer, not per message.
+ *  - Keeps daily `.bson` files open and batches writes, flushing once per second.
+ *  - Parses messages through a SIMD structural index chosen for the host CPU.
+ *  - Interns every product symbol at startup and normalizes names through the symbol table.
+ *  - Services sockets on N threads and writes JSON/BSON on M writer threads
+ *    (INGEST_SERVICE_THREADS / INGEST_WRITER_THREADS), linked by lock-free rings.
+ *  - `--capture FILE` records every raw frame with its receive time for `bench_replay`.
+ *  - `--endpoint HOST:PORT` connects every exchange to a local `replay_server` instead.
+ *  - `--archive DIR` also writes a columnar, delta-encoded tick archive (`tick_query` reads it).
+ *  - Lays out connections from the product lists and last run's per-symbol rates, and
+ *    splits connections that saturate while running (`connection_table.c`).
+ *  - Compiles subscribe messages once at startup and logs time from connect to first record.
+ *  - `--quotes` publishes per-exchange and consolidated best bid/offer in shared memory
+ *    for local readers (`quote_watch`).
+ *  - `--bars DIR [--bar-intervals 1s,1m,5m]` writes OHLCV/VWAP bars from the trade stream
+ *    as each bar closes (`bar_engine.c`).
+ *  - `--books DIR [--book-symbols BTC-USD,ETH-USDT]` keeps level-2 order books from the depth
+ *    channels and writes compact snapshots of them (`order_book.c`; `book_query` reads them).
+ *  - Times every record from exchange event to frame arrival, through the callback, to the writer
+ *    and to the BSON flush, per exchange and connection (`latency_stats.c`). `--stats-socket PATH`
+ *    and `--stats-port PORT` serve the histograms and counters as Prometheus text.
+ *  - `--segments DIR [--segment-mb N] [--segment-seconds S]` seals the JSON entries into immutable
+ *    gzip segments listed in a manifest, for `segment_upload` to ship (`segment_writer.c`).
+ *  - Drops trades whose (exchange, symbol, trade ID) was written in the last two minutes, as
+ *    after a re-subscribe or on overlapping connections (`trade_dedup.c`).
+ *  - SIGINT/SIGTERM run the normal shutdown, so buffered BSON, segments and rates are written out.
  * 
  * Dependencies:
  *
@@ -46,7 +72,8 @@
  *      Standard math library used in calculations (e.g., float handling, price comparisons).
  * 
  *  - libcurl (`-lcurl`)
- *      Required to fetch product ID lists from exchange REST APIs before WebSocket subscriptions.
+ *      Required to fetch product ID lists from exchange REST APIs before WebSocket subscriptions,
+ *      and Binance order book snapshots with `--books`.
  * 
  *  Standard C Libraries:
  *  ---------------------
@@ -55,7 +82,8 @@
  *  - `string.h`     : String manipulation and comparison.
  *  - `time.h` / `sys/time.h` : Timestamping and formatting.
  *  - `unistd.h`     : Sleep/delay and POSIX API usage.
- *  - `pthread.h`    : Used for running background health monitoring threads.
+ *  - `pthread.h`    : Used by the ingest service and writer threads.
+ *  - `signal.h`     : SIGINT/SIGTERM shutdown.
  *
  *  Notes:
  *  - Make sure all libraries are installed and discoverable via your system's compiler/linker path.
@@ -65,9 +93,15 @@
  *    See README for build instructions.
  *    Run the program:
  *        ./crypto_ws
+ *        ./crypto_ws --capture session.cap
+ *        ./crypto_ws --endpoint 127.0.0.1:7681
+ *        ./crypto_ws --quotes
+ *        ./crypto_ws --books books --book-symbols BTC-USD,BTC-USDT
+ *        ./crypto_ws --stats-socket /tmp/crypto_ws.sock --stats-port 9464
+ *        ./crypto_ws --segments segments --segment-seconds 60
  * 
  * Created:  3/7/2025
- * Updated:  5/12/2025
+ * Updated:  10/18/2026
  */
  
 #include <stdio.h>
@@ -76,46 +110,168 @@
 #include <libwebsockets.h>
 #include <errno.h>
 #include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include <signal.h>
 
 #include "exchange_websocket.h"
 #include "exchange_connect.h"
+#include "exchange_reconnect.h"
 #include "utils.h"
+#include "bson_writer.h"
+#include "json_scan.h"
+#include "symbol_table.h"
+#include "ingest.h"
+#include "capture.h"
+#include "inflate_stream.h"
+#include "connection_table.h"
+#include "subscription_cache.h"
+#include "archive_writer.h"
+#include "quote_book.h"
+#include "bar_engine.h"
+#include "order_book.h"
+#include "latency_stats.h"
+#include "trade_dedup.h"
+#include "segment_writer.h"
 
-/* External declaration of WebSocket protocols */
-extern struct lws_protocols protocols[];
+/* Main-thread housekeeping period: snapshot/flush timers and queue statistics */
+#define HOUSEKEEPING_INTERVAL_US 10000
 
-/* Global WebSocket context */
-struct lws_context *context;
+/* Set by SIGINT/SIGTERM; the housekeeping loop then runs the shutdown below it */
+static volatile sig_atomic_t stop_requested = 0;
 
-/* Global WebSocket context */
-void start_health_monitor(void);
+static void handle_signal(int signal_number) {
+    (void)signal_number;
+    stop_requested = 1;
+    for (int i = 0; i < ingest_service_threads(); i++)
+        lws_cancel_service(ingest_context(i));
+}
 
-int main() {
+int main(int argc, char **argv) {
     printf("[INFO] Starting Crypto WebSocket Data Logger...\n");
 
+    const char *capture_path = NULL;
+    const char *archive_path = NULL;
+    int archive_compress = 1;
+    int quotes = 0;
+    const char *bar_path = NULL;
+    const char *bar_intervals = BAR_DEFAULT_INTERVALS;
+    const char *book_path = NULL;
+    const char *book_symbols = NULL;
+    const char *stats_socket = NULL;
+    int stats_port = 0;
+    const char *segment_path = NULL;
+    int segment_mb = SEGMENT_DEFAULT_MB;
+    int segment_seconds = SEGMENT_DEFAULT_SECONDS;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capture_path = argv[++i];
+        } else if (strcmp(argv[i], "--endpoint") == 0 && i + 1 < argc) {
+            if (exchange_connect_set_endpoint(argv[++i]) != 0) return -1;
+        } else if (strcmp(argv[i], "--archive") == 0 && i + 1 < argc) {
+            archive_path = argv[++i];
+        } else if (strcmp(argv[i], "--archive-raw") == 0) {
+            archive_compress = 0;
+        } else if (strcmp(argv[i], "--quotes") == 0) {
+            quotes = 1;
+        } else if (strcmp(argv[i], "--bars") == 0 && i + 1 < argc) {
+            bar_path = argv[++i];
+        } else if (strcmp(argv[i], "--bar-intervals") == 0 && i + 1 < argc) {
+            bar_intervals = argv[++i];
+        } else if (strcmp(argv[i], "--books") == 0 && i + 1 < argc) {
+            book_path = argv[++i];
+        } else if (strcmp(argv[i], "--book-symbols") == 0 && i + 1 < argc) {
+            book_symbols = argv[++i];
+        } else if (strcmp(argv[i], "--stats-socket") == 0 && i + 1 < argc) {
+            stats_socket = argv[++i];
+        } else if (strcmp(argv[i], "--stats-port") == 0 && i + 1 < argc) {
+            stats_port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--segments") == 0 && i + 1 < argc) {
+            segment_path = argv[++i];
+        } else if (strcmp(argv[i], "--segment-mb") == 0 && i + 1 < argc) {
+            segment_mb = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--segment-seconds") == 0 && i + 1 < argc) {
+            segment_seconds = atoi(argv[++i]);
+        } else {
+            printf("[ERROR] Usage: %s [--capture FILE] [--endpoint HOST:PORT] [--archive DIR [--archive-raw]] [--quotes] [--bars DIR [--bar-intervals LIST]] [--books DIR [--book-symbols LIST]] [--stats-socket PATH] [--stats-port PORT] [--segments DIR [--segment-mb N] [--segment-seconds S]]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    if (capture_path && capture_open(capture_path) != 0) {
+        return -1;
+    }
+
+    if (archive_path && archive_writer_open(archive_path, archive_compress) != 0) {
+        return -1;
+    }
+
+    if (segment_path && segment_writer_open(segment_path, segment_mb, segment_seconds) != 0) {
+        return -1;
+    }
+
+    if (quotes && quote_book_open(QUOTE_TABLE_NAME) != 0) {
+        return -1;
+    }
+
+    if (bar_path && bar_engine_open(bar_path, bar_intervals) != 0) {
+        return -1;
+    }
+
+    // Before the subscriptions are compiled, which add depth channels for the book symbols
+    if (book_path && order_book_open(book_path, book_symbols) != 0) {
+        return -1;
+    }
+
+    json_scan_init();
+    printf("[INFO] JSON structural scanner: %s\n", json_scan_impl_name());
+
+    size_t symbol_total = symbol_table_load(CURRENCY_FILES_DIR);
+    printf("[INFO] Symbol table loaded: %zu symbols\n", symbol_total);
+
+    // Connection layout (and the lws protocols) from the product lists and last run's rates
+    if (connection_table_build(CURRENCY_FILES_DIR) < 0 || build_protocols() != 0) {
+        printf("[ERROR] Failed to lay out exchange connections\n");
+        return -1;
+    }
+    reconnect_init();
+
+    // Names its series after the connection table; reads only atomics, so it can start early
+    if (latency_stats_serve(stats_socket, stats_port) != 0) {
+        return -1;
+    }
+
+    // Subscribe messages are compiled once here; (re)connects only write them
+    if (subscription_cache_build() != 0) {
+        printf("[ERROR] Failed to compile subscription messages\n");
+        return -1;
+    }
+
     struct lws_context_creation_info context_info;
     memset(&context_info, 0, sizeof(context_info));
     context_info.port = CONTEXT_PORT_NO_LISTEN;
     context_info.protocols = protocols;
     context_info.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
 
-    context = lws_create_context(&context_info);
-    if (!context) {
-        printf("[ERROR] Failed to create WebSocket context\n");
+    // One context per service thread; thread counts come from the environment
+    if (ingest_init(&context_info, 0, 0) != 0) {
+        printf("[ERROR] Failed to set up ingest threads\n");
         return -1;
     }
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
 
     ticker_data_file = fopen("ticker_output_data.json", "a");
     if (!ticker_data_file) {
         printf("[ERROR] Failed to open ticker log file\n");
-        lws_context_destroy(context);
+        ingest_stop();
         return -1;
     }
 
     trades_data_file = fopen("trades_output_data.json", "a");
     if (!trades_data_file) {
         printf("[ERROR] Failed to open trades log file\n");
-        lws_context_destroy(context);
+        ingest_stop();
         return -1;
     }
     
@@ -128,6 +284,15 @@ int main() {
     // Start connection health tracking
     start_health_monitor();
 
+    // Sample per-connection rates and split saturated connections
+    connection_rebalance_start();
+
+    // Service and writer threads take over the sockets from here
+    if (ingest_start() != 0) {
+        printf("[ERROR] Failed to start ingest threads\n");
+        return -1;
+    }
+
     // Connect to exchanges
     // int total_symbols_binance = count_symbols_in_file("currency_text_files/binance_currency_ids_trades.txt");
     // int num_chunks_binance = (total_symbols_binance + 99) / 100;
@@ -160,15 +325,156 @@ int main() {
 
     printf("[INFO] All WebSocket connections initialized. Listening for data...\n");
 
-    // Event loop: Handles incoming WebSocket messages and reconnections
-    while (lws_service(context, 10) >= 0) {}
+    // Housekeeping loop: the service threads handle messages and reconnections
+    time_t last_stats = time(NULL);
+    time_t last_rates_save = last_stats;
+    while (!stop_requested && ingest_running()) {
+        usleep(HOUSEKEEPING_INTERVAL_US);
+        flush_json_snapshots(0);
+        bson_writer_flush(0);
+        capture_flush(0);
+        archive_writer_flush(0);
+        segment_writer_flush(0);
+        bar_engine_flush(0);
+        order_book_flush(0);
+        subscription_cache_refresh();
+
+        time_t now = time(NULL);
+        if (now - last_rates_save >= CONNECTION_RATES_SAVE_INTERVAL) {
+            connection_table_save(CURRENCY_FILES_DIR);
+            last_rates_save = now;
+        }
+        if (now - last_stats >= INGEST_STATS_INTERVAL) {
+            IngestStats stats;
+            ingest_stats(&stats);
+            printf("[INFO] Ingest: %llu queued, %llu written, %llu dropped, depth %zu (max %zu), "
+                   "frame-to-write latency avg %.1f us (max %.1f us)\n",
+                   (unsigned long long)stats.submitted, (unsigned long long)stats.written,
+                   (unsigned long long)stats.dropped, stats.depth, stats.max_depth,
+                   stats.written ? (double)stats.latency_total_ns / stats.written / 1000.0 : 0.0,
+                   (double)stats.latency_max_ns / 1000.0);
+
+            ReconnectStats reconnects;
+            reconnect_stats(&reconnects);
+            if (reconnects.attempts) {
+                printf("[INFO] Reconnect: %llu attempts, %llu recovered (avg %.1f ms, max %.1f ms), "
+                       "%d down, last outage %.1f ms\n",
+                       (unsigned long long)reconnects.attempts, (unsigned long long)reconnects.recoveries,
+                       reconnects.recoveries ? (double)reconnects.recovery_total_ns / reconnects.recoveries / 1e6 : 0.0,
+                       (double)reconnects.recovery_max_ns / 1e6, reconnects.down,
+                       (double)reconnects.last_outage_ns / 1e6);
+            }
+
+            InflateStats inflated;
+            inflate_stats(&inflated);
+            if (inflated.frames || inflated.failed) {
+                printf("[INFO] Inflate: %llu frames, ratio %.2f, %llu oversize, %llu failed, largest %llu bytes\n",
+                       (unsigned long long)inflated.frames,
+                       inflated.bytes_in ? (double)inflated.bytes_out / inflated.bytes_in : 0.0,
+                       (unsigned long long)inflated.oversize, (unsigned long long)inflated.failed,
+                       (unsigned long long)inflated.largest);
+            }
+
+            if (archive_writer_enabled()) {
+                ArchiveStats archived;
+                archive_writer_stats(&archived);
+                printf("[INFO] Archive: %llu rows in %llu blocks, %llu bytes (%.1f bytes/row)\n",
+                       (unsigned long long)archived.rows, (unsigned long long)archived.blocks,
+                       (unsigned long long)archived.bytes,
+                       archived.rows ? (double)archived.bytes / archived.rows : 0.0);
+            }
+
+            if (segment_writer_enabled()) {
+                SegmentStats segments;
+                segment_writer_stats(&segments);
+                printf("[INFO] Segments: %llu sealed, %llu records, %.1f MB of JSON in %.1f MB (ratio %.1f)\n",
+                       (unsigned long long)segments.segments, (unsigned long long)segments.records,
+                       (double)segments.raw_bytes / (1024.0 * 1024.0), (double)segments.bytes / (1024.0 * 1024.0),
+                       segments.bytes ? (double)segments.raw_bytes / segments.bytes : 0.0);
+            }
+
+            if (quote_book_enabled()) {
+                QuoteBookStats quoted;
+                quote_book_stats(&quoted);
+                printf("[INFO] Quotes: %llu updates over %u symbols\n",
+                       (unsigned long long)quoted.updates, quoted.symbols);
+            }
+
+            if (bar_engine_enabled()) {
+                BarStats bars;
+                bar_engine_stats(&bars);
+                printf("[INFO] Bars: %llu trades, %llu bars written, %llu open, %llu late trades\n",
+                       (unsigned long long)bars.trades, (unsigned long long)bars.bars,
+                       (unsigned long long)bars.open_bars, (unsigned long long)bars.late);
+            }
+
+            if (order_book_enabled()) {
+                BookStats books;
+                order_book_stats(&books);
+                printf("[INFO] Books: %u in sync, %llu messages, %llu levels, %llu resyncs, "
+                       "%llu snapshots (%.1f MB)\n",
+                       books.books, (unsigned long long)books.messages, (unsigned long long)books.levels,
+                       (unsigned long long)books.resyncs, (unsigned long long)books.snapshots,
+                       (double)books.bytes / (1024.0 * 1024.0));
+            }
+
+            TradeDedupStats dedup;
+            trade_dedup_stats(EXCHANGE_UNKNOWN, &dedup);
+            if (dedup.checked || dedup.unkeyed) {
+                printf("[INFO] Dedup: %llu trades checked, %llu duplicates suppressed, %llu without trade ID, "
+                       "%llu evicted early\n",
+                       (unsigned long long)dedup.checked, (unsigned long long)dedup.suppressed,
+                       (unsigned long long)dedup.unkeyed, (unsigned long long)dedup.evicted);
+            }
+
+            for (uint16_t exchange = 1; exchange < EXCHANGE_COUNT; exchange++) {
+                ExchangeLatency latency;
+                latency_stats_exchange(exchange, &latency);
+                if (!latency.frames) continue;
+                printf("[INFO] Latency %s: %llu frames, %llu parse failures, %llu reconnects; "
+                       "wire p50 %.1f ms p99 %.1f ms, parse p99 %.1f us, write p99 %.1f us, handoff p99 %.1f ms\n",
+                       exchange_name(exchange), (unsigned long long)latency.frames,
+                       (unsigned long long)latency.parse_failures, (unsigned long long)latency.reconnects,
+                       (double)latency.stage[LATENCY_WIRE].p50_ns / 1e6, (double)latency.stage[LATENCY_WIRE].p99_ns / 1e6,
+                       (double)latency.stage[LATENCY_PARSE].p99_ns / 1e3, (double)latency.stage[LATENCY_WRITE].p99_ns / 1e3,
+                       (double)latency.stage[LATENCY_HANDOFF].p99_ns / 1e6);
+            }
+
+            SubscriptionStats subscriptions;
+            subscription_stats(&subscriptions);
+            if (subscriptions.sends) {
+                printf("[INFO] Subscriptions: %llu sent (%llu frames, avg %.1f us, max %.1f us), "
+                       "first record avg %.1f ms (max %.1f ms) over %llu, %llu recompiled\n",
+                       (unsigned long long)subscriptions.sends, (unsigned long long)subscriptions.frames,
+                       (double)subscriptions.send_total_ns / subscriptions.sends / 1000.0,
+                       (double)subscriptions.send_max_ns / 1000.0,
+                       subscriptions.first_ticks ? (double)subscriptions.first_tick_total_ns / subscriptions.first_ticks / 1e6 : 0.0,
+                       (double)subscriptions.first_tick_max_ns / 1e6,
+                       (unsigned long long)subscriptions.first_ticks, (unsigned long long)subscriptions.rebuilds);
+            }
+            last_stats = now;
+        }
+    }
 
-    printf("[INFO] Cleaning up WebSocket context...\n");
-    flush_buffer_to_file("ticker_output_data.json", ticker_buffer);
-    flush_buffer_to_file("trades_output_data.json", trades_buffer);
+    if (stop_requested) printf("[INFO] Stop requested; writing out buffered data...\n");
+    printf("[INFO] Cleaning up WebSocket contexts...\n");
+    reconnect_shutdown();
+    ingest_stop();
+    latency_stats_close();
+    trade_dedup_close();
+    connection_table_save(CURRENCY_FILES_DIR);
+    subscription_cache_free();
+    flush_json_snapshots(1);
+    free_json_buffers();
+    bson_writer_close_all();
+    archive_writer_close_all();
+    segment_writer_close_all();
+    quote_book_close();
+    bar_engine_close();
+    order_book_close();
+    capture_close();
     fclose(ticker_data_file);
     fclose(trades_data_file);
-    lws_context_destroy(context);
 
     return 0;
 }
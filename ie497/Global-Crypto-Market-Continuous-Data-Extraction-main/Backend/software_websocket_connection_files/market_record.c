@@ -0,0 +1,269 @@
+/*
+ * Market Records
+ *
+ * This module implements the binary ticker/trade records: fixed-point number
+ * parsing and formatting, epoch-nanosecond timestamp parsing, and the FieldSpec
+ * parsers used by the exchange field tables. Symbols live in `symbol_table.c`.
+ *
+ * Features:
+ *  - Parses decimal and exponent notation into int64 fixed-point without atof.
+ *  - Keeps, per symbol, the widest price and quantity scale seen so far, and
+ *    rescales each record to it so values of one symbol share a scale.
+ *  - Parses epoch milliseconds, "seconds.fraction" and ISO 8601 timestamps to ns, and formats
+ *    them back, through the timestamp codec (`timestamp_codec.c`).
+ *
+ * Dependencies:
+ *  - timestamp_codec.h: Timestamp parsing and formatting.
+ *  - Standard C libraries (stdio, string, time).
+ *
+ * Usage:
+ *  - Parsers are referenced from `exchange_fields.c`; the rest is called from
+ *    `exchange_websocket.c` and `utils.c`, on the service and writer threads.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "market_record.h"
+#include "timestamp_codec.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static const char *exchange_names[EXCHANGE_COUNT] = {
+    "", "Binance", "Coinbase", "Kraken", "Bitfinex", "Huobi", "OKX"
+};
+
+static const int64_t pow10_table[FIXED_MAX_SCALE + 1] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL,
+    1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL,
+    100000000000000LL, 1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+    1000000000000000000LL
+};
+
+/* ------------------------------- Exchanges -------------------------------- */
+
+const char *exchange_name(uint16_t exchange_id) {
+    return (exchange_id < EXCHANGE_COUNT) ? exchange_names[exchange_id] : "";
+}
+
+/* ------------------------------ Fixed point ------------------------------- */
+
+int fixed_parse(const char *text, size_t len, Fixed *out) {
+    const char *p = text;
+    const char *end = text + len;
+    int negative = 0;
+
+    if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+
+    int64_t value = 0;
+    int scale = 0;
+    int seen_dot = 0;
+    int digits = 0;
+
+    for (; p < end; p++) {
+        char c = *p;
+        if (c >= '0' && c <= '9') {
+            digits++;
+            /* Fraction digits past the maximum scale or int64 range are truncated */
+            if (seen_dot && scale == FIXED_MAX_SCALE) continue;
+            if (value > (INT64_MAX - 9) / 10) {
+                if (seen_dot) continue;
+                return 0;
+            }
+            value = value * 10 + (c - '0');
+            if (seen_dot) scale++;
+        } else if (c == '.' && !seen_dot) {
+            seen_dot = 1;
+        } else {
+            break;
+        }
+    }
+    if (!digits) return 0;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        int exp_negative = 0;
+        if (p < end && (*p == '-' || *p == '+')) exp_negative = (*p++ == '-');
+        int exponent = 0;
+        if (p == end) return 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (exponent < 1000) exponent = exponent * 10 + (*p - '0');
+        }
+        scale += exp_negative ? exponent : -exponent;
+    }
+    if (p != end) return 0;
+
+    while (scale < 0) {
+        if (value > INT64_MAX / 10) return 0;
+        value *= 10;
+        scale++;
+    }
+    while (scale > FIXED_MAX_SCALE) {
+        value /= 10;
+        scale--;
+    }
+
+    out->value = negative ? -value : value;
+    out->scale = (int8_t)scale;
+    return 1;
+}
+
+size_t fixed_format(Fixed value, char *buf, size_t size) {
+    if (size == 0) return 0;
+    if (!FIXED_PRESENT(value)) {
+        buf[0] = '\0';
+        return 0;
+    }
+
+    uint64_t magnitude = (value.value < 0) ? (uint64_t)0 - (uint64_t)value.value : (uint64_t)value.value;
+    const char *sign = (value.value < 0) ? "-" : "";
+    int written;
+
+    if (value.scale == 0) {
+        written = snprintf(buf, size, "%s%llu", sign, (unsigned long long)magnitude);
+    } else {
+        uint64_t unit = (uint64_t)pow10_table[value.scale];
+        written = snprintf(buf, size, "%s%llu.%0*llu", sign,
+                           (unsigned long long)(magnitude / unit), value.scale,
+                           (unsigned long long)(magnitude % unit));
+    }
+    return (written < 0) ? 0 : (size_t)written;
+}
+
+int fixed_compare(Fixed a, Fixed b) {
+    __int128 left = a.value, right = b.value;
+    if (a.scale < b.scale) left *= pow10_table[b.scale - a.scale];
+    if (b.scale < a.scale) right *= pow10_table[a.scale - b.scale];
+    return (left > right) - (left < right);
+}
+
+Fixed fixed_add(Fixed a, Fixed b) {
+    if (!FIXED_PRESENT(a)) return b;
+    if (!FIXED_PRESENT(b)) return a;
+
+    int scale = a.scale > b.scale ? a.scale : b.scale;
+    __int128 sum = (__int128)a.value * pow10_table[scale - a.scale] + (__int128)b.value * pow10_table[scale - b.scale];
+    while ((sum > INT64_MAX || sum < INT64_MIN) && scale > 0) {
+        sum /= 10;
+        scale--;
+    }
+    if (sum > INT64_MAX) sum = INT64_MAX;
+    if (sum < INT64_MIN) sum = INT64_MIN;
+    return (Fixed){ (int64_t)sum, (int8_t)scale };
+}
+
+/* Bring a value up to the symbol's scale, widening the symbol scale if the value is finer.
+ * The scale is shared by every service thread that sees the symbol, so it only grows via CAS. */
+static void rescale(Fixed *f, int8_t *symbol_scale) {
+    if (!FIXED_PRESENT(*f)) return;
+
+    int8_t scale = __atomic_load_n(symbol_scale, __ATOMIC_RELAXED);
+    while (f->scale > scale &&
+           !__atomic_compare_exchange_n(symbol_scale, &scale, f->scale, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    if (f->scale > scale) scale = f->scale;
+
+    int shift = scale - f->scale;
+    int64_t magnitude = (f->value < 0) ? -f->value : f->value;
+    if (magnitude > INT64_MAX / pow10_table[shift]) return;   // keep its own scale
+
+    f->value *= pow10_table[shift];
+    f->scale = scale;
+}
+
+/* ------------------------------- Records ---------------------------------- */
+
+void ticker_init(TickerData *ticker, ExchangeId exchange) {
+    Fixed *values = &ticker->price;
+    size_t count = (sizeof(TickerData) - offsetof(TickerData, price)) / sizeof(Fixed);
+
+    ticker->ts_ns = 0;
+    ticker->exchange_id = exchange;
+    ticker->symbol_id = 0;
+    for (size_t i = 0; i < count; i++) values[i] = FIXED_ABSENT;
+}
+
+void trade_init(TradeData *trade, ExchangeId exchange) {
+    trade->ts_ns = 0;
+    trade->exchange_id = exchange;
+    trade->symbol_id = 0;
+    trade->market_maker = -1;
+    trade->price = FIXED_ABSENT;
+    trade->size = FIXED_ABSENT;
+    trade->trade_id = FIXED_ABSENT;
+}
+
+void ticker_finish(TickerData *ticker) {
+    if (!ticker->ts_ns) ticker->ts_ns = market_clock_ns();
+
+    SymbolScales *symbol = symbol_scales(ticker->symbol_id);
+    if (!symbol) return;
+    Fixed *prices[] = {
+        &ticker->price, &ticker->bid, &ticker->ask, &ticker->open_price, &ticker->high_price,
+        &ticker->low_price, &ticker->last_trade_price, &ticker->vwap_today, &ticker->vwap_24h,
+        &ticker->low_today, &ticker->high_today, &ticker->open_today
+    };
+    Fixed *quantities[] = {
+        &ticker->bid_qty, &ticker->ask_qty, &ticker->last_trade_size, &ticker->last_vol
+    };
+
+    for (size_t i = 0; i < sizeof(prices) / sizeof(prices[0]); i++)
+        rescale(prices[i], &symbol->price_scale);
+    for (size_t i = 0; i < sizeof(quantities) / sizeof(quantities[0]); i++)
+        rescale(quantities[i], &symbol->qty_scale);
+}
+
+void trade_finish(TradeData *trade) {
+    if (!trade->ts_ns) trade->ts_ns = market_clock_ns();
+    SymbolScales *symbol = symbol_scales(trade->symbol_id);
+    if (!symbol) return;
+
+    rescale(&trade->price, &symbol->price_scale);
+    rescale(&trade->size, &symbol->qty_scale);
+}
+
+/* ------------------------------ Timestamps -------------------------------- */
+
+int64_t market_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * TS_NS_PER_SECOND + ts.tv_nsec;
+}
+
+void format_timestamp_ns(int64_t ts_ns, int iso, char *buf, size_t size) {
+    ts_format(ts_ns, iso ? TS_FORMAT_ISO : TS_FORMAT_UTC, buf, size);
+}
+
+/* ------------------------------ FieldSpec parsers ------------------------- */
+
+int parse_fixed_field(const char *value, size_t len, void *dest) {
+    return fixed_parse(value, len, (Fixed *)dest);
+}
+
+int parse_bool_field(const char *value, size_t len, void *dest) {
+    int8_t *flag = (int8_t *)dest;
+    if (len == 4 && memcmp(value, "true", 4) == 0) *flag = 1;
+    else if (len == 5 && memcmp(value, "false", 5) == 0) *flag = 0;
+    else return 0;
+    return 1;
+}
+
+int parse_symbol_field(const char *value, size_t len, void *dest) {
+    uint16_t id = symbol_intern(value, len);
+    *(uint16_t *)dest = id;
+    return id != 0;
+}
+
+int parse_time_ms_field(const char *value, size_t len, void *dest) {
+    return ts_parse_epoch_ms(value, len, (int64_t *)dest);
+}
+
+int parse_time_seconds_field(const char *value, size_t len, void *dest) {
+    return ts_parse_epoch_seconds(value, len, (int64_t *)dest);
+}
+
+int parse_time_iso_field(const char *value, size_t len, void *dest) {
+    return ts_parse_iso(value, len, (int64_t *)dest);
+}
@@ -0,0 +1,156 @@
+/*
+ * Market Record Header
+ *
+ * Declares the binary ticker/trade records produced by the WebSocket parsers.
+ * Prices and quantities are int64 fixed-point values, timestamps are epoch
+ * nanoseconds, and exchanges/symbols are small interned IDs. Text is produced
+ * only at the output edge (JSON snapshots and BSON documents).
+ *
+ * Features:
+ *  - `Fixed`: int64 mantissa plus decimal scale; parsed without atof/strtod.
+ *  - `TickerData` / `TradeData`: compact records (~430 B / ~70 B instead of ~1.1 KB / ~290 B).
+ *  - Symbols are IDs from `symbol_table.h`, each with a price and quantity scale.
+ *  - FieldSpec parsers so extract_fields() writes binary values straight from the payload.
+ *  - Edge formatters for fixed-point values and timestamps.
+ *
+ * Dependencies:
+ *  - json_parser.h for FieldSpec, symbol_table.h for symbol IDs.
+ *  - Standard C libraries (stddef.h, stdint.h).
+ *
+ * Usage:
+ *  - Records are filled in `exchange_websocket.c`, formatted in `utils.c` and by the BSON writers.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef MARKET_RECORD_H
+#define MARKET_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "json_parser.h"
+#include "symbol_table.h"
+
+/* Largest decimal scale a fixed-point value may carry */
+#define FIXED_MAX_SCALE 18
+
+/* Buffer size large enough for any formatted Fixed value */
+#define FIXED_TEXT_SIZE 48
+
+/* Exchange IDs stored in records; names come from exchange_name() */
+typedef enum {
+    EXCHANGE_UNKNOWN = 0,
+    EXCHANGE_BINANCE,
+    EXCHANGE_COINBASE,
+    EXCHANGE_KRAKEN,
+    EXCHANGE_BITFINEX,
+    EXCHANGE_HUOBI,
+    EXCHANGE_OKX,
+    EXCHANGE_COUNT
+} ExchangeId;
+
+/* Decimal fixed-point value: value / 10^scale. A negative scale means "not present". */
+typedef struct {
+    int64_t value;
+    int8_t scale;
+} Fixed;
+
+#define FIXED_ABSENT ((Fixed){ 0, -1 })
+#define FIXED_PRESENT(f) ((f).scale >= 0)
+
+typedef struct {
+    int64_t ts_ns;              // event time, nanoseconds since the Unix epoch
+    uint16_t exchange_id;       // ExchangeId
+    uint16_t symbol_id;         // interned exchange symbol
+
+    Fixed price;
+    Fixed bid;
+    Fixed ask;
+    Fixed bid_qty;
+    Fixed ask_qty;
+
+    Fixed open_price;
+    Fixed high_price;
+    Fixed low_price;
+    Fixed close_price;
+
+    Fixed volume_24h;
+    Fixed volume_30d;
+    Fixed quote_volume;
+
+    Fixed last_trade_time;
+    Fixed last_trade_price;
+    Fixed last_trade_size;
+
+    Fixed trade_id;
+    Fixed sequence;
+
+    // Kraken-specific fields
+    Fixed bid_whole;
+    Fixed ask_whole;
+    Fixed last_vol;
+    Fixed vol_today;
+    Fixed vwap_today;
+    Fixed low_today;
+    Fixed vwap_24h;
+    Fixed high_today;
+    Fixed open_today;
+} TickerData;
+
+typedef struct {
+    int64_t ts_ns;              // trade time, nanoseconds since the Unix epoch
+    uint16_t exchange_id;       // ExchangeId
+    uint16_t symbol_id;         // interned exchange symbol
+    int8_t market_maker;        // 1 / 0, or -1 when the exchange does not say
+    Fixed price;
+    Fixed size;
+    Fixed trade_id;
+} TradeData;
+
+/* Initializes a record for an exchange: every value absent, no timestamp or symbol. */
+void ticker_init(TickerData *ticker, ExchangeId exchange);
+void trade_init(TradeData *trade, ExchangeId exchange);
+
+/* Fills a missing timestamp with the receive time and rescales prices/quantities to the symbol's scale. */
+void ticker_finish(TickerData *ticker);
+void trade_finish(TradeData *trade);
+
+/* Display name of an exchange ("Binance", "OKX", ...). */
+const char *exchange_name(uint16_t exchange_id);
+
+/* Parses a JSON number ("-12.50", "1.2e-5") into a Fixed. Returns 1 on success. */
+int fixed_parse(const char *text, size_t len, Fixed *out);
+
+/* Formats a Fixed with exactly `scale` decimals; absent values format as "". */
+size_t fixed_format(Fixed value, char *buf, size_t size);
+
+/* Exact comparison of two present values of any scales: <0, 0 or >0. */
+int fixed_compare(Fixed a, Fixed b);
+
+/* Sum at the wider scale (fewer decimals if that would overflow); an absent operand is ignored. */
+Fixed fixed_add(Fixed a, Fixed b);
+
+/* Current wall-clock time in nanoseconds since the Unix epoch. */
+int64_t market_clock_ns(void);
+
+/* Formats epoch ns as "YYYY-MM-DD HH:MM:SS.ffffff UTC" (iso = 0) or "YYYY-MM-DDTHH:MM:SS.ffffffZ" (iso = 1). */
+void format_timestamp_ns(int64_t ts_ns, int iso, char *buf, size_t size);
+
+/* FieldSpec parsers; each writes to the member named in the spec */
+int parse_fixed_field(const char *value, size_t len, void *dest);        // Fixed
+int parse_bool_field(const char *value, size_t len, void *dest);         // int8_t
+int parse_symbol_field(const char *value, size_t len, void *dest);       // uint16_t symbol ID
+int parse_time_ms_field(const char *value, size_t len, void *dest);      // int64_t ns from epoch ms
+int parse_time_seconds_field(const char *value, size_t len, void *dest); // int64_t ns from "sec.frac"
+int parse_time_iso_field(const char *value, size_t len, void *dest);     // int64_t ns from ISO 8601
+
+#define FIXED_FIELD(key, type, member, flags)        FIELD_PARSE_SPEC(key, type, member, flags, parse_fixed_field)
+#define BOOL_FIELD(key, type, member, flags)         FIELD_PARSE_SPEC(key, type, member, flags, parse_bool_field)
+#define SYMBOL_FIELD(key, type, member, flags)       FIELD_PARSE_SPEC(key, type, member, flags, parse_symbol_field)
+#define TIME_MS_FIELD(key, type, member, flags)      FIELD_PARSE_SPEC(key, type, member, flags, parse_time_ms_field)
+#define TIME_SECONDS_FIELD(key, type, member, flags) FIELD_PARSE_SPEC(key, type, member, flags, parse_time_seconds_field)
+#define TIME_ISO_FIELD(key, type, member, flags)     FIELD_PARSE_SPEC(key, type, member, flags, parse_time_iso_field)
+
+#endif // MARKET_RECORD_H
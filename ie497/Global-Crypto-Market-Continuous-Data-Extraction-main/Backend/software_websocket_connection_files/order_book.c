@@ -0,0 +1,857 @@
+/*
+ * Order Book
+ *
+ * This module keeps a local level-2 book per (exchange, symbol) for the
+ * symbols given with `--book-symbols`, from the depth messages parsed in
+ * `exchange_websocket.c`, and writes compact periodic snapshots of them.
+ *
+ * Each side is a pair of contiguous arrays (price key, quantity) sorted with
+ * the best level last. Almost every update lands within a few levels of the
+ * top, so a short backwards scan finds it and inserting or removing it moves
+ * only the handful of levels above; deeper levels fall back to a binary search.
+ * Prices and quantities are integers at one decimal scale per book.
+ *
+ * Sequencing:
+ *  - Binance: Diffs are buffered until a REST snapshot (fetched on a background thread)
+ *    arrives, then replayed from the first diff that bridges it; afterwards every diff
+ *    must start right after the previous one.
+ *  - OKX: Every update's prevSeqId must be the seqId of the one before.
+ *  - Kraken: The CRC32 of the top levels must match the checksum of each update; the
+ *    book is truncated to the subscribed depth as Kraken expects.
+ *  - Coinbase: level2_batch has no sequence numbers; the snapshot starts the book.
+ *  A book that loses sync is cleared and ignored until a new snapshot arrives: Binance
+ *  fetches one, OKX and Kraken resubscribe the symbol (at most every BOOK_RESYNC_SECONDS).
+ *
+ * Features:
+ *  - One mutex per book; updates come from the symbol's service thread, and only the
+ *    housekeeping snapshot writer and the Binance fetcher ever wait on it.
+ *  - Snapshots of the top BOOK_SNAPSHOT_DEPTH levels per side, written only for books
+ *    that changed, to one `<Exchange>_book_YYYYMMDD.obk` file per exchange and UTC day.
+ *
+ * Dependencies:
+ *  - book_file.c: Snapshot file format.
+ *  - json_scan.c / market_record.c / symbol_table.c: Level parsing, Fixed values, symbol names.
+ *  - libcurl: Binance REST snapshots. zlib: Kraken checksums. pthread.
+ *
+ * Usage:
+ *  - Enabled from `main.c` (`--books DIR [--book-symbols LIST]`).
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "order_book.h"
+#include "book_file.h"
+#include "symbol_table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <curl/curl.h>
+
+#define NS_PER_SECOND 1000000000LL
+#define SECONDS_PER_DAY 86400
+
+/* Books that can exist at once: every exchange symbol that normalizes to a listed symbol */
+#define BOOK_MAX_BOOKS (EXCHANGE_COUNT * BOOK_MAX_SYMBOLS * 2)
+
+/* Levels scanned from the top of a side before falling back to a binary search */
+#define BOOK_SEARCH_TOP 8
+
+/* Initial level capacity of a side; grows by doubling up to BOOK_MAX_LEVELS */
+#define BOOK_INITIAL_LEVELS 64
+
+/* stdio buffer per open snapshot file */
+#define BOOK_FILE_BUFFER_SIZE (256 * 1024)
+
+#define BOOK_FETCH_TIMEOUT 10
+
+enum { BOOK_AWAITING_SNAPSHOT = 0, BOOK_LIVE = 1 };
+enum { SIDE_BID = 0, SIDE_ASK = 1 };
+
+/* Levels sorted ascending by key with the best level last; the key is the price for bids
+ * and minus the price for asks */
+typedef struct {
+    int64_t *key;
+    int64_t *qty;
+    int count;
+    int capacity;
+} BookSide;
+
+/* A Binance diff level waiting for the REST snapshot */
+typedef struct {
+    uint64_t first_seq;
+    uint64_t last_seq;
+    int64_t ts_ns;
+    uint8_t side;
+    BookLevel level;
+} PendingLevel;
+
+typedef struct {
+    pthread_mutex_t lock;
+    uint16_t exchange_id;
+    uint16_t symbol_id;
+    int state;
+    int8_t price_scale;         // -1 until the first level
+    int8_t qty_scale;
+    uint64_t seq;               // last applied exchange sequence number
+    int64_t ts_ns;              // exchange time of the last applied message
+    uint64_t version;           // applied messages, for skipping unchanged books
+    time_t last_resync;
+    BookSide sides[2];
+    PendingLevel *pending;
+    int pending_count;
+    int pending_capacity;
+    int fetch_queued;
+
+    /* Snapshot writer only */
+    uint64_t written_version;
+    uint32_t file_generation;   // BookFile.generation the dictionary entry was written to
+    uint16_t file_symbol;
+    int64_t file_best[2];
+} Book;
+
+/* One open snapshot file per exchange */
+typedef struct {
+    FILE *fp;
+    char *buffer;
+    long day;
+    uint32_t generation;        // bumped on every open, so books rewrite their dictionary entry
+    uint16_t next_file_symbol;
+} BookFile;
+
+static Book **books[EXCHANGE_COUNT];        // indexed by symbol ID
+static Book *book_list[BOOK_MAX_BOOKS];
+static int book_count = 0;
+static uint8_t wanted[MAX_SYMBOLS];         // indexed by canonical symbol ID
+static BookFile files[EXCHANGE_COUNT];
+static char book_dir[256];
+static int book_enabled = 0;
+static int64_t last_flush_ns = 0;
+static BookStats stats;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Binance snapshot fetcher */
+static pthread_t fetch_thread;
+static pthread_mutex_t fetch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t fetch_cond = PTHREAD_COND_INITIALIZER;
+static Book *fetch_queue[BOOK_MAX_BOOKS];
+static int fetch_head = 0, fetch_count = 0;
+static int fetch_stop = 0;
+static int fetch_running = 0;
+
+/* Snapshot writer scratch (housekeeping thread only) */
+static int64_t snapshot_price[2][BOOK_SNAPSHOT_DEPTH];
+static int64_t snapshot_qty[2][BOOK_SNAPSHOT_DEPTH];
+static uint8_t snapshot_data[BOOK_ENCODED_MAX(2 * BOOK_SNAPSHOT_DEPTH)];
+
+static void *fetch_main(void *arg);
+
+/* --------------------------------- Setup ---------------------------------- */
+
+int order_book_open(const char *dir, const char *symbols) {
+    const char *list = symbols ? symbols : BOOK_DEFAULT_SYMBOLS;
+    int listed = 0;
+    for (const char *p = list; *p;) {
+        const char *end = strchr(p, ',');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len > 0) {
+            if (listed == BOOK_MAX_SYMBOLS) {
+                printf("[ERROR] At most %d book symbols are supported\n", BOOK_MAX_SYMBOLS);
+                return -1;
+            }
+            uint16_t canonical = symbol_canonical_id(symbol_intern(p, len));
+            if (!canonical) return -1;
+            wanted[canonical] = 1;
+            listed++;
+        }
+        p = end ? end + 1 : p + len;
+    }
+    if (listed == 0) {
+        printf("[ERROR] No book symbols given\n");
+        return -1;
+    }
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        printf("[ERROR] Could not create book directory %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+    for (int i = 0; i < EXCHANGE_COUNT; i++) {
+        books[i] = calloc(MAX_SYMBOLS, sizeof(Book *));
+        if (!books[i]) {
+            printf("[ERROR] Failed to allocate book index\n");
+            return -1;
+        }
+        files[i].day = -1;
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    if (pthread_create(&fetch_thread, NULL, fetch_main, NULL) != 0) {
+        printf("[ERROR] Failed to start the book snapshot fetcher\n");
+        return -1;
+    }
+    fetch_running = 1;
+
+    snprintf(book_dir, sizeof(book_dir), "%s", dir);
+    book_enabled = 1;
+    printf("[INFO] Keeping order books for %s, snapshots every %d ms to %s/\n", list,
+           BOOK_SNAPSHOT_INTERVAL_MS, book_dir);
+    return 0;
+}
+
+int order_book_enabled(void) {
+    return book_enabled;
+}
+
+int order_book_wants(uint16_t symbol_id) {
+    return book_enabled && wanted[symbol_canonical_id(symbol_id)];
+}
+
+int order_book_parse_levels(const JsonIndex *ix, size_t node, int first_field, BookLevel *levels, int capacity) {
+    static const char *fields[] = { "/0", "/1", "/2", "/3" };
+    int count = 0;
+    if (node == JSON_INDEX_NONE || first_field < 0 || first_field > 2) return 0;
+
+    for (size_t level = json_index_child(ix, node); level != JSON_INDEX_NONE && count < capacity;
+         level = json_index_sibling(ix, level)) {
+        const char *text;
+        size_t len;
+        BookLevel *out = &levels[count];
+        if (!json_index_lookup(ix, level, fields[first_field], &text, &len) || !fixed_parse(text, len, &out->price))
+            continue;
+        if (!json_index_lookup(ix, level, fields[first_field + 1], &text, &len) || !fixed_parse(text, len, &out->qty))
+            continue;
+        count++;
+    }
+    return count;
+}
+
+/* Book of an exchange symbol, created on first use */
+static Book *book_get(uint16_t exchange_id, uint16_t symbol_id) {
+    Book *book = __atomic_load_n(&books[exchange_id][symbol_id], __ATOMIC_ACQUIRE);
+    if (book) return book;
+
+    pthread_mutex_lock(&registry_lock);
+    book = books[exchange_id][symbol_id];
+    if (!book && book_count < BOOK_MAX_BOOKS && (book = calloc(1, sizeof(Book))) != NULL) {
+        pthread_mutex_init(&book->lock, NULL);
+        book->exchange_id = exchange_id;
+        book->symbol_id = symbol_id;
+        book->price_scale = book->qty_scale = -1;
+        book_list[book_count] = book;
+        __atomic_store_n(&book_count, book_count + 1, __ATOMIC_RELEASE);
+        __atomic_store_n(&books[exchange_id][symbol_id], book, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return book;
+}
+
+/* ---------------------------------- Sides --------------------------------- */
+
+/* Index of the first level whose key is >= `key` */
+static int side_find(const BookSide *side, int64_t key) {
+    int stop = side->count > BOOK_SEARCH_TOP ? side->count - BOOK_SEARCH_TOP : 0;
+    int i = side->count;
+    while (i > stop && side->key[i - 1] >= key) i--;
+    if (i > stop || i == 0) return i;
+
+    int lo = 0, hi = stop;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (side->key[mid] < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static int side_grow(BookSide *side) {
+    int capacity = side->capacity ? side->capacity * 2 : BOOK_INITIAL_LEVELS;
+    if (capacity > BOOK_MAX_LEVELS) capacity = BOOK_MAX_LEVELS;
+
+    int64_t *key = realloc(side->key, (size_t)capacity * sizeof(int64_t));
+    if (!key) return -1;
+    side->key = key;
+    int64_t *qty = realloc(side->qty, (size_t)capacity * sizeof(int64_t));
+    if (!qty) return -1;
+    side->qty = qty;
+    side->capacity = capacity;
+    return 0;
+}
+
+/* Removes the `count` worst levels */
+static void side_drop_worst(BookSide *side, int count) {
+    memmove(side->key, side->key + count, (size_t)(side->count - count) * sizeof(int64_t));
+    memmove(side->qty, side->qty + count, (size_t)(side->count - count) * sizeof(int64_t));
+    side->count -= count;
+}
+
+static void side_set(BookSide *side, int64_t key, int64_t qty) {
+    int i = side_find(side, key);
+    if (i < side->count && side->key[i] == key) {
+        if (qty != 0) {
+            side->qty[i] = qty;
+            return;
+        }
+        memmove(side->key + i, side->key + i + 1, (size_t)(side->count - i - 1) * sizeof(int64_t));
+        memmove(side->qty + i, side->qty + i + 1, (size_t)(side->count - i - 1) * sizeof(int64_t));
+        side->count--;
+        return;
+    }
+    if (qty == 0) return;
+
+    if (side->count == side->capacity && side->capacity < BOOK_MAX_LEVELS && side_grow(side) != 0) return;
+    if (side->count == side->capacity) {
+        if (i == 0) return;             // worse than every level kept
+        side_drop_worst(side, 1);
+        i--;
+    }
+
+    memmove(side->key + i + 1, side->key + i, (size_t)(side->count - i) * sizeof(int64_t));
+    memmove(side->qty + i + 1, side->qty + i, (size_t)(side->count - i) * sizeof(int64_t));
+    side->key[i] = key;
+    side->qty[i] = qty;
+    side->count++;
+}
+
+/* ---------------------------------- Books --------------------------------- */
+
+static int multiply_checked(int64_t value, int64_t factor, int64_t *out) {
+    if (value > INT64_MAX / factor || value < -(INT64_MAX / factor)) return -1;
+    *out = value * factor;
+    return 0;
+}
+
+/* Moves every price (or quantity) of the book to a finer scale. Returns 0, or -1 on overflow. */
+static int book_widen(Book *book, int qty, int8_t scale) {
+    int8_t *current = qty ? &book->qty_scale : &book->price_scale;
+    if (*current < 0) {
+        *current = scale;
+        return 0;
+    }
+
+    int64_t factor = 1;
+    for (int i = *current; i < scale; i++) factor *= 10;
+    for (int s = 0; s < 2; s++) {
+        const BookSide *side = &book->sides[s];
+        const int64_t *values = qty ? side->qty : side->key;
+        for (int i = 0; i < side->count; i++) {
+            int64_t ignored;
+            if (multiply_checked(values[i], factor, &ignored) != 0) return -1;
+        }
+    }
+    for (int s = 0; s < 2; s++) {
+        BookSide *side = &book->sides[s];
+        int64_t *values = qty ? side->qty : side->key;
+        for (int i = 0; i < side->count; i++) values[i] *= factor;
+    }
+    *current = scale;
+    return 0;
+}
+
+/* A level's value as an integer at the book's scale. Returns 0, or -1 if it cannot be represented. */
+static int book_units(Book *book, Fixed value, int qty, int64_t *out) {
+    if (!FIXED_PRESENT(value) || value.scale > FIXED_MAX_SCALE) return -1;
+    int8_t scale = qty ? book->qty_scale : book->price_scale;
+    if (value.scale > scale) {
+        if (book_widen(book, qty, value.scale) != 0) return -1;
+        scale = value.scale;
+    }
+
+    int64_t factor = 1;
+    for (int i = value.scale; i < scale; i++) factor *= 10;
+    return multiply_checked(value.value, factor, out);
+}
+
+static void book_set(Book *book, int side, const BookLevel *level) {
+    int64_t price, qty;
+    if (book_units(book, level->price, 0, &price) != 0 || book_units(book, level->qty, 1, &qty) != 0) return;
+    if (qty < 0) return;
+    side_set(&book->sides[side], side == SIDE_ASK ? -price : price, qty);
+}
+
+static void book_clear(Book *book) {
+    book->sides[SIDE_BID].count = book->sides[SIDE_ASK].count = 0;
+    book->price_scale = book->qty_scale = -1;
+    book->seq = 0;
+    book->state = BOOK_AWAITING_SNAPSHOT;
+}
+
+static void apply_levels(Book *book, const BookMessage *message, int64_t ts_ns) {
+    for (int i = 0; i < message->bid_count; i++) book_set(book, SIDE_BID, &message->bids[i]);
+    for (int i = 0; i < message->ask_count; i++) book_set(book, SIDE_ASK, &message->asks[i]);
+    __atomic_add_fetch(&stats.levels, (uint64_t)(message->bid_count + message->ask_count), __ATOMIC_RELAXED);
+    book->ts_ns = ts_ns;
+    book->version++;
+}
+
+/* Replaces the book; snapshot levels come best first, so they are inserted worst first */
+static void apply_snapshot(Book *book, const BookLevel *bids, int bid_count, const BookLevel *asks, int ask_count,
+                           uint64_t seq, int64_t ts_ns) {
+    book_clear(book);
+    for (int i = bid_count - 1; i >= 0; i--) book_set(book, SIDE_BID, &bids[i]);
+    for (int i = ask_count - 1; i >= 0; i--) book_set(book, SIDE_ASK, &asks[i]);
+    __atomic_add_fetch(&stats.levels, (uint64_t)(bid_count + ask_count), __ATOMIC_RELAXED);
+    book->seq = seq;
+    book->ts_ns = ts_ns;
+    book->state = BOOK_LIVE;
+    book->version++;
+}
+
+static void lose_sync(Book *book) {
+    book_clear(book);
+    book->pending_count = 0;
+    __atomic_add_fetch(&stats.resyncs, 1, __ATOMIC_RELAXED);
+}
+
+/* Whether a resync may start now; at most one per BOOK_RESYNC_SECONDS per book */
+static int resync_due(Book *book) {
+    time_t now = time(NULL);
+    if (now - book->last_resync < BOOK_RESYNC_SECONDS) return 0;
+    book->last_resync = now;
+    return 1;
+}
+
+/* Kraken's checksum: CRC32 of the top asks then bids, each price and quantity written
+ * without the decimal point and leading zeros */
+static uint32_t kraken_checksum(const Book *book) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+    const int order[] = { SIDE_ASK, SIDE_BID };
+    for (int o = 0; o < 2; o++) {
+        const BookSide *side = &book->sides[order[o]];
+        for (int j = 0; j < BOOK_KRAKEN_CHECKSUM_LEVELS && j < side->count; j++) {
+            int i = side->count - 1 - j;
+            Fixed values[2] = {
+                { order[o] == SIDE_ASK ? -side->key[i] : side->key[i], book->price_scale },
+                { side->qty[i], book->qty_scale },
+            };
+            for (int v = 0; v < 2; v++) {
+                char text[FIXED_TEXT_SIZE], digits[FIXED_TEXT_SIZE];
+                size_t len = fixed_format(values[v], text, sizeof(text)), n = 0;
+                for (size_t c = 0; c < len; c++) {
+                    if (text[c] == '.' || (n == 0 && text[c] == '0')) continue;
+                    digits[n++] = text[c];
+                }
+                crc = crc32(crc, (const Bytef *)digits, (uInt)n);
+            }
+        }
+    }
+    return (uint32_t)crc;
+}
+
+/* ------------------------------ Binance sync ------------------------------ */
+
+static void queue_fetch(Book *book) {
+    pthread_mutex_lock(&fetch_lock);
+    if (fetch_count < BOOK_MAX_BOOKS) {
+        fetch_queue[(fetch_head + fetch_count) % BOOK_MAX_BOOKS] = book;
+        fetch_count++;
+        book->fetch_queued = 1;
+        pthread_cond_signal(&fetch_cond);
+    }
+    pthread_mutex_unlock(&fetch_lock);
+}
+
+static void buffer_levels(Book *book, const BookMessage *message, int64_t ts_ns) {
+    int needed = message->bid_count + message->ask_count;
+    if (book->pending_count + needed > BOOK_PENDING_LEVELS) {
+        book->pending_count = 0;        // the snapshot will show the gap and be fetched again
+        if (needed > BOOK_PENDING_LEVELS) return;
+    }
+    if (book->pending_count + needed > book->pending_capacity) {
+        int capacity = book->pending_capacity ? book->pending_capacity : 1024;
+        while (capacity < book->pending_count + needed) capacity *= 2;
+        PendingLevel *pending = realloc(book->pending, (size_t)capacity * sizeof(PendingLevel));
+        if (!pending) return;
+        book->pending = pending;
+        book->pending_capacity = capacity;
+    }
+
+    for (int s = 0; s < 2; s++) {
+        const BookLevel *levels = s == SIDE_BID ? message->bids : message->asks;
+        int count = s == SIDE_BID ? message->bid_count : message->ask_count;
+        for (int i = 0; i < count; i++) {
+            PendingLevel *p = &book->pending[book->pending_count++];
+            p->first_seq = message->first_seq;
+            p->last_seq = message->last_seq;
+            p->ts_ns = ts_ns;
+            p->side = (uint8_t)s;
+            p->level = levels[i];
+        }
+    }
+}
+
+static void binance_update(Book *book, const BookMessage *message, int64_t ts_ns) {
+    if (book->state == BOOK_LIVE) {
+        if (message->last_seq <= book->seq) return;         // already in the book
+        if (message->first_seq <= book->seq + 1) {
+            apply_levels(book, message, ts_ns);
+            book->seq = message->last_seq;
+            return;
+        }
+        lose_sync(book);
+    }
+
+    buffer_levels(book, message, ts_ns);
+    if (!book->fetch_queued && resync_due(book)) queue_fetch(book);
+}
+
+/* Applies a REST snapshot and replays the buffered diffs newer than it (under the book lock) */
+static void binance_snapshot(Book *book, const BookLevel *bids, int bid_count, const BookLevel *asks, int ask_count,
+                             uint64_t last_update_id) {
+    apply_snapshot(book, bids, bid_count, asks, ask_count, last_update_id, market_clock_ns());
+
+    uint64_t first = 0, last = 0;
+    for (int i = 0; i < book->pending_count; i++) {
+        const PendingLevel *p = &book->pending[i];
+        if (p->last_seq <= last_update_id) continue;
+        if (p->first_seq != first || p->last_seq != last) {
+            if (p->first_seq > book->seq + 1) {
+                lose_sync(book);        // the snapshot is older than the first diff kept
+                return;
+            }
+            first = p->first_seq;
+            last = p->last_seq;
+            book->seq = last;
+            book->ts_ns = p->ts_ns;
+        }
+        book_set(book, p->side, &p->level);
+    }
+    book->pending_count = 0;
+}
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+} FetchBody;
+
+static size_t fetch_append(void *data, size_t size, size_t count, void *context) {
+    FetchBody *body = context;
+    size_t len = size * count;
+    if (body->len + len + 1 > body->capacity) {
+        size_t capacity = body->capacity ? body->capacity : 64 * 1024;
+        while (body->len + len + 1 > capacity) capacity *= 2;
+        char *grown = realloc(body->data, capacity);
+        if (!grown) return 0;
+        body->data = grown;
+        body->capacity = capacity;
+    }
+    memcpy(body->data + body->len, data, len);
+    body->len += len;
+    body->data[body->len] = '\0';
+    return len;
+}
+
+static BookLevel fetch_bids[BOOK_MAX_LEVELS];
+static BookLevel fetch_asks[BOOK_MAX_LEVELS];
+
+static void fetch_snapshot(CURL *curl, FetchBody *body, Book *book) {
+    char url[256];
+    snprintf(url, sizeof(url), "%s%s", BOOK_BINANCE_DEPTH_URL, symbol_name(book->symbol_id));
+    body->len = 0;
+
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    CURLcode result = curl_easy_perform(curl);
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+    int applied = 0;
+    if (result != CURLE_OK || status != 200 || body->len == 0) {
+        printf("[WARNING] Binance depth snapshot for %s failed: %s (HTTP %ld)\n", symbol_name(book->symbol_id),
+               result != CURLE_OK ? curl_easy_strerror(result) : "bad response", status);
+    } else {
+        uint32_t *positions = malloc(body->len * sizeof(uint32_t));
+        JsonIndex ix;
+        const char *text;
+        size_t len;
+        if (positions && json_index_build(&ix, body->data, body->len, positions, body->len) == 0 &&
+            json_index_lookup(&ix, JSON_INDEX_NONE, "/lastUpdateId", &text, &len)) {
+            uint64_t last_update_id = strtoull(text, NULL, 10);
+            int bid_count = order_book_parse_levels(&ix, json_index_node(&ix, JSON_INDEX_NONE, "/bids"), 0,
+                                                    fetch_bids, BOOK_MAX_LEVELS);
+            int ask_count = order_book_parse_levels(&ix, json_index_node(&ix, JSON_INDEX_NONE, "/asks"), 0,
+                                                    fetch_asks, BOOK_MAX_LEVELS);
+
+            pthread_mutex_lock(&book->lock);
+            binance_snapshot(book, fetch_bids, bid_count, fetch_asks, ask_count, last_update_id);
+            book->fetch_queued = 0;
+            pthread_mutex_unlock(&book->lock);
+            applied = 1;
+        }
+        free(positions);
+    }
+
+    if (!applied) {
+        pthread_mutex_lock(&book->lock);
+        book->fetch_queued = 0;         // the next diff asks again once a resync is due
+        pthread_mutex_unlock(&book->lock);
+    }
+}
+
+static void *fetch_main(void *arg) {
+    (void)arg;
+    CURL *curl = curl_easy_init();
+    FetchBody body = {0};
+    if (curl) {
+        curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, fetch_append);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&body);
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, (long)BOOK_FETCH_TIMEOUT);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&fetch_lock);
+        while (!fetch_stop && fetch_count == 0) pthread_cond_wait(&fetch_cond, &fetch_lock);
+        if (fetch_stop) {
+            pthread_mutex_unlock(&fetch_lock);
+            break;
+        }
+        Book *book = fetch_queue[fetch_head];
+        fetch_head = (fetch_head + 1) % BOOK_MAX_BOOKS;
+        fetch_count--;
+        pthread_mutex_unlock(&fetch_lock);
+
+        if (curl) fetch_snapshot(curl, &body, book);
+        usleep(BOOK_FETCH_SPACING_MS * 1000);
+    }
+
+    free(body.data);
+    if (curl) curl_easy_cleanup(curl);
+    return NULL;
+}
+
+/* --------------------------------- Updates -------------------------------- */
+
+int order_book_apply(const BookMessage *message) {
+    if (!book_enabled || message->exchange_id >= EXCHANGE_COUNT || !order_book_wants(message->symbol_id)) return 0;
+    Book *book = book_get(message->exchange_id, message->symbol_id);
+    if (!book) return 0;
+
+    int64_t ts_ns = message->ts_ns ? message->ts_ns : market_clock_ns();
+    int resubscribe = 0;
+    __atomic_add_fetch(&stats.messages, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&book->lock);
+    if (message->exchange_id == EXCHANGE_BINANCE) {
+        binance_update(book, message, ts_ns);
+    } else if (message->snapshot) {
+        apply_snapshot(book, message->bids, message->bid_count, message->asks, message->ask_count,
+                       message->last_seq, ts_ns);
+    } else if (book->state != BOOK_LIVE) {
+        resubscribe = resync_due(book);     // updates without a snapshot to build on
+    } else if (message->exchange_id == EXCHANGE_OKX && message->prev_seq != book->seq) {
+        lose_sync(book);
+        resubscribe = resync_due(book);
+    } else {
+        apply_levels(book, message, ts_ns);
+        book->seq = message->last_seq;
+
+        if (message->exchange_id == EXCHANGE_KRAKEN) {
+            for (int s = 0; s < 2; s++) {
+                BookSide *side = &book->sides[s];
+                if (side->count > BOOK_KRAKEN_DEPTH) side_drop_worst(side, side->count - BOOK_KRAKEN_DEPTH);
+            }
+            if (message->has_checksum && kraken_checksum(book) != message->checksum) {
+                lose_sync(book);
+                resubscribe = resync_due(book);
+            }
+        }
+    }
+    pthread_mutex_unlock(&book->lock);
+    return resubscribe;
+}
+
+/* -------------------------------- Snapshots ------------------------------- */
+
+static int write_all(BookFile *file, const void *data, size_t len) {
+    if (fwrite(data, 1, len, file->fp) != len) return -1;
+    __atomic_add_fetch(&stats.bytes, len, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/* Snapshot file of an exchange for the day of `ts_ns`, opened on demand */
+static BookFile *book_file(uint16_t exchange_id, int64_t ts_ns) {
+    BookFile *file = &files[exchange_id];
+    long day = (long)(ts_ns / NS_PER_SECOND / SECONDS_PER_DAY);
+    if (file->fp && file->day == day) return file;
+
+    if (file->fp) {
+        fclose(file->fp);
+        file->fp = NULL;
+    }
+
+    time_t day_start = (time_t)day * SECONDS_PER_DAY;
+    struct tm tm_info;
+    gmtime_r(&day_start, &tm_info);
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s_book_%04d%02d%02d.obk", book_dir, exchange_name(exchange_id),
+             tm_info.tm_year + 1900, tm_info.tm_mon + 1, tm_info.tm_mday);
+
+    file->fp = fopen(path, "ab");
+    if (!file->fp) {
+        printf("[ERROR] Could not open book file %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    if (!file->buffer) file->buffer = malloc(BOOK_FILE_BUFFER_SIZE);
+    if (file->buffer) setvbuf(file->fp, file->buffer, _IOFBF, BOOK_FILE_BUFFER_SIZE);
+    file->day = day;
+    file->generation++;
+    file->next_file_symbol = 0;
+
+    if (fseeko(file->fp, 0, SEEK_END) == 0 && ftello(file->fp) == 0) {
+        BookFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, BOOK_FILE_MAGIC, BOOK_FILE_MAGIC_LENGTH);
+        header.exchange_id = exchange_id;
+        header.version = BOOK_FILE_VERSION;
+        strncpy(header.exchange, exchange_name(exchange_id), sizeof(header.exchange) - 1);
+        if (write_all(file, &header, sizeof(header)) != 0) {
+            fclose(file->fp);
+            file->fp = NULL;
+            return NULL;
+        }
+    }
+    return file;
+}
+
+static void write_snapshot(Book *book, int64_t ts_ns, uint64_t seq, int8_t price_scale, int8_t qty_scale,
+                           const int counts[2]) {
+    BookFile *file = book_file(book->exchange_id, ts_ns);
+    if (!file) return;
+
+    if (book->file_generation != file->generation) {
+        const char *name = symbol_name(book->symbol_id);
+        BookDictEntry entry = { BOOK_DICT_MAGIC, file->next_file_symbol, (uint8_t)strnlen(name, BOOK_FILE_MAX_NAME), 0 };
+        if (write_all(file, &entry, sizeof(entry)) != 0 || write_all(file, name, entry.name_len) != 0) goto failed;
+        book->file_symbol = file->next_file_symbol++;
+        book->file_generation = file->generation;
+        book->file_best[0] = book->file_best[1] = 0;
+    }
+
+    size_t len = book_encode_levels(snapshot_data, snapshot_price[SIDE_BID], snapshot_qty[SIDE_BID],
+                                    counts[SIDE_BID], 0, &book->file_best[SIDE_BID]);
+    len += book_encode_levels(snapshot_data + len, snapshot_price[SIDE_ASK], snapshot_qty[SIDE_ASK],
+                              counts[SIDE_ASK], 1, &book->file_best[SIDE_ASK]);
+
+    BookSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = BOOK_SNAPSHOT_MAGIC;
+    header.symbol = book->file_symbol;
+    header.price_scale = price_scale;
+    header.qty_scale = qty_scale;
+    header.ts_ns = ts_ns;
+    header.sequence = seq;
+    header.bid_count = (uint16_t)counts[SIDE_BID];
+    header.ask_count = (uint16_t)counts[SIDE_ASK];
+    header.data_len = (uint32_t)len;
+    if (write_all(file, &header, sizeof(header)) != 0 || write_all(file, snapshot_data, len) != 0) goto failed;
+
+    __atomic_add_fetch(&stats.snapshots, 1, __ATOMIC_RELAXED);
+    return;
+
+failed:
+    printf("[ERROR] Failed to write %s book file: %s\n", exchange_name(book->exchange_id), strerror(errno));
+    fclose(file->fp);
+    file->fp = NULL;
+}
+
+void order_book_flush(int force) {
+    if (!book_enabled) return;
+
+    int64_t now_ns = market_clock_ns();
+    if (!force && now_ns - last_flush_ns < (int64_t)BOOK_SNAPSHOT_INTERVAL_MS * 1000000LL) return;
+    last_flush_ns = now_ns;
+
+    int count = __atomic_load_n(&book_count, __ATOMIC_ACQUIRE);
+    for (int b = 0; b < count; b++) {
+        Book *book = book_list[b];
+
+        pthread_mutex_lock(&book->lock);
+        if (book->state != BOOK_LIVE || book->version == book->written_version) {
+            pthread_mutex_unlock(&book->lock);
+            continue;
+        }
+        int counts[2];
+        for (int s = 0; s < 2; s++) {
+            const BookSide *side = &book->sides[s];
+            counts[s] = side->count < BOOK_SNAPSHOT_DEPTH ? side->count : BOOK_SNAPSHOT_DEPTH;
+            for (int j = 0; j < counts[s]; j++) {
+                int i = side->count - 1 - j;
+                snapshot_price[s][j] = s == SIDE_ASK ? -side->key[i] : side->key[i];
+                snapshot_qty[s][j] = side->qty[i];
+            }
+        }
+        int64_t ts_ns = book->ts_ns;
+        uint64_t seq = book->seq;
+        int8_t price_scale = book->price_scale, qty_scale = book->qty_scale;
+        book->written_version = book->version;
+        pthread_mutex_unlock(&book->lock);
+
+        write_snapshot(book, ts_ns, seq, price_scale, qty_scale, counts);
+    }
+
+    for (int i = 0; i < EXCHANGE_COUNT; i++) {
+        if (files[i].fp) fflush(files[i].fp);
+    }
+}
+
+void order_book_close(void) {
+    if (!book_enabled) return;
+
+    if (fetch_running) {
+        pthread_mutex_lock(&fetch_lock);
+        fetch_stop = 1;
+        pthread_cond_signal(&fetch_cond);
+        pthread_mutex_unlock(&fetch_lock);
+        pthread_join(fetch_thread, NULL);
+        fetch_running = 0;
+    }
+
+    order_book_flush(1);
+    book_enabled = 0;
+
+    for (int i = 0; i < EXCHANGE_COUNT; i++) {
+        if (files[i].fp) fclose(files[i].fp);
+        free(files[i].buffer);
+        memset(&files[i], 0, sizeof(files[i]));
+        free(books[i]);
+        books[i] = NULL;
+    }
+    for (int b = 0; b < book_count; b++) {
+        Book *book = book_list[b];
+        free(book->sides[SIDE_BID].key);
+        free(book->sides[SIDE_BID].qty);
+        free(book->sides[SIDE_ASK].key);
+        free(book->sides[SIDE_ASK].qty);
+        free(book->pending);
+        pthread_mutex_destroy(&book->lock);
+        free(book);
+        book_list[b] = NULL;
+    }
+    book_count = 0;
+    curl_global_cleanup();
+}
+
+void order_book_stats(BookStats *out) {
+    out->messages = __atomic_load_n(&stats.messages, __ATOMIC_RELAXED);
+    out->levels = __atomic_load_n(&stats.levels, __ATOMIC_RELAXED);
+    out->resyncs = __atomic_load_n(&stats.resyncs, __ATOMIC_RELAXED);
+    out->snapshots = __atomic_load_n(&stats.snapshots, __ATOMIC_RELAXED);
+    out->bytes = __atomic_load_n(&stats.bytes, __ATOMIC_RELAXED);
+    out->books = 0;
+
+    int count = __atomic_load_n(&book_count, __ATOMIC_ACQUIRE);
+    for (int b = 0; b < count; b++) {
+        if (__atomic_load_n(&book_list[b]->state, __ATOMIC_RELAXED) == BOOK_LIVE) out->books++;
+    }
+}
@@ -0,0 +1,120 @@
+/*
+ * Order Book Header
+ *
+ * Declares the local level-2 order books kept from the exchanges' depth
+ * channels (Binance depth diffs, Coinbase level2_batch, Kraken book, OKX
+ * books) and written to disk as periodic compact snapshots (`book_file.h`).
+ *
+ * Features:
+ *  - order_book_open(): Enables books for a list of normalized symbols
+ *    (`crypto_ws --books DIR [--book-symbols BTC-USD,ETH-USDT]`).
+ *  - order_book_wants(): Whether a symbol's depth channel should be subscribed.
+ *  - order_book_parse_levels(): Reads a JSON array of [price, qty] levels.
+ *  - order_book_apply(): Applies one parsed depth message, checking its sequence.
+ *  - order_book_flush(): Writes a snapshot of every book that changed since its last one.
+ *  - order_book_close(): Writes final snapshots, stops the snapshot fetcher, frees the books.
+ *
+ * Dependencies:
+ *  - market_record.h: Fixed, ExchangeId.
+ *  - json_scan.h: Level arrays are parsed from a structural index.
+ *
+ * Usage:
+ *  - Depth messages are parsed in `exchange_websocket.c` on the service threads; depth channels
+ *    are added to the subscribe frames by `subscription_cache.c`; flushed from `main.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef ORDER_BOOK_H
+#define ORDER_BOOK_H
+
+#include <stdint.h>
+
+#include "market_record.h"
+#include "json_scan.h"
+
+/* Symbols with books when none are given, and the most that can be configured */
+#define BOOK_DEFAULT_SYMBOLS "BTC-USD,ETH-USD,BTC-USDT,ETH-USDT"
+#define BOOK_MAX_SYMBOLS 64
+
+/* Levels kept per side; a book only tracks the best BOOK_MAX_LEVELS prices */
+#define BOOK_MAX_LEVELS 1000
+
+/* Levels per side in each snapshot written to disk, and how often changed books are written */
+#define BOOK_SNAPSHOT_DEPTH 50
+#define BOOK_SNAPSHOT_INTERVAL_MS 1000
+
+/* Depth of the Kraken subscription; Kraken expects the book truncated to it, and checksums
+ * the top BOOK_KRAKEN_CHECKSUM_LEVELS of each side */
+#define BOOK_KRAKEN_DEPTH 100
+#define BOOK_KRAKEN_CHECKSUM_LEVELS 10
+
+/* Binance diff levels buffered per book while its REST snapshot is fetched */
+#define BOOK_PENDING_LEVELS 65536
+
+/* Seconds between two resyncs (snapshot request or resubscription) of one book */
+#define BOOK_RESYNC_SECONDS 5
+
+/* Binance REST snapshot; the fetcher waits BOOK_FETCH_SPACING_MS between requests */
+#define BOOK_BINANCE_DEPTH_URL "https://api.binance.us/api/v3/depth?limit=1000&symbol="
+#define BOOK_FETCH_SPACING_MS 250
+
+/* One price level; a zero quantity removes the level */
+typedef struct {
+    Fixed price;
+    Fixed qty;
+} BookLevel;
+
+/* One depth message, as parsed from the exchange */
+typedef struct {
+    uint16_t exchange_id;       // ExchangeId
+    uint16_t symbol_id;
+    int64_t ts_ns;              // exchange time, 0 for the receive time
+    int snapshot;               // replaces the book instead of updating it
+    uint64_t first_seq;         // Binance: first update ID (U)
+    uint64_t last_seq;          // Binance: last update ID (u); OKX: seqId
+    uint64_t prev_seq;          // OKX: prevSeqId
+    int has_checksum;           // Kraken: `checksum` is the CRC32 of the top levels after the update
+    uint32_t checksum;
+    const BookLevel *bids;
+    int bid_count;
+    const BookLevel *asks;
+    int ask_count;
+} BookMessage;
+
+typedef struct {
+    uint64_t messages;          // depth messages applied or buffered
+    uint64_t levels;            // level changes applied
+    uint64_t resyncs;           // sequence gaps or checksum mismatches
+    uint64_t snapshots;         // book snapshots written
+    uint64_t bytes;             // bytes written
+    uint32_t books;             // books in sync
+} BookStats;
+
+/* Starts keeping books for a comma-separated list of normalized symbols (BOOK_DEFAULT_SYMBOLS
+ * if NULL) and writing snapshots to `dir` (created if missing). Returns 0 or -1. */
+int order_book_open(const char *dir, const char *symbols);
+
+/* Non-zero once order_book_open() succeeded. */
+int order_book_enabled(void);
+
+/* Non-zero if the symbol's normalized name is in the book list. */
+int order_book_wants(uint16_t symbol_id);
+
+/* Parses the array of levels at `node` ([[price, qty, ...], ...]; with `first_field` 1, the
+ * level is [side, price, qty]) into `levels`. Returns the levels parsed, at most `capacity`. */
+int order_book_parse_levels(const JsonIndex *ix, size_t node, int first_field, BookLevel *levels, int capacity);
+
+/* Applies one depth message on the symbol's service thread. Returns 1 if the book lost sync
+ * and the caller should resubscribe the symbol's depth channel (OKX, Kraken), else 0. */
+int order_book_apply(const BookMessage *message);
+
+/* Writes changed books (at most every BOOK_SNAPSHOT_INTERVAL_MS unless forced). */
+void order_book_flush(int force);
+
+void order_book_close(void);
+
+void order_book_stats(BookStats *stats);
+
+#endif // ORDER_BOOK_H
@@ -0,0 +1,163 @@
+/*
+ * Quote Book
+ *
+ * This module keeps the shared-memory best bid/offer table current. Each
+ * ticker with a bid or ask replaces its exchange's quote for the normalized
+ * symbol, then the symbol's consolidated best bid/ask is recomputed from the
+ * per-exchange entries.
+ *
+ * Features:
+ *  - Slots are indexed by canonical symbol ID, so finding a symbol's slot is an array read.
+ *  - A ticker carrying only one side keeps the other side of the previous quote.
+ *  - The best bid/ask is rebuilt while holding the `best` entry, so concurrent updates
+ *    of one symbol from two service threads cannot publish an older result last.
+ *  - Prices of different scales are compared exactly (fixed_compare()).
+ *  - Quotes older than QUOTE_STALE_SECONDS do not take part in the best bid/ask.
+ *
+ * Dependencies:
+ *  - quote_table.c: Shared table and seqlock.
+ *  - symbol_table.h / market_record.h: Canonical symbol IDs, exchange names, wall clock.
+ *
+ * Usage:
+ *  - Opened from `main.c` (`--quotes`); quote_book_ticker() runs on the service threads.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "quote_book.h"
+#include "quote_table.h"
+#include "symbol_table.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+_Static_assert(EXCHANGE_COUNT <= QUOTE_MAX_EXCHANGES, "quote table has too few exchange entries");
+
+#define NS_PER_SECOND 1000000000LL
+
+static QuoteTable *table = NULL;
+static size_t table_bytes = 0;
+
+int quote_book_open(const char *name) {
+    table = quote_table_create(name, MAX_SYMBOLS, &table_bytes);
+    if (!table) return -1;
+
+    for (int i = 0; i < EXCHANGE_COUNT; i++)
+        strncpy(table->header.exchanges[i], exchange_name((uint16_t)i), QUOTE_EXCHANGE_NAME_LENGTH - 1);
+
+    printf("[INFO] Publishing best bid/offer to shared memory %s (%.1f MB)\n", name, (double)table_bytes / 1e6);
+    return 0;
+}
+
+int quote_book_enabled(void) {
+    return table != NULL;
+}
+
+/* Names the slot of a canonical symbol on first use */
+static QuoteSymbol *symbol_slot(uint16_t canonical_id) {
+    QuoteSymbol *slot = &table->symbols[canonical_id];
+    uint32_t state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+    if (state == QUOTE_SYMBOL_READY) return slot;
+
+    uint32_t unused = QUOTE_SYMBOL_UNUSED;
+    if (!__atomic_compare_exchange_n(&slot->state, &unused, QUOTE_SYMBOL_NAMING, 0,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return slot;    // named by another thread; its quotes show up once it is ready
+
+    strncpy(slot->name, symbol_canonical(canonical_id), QUOTE_NAME_LENGTH - 1);
+    __atomic_store_n(&slot->state, QUOTE_SYMBOL_READY, __ATOMIC_RELEASE);
+
+    uint32_t high = __atomic_load_n(&table->header.symbol_high, __ATOMIC_RELAXED);
+    while (high <= canonical_id &&
+           !__atomic_compare_exchange_n(&table->header.symbol_high, &high, (uint32_t)canonical_id + 1, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    return slot;
+}
+
+/* Rebuilds the consolidated best bid/ask of a slot from its exchange entries */
+static void update_best(QuoteSymbol *slot, int64_t now_ns) {
+    QuoteSnapshot best;
+    quote_entry_begin(&slot->best, &best);
+
+    memset(&best, 0, sizeof(best));
+    best.bid = best.bid_qty = best.ask = best.ask_qty = FIXED_ABSENT;
+    best.updated_ns = now_ns;
+
+    for (int exchange = 1; exchange < EXCHANGE_COUNT; exchange++) {
+        QuoteSnapshot quote;
+        if (quote_entry_read(&slot->exchanges[exchange], &quote) != 1) continue;
+        if (now_ns - quote.updated_ns > QUOTE_STALE_SECONDS * NS_PER_SECOND) continue;
+
+        if (FIXED_PRESENT(quote.bid) && (!FIXED_PRESENT(best.bid) || fixed_compare(quote.bid, best.bid) > 0)) {
+            best.bid = quote.bid;
+            best.bid_qty = quote.bid_qty;
+            best.bid_exchange = (uint8_t)exchange;
+        }
+        if (FIXED_PRESENT(quote.ask) && (!FIXED_PRESENT(best.ask) || fixed_compare(quote.ask, best.ask) < 0)) {
+            best.ask = quote.ask;
+            best.ask_qty = quote.ask_qty;
+            best.ask_exchange = (uint8_t)exchange;
+        }
+        if (quote.ts_ns > best.ts_ns) best.ts_ns = quote.ts_ns;
+    }
+
+    quote_entry_store(&slot->best, &best);
+    quote_entry_end(&slot->best);
+}
+
+void quote_book_ticker(const TickerData *ticker) {
+    if (!table || (!FIXED_PRESENT(ticker->bid) && !FIXED_PRESENT(ticker->ask))) return;
+    if (ticker->exchange_id == EXCHANGE_UNKNOWN || ticker->exchange_id >= EXCHANGE_COUNT) return;
+
+    uint16_t canonical_id = symbol_canonical_id(ticker->symbol_id);
+    if (canonical_id == 0) return;
+
+    QuoteSymbol *slot = symbol_slot(canonical_id);
+    if (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) != QUOTE_SYMBOL_READY) return;
+
+    int64_t now_ns = market_clock_ns();
+    QuoteEntry *entry = &slot->exchanges[ticker->exchange_id];
+    QuoteSnapshot quote;
+    quote_entry_begin(entry, &quote);
+
+    if (FIXED_PRESENT(ticker->bid)) {
+        quote.bid = ticker->bid;
+        quote.bid_qty = ticker->bid_qty;
+    }
+    if (FIXED_PRESENT(ticker->ask)) {
+        quote.ask = ticker->ask;
+        quote.ask_qty = ticker->ask_qty;
+    }
+    quote.bid_exchange = quote.ask_exchange = (uint8_t)ticker->exchange_id;
+    quote.ts_ns = ticker->ts_ns;
+    quote.updated_ns = now_ns;
+
+    quote_entry_store(entry, &quote);
+    quote_entry_end(entry);
+    __atomic_add_fetch(&table->header.updates, 1, __ATOMIC_RELAXED);
+
+    update_best(slot, now_ns);
+}
+
+void quote_book_close(void) {
+    if (!table) return;
+
+    /* The last quotes stay readable until the next start replaces the table */
+    __atomic_store_n(&table->header.writer_pid, 0, __ATOMIC_RELEASE);
+    munmap(table, table_bytes);
+    table = NULL;
+}
+
+void quote_book_stats(QuoteBookStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (!table) return;
+
+    stats->updates = __atomic_load_n(&table->header.updates, __ATOMIC_RELAXED);
+    uint32_t high = __atomic_load_n(&table->header.symbol_high, __ATOMIC_RELAXED);
+    for (uint32_t i = 0; i < high; i++) {
+        if (__atomic_load_n(&table->symbols[i].state, __ATOMIC_RELAXED) == QUOTE_SYMBOL_READY) stats->symbols++;
+    }
+}
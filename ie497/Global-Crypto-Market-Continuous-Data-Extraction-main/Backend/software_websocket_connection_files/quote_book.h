@@ -0,0 +1,52 @@
+/*
+ * Quote Book Header
+ *
+ * Declares the live best bid/offer book: every normalized ticker updates its
+ * (symbol, exchange) quote in the shared-memory table (`quote_table.h`) and the
+ * symbol's consolidated best bid and best ask.
+ *
+ * Features:
+ *  - quote_book_open(): Creates the shared table (`crypto_ws --quotes`).
+ *  - quote_book_ticker(): Applies one ticker; a no-op when disabled or without bid/ask.
+ *  - quote_book_close(): Marks the table as no longer written and unmaps it.
+ *
+ * Dependencies:
+ *  - market_record.h: TickerData.
+ *  - quote_table.h: Shared table layout and QUOTE_TABLE_NAME.
+ *
+ * Usage:
+ *  - Called from ingest_submit_ticker() on the service threads, before the record is queued.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef QUOTE_BOOK_H
+#define QUOTE_BOOK_H
+
+#include <stdint.h>
+
+#include "market_record.h"
+#include "quote_table.h"
+
+/* Exchange quotes older than this are left out of the consolidated best bid/ask */
+#define QUOTE_STALE_SECONDS 60
+
+typedef struct {
+    uint64_t updates;           // exchange quotes stored
+    uint32_t symbols;           // symbols with a slot in the table
+} QuoteBookStats;
+
+/* Creates the shared table under `name` (QUOTE_TABLE_NAME by default). Returns 0 or -1. */
+int quote_book_open(const char *name);
+
+/* Non-zero once quote_book_open() succeeded. */
+int quote_book_enabled(void);
+
+void quote_book_ticker(const TickerData *ticker);
+
+void quote_book_close(void);
+
+void quote_book_stats(QuoteBookStats *stats);
+
+#endif // QUOTE_BOOK_H
@@ -0,0 +1,192 @@
+/*
+ * Quote Table
+ *
+ * This module creates and maps the shared-memory best bid/offer table and
+ * implements its per-entry seqlock (layout in `quote_table.h`). It has no
+ * dependency on the rest of `crypto_ws`, so reader programs link only this file.
+ *
+ * Features:
+ *  - The writer stores fields with relaxed atomics between an odd and an even `seq`;
+ *    readers copy with relaxed loads and validate `seq` after an acquire fence.
+ *  - Taking an entry is a compare-and-swap on `seq`, so two service threads never
+ *    interleave stores into the same entry.
+ *  - Readers bound their retries, so a writer that died mid-update cannot hang them.
+ *
+ * Dependencies:
+ *  - Standard C libraries (stdio, string, errno, time) and POSIX shm_open / mmap.
+ *
+ * Usage:
+ *  - `quote_book.c` (writer) and `quote_watch.c` (reader).
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "quote_table.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define STORE(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+
+static void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static size_t table_size(uint32_t symbol_capacity) {
+    return sizeof(QuoteTable) + (size_t)symbol_capacity * sizeof(QuoteSymbol);
+}
+
+QuoteTable *quote_table_create(const char *name, uint32_t symbol_capacity, size_t *size) {
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        printf("[ERROR] Failed to create quote table %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+
+    /* A new object reads as zeros: every slot unused, every entry never written */
+    *size = table_size(symbol_capacity);
+    QuoteTable *table = NULL;
+    if (ftruncate(fd, (off_t)*size) == 0) {
+        table = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (table == MAP_FAILED) table = NULL;
+    }
+    close(fd);
+    if (!table) {
+        printf("[ERROR] Failed to map quote table %s: %s\n", name, strerror(errno));
+        shm_unlink(name);
+        return NULL;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    table->header.version = QUOTE_TABLE_VERSION;
+    table->header.symbol_capacity = symbol_capacity;
+    table->header.symbol_size = sizeof(QuoteSymbol);
+    table->header.writer_pid = (int32_t)getpid();
+    table->header.created_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+
+    /* Readers check the magic first; publish it after the rest of the header */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(table->header.magic, QUOTE_TABLE_MAGIC, QUOTE_TABLE_MAGIC_LENGTH);
+    return table;
+}
+
+const QuoteTable *quote_table_attach(const char *name, size_t *size) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    const QuoteTable *table = NULL;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(QuoteTable)) {
+        table = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (table == MAP_FAILED) table = NULL;
+    }
+    close(fd);
+    if (!table) return NULL;
+
+    *size = (size_t)st.st_size;
+    const QuoteTableHeader *header = &table->header;
+    if (memcmp(header->magic, QUOTE_TABLE_MAGIC, QUOTE_TABLE_MAGIC_LENGTH) != 0 ||
+        header->version != QUOTE_TABLE_VERSION || header->symbol_size != sizeof(QuoteSymbol) ||
+        table_size(header->symbol_capacity) > *size) {
+        munmap((void *)table, *size);
+        return NULL;
+    }
+    return table;
+}
+
+void quote_table_detach(const QuoteTable *table, size_t size) {
+    if (table) munmap((void *)table, size);
+}
+
+int quote_table_find(const QuoteTable *table, const char *name) {
+    uint32_t high = __atomic_load_n(&table->header.symbol_high, __ATOMIC_ACQUIRE);
+    if (high > table->header.symbol_capacity) high = table->header.symbol_capacity;
+
+    for (uint32_t i = 0; i < high; i++) {
+        const QuoteSymbol *symbol = &table->symbols[i];
+        if (__atomic_load_n(&symbol->state, __ATOMIC_ACQUIRE) == QUOTE_SYMBOL_READY &&
+            strncmp(symbol->name, name, QUOTE_NAME_LENGTH) == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+/* Field copy shared by the reader and the writer (relaxed loads; validity is up to the caller) */
+static void load_fields(const QuoteEntry *entry, QuoteSnapshot *out) {
+    out->ts_ns = LOAD(entry->ts_ns);
+    out->updated_ns = LOAD(entry->updated_ns);
+    out->bid = (Fixed){ LOAD(entry->bid), LOAD(entry->bid_scale) };
+    out->bid_qty = (Fixed){ LOAD(entry->bid_qty), LOAD(entry->bid_qty_scale) };
+    out->ask = (Fixed){ LOAD(entry->ask), LOAD(entry->ask_scale) };
+    out->ask_qty = (Fixed){ LOAD(entry->ask_qty), LOAD(entry->ask_qty_scale) };
+    out->bid_exchange = LOAD(entry->bid_exchange);
+    out->ask_exchange = LOAD(entry->ask_exchange);
+}
+
+int quote_entry_read(const QuoteEntry *entry, QuoteSnapshot *out) {
+    for (int attempt = 0; attempt < QUOTE_READ_RETRIES; attempt++) {
+        uint32_t before = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            cpu_relax();
+            continue;
+        }
+        if (before == 0) return 0;
+
+        load_fields(entry, out);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&entry->seq, __ATOMIC_RELAXED) == before) return 1;
+    }
+    return -1;
+}
+
+void quote_entry_begin(QuoteEntry *entry, QuoteSnapshot *current) {
+    uint32_t seq = __atomic_load_n(&entry->seq, __ATOMIC_RELAXED);
+    for (;;) {
+        if (!(seq & 1) &&
+            __atomic_compare_exchange_n(&entry->seq, &seq, seq + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            break;
+        cpu_relax();
+        seq = __atomic_load_n(&entry->seq, __ATOMIC_RELAXED);
+    }
+    /* The odd sequence must be visible before any field store */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if (seq == 0) {
+        memset(current, 0, sizeof(*current));
+        current->bid.scale = current->bid_qty.scale = -1;
+        current->ask.scale = current->ask_qty.scale = -1;
+    } else {
+        load_fields(entry, current);
+    }
+}
+
+void quote_entry_store(QuoteEntry *entry, const QuoteSnapshot *quote) {
+    STORE(entry->ts_ns, quote->ts_ns);
+    STORE(entry->updated_ns, quote->updated_ns);
+    STORE(entry->bid, quote->bid.value);
+    STORE(entry->bid_scale, quote->bid.scale);
+    STORE(entry->bid_qty, quote->bid_qty.value);
+    STORE(entry->bid_qty_scale, quote->bid_qty.scale);
+    STORE(entry->ask, quote->ask.value);
+    STORE(entry->ask_scale, quote->ask.scale);
+    STORE(entry->ask_qty, quote->ask_qty.value);
+    STORE(entry->ask_qty_scale, quote->ask_qty.scale);
+    STORE(entry->bid_exchange, quote->bid_exchange);
+    STORE(entry->ask_exchange, quote->ask_exchange);
+}
+
+void quote_entry_end(QuoteEntry *entry) {
+    __atomic_add_fetch(&entry->seq, 1, __ATOMIC_RELEASE);
+}
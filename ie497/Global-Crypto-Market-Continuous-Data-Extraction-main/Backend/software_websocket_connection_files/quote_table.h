@@ -0,0 +1,142 @@
+/*
+ * Quote Table Header
+ *
+ * Declares the shared-memory best bid/offer table that `crypto_ws --quotes`
+ * keeps up to date and any number of local processes can read. The table is a
+ * POSIX shared memory object (QUOTE_TABLE_NAME, i.e. /dev/shm/crypto_ws_quotes)
+ * holding one slot per normalized "BASE-QUOTE" symbol. Each slot has the latest
+ * quote of every exchange and the consolidated best bid and best ask.
+ *
+ * Layout (host byte order; readers check magic, version and sizes):
+ *  - QuoteTableHeader.
+ *  - `symbol_capacity` QuoteSymbol slots, 64-byte aligned. Slots below `symbol_high`
+ *    with `state == QUOTE_SYMBOL_READY` are named and in use.
+ *
+ * Every QuoteEntry is a seqlock: the writer makes `seq` odd, stores the fields and
+ * makes it even again; a reader copies the fields between two loads of `seq` and
+ * retries if they differ. Reading is plain loads on the mapping: no syscalls, no locks,
+ * and readers never slow the writer down.
+ *
+ * Features:
+ *  - quote_table_create(): Creates (or replaces) the table for the writer.
+ *  - quote_table_attach() / quote_table_find(): Read-only mapping and name lookup for readers.
+ *  - quote_entry_read(): Consistent snapshot of one entry.
+ *  - quote_entry_begin() / quote_entry_store() / quote_entry_end(): Writer side of the seqlock.
+ *
+ * Dependencies:
+ *  - market_record.h: Fixed (type only).
+ *  - POSIX shared memory (shm_open, mmap).
+ *
+ * Usage:
+ *  - Written by `quote_book.c`; read by `quote_watch` or any program that includes this header
+ *    and links `quote_table.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef QUOTE_TABLE_H
+#define QUOTE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "market_record.h"
+
+#define QUOTE_TABLE_NAME "/crypto_ws_quotes"
+
+#define QUOTE_TABLE_MAGIC "CWSBBO01"
+#define QUOTE_TABLE_MAGIC_LENGTH 8
+#define QUOTE_TABLE_VERSION 1
+
+/* Exchange entries per symbol, indexed by ExchangeId */
+#define QUOTE_MAX_EXCHANGES 8
+
+#define QUOTE_NAME_LENGTH 32
+#define QUOTE_EXCHANGE_NAME_LENGTH 16
+
+/* Reader attempts (a few ms) before giving up on an entry that stays mid-update, e.g. after
+ * the writer died inside one; a live writer holds an entry for well under a microsecond */
+#define QUOTE_READ_RETRIES 100000
+
+/* QuoteSymbol.state */
+#define QUOTE_SYMBOL_UNUSED 0
+#define QUOTE_SYMBOL_NAMING 1
+#define QUOTE_SYMBOL_READY 2
+
+/* One seqlocked quote. A scale of -1 marks an absent value. */
+typedef struct {
+    _Alignas(64) uint32_t seq;  // odd while the writer is storing; 0 if never written
+    uint8_t bid_exchange;       // ExchangeId of the bid (the entry's own exchange outside `best`)
+    uint8_t ask_exchange;
+    int8_t bid_scale;
+    int8_t ask_scale;
+    int64_t ts_ns;              // exchange time of the newest quote in the entry, epoch ns
+    int64_t updated_ns;         // wall-clock time the writer stored it, epoch ns
+    int64_t bid;
+    int64_t bid_qty;
+    int64_t ask;
+    int64_t ask_qty;
+    int8_t bid_qty_scale;
+    int8_t ask_qty_scale;
+} QuoteEntry;
+
+typedef struct {
+    _Alignas(64) char name[QUOTE_NAME_LENGTH];     // normalized "BASE-QUOTE"
+    uint32_t state;                                 // QUOTE_SYMBOL_*
+    QuoteEntry best;                                // consolidated best bid / best ask
+    QuoteEntry exchanges[QUOTE_MAX_EXCHANGES];
+} QuoteSymbol;
+
+typedef struct {
+    char magic[QUOTE_TABLE_MAGIC_LENGTH];          // stored last by the writer
+    uint32_t version;
+    uint32_t symbol_capacity;
+    uint32_t symbol_size;                           // sizeof(QuoteSymbol)
+    uint32_t symbol_high;                           // slots at or above are unused
+    int32_t writer_pid;                             // 0 once the writer has exited
+    uint32_t reserved;
+    int64_t created_ns;
+    uint64_t updates;                               // exchange quotes stored since creation
+    char exchanges[QUOTE_MAX_EXCHANGES][QUOTE_EXCHANGE_NAME_LENGTH];
+} QuoteTableHeader;
+
+typedef struct {
+    QuoteTableHeader header;
+    QuoteSymbol symbols[];
+} QuoteTable;
+
+/* Decoded copy of an entry */
+typedef struct {
+    int64_t ts_ns;
+    int64_t updated_ns;
+    Fixed bid;
+    Fixed bid_qty;
+    Fixed ask;
+    Fixed ask_qty;
+    uint8_t bid_exchange;
+    uint8_t ask_exchange;
+} QuoteSnapshot;
+
+/* Creates a fresh table (an older one of the same name is unlinked; its readers keep
+ * their mapping). Returns the writable mapping, or NULL. */
+QuoteTable *quote_table_create(const char *name, uint32_t symbol_capacity, size_t *size);
+
+/* Maps an existing table read-only and checks its header. Returns NULL if absent or incompatible. */
+const QuoteTable *quote_table_attach(const char *name, size_t *size);
+
+void quote_table_detach(const QuoteTable *table, size_t size);
+
+/* Slot of a ready symbol with this name, or -1. */
+int quote_table_find(const QuoteTable *table, const char *name);
+
+/* Copies an entry. Returns 1, 0 if it was never written, or -1 if it stayed mid-update. */
+int quote_entry_read(const QuoteEntry *entry, QuoteSnapshot *out);
+
+/* Writer side. begin() takes the entry (spinning while another writer holds it) and loads
+ * its current contents into `current`; store() replaces them; end() publishes. */
+void quote_entry_begin(QuoteEntry *entry, QuoteSnapshot *current);
+void quote_entry_store(QuoteEntry *entry, const QuoteSnapshot *quote);
+void quote_entry_end(QuoteEntry *entry);
+
+#endif // QUOTE_TABLE_H
@@ -0,0 +1,183 @@
+/*
+ * Quote Watch
+ *
+ * Example reader of the shared-memory best bid/offer table written by
+ * `crypto_ws --quotes`. It maps the table read-only and polls it with plain
+ * memory loads; the writer is never blocked or signalled.
+ *
+ * Features:
+ *  - Default: Consolidated best bid/ask of every symbol (or of the symbols given).
+ *  - `--exchanges`: Also each exchange's latest quote for the symbol.
+ *  - `--interval MS [--count N]`: Polls repeatedly instead of printing once.
+ *  - `--bench`: Times seqlock reads of the first symbol's best entry for one second.
+ *
+ * Dependencies:
+ *  - quote_table.c.
+ *  - Standard C libraries (stdio, stdlib, string, time, unistd).
+ *
+ * Usage:
+ *  make quote_watch
+ *  ./quote_watch [SYMBOL...] [--exchanges] [--interval MS] [--count N] [--bench] [--name SHM]
+ *  SYMBOL is the normalized "BASE-QUOTE" name, e.g. BTC-USD.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "quote_table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static int64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* value / 10^scale as text; "-" when absent */
+static void format_fixed(Fixed value, char *buf, size_t size) {
+    if (value.scale < 0) {
+        snprintf(buf, size, "-");
+        return;
+    }
+    if (value.scale == 0 || value.scale > 18) {
+        snprintf(buf, size, "%lld", (long long)value.value);
+        return;
+    }
+
+    unsigned long long magnitude = value.value < 0 ? 0ULL - (unsigned long long)value.value : (unsigned long long)value.value;
+    unsigned long long divisor = 1;
+    for (int i = 0; i < value.scale; i++) divisor *= 10;
+    snprintf(buf, size, "%s%llu.%0*llu", value.value < 0 ? "-" : "", magnitude / divisor, (int)value.scale,
+             magnitude % divisor);
+}
+
+static const char *exchange_label(const QuoteTable *table, uint8_t exchange) {
+    return exchange < QUOTE_MAX_EXCHANGES && table->header.exchanges[exchange][0] ? table->header.exchanges[exchange] : "-";
+}
+
+static void print_quote(const QuoteTable *table, const char *label, const QuoteSnapshot *quote, int64_t now_ns) {
+    char bid[48], bid_qty[48], ask[48], ask_qty[48];
+    format_fixed(quote->bid, bid, sizeof(bid));
+    format_fixed(quote->bid_qty, bid_qty, sizeof(bid_qty));
+    format_fixed(quote->ask, ask, sizeof(ask));
+    format_fixed(quote->ask_qty, ask_qty, sizeof(ask_qty));
+    printf("%-16s bid %s x %s %-9s ask %s x %s %-9s age %.0f ms\n", label, bid, bid_qty,
+           exchange_label(table, quote->bid_exchange), ask, ask_qty, exchange_label(table, quote->ask_exchange),
+           (double)(now_ns - quote->updated_ns) / 1e6);
+}
+
+static void print_symbol(const QuoteTable *table, int slot, int exchanges) {
+    const QuoteSymbol *symbol = &table->symbols[slot];
+    int64_t now_ns = clock_ns(CLOCK_REALTIME);
+    QuoteSnapshot quote;
+
+    if (quote_entry_read(&symbol->best, &quote) == 1) print_quote(table, symbol->name, &quote, now_ns);
+    if (!exchanges) return;
+
+    for (int i = 1; i < QUOTE_MAX_EXCHANGES; i++) {
+        if (quote_entry_read(&symbol->exchanges[i], &quote) != 1) continue;
+        char label[QUOTE_EXCHANGE_NAME_LENGTH + 4];
+        snprintf(label, sizeof(label), "  %s", exchange_label(table, (uint8_t)i));
+        print_quote(table, label, &quote, now_ns);
+    }
+}
+
+static void bench(const QuoteTable *table, int slot) {
+    const QuoteEntry *entry = &table->symbols[slot].best;
+    QuoteSnapshot quote;
+    uint64_t reads = 0, failed = 0;
+    int64_t start = clock_ns(CLOCK_MONOTONIC), elapsed;
+
+    do {
+        for (int i = 0; i < 4096; i++) failed += quote_entry_read(entry, &quote) < 0;
+        reads += 4096;
+        elapsed = clock_ns(CLOCK_MONOTONIC) - start;
+    } while (elapsed < 1000000000LL);
+
+    printf("%s: %llu reads in %.2f s, %.1f ns/read, %llu gave up\n", table->symbols[slot].name,
+           (unsigned long long)reads, (double)elapsed / 1e9, (double)elapsed / (double)reads,
+           (unsigned long long)failed);
+}
+
+int main(int argc, char **argv) {
+    const char *name = QUOTE_TABLE_NAME;
+    const char **symbols = calloc((size_t)argc, sizeof(char *));
+    int symbol_count = 0, exchanges = 0, run_bench = 0;
+    long interval_ms = 0, count = 0;
+    if (!symbols) return 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--exchanges") == 0) {
+            exchanges = 1;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            run_bench = 1;
+        } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval_ms = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+            name = argv[++i];
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "[ERROR] Usage: %s [SYMBOL...] [--exchanges] [--interval MS] [--count N] "
+                            "[--bench] [--name SHM]\n", argv[0]);
+            return 1;
+        } else {
+            symbols[symbol_count++] = argv[i];
+        }
+    }
+
+    size_t size;
+    const QuoteTable *table = quote_table_attach(name, &size);
+    if (!table) {
+        fprintf(stderr, "[ERROR] No quote table %s (start crypto_ws with --quotes)\n", name);
+        return 1;
+    }
+    if (__atomic_load_n(&table->header.writer_pid, __ATOMIC_ACQUIRE) == 0)
+        fprintf(stderr, "[WARNING] The writer has exited; these are the last quotes it stored\n");
+
+    int *slots = calloc((size_t)symbol_count + 1, sizeof(int));
+    if (!slots) return 1;
+    for (int i = 0; i < symbol_count; i++) {
+        slots[i] = quote_table_find(table, symbols[i]);
+        if (slots[i] < 0) fprintf(stderr, "[WARNING] %s has no quotes yet\n", symbols[i]);
+    }
+
+    if (run_bench) {
+        if (symbol_count == 0 || slots[0] < 0) {
+            fprintf(stderr, "[ERROR] --bench needs a symbol with quotes\n");
+            return 1;
+        }
+        bench(table, slots[0]);
+    } else {
+        for (long round = 0; count == 0 || round < count; round++) {
+            if (symbol_count == 0) {
+                uint32_t high = __atomic_load_n(&table->header.symbol_high, __ATOMIC_ACQUIRE);
+                for (uint32_t slot = 0; slot < high && slot < table->header.symbol_capacity; slot++) {
+                    if (__atomic_load_n(&table->symbols[slot].state, __ATOMIC_ACQUIRE) == QUOTE_SYMBOL_READY)
+                        print_symbol(table, (int)slot, exchanges);
+                }
+            } else {
+                for (int i = 0; i < symbol_count; i++) {
+                    if (slots[i] < 0) slots[i] = quote_table_find(table, symbols[i]);
+                    if (slots[i] >= 0) print_symbol(table, slots[i], exchanges);
+                }
+            }
+            fflush(stdout);
+
+            if (interval_ms <= 0) break;
+            usleep((useconds_t)interval_ms * 1000);
+        }
+    }
+
+    printf("%llu quote updates since the table was created\n",
+           (unsigned long long)__atomic_load_n(&table->header.updates, __ATOMIC_RELAXED));
+    free(slots);
+    free(symbols);
+    quote_table_detach(table, size);
+    return 0;
+}
@@ -0,0 +1,334 @@
+/*
+ * Capture Replay Server
+ *
+ * Local libwebsockets server that stands in for every exchange. `crypto_ws
+ * --endpoint HOST:PORT` connects each of its connections here, asking for
+ * `/replay/<connection index>`; the server then sends that connection's frames
+ * from a capture recorded with `crypto_ws --capture FILE`, keeping the original
+ * spacing between frames (scaled by --speed) or as fast as the socket allows.
+ *
+ * Features:
+ *  - Paced replay at 1x, Nx (--speed N) or maximum speed (--speed 0).
+ *  - Per-connection cursor: a reconnecting client resumes where it left off.
+ *  - Injected disconnects (--disconnect-after N frames) to exercise reconnects.
+ *  - Injected silent stalls (--stall-after N frames, --stall-seconds S) to trip the
+ *    no-data timeout in `exchange_reconnect.c`.
+ *  - Optional looping (--loop) for long-running load tests.
+ *  - Simultaneous outages (--drop-all-every S) that close every session at once, so
+ *    `crypto_ws` can report how long all connections take to recover.
+ *  - Subscription requests and pongs from the client are accepted and ignored.
+ *
+ * Dependencies:
+ *  - libwebsockets: Server side of the replayed connections.
+ *  - capture.c: Capture loader.
+ *  - Standard C libraries (stdio, stdlib, string, signal, time).
+ *
+ * Usage:
+ *  - make replay_server
+ *  - ./replay_server session.cap [--port 7681] [--speed 1] [--loop]
+ *        [--disconnect-after N] [--stall-after N] [--stall-seconds S] [--drop-all-every S]
+ *  - ./crypto_ws --endpoint 127.0.0.1:7681
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "capture.h"
+#include "market_record.h"
+
+#include <libwebsockets.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+
+#define DEFAULT_REPLAY_PORT 7681
+
+/* Long enough to pass NO_DATA_TIMEOUT plus one health-check interval */
+#define DEFAULT_STALL_SECONDS 100
+
+/* Frames of one captured connection, in capture order */
+typedef struct {
+    size_t *index;              // positions in capture.frames
+    size_t count;
+    size_t next;                // next frame to send; kept across reconnects
+} ReplayConnection;
+
+/* Per-session state held in lws per-session user data */
+typedef struct {
+    int connection;             // -1 until the request path is parsed
+    int64_t start_ns;           // CLOCK_MONOTONIC when the pass's first frame was due
+    int64_t base_ns;            // capture recv_ns of that first frame
+    int64_t resume_ns;          // no frames before this time (injected stall)
+    uint64_t sent;
+    unsigned generation;        // drop_generation when the session started
+} ReplaySession;
+
+static CaptureArchive capture;
+static ReplayConnection *connections = NULL;
+static size_t connection_count = 0;
+
+static double replay_speed = 1.0;
+static int replay_loop = 0;
+static uint64_t disconnect_after = 0;
+static uint64_t stall_after = 0;
+static int stall_seconds = DEFAULT_STALL_SECONDS;
+static int drop_all_every = 0;
+static unsigned drop_generation = 0;
+
+static volatile sig_atomic_t interrupted = 0;
+
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void handle_signal(int signal_number) {
+    (void)signal_number;
+    interrupted = 1;
+}
+
+/* Groups the capture's frames by the connection they were received on */
+static int index_connections(void) {
+    for (size_t i = 0; i < capture.count; i++) {
+        uint16_t connection = capture.frames[i].header.connection;
+        if (connection != UINT16_MAX && connection >= connection_count)
+            connection_count = connection + 1;
+    }
+
+    connections = calloc(connection_count ? connection_count : 1, sizeof(*connections));
+    if (!connections) return -1;
+
+    for (size_t i = 0; i < capture.count; i++) {
+        uint16_t connection = capture.frames[i].header.connection;
+        if (connection != UINT16_MAX) connections[connection].count++;
+    }
+    for (size_t c = 0; c < connection_count; c++) {
+        if (!connections[c].count) continue;
+        connections[c].index = malloc(connections[c].count * sizeof(size_t));
+        if (!connections[c].index) return -1;
+        connections[c].count = 0;
+    }
+    for (size_t i = 0; i < capture.count; i++) {
+        uint16_t connection = capture.frames[i].header.connection;
+        if (connection != UINT16_MAX)
+            connections[connection].index[connections[connection].count++] = i;
+    }
+    return 0;
+}
+
+static const CaptureFrame *next_frame(const ReplaySession *session) {
+    const ReplayConnection *connection = &connections[session->connection];
+    return &capture.frames[connection->index[connection->next]];
+}
+
+/* Restarts pacing from the connection's next frame */
+static void start_pass(ReplaySession *session) {
+    session->start_ns = monotonic_ns();
+    session->base_ns = next_frame(session)->header.recv_ns;
+}
+
+/* When the next frame is due, preserving the captured spacing divided by the speed */
+static int64_t frame_due(const ReplaySession *session) {
+    int64_t due = 0;
+    if (replay_speed > 0)
+        due = session->start_ns + (int64_t)((double)(next_frame(session)->header.recv_ns - session->base_ns) / replay_speed);
+    return (due > session->resume_ns) ? due : session->resume_ns;
+}
+
+/* Arms a timer or a writeable callback for the next frame */
+static void schedule_next(struct lws *wsi, ReplaySession *session) {
+    ReplayConnection *connection = &connections[session->connection];
+    if (connection->next == connection->count) {
+        if (!replay_loop) {
+            printf("[INFO] Connection %d: capture finished after %llu frames\n",
+                   session->connection, (unsigned long long)session->sent);
+            return;
+        }
+        connection->next = 0;
+        start_pass(session);
+    }
+
+    int64_t delay = frame_due(session) - monotonic_ns();
+    if (delay <= 0)
+        lws_callback_on_writable(wsi);
+    else
+        lws_set_timer_usecs(wsi, delay / 1000);
+}
+
+/* Sends the next frame if it is due; returns -1 to drop the connection */
+static int send_frame(struct lws *wsi, ReplaySession *session) {
+    ReplayConnection *connection = &connections[session->connection];
+    if (session->generation != drop_generation) {
+        printf("[INFO] Connection %d: dropped by injected outage\n", session->connection);
+        return -1;
+    }
+    if (connection->next == connection->count) return 0;
+    if (frame_due(session) > monotonic_ns()) {
+        schedule_next(wsi, session);
+        return 0;
+    }
+
+    const CaptureFrame *frame = next_frame(session);
+    enum lws_write_protocol type = (frame->header.exchange_id == EXCHANGE_HUOBI) ? LWS_WRITE_BINARY : LWS_WRITE_TEXT;
+    if (lws_write(wsi, capture.arena + frame->offset, frame->header.len, type) < (int)frame->header.len) {
+        printf("[ERROR] Connection %d: write failed\n", session->connection);
+        return -1;
+    }
+    connection->next++;
+    session->sent++;
+
+    if (disconnect_after && session->sent % disconnect_after == 0) {
+        printf("[INFO] Connection %d: injected disconnect after %llu frames\n",
+               session->connection, (unsigned long long)session->sent);
+        return -1;
+    }
+    if (stall_after && session->sent % stall_after == 0) {
+        printf("[INFO] Connection %d: injected stall of %d s after %llu frames\n",
+               session->connection, stall_seconds, (unsigned long long)session->sent);
+        session->resume_ns = monotonic_ns() + (int64_t)stall_seconds * 1000000000LL;
+    }
+
+    schedule_next(wsi, session);
+    return 0;
+}
+
+static int callback_replay(struct lws *wsi, enum lws_callback_reasons reason,
+                           void *user, void *in, size_t len) {
+    (void)in;
+    (void)len;
+    ReplaySession *session = (ReplaySession *)user;
+
+    switch (reason) {
+        case LWS_CALLBACK_ESTABLISHED: {
+            memset(session, 0, sizeof(*session));
+            session->connection = -1;
+            session->generation = drop_generation;
+
+            char uri[64] = {0};
+            lws_hdr_copy(wsi, uri, sizeof(uri), WSI_TOKEN_GET_URI);
+            int connection = (strncmp(uri, "/replay/", 8) == 0) ? atoi(uri + 8) : -1;
+            if (connection < 0 || (size_t)connection >= connection_count || !connections[connection].count) {
+                printf("[WARNING] No captured frames for %s; connection stays silent\n", uri);
+                break;
+            }
+
+            session->connection = connection;
+            if (connections[connection].next == connections[connection].count) {
+                if (!replay_loop) break;
+                connections[connection].next = 0;
+            }
+            printf("[INFO] Connection %d: replaying from frame %zu of %zu\n",
+                   connection, connections[connection].next, connections[connection].count);
+            start_pass(session);
+            schedule_next(wsi, session);
+            break;
+        }
+        case LWS_CALLBACK_TIMER:
+            if (session->connection >= 0) lws_callback_on_writable(wsi);
+            break;
+        case LWS_CALLBACK_SERVER_WRITEABLE:
+            if (session->connection >= 0) return send_frame(wsi, session);
+            break;
+        case LWS_CALLBACK_RECEIVE:
+            break;              // subscriptions and pongs need no answer
+        case LWS_CALLBACK_CLOSED:
+            if (session->connection >= 0)
+                printf("[INFO] Connection %d: closed after %llu frames\n",
+                       session->connection, (unsigned long long)session->sent);
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+static struct lws_protocols replay_protocols[] = {
+    { "replay", callback_replay, sizeof(ReplaySession), 4096, 0, NULL, 0 },
+    { NULL, NULL, 0, 0, 0, NULL, 0 }
+};
+
+static struct lws_context *replay_context = NULL;
+static lws_sorted_usec_list_t drop_timer;
+
+/* Injected outage: every session closes on its next writeable callback */
+static void drop_all_sessions(lws_sorted_usec_list_t *sul) {
+    printf("[INFO] Injected outage: closing every session\n");
+    drop_generation++;
+    lws_callback_on_writable_all_protocol(replay_context, &replay_protocols[0]);
+    lws_sul_schedule(replay_context, 0, sul, drop_all_sessions, (lws_usec_t)drop_all_every * LWS_US_PER_SEC);
+}
+
+int main(int argc, char **argv) {
+    const char *capture_path = NULL;
+    int port = DEFAULT_REPLAY_PORT;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            replay_speed = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--loop") == 0) {
+            replay_loop = 1;
+        } else if (strcmp(argv[i], "--disconnect-after") == 0 && i + 1 < argc) {
+            disconnect_after = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--stall-after") == 0 && i + 1 < argc) {
+            stall_after = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--stall-seconds") == 0 && i + 1 < argc) {
+            stall_seconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--drop-all-every") == 0 && i + 1 < argc) {
+            drop_all_every = atoi(argv[++i]);
+        } else if (!capture_path && argv[i][0] != '-') {
+            capture_path = argv[i];
+        } else {
+            capture_path = NULL;
+            break;
+        }
+    }
+    if (!capture_path || port <= 0 || replay_speed < 0 || stall_seconds < 0 || drop_all_every < 0) {
+        printf("[ERROR] Usage: %s CAPTURE_FILE [--port N] [--speed X (0 = max)] [--loop]\n"
+               "        [--disconnect-after N] [--stall-after N] [--stall-seconds S] [--drop-all-every S]\n", argv[0]);
+        return 1;
+    }
+
+    if (capture_load(&capture, capture_path, LWS_PRE) != 0) return 1;
+    if (index_connections() != 0) {
+        printf("[ERROR] Memory allocation failed while indexing %s\n", capture_path);
+        return 1;
+    }
+    printf("[INFO] Loaded %zu frames for %zu connection slots from %s\n",
+           capture.count, connection_count, capture_path);
+
+    struct lws_context_creation_info info;
+    memset(&info, 0, sizeof(info));
+    info.port = port;
+    info.protocols = replay_protocols;
+
+    struct lws_context *context = lws_create_context(&info);
+    if (!context) {
+        printf("[ERROR] Failed to create replay server context\n");
+        return 1;
+    }
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    if (replay_speed > 0)
+        printf("[INFO] Replay server listening on port %d at %.2fx\n", port, replay_speed);
+    else
+        printf("[INFO] Replay server listening on port %d at maximum speed\n", port);
+
+    replay_context = context;
+    if (drop_all_every)
+        lws_sul_schedule(context, 0, &drop_timer, drop_all_sessions, (lws_usec_t)drop_all_every * LWS_US_PER_SEC);
+
+    while (!interrupted && lws_service(context, 0) >= 0)
+        ;
+
+    lws_context_destroy(context);
+    for (size_t c = 0; c < connection_count; c++) free(connections[c].index);
+    free(connections);
+    capture_archive_free(&capture);
+    return 0;
+}
@@ -0,0 +1,340 @@
+/*
+ * Rolling Window Store
+ *
+ * This module keeps the last ROLLING_WINDOW_SECONDS of serialized JSON log lines in
+ * memory and produces the `*_output_data.json` snapshot files read by the S3 uploader.
+ *
+ * Entries are appended into segments bucketed by insertion second. A segment is
+ * released as a whole once every entry inside it is older than the window, so the
+ * per-message cost is a single memcpy instead of a full re-serialize and rewrite.
+ * Snapshots skip any individually expired entries inside live segments, which keeps
+ * the output byte-identical to the old trim_buffer() + flush_buffer_to_file() pair.
+ *
+ * Features:
+ *  - Append-only segments with amortized O(1) inserts.
+ *  - Whole-segment expiry with segment recycling (no per-message malloc once warm).
+ *  - Snapshot written to a temporary file and renamed into place.
+ *  - A per-store mutex lets writer threads append while the main thread snapshots. The
+ *    snapshot only copies the live lines into a reused buffer under it; the file is written
+ *    after it is released, so appends never wait on the disk.
+ *  - A timed snapshot is skipped unless a line was added or one in the last file expired.
+ *
+ * Dependencies:
+ *  - Standard C libraries (stdio, stdlib, string, time, pthread).
+ *
+ * Usage:
+ *  - Called by `utils.c` from log_ticker_price()/log_trade_price() on the ingest
+ *    writer threads, and by `main.c` from the housekeeping loop for timed snapshots.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "rolling_window.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define SEGMENT_INITIAL_DATA    4096
+#define SEGMENT_INITIAL_RECORDS 32
+
+/* One serialized line inside a segment's data buffer (newline included) */
+typedef struct {
+    time_t entry_time;
+    size_t offset;
+    size_t len;
+} RollingRecord;
+
+/* All lines appended during one insertion second */
+typedef struct RollingSegment {
+    time_t bucket;
+    time_t max_entry_time;
+
+    char *data;
+    size_t data_len;
+    size_t data_cap;
+
+    RollingRecord *records;
+    size_t count;
+    size_t cap;
+
+    struct RollingSegment *next;
+} RollingSegment;
+
+struct RollingWindow {
+    char *filename;
+    char *tmp_filename;
+    time_t window_secs;
+
+    RollingSegment *head;
+    RollingSegment *tail;
+    RollingSegment *free_list;
+
+    size_t total_records;
+    time_t last_snapshot;
+    int dirty;
+    size_t written_records;     // lines in the last snapshot file
+    time_t oldest_written;      // oldest entry time among them; the file is stale once it expires
+
+    pthread_mutex_t lock;       // writer threads append while the main thread snapshots
+
+    /* Snapshot side: only the thread holding snapshot_lock touches these */
+    pthread_mutex_t snapshot_lock;
+    char *snapshot;             // live lines copied out under `lock`
+    size_t snapshot_cap;
+};
+
+/* Get a cleared segment from the free list, or allocate a new one */
+static RollingSegment *segment_acquire(RollingWindow *rw, time_t bucket) {
+    RollingSegment *seg = rw->free_list;
+    if (seg) {
+        rw->free_list = seg->next;
+    } else {
+        seg = calloc(1, sizeof(*seg));
+        if (!seg) return NULL;
+    }
+
+    seg->bucket = bucket;
+    seg->max_entry_time = 0;
+    seg->data_len = 0;
+    seg->count = 0;
+    seg->next = NULL;
+    return seg;
+}
+
+/* Return a segment to the free list, keeping its buffers for reuse */
+static void segment_release(RollingWindow *rw, RollingSegment *seg) {
+    seg->next = rw->free_list;
+    rw->free_list = seg;
+}
+
+static void segment_free(RollingSegment *seg) {
+    free(seg->data);
+    free(seg->records);
+    free(seg);
+}
+
+/* Grow a segment so it can take one more record of `len` bytes */
+static int segment_reserve(RollingSegment *seg, size_t len) {
+    if (seg->data_len + len > seg->data_cap) {
+        size_t cap = seg->data_cap ? seg->data_cap : SEGMENT_INITIAL_DATA;
+        while (cap < seg->data_len + len) cap *= 2;
+        char *data = realloc(seg->data, cap);
+        if (!data) return -1;
+        seg->data = data;
+        seg->data_cap = cap;
+    }
+
+    if (seg->count == seg->cap) {
+        size_t cap = seg->cap ? seg->cap * 2 : SEGMENT_INITIAL_RECORDS;
+        RollingRecord *records = realloc(seg->records, cap * sizeof(*records));
+        if (!records) return -1;
+        seg->records = records;
+        seg->cap = cap;
+    }
+
+    return 0;
+}
+
+RollingWindow *rolling_window_create(const char *filename, time_t window_secs) {
+    RollingWindow *rw = calloc(1, sizeof(*rw));
+    if (!rw) return NULL;
+
+    size_t name_len = strlen(filename);
+    rw->filename = malloc(name_len + 1);
+    rw->tmp_filename = malloc(name_len + sizeof(".tmp"));
+    if (!rw->filename || !rw->tmp_filename) {
+        free(rw->filename);
+        free(rw->tmp_filename);
+        free(rw);
+        return NULL;
+    }
+
+    pthread_mutex_init(&rw->lock, NULL);
+    pthread_mutex_init(&rw->snapshot_lock, NULL);
+    memcpy(rw->filename, filename, name_len + 1);
+    snprintf(rw->tmp_filename, name_len + sizeof(".tmp"), "%s.tmp", filename);
+    rw->window_secs = window_secs;
+    return rw;
+}
+
+static int append_locked(RollingWindow *rw, time_t entry_time, const char *line, size_t len) {
+    time_t bucket = time(NULL);
+    RollingSegment *seg = rw->tail;
+    if (!seg || seg->bucket != bucket) {
+        seg = segment_acquire(rw, bucket);
+        if (!seg) return -1;
+        if (rw->tail) rw->tail->next = seg;
+        else rw->head = seg;
+        rw->tail = seg;
+    }
+
+    if (segment_reserve(seg, len + 1) != 0) {
+        fprintf(stderr, "[ERROR] Rolling window allocation failed for %s\n", rw->filename);
+        return -1;
+    }
+
+    RollingRecord *rec = &seg->records[seg->count++];
+    rec->entry_time = entry_time;
+    rec->offset = seg->data_len;
+    rec->len = len + 1;
+
+    memcpy(seg->data + seg->data_len, line, len);
+    seg->data[seg->data_len + len] = '\n';
+    seg->data_len += len + 1;
+
+    if (seg->count == 1 || entry_time > seg->max_entry_time)
+        seg->max_entry_time = entry_time;
+
+    rw->total_records++;
+    rw->dirty = 1;
+    return 0;
+}
+
+int rolling_window_append(RollingWindow *rw, time_t entry_time, const char *line, size_t len) {
+    if (!rw || !line) return -1;
+
+    pthread_mutex_lock(&rw->lock);
+    int result = append_locked(rw, entry_time, line, len);
+    pthread_mutex_unlock(&rw->lock);
+    return result;
+}
+
+static void expire_locked(RollingWindow *rw, time_t now) {
+    while (rw->head && difftime(now, rw->head->max_entry_time) > rw->window_secs) {
+        RollingSegment *seg = rw->head;
+        rw->head = seg->next;
+        if (!rw->head) rw->tail = NULL;
+
+        rw->total_records -= seg->count;
+        rw->dirty = 1;
+        segment_release(rw, seg);
+    }
+}
+
+void rolling_window_expire(RollingWindow *rw, time_t now) {
+    if (!rw) return;
+
+    pthread_mutex_lock(&rw->lock);
+    expire_locked(rw, now);
+    pthread_mutex_unlock(&rw->lock);
+}
+
+/* Copies the entries still inside the window into rw->snapshot; the caller holds both locks.
+ * Returns the number of bytes copied, or -1 if the buffer could not grow. */
+static long copy_live_locked(RollingWindow *rw, time_t now) {
+    size_t need = 0;
+    for (RollingSegment *seg = rw->head; seg; seg = seg->next) need += seg->data_len;
+    if (need > rw->snapshot_cap) {
+        char *grown = realloc(rw->snapshot, need);
+        if (!grown) return -1;
+        rw->snapshot = grown;
+        rw->snapshot_cap = need;
+    }
+
+    size_t len = 0, written = 0;
+    time_t oldest = 0;
+    for (RollingSegment *seg = rw->head; seg; seg = seg->next) {
+        /* Coalesce runs of live records into a single memcpy */
+        size_t run_start = 0, run_len = 0;
+        for (size_t i = 0; i < seg->count; i++) {
+            const RollingRecord *rec = &seg->records[i];
+            if (difftime(now, rec->entry_time) > rw->window_secs) {
+                if (run_len) memcpy(rw->snapshot + len, seg->data + run_start, run_len);
+                len += run_len;
+                run_len = 0;
+                continue;
+            }
+            if (!written++ || rec->entry_time < oldest) oldest = rec->entry_time;
+            if (!run_len) run_start = rec->offset;
+            run_len += rec->len;
+        }
+        if (run_len) memcpy(rw->snapshot + len, seg->data + run_start, run_len);
+        len += run_len;
+    }
+
+    rw->written_records = written;
+    rw->oldest_written = oldest;
+    rw->last_snapshot = now;
+    rw->dirty = 0;
+    return (long)len;
+}
+
+/* Writes the copied lines out; called with only snapshot_lock held */
+static int write_copied(RollingWindow *rw, size_t len) {
+    FILE *f = fopen(rw->tmp_filename, "w");
+    int ok = f && fwrite(rw->snapshot, 1, len, f) == len;
+    if (f && fclose(f) != 0) ok = 0;
+    if (ok && rename(rw->tmp_filename, rw->filename) == 0) return 0;
+
+    fprintf(stderr, "[ERROR] Failed to write snapshot %s\n", rw->filename);
+    remove(rw->tmp_filename);
+
+    /* Try again on the next timed snapshot */
+    pthread_mutex_lock(&rw->lock);
+    rw->dirty = 1;
+    pthread_mutex_unlock(&rw->lock);
+    return -1;
+}
+
+/* Expires, copies under the store lock if needed (or forced), then writes without it */
+static int snapshot(RollingWindow *rw, time_t now, int force) {
+    pthread_mutex_lock(&rw->snapshot_lock);
+    pthread_mutex_lock(&rw->lock);
+    expire_locked(rw, now);
+
+    /* Lines expire on their own as time passes, so the file is also stale once its oldest does */
+    int stale = rw->written_records != 0 && difftime(now, rw->oldest_written) > rw->window_secs;
+    int due = force || ((rw->dirty || stale) &&
+                        difftime(now, rw->last_snapshot) >= ROLLING_WINDOW_SNAPSHOT_INTERVAL);
+    long len = due ? copy_live_locked(rw, now) : 0;
+    pthread_mutex_unlock(&rw->lock);
+
+    int result = 0;
+    if (len < 0) {
+        fprintf(stderr, "[ERROR] Rolling window allocation failed for %s\n", rw->filename);
+        result = -1;
+    } else if (due) {
+        result = write_copied(rw, (size_t)len);
+    }
+    pthread_mutex_unlock(&rw->snapshot_lock);
+    return result;
+}
+
+int rolling_window_write_snapshot(RollingWindow *rw, time_t now) {
+    if (!rw) return -1;
+    return snapshot(rw, now, 1);
+}
+
+int rolling_window_maybe_snapshot(RollingWindow *rw, time_t now, int force) {
+    if (!rw) return -1;
+    return snapshot(rw, now, force);
+}
+
+void rolling_window_destroy(RollingWindow *rw) {
+    if (!rw) return;
+
+    RollingSegment *seg = rw->head;
+    while (seg) {
+        RollingSegment *next = seg->next;
+        segment_free(seg);
+        seg = next;
+    }
+
+    seg = rw->free_list;
+    while (seg) {
+        RollingSegment *next = seg->next;
+        segment_free(seg);
+        seg = next;
+    }
+
+    pthread_mutex_destroy(&rw->lock);
+    pthread_mutex_destroy(&rw->snapshot_lock);
+    free(rw->snapshot);
+    free(rw->filename);
+    free(rw->tmp_filename);
+    free(rw);
+}
@@ -0,0 +1,58 @@
+/*
+ * Rolling Window Store Header
+ *
+ * Declares an append-only, time-bucketed store that holds the last N seconds of
+ * serialized JSON log lines and periodically writes them out as a snapshot file.
+ *
+ * Features:
+ *  - rolling_window_create(): Allocates a store bound to a snapshot file.
+ *  - rolling_window_append(): Appends one pre-serialized line (O(1) amortized).
+ *  - rolling_window_expire(): Drops whole segments whose entries have all expired.
+ *  - rolling_window_write_snapshot(): Writes live entries to the snapshot file.
+ *  - rolling_window_destroy(): Frees every segment owned by the store.
+ *
+ * Dependencies:
+ *  - Standard C libraries (stddef.h, time.h).
+ *
+ * Usage:
+ *  - Used by `utils.c` to back `ticker_output_data.json` and `trades_output_data.json`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef ROLLING_WINDOW_H
+#define ROLLING_WINDOW_H
+
+#include <stddef.h>
+#include <time.h>
+
+/* Number of seconds an entry stays in the window (matches the old trim_buffer()) */
+#define ROLLING_WINDOW_SECONDS 600
+
+/* Minimum number of seconds between two timed snapshot writes */
+#define ROLLING_WINDOW_SNAPSHOT_INTERVAL 1
+
+typedef struct RollingWindow RollingWindow;
+
+/* Creates an empty store that snapshots into `filename` and keeps `window_secs` of entries. */
+RollingWindow *rolling_window_create(const char *filename, time_t window_secs);
+
+/* Appends one serialized JSON line (without trailing newline) stamped with its entry time. */
+int rolling_window_append(RollingWindow *rw, time_t entry_time, const char *line, size_t len);
+
+/* Releases every leading segment in which all entries are older than the window. */
+void rolling_window_expire(RollingWindow *rw, time_t now);
+
+/* Writes all entries still inside the window to the snapshot file, in insertion order. */
+int rolling_window_write_snapshot(RollingWindow *rw, time_t now);
+
+/* Writes a snapshot if the store changed (an entry was added, or one in the last snapshot
+ * expired) and the snapshot interval has elapsed, or if forced. The file is written after the
+ * store lock is released. */
+int rolling_window_maybe_snapshot(RollingWindow *rw, time_t now, int force);
+
+/* Frees the store and all of its segments. */
+void rolling_window_destroy(RollingWindow *rw);
+
+#endif // ROLLING_WINDOW_H
@@ -0,0 +1,138 @@
+/*
+ * Segment Manifest
+ *
+ * This module reads and appends the manifest of sealed export segments
+ * (`segment_manifest.h`). Lines are appended with one write() each and
+ * fsynced, so a crash leaves at most one partial last line, which readers
+ * skip until it is complete.
+ *
+ * Dependencies:
+ *  - zlib (crc32).
+ *  - Standard C libraries (stdio, stdlib, string, errno, fcntl, unistd, inttypes).
+ *
+ * Usage:
+ *  - See `segment_manifest.h`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "segment_manifest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <zlib.h>
+
+#define MANIFEST_LINE_SIZE 512
+#define CRC_CHUNK_SIZE (256 * 1024)
+
+static const char manifest_header[] =
+    "# seq\tname\tkind\trecords\traw_bytes\tbytes\tcrc32\tfirst_ns\tlast_ns\n";
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+    return 0;
+}
+
+int segment_manifest_append(const char *dir, const SegmentEntry *entry) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, SEGMENT_MANIFEST_NAME);
+
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) {
+        printf("[ERROR] Could not open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    char line[MANIFEST_LINE_SIZE];
+    int len = snprintf(line, sizeof(line), "%" PRIu64 "\t%s\t%s\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%08" PRIx32
+                       "\t%" PRId64 "\t%" PRId64 "\n",
+                       entry->seq, entry->name, entry->kind, entry->records, entry->raw_bytes, entry->bytes,
+                       entry->crc32, entry->first_ns, entry->last_ns);
+
+    int status = 0;
+    if (lseek(fd, 0, SEEK_END) == 0 && write_all(fd, manifest_header, sizeof(manifest_header) - 1) != 0) status = -1;
+    if (status == 0 && write_all(fd, line, (size_t)len) != 0) status = -1;
+    if (status == 0 && fsync(fd) != 0) status = -1;
+    if (status != 0) printf("[ERROR] Failed to append to %s: %s\n", path, strerror(errno));
+    close(fd);
+    return status;
+}
+
+int segment_manifest_open(SegmentManifestReader *reader, const char *dir, long offset) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, SEGMENT_MANIFEST_NAME);
+
+    reader->fp = fopen(path, "r");
+    reader->offset = offset;
+    if (!reader->fp) return -1;
+    if (fseek(reader->fp, offset, SEEK_SET) != 0) {
+        fclose(reader->fp);
+        reader->fp = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int segment_manifest_next(SegmentManifestReader *reader, SegmentEntry *entry) {
+    char line[MANIFEST_LINE_SIZE];
+    while (fgets(line, sizeof(line), reader->fp)) {
+        size_t len = strlen(line);
+        if (len == 0 || line[len - 1] != '\n') return 0;     // incomplete; reread next time
+        reader->offset += (long)len;
+        if (line[0] == '#') continue;
+
+        memset(entry, 0, sizeof(*entry));
+        if (sscanf(line, "%" SCNu64 "\t%95s\t%15s\t%" SCNu64 "\t%" SCNu64 "\t%" SCNu64 "\t%" SCNx32
+                         "\t%" SCNd64 "\t%" SCNd64,
+                   &entry->seq, entry->name, entry->kind, &entry->records, &entry->raw_bytes, &entry->bytes,
+                   &entry->crc32, &entry->first_ns, &entry->last_ns) != 9)
+            return -1;
+        return 1;
+    }
+    return 0;
+}
+
+void segment_manifest_close(SegmentManifestReader *reader) {
+    if (reader->fp) fclose(reader->fp);
+    reader->fp = NULL;
+}
+
+int segment_file_crc32(const char *path, uint32_t *crc, uint64_t *size) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return -1;
+
+    unsigned char *chunk = malloc(CRC_CHUNK_SIZE);
+    if (!chunk) {
+        fclose(fp);
+        return -1;
+    }
+
+    uLong value = crc32(0L, Z_NULL, 0);
+    uint64_t total = 0;
+    size_t n;
+    while ((n = fread(chunk, 1, CRC_CHUNK_SIZE, fp)) > 0) {
+        value = crc32(value, chunk, (uInt)n);
+        total += n;
+    }
+    int status = ferror(fp) ? -1 : 0;
+
+    free(chunk);
+    fclose(fp);
+    *crc = (uint32_t)value;
+    *size = total;
+    return status;
+}
@@ -0,0 +1,73 @@
+/*
+ * Segment Manifest Header
+ *
+ * Declares the manifest of sealed export segments, shared by the segment writer
+ * in `crypto_ws` and by `segment_upload`. Each sealed segment is one line of
+ * `<dir>/manifest.tsv`, appended only after the segment file is complete and in
+ * place, so a reader never sees a segment that is still being written.
+ *
+ * Format:
+ *  - A "# ..." header line naming the columns, then one tab-separated line per segment:
+ *    seq, name, kind, records, raw_bytes, bytes, crc32 (hex, of the .gz file), first_ns, last_ns.
+ *  - `seq` increases by one per sealed segment across kinds and restarts of the writer.
+ *
+ * Features:
+ *  - segment_manifest_append(): Appends and fsyncs one line.
+ *  - SegmentManifestReader: Reads complete lines from a byte offset, so an uploader only
+ *    parses what was added since its last pass.
+ *  - segment_file_crc32(): Checksum and size of a segment file, to verify it before shipping.
+ *
+ * Dependencies:
+ *  - zlib (crc32).
+ *  - Standard C libraries (stdio, stdint).
+ *
+ * Usage:
+ *  - `segment_writer.c` appends; `segment_upload.c` reads.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef SEGMENT_MANIFEST_H
+#define SEGMENT_MANIFEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define SEGMENT_MANIFEST_NAME "manifest.tsv"
+#define SEGMENT_NAME_SIZE 96
+#define SEGMENT_KIND_SIZE 16
+
+typedef struct {
+    uint64_t seq;
+    char name[SEGMENT_NAME_SIZE];       // file name inside the segment directory
+    char kind[SEGMENT_KIND_SIZE];       // "ticker" / "trades"
+    uint64_t records;
+    uint64_t raw_bytes;                 // JSON lines before compression
+    uint64_t bytes;                     // size of the .gz file
+    uint32_t crc32;                     // of the .gz file
+    int64_t first_ns;                   // smallest and largest record time, epoch ns
+    int64_t last_ns;
+} SegmentEntry;
+
+typedef struct {
+    FILE *fp;
+    long offset;                        // end of the last complete line read
+} SegmentManifestReader;
+
+/* Appends `entry` to `<dir>/manifest.tsv` (created with its header) and fsyncs it. Returns 0 or -1. */
+int segment_manifest_append(const char *dir, const SegmentEntry *entry);
+
+/* Opens `<dir>/manifest.tsv` at byte `offset`. Returns 0, or -1 if there is no manifest. */
+int segment_manifest_open(SegmentManifestReader *reader, const char *dir, long offset);
+
+/* Reads the next complete line: 1 with `entry` filled, 0 at the end, -1 on a malformed line
+ * (which is skipped). A line still being written is left for the next pass. */
+int segment_manifest_next(SegmentManifestReader *reader, SegmentEntry *entry);
+
+void segment_manifest_close(SegmentManifestReader *reader);
+
+/* CRC-32 and size of a file. Returns 0, or -1 if it cannot be read. */
+int segment_file_crc32(const char *path, uint32_t *crc, uint64_t *size);
+
+#endif // SEGMENT_MANIFEST_H
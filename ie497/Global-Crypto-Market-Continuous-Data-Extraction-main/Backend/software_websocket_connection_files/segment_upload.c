@@ -0,0 +1,320 @@
+/*
+ * Segment Upload
+ *
+ * Ships the export segments sealed by `crypto_ws --segments DIR` to a sink.
+ * It reads the manifest from where its last pass stopped, verifies each new
+ * segment against its manifest size and CRC-32, ships it, and records its
+ * progress after every segment. Segments never change once listed, so each
+ * one is shipped exactly once and nothing is re-sent on the next pass.
+ *
+ * Features:
+ *  - `--dir SINK`: Copies into a directory (a local stand-in for an object store, or a mount).
+ *  - `--put URL`: HTTP PUT of each segment to URL/<name> (an object-store endpoint or gateway).
+ *  - `--exec CMD`: Runs `sh -c CMD` with the segment path as $1, e.g. an `aws s3 cp`.
+ *  - `--watch SECONDS`: Repeats the pass on an interval instead of exiting.
+ *  - Progress (manifest offset and last seq) is kept in `--state FILE`, default `DIR/.uploaded`.
+ *    A failed segment stops the pass and is retried on the next one.
+ *
+ * Dependencies:
+ *  - segment_manifest.c (zlib), libcurl (for --put).
+ *  - Standard C libraries (stdio, stdlib, string, errno, fcntl, unistd, sys/stat, sys/wait).
+ *
+ * Usage:
+ *  make segment_upload
+ *  ./segment_upload DIR (--dir SINK | --put URL | --exec CMD) [--state FILE] [--watch SECONDS]
+ *  ./segment_upload segments --exec 'aws s3 cp --only-show-errors "$1" s3://crypto-json-storage/segments/' --watch 5
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "segment_manifest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <curl/curl.h>
+
+#define COPY_CHUNK_SIZE (256 * 1024)
+#define PUT_TIMEOUT 300
+
+typedef enum {
+    SINK_DIR,
+    SINK_PUT,
+    SINK_EXEC
+} SinkKind;
+
+typedef struct {
+    SinkKind kind;
+    const char *target;         // directory, URL prefix or command
+} Sink;
+
+typedef struct {
+    long offset;                // manifest bytes already handled
+    unsigned long long seq;     // last segment shipped
+} UploadState;
+
+static int load_state(const char *path, UploadState *state) {
+    state->offset = 0;
+    state->seq = 0;
+    FILE *fp = fopen(path, "r");
+    if (!fp) return errno == ENOENT ? 0 : -1;
+    int status = fscanf(fp, "%ld %llu", &state->offset, &state->seq) == 2 ? 0 : -1;
+    fclose(fp);
+    return status;
+}
+
+/* Written to a temporary file and renamed, so a crash leaves the old state or the new one */
+static int save_state(const char *path, const UploadState *state) {
+    char tmp[1024];
+    int len = snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    if (len < 0 || (size_t)len >= sizeof(tmp)) {
+        fprintf(stderr, "[ERROR] State file path too long: %s\n", path);
+        return -1;
+    }
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) return -1;
+    fprintf(fp, "%ld %llu\n", state->offset, state->seq);
+    int status = (fflush(fp) == 0 && fsync(fileno(fp)) == 0) ? 0 : -1;
+    if (fclose(fp) != 0) status = -1;
+    if (status == 0 && rename(tmp, path) != 0) status = -1;
+    return status;
+}
+
+/* ---------------------------------- Sinks --------------------------------- */
+
+static int ship_dir(const char *dir, const char *path, const char *name) {
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "[ERROR] Could not create %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    /* A cut-off name would be renamed over the wrong file */
+    char tmp[1024], final_path[1024];
+    int tmp_len = snprintf(tmp, sizeof(tmp), "%s/.%s.tmp", dir, name);
+    int final_len = snprintf(final_path, sizeof(final_path), "%s/%s", dir, name);
+    if (tmp_len < 0 || (size_t)tmp_len >= sizeof(tmp) || final_len < 0 || (size_t)final_len >= sizeof(final_path)) {
+        fprintf(stderr, "[ERROR] Destination path too long: %s/%s\n", dir, name);
+        return -1;
+    }
+
+    FILE *in = fopen(path, "rb");
+    FILE *out = fopen(tmp, "wb");
+    char *chunk = malloc(COPY_CHUNK_SIZE);
+    int status = (in && out && chunk) ? 0 : -1;
+
+    size_t n;
+    while (status == 0 && (n = fread(chunk, 1, COPY_CHUNK_SIZE, in)) > 0) {
+        if (fwrite(chunk, 1, n, out) != n) status = -1;
+    }
+    if (status == 0 && ferror(in)) status = -1;
+    if (out && (fflush(out) != 0 || fsync(fileno(out)) != 0)) status = -1;
+    if (out && fclose(out) != 0) status = -1;
+    if (in) fclose(in);
+    free(chunk);
+
+    if (status == 0 && rename(tmp, final_path) != 0) status = -1;
+    if (status != 0) {
+        fprintf(stderr, "[ERROR] Could not copy %s to %s: %s\n", name, dir, strerror(errno));
+        unlink(tmp);
+        return -1;
+    }
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    return 0;
+}
+
+static int ship_put(const char *prefix, const char *path, const char *name, uint64_t size) {
+    char url[2048];
+    size_t prefix_len = strlen(prefix);
+    snprintf(url, sizeof(url), "%.*s/%s", (int)(prefix_len && prefix[prefix_len - 1] == '/' ? prefix_len - 1 : prefix_len),
+             prefix, name);
+
+    FILE *in = fopen(path, "rb");
+    CURL *curl = curl_easy_init();
+    if (!in || !curl) {
+        fprintf(stderr, "[ERROR] Could not start upload of %s\n", name);
+        if (in) fclose(in);
+        if (curl) curl_easy_cleanup(curl);
+        return -1;
+    }
+
+    struct curl_slist *headers = curl_slist_append(NULL, "Content-Type: application/gzip");
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+    curl_easy_setopt(curl, CURLOPT_READDATA, in);
+    curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t)size);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, (long)PUT_TIMEOUT);
+
+    CURLcode result = curl_easy_perform(curl);
+    long code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+    fclose(in);
+
+    if (result != CURLE_OK) {
+        fprintf(stderr, "[ERROR] PUT %s failed: %s\n", url, curl_easy_strerror(result));
+        return -1;
+    }
+    if (code < 200 || code >= 300) {
+        fprintf(stderr, "[ERROR] PUT %s returned HTTP %ld\n", url, code);
+        return -1;
+    }
+    return 0;
+}
+
+static int ship_exec(const char *command, const char *path) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "[ERROR] fork failed: %s\n", strerror(errno));
+        return -1;
+    }
+    if (pid == 0) {
+        execl("/bin/sh", "sh", "-c", command, "sh", path, (char *)NULL);
+        _exit(127);
+    }
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return -1;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "[ERROR] Upload command failed for %s (status %d)\n", path,
+                WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        return -1;
+    }
+    return 0;
+}
+
+/* ---------------------------------- Pass ---------------------------------- */
+
+/* Ships every segment listed after the saved offset; returns the number shipped, or -1 */
+static int upload_pass(const char *segment_dir, const Sink *sink, const char *state_path, uint64_t *shipped_bytes) {
+    UploadState state;
+    if (load_state(state_path, &state) != 0) {
+        fprintf(stderr, "[ERROR] Could not read upload state %s\n", state_path);
+        return -1;
+    }
+
+    SegmentManifestReader reader;
+    if (segment_manifest_open(&reader, segment_dir, state.offset) != 0) return 0;   // nothing sealed yet
+
+    int shipped = 0, status;
+    SegmentEntry entry;
+    while ((status = segment_manifest_next(&reader, &entry)) != 0) {
+        if (status < 0) {
+            fprintf(stderr, "[WARNING] Skipping a malformed manifest line in %s\n", segment_dir);
+        } else if (entry.seq > state.seq) {
+            char path[1024];
+            snprintf(path, sizeof(path), "%s/%s", segment_dir, entry.name);
+
+            uint32_t crc;
+            uint64_t size;
+            if (segment_file_crc32(path, &crc, &size) != 0) {
+                fprintf(stderr, "[ERROR] Cannot read segment %s\n", path);
+                shipped = -1;
+                break;
+            }
+            if (crc != entry.crc32 || size != entry.bytes) {
+                fprintf(stderr, "[ERROR] Segment %s does not match its manifest line (crc %08x/%08x, %llu/%llu bytes)\n",
+                        path, (unsigned)crc, (unsigned)entry.crc32,
+                        (unsigned long long)size, (unsigned long long)entry.bytes);
+                shipped = -1;
+                break;
+            }
+
+            int result = (sink->kind == SINK_DIR) ? ship_dir(sink->target, path, entry.name)
+                       : (sink->kind == SINK_PUT) ? ship_put(sink->target, path, entry.name, size)
+                       : ship_exec(sink->target, path);
+            if (result != 0) {
+                shipped = -1;
+                break;
+            }
+
+            state.seq = entry.seq;
+            shipped++;
+            *shipped_bytes += size;
+            printf("[INFO] Shipped %s (%llu records, %llu bytes)\n", entry.name,
+                   (unsigned long long)entry.records, (unsigned long long)size);
+        }
+
+        state.offset = reader.offset;
+        if (save_state(state_path, &state) != 0) {
+            fprintf(stderr, "[ERROR] Could not write upload state %s\n", state_path);
+            shipped = -1;
+            break;
+        }
+    }
+
+    segment_manifest_close(&reader);
+    return shipped;
+}
+
+int main(int argc, char **argv) {
+    const char *segment_dir = NULL;
+    const char *state_path = NULL;
+    Sink sink = { SINK_DIR, NULL };
+    int watch = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+            sink.kind = SINK_DIR;
+            sink.target = argv[++i];
+        } else if (strcmp(argv[i], "--put") == 0 && i + 1 < argc) {
+            sink.kind = SINK_PUT;
+            sink.target = argv[++i];
+        } else if (strcmp(argv[i], "--exec") == 0 && i + 1 < argc) {
+            sink.kind = SINK_EXEC;
+            sink.target = argv[++i];
+        } else if (strcmp(argv[i], "--state") == 0 && i + 1 < argc) {
+            state_path = argv[++i];
+        } else if (strcmp(argv[i], "--watch") == 0 && i + 1 < argc) {
+            watch = atoi(argv[++i]);
+        } else if (argv[i][0] != '-' && !segment_dir) {
+            segment_dir = argv[i];
+        } else {
+            segment_dir = NULL;
+            break;
+        }
+    }
+    if (!segment_dir || !sink.target) {
+        fprintf(stderr, "[ERROR] Usage: %s DIR (--dir SINK | --put URL | --exec CMD) [--state FILE] [--watch SECONDS]\n",
+                argv[0]);
+        return 1;
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);      // progress lines reach logs as they happen under --watch
+
+    char default_state[1024];
+    if (!state_path) {
+        snprintf(default_state, sizeof(default_state), "%s/.uploaded", segment_dir);
+        state_path = default_state;
+    }
+    if (sink.kind == SINK_PUT) curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    int status = 0;
+    do {
+        uint64_t bytes = 0;
+        int shipped = upload_pass(segment_dir, &sink, state_path, &bytes);
+        if (shipped > 0)
+            printf("[INFO] Pass complete: %d segment(s), %.2f MB\n", shipped, (double)bytes / (1024.0 * 1024.0));
+        status = (shipped < 0);
+        if (watch > 0) sleep((unsigned)watch);
+    } while (watch > 0);
+
+    if (sink.kind == SINK_PUT) curl_global_cleanup();
+    return status;
+}
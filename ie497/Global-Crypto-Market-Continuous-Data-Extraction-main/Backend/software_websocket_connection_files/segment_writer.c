@@ -0,0 +1,451 @@
+/*
+ * Segment Writer
+ *
+ * This module writes the export segments. Each kind (ticker, trades) has at
+ * most one open segment, a gzip stream written to `<dir>/.open_<kind>.jsonl.gz`.
+ * Sealing finishes the stream, fsyncs it, renames it to
+ * `<kind>_<seq>_<YYYYMMDDTHHMMSSZ>.jsonl.gz` and only then appends its manifest
+ * line, so everything the manifest lists is complete and immutable.
+ *
+ * Features:
+ *  - Entries are compressed as they arrive; nothing is buffered beyond zlib's window.
+ *  - The manifest carries the CRC-32 and size of the .gz file; gzip's own trailer
+ *    checks the JSON lines inside.
+ *  - Sequence numbers continue from the manifest after a restart.
+ *  - One mutex per kind serializes writer-thread appends with housekeeping seals.
+ *  - A segment left open by a crash is sealed at startup: its complete lines are read back
+ *    (up to where the crash cut the gzip stream) and compressed into a new segment. It is moved
+ *    to `.recover_<kind>.jsonl.gz` first and removed once the new segment is sealed.
+ *  - A segment sealed by a crash just before its manifest line is listed at startup, with its
+ *    records and sizes read back from the file (first_ns/last_ns are not kept in it and stay 0).
+ *    One that does not read back cleanly, or whose manifest line failed while running, is
+ *    renamed to `.unlisted_<name>` so that it is kept but never shipped.
+ *
+ * Dependencies:
+ *  - segment_manifest.h, zlib.
+ *  - Standard C libraries (stdio, stdlib, string, time, errno, fcntl, pthread, unistd, dirent, sys/stat).
+ *
+ * Usage:
+ *  - Enabled by `crypto_ws --segments DIR`; fed from `utils.c`, sealed from `main.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "segment_writer.h"
+#include "segment_manifest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+/* zlib's default level: JSON lines shrink about 8x at a few ns per byte */
+#define SEGMENT_COMPRESSION_LEVEL 6
+
+/* Compressed output is written in chunks of this size */
+#define SEGMENT_OUT_CHUNK (64 * 1024)
+
+/* Unlisted sealed segments looked for at startup (a crash leaves at most one per kind) */
+#define SEGMENT_RECOVER_MAX 64
+
+/* One open segment */
+typedef struct {
+    pthread_mutex_t lock;
+    FILE *fp;                   // NULL while no segment is open
+    z_stream zs;
+    int failed;                 // a write failed; the segment is dropped at the seal
+    uint32_t crc;               // of the compressed bytes written so far
+    uint64_t records;
+    uint64_t raw_bytes;
+    uint64_t bytes;
+    int64_t first_ns;
+    int64_t last_ns;
+    time_t opened;
+    unsigned char out[SEGMENT_OUT_CHUNK];
+} SegmentStream;
+
+static SegmentStream streams[SEGMENT_KIND_COUNT] = {
+    { .lock = PTHREAD_MUTEX_INITIALIZER },
+    { .lock = PTHREAD_MUTEX_INITIALIZER },
+};
+
+static const char *kind_names[SEGMENT_KIND_COUNT] = { "ticker", "trades" };
+
+static char segment_dir[256];
+static uint64_t max_raw_bytes = (uint64_t)SEGMENT_DEFAULT_MB * 1024 * 1024;
+static int max_age = SEGMENT_DEFAULT_SECONDS;
+static int segment_enabled = 0;
+
+/* Sequence numbers, manifest appends and stats are shared by both kinds */
+static pthread_mutex_t seal_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t next_seq = 1;
+static SegmentStats stats;
+
+static void recover_open_segment(SegmentKind kind);
+
+static void open_path(SegmentKind kind, char *path, size_t size) {
+    snprintf(path, size, "%s/.open_%s.jsonl.gz", segment_dir, kind_names[kind]);
+}
+
+/* Moves a sealed segment that cannot be listed out of the way, under a name nothing reads */
+static void quarantine(const char *name) {
+    char path[512], moved[512];
+    snprintf(path, sizeof(path), "%s/%s", segment_dir, name);
+    snprintf(moved, sizeof(moved), "%s/.unlisted_%s", segment_dir, name);
+    if (rename(path, moved) == 0)
+        printf("[ERROR] Export segment %s is not in the manifest; kept as .unlisted_%s\n", name, name);
+    else
+        printf("[ERROR] Export segment %s is not in the manifest and could not be moved: %s\n", name, strerror(errno));
+}
+
+/* Sequence number of a sealed segment name ("trades_00000042_20261018T120000Z.jsonl.gz"), or 0 */
+static uint64_t sealed_seq(const char *name) {
+    for (int kind = 0; kind < SEGMENT_KIND_COUNT; kind++) {
+        size_t len = strlen(kind_names[kind]);
+        if (strncmp(name, kind_names[kind], len) != 0 || name[len] != '_') continue;
+
+        char *end;
+        unsigned long long seq = strtoull(name + len + 1, &end, 10);
+        size_t name_len = strlen(name);
+        if (end == name + len + 1 || *end != '_' || name_len < 9 || strcmp(name + name_len - 9, ".jsonl.gz") != 0)
+            return 0;
+        return (uint64_t)seq;
+    }
+    return 0;
+}
+
+/* Fills a manifest entry from the segment file itself. Returns 0, or -1 if it does not read back cleanly. */
+static int read_back(SegmentEntry *entry) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", segment_dir, entry->name);
+    if (segment_file_crc32(path, &entry->crc32, &entry->bytes) != 0) return -1;
+
+    gzFile gz = gzopen(path, "rb");
+    if (!gz) return -1;
+    unsigned char *chunk = malloc(SEGMENT_OUT_CHUNK);
+    if (!chunk) {
+        gzclose(gz);
+        return -1;
+    }
+
+    int n;
+    while ((n = gzread(gz, chunk, SEGMENT_OUT_CHUNK)) > 0) {
+        entry->raw_bytes += (uint64_t)n;
+        for (unsigned char *p = chunk; (p = memchr(p, '\n', (size_t)(chunk + n - p))) != NULL; p++)
+            entry->records++;
+    }
+    free(chunk);
+    /* gzclose reports a truncated stream or a bad gzip trailer */
+    return (gzclose(gz) == Z_OK && n == 0) ? 0 : -1;
+}
+
+static int compare_seq(const void *a, const void *b) {
+    uint64_t x = ((const SegmentEntry *)a)->seq, y = ((const SegmentEntry *)b)->seq;
+    return (x > y) - (x < y);
+}
+
+/* Lists segments renamed into place after the manifest's last line, i.e. sealed by a crash
+ * between the rename and the manifest append */
+static void recover_unlisted(void) {
+    DIR *dir = opendir(segment_dir);
+    if (!dir) return;
+
+    SegmentEntry found[SEGMENT_RECOVER_MAX];
+    int count = 0;
+    struct dirent *de;
+    while (count < SEGMENT_RECOVER_MAX && (de = readdir(dir)) != NULL) {
+        uint64_t seq = sealed_seq(de->d_name);
+        if (seq == 0 || seq < next_seq || strlen(de->d_name) >= SEGMENT_NAME_SIZE) continue;
+
+        SegmentEntry *entry = &found[count++];
+        memset(entry, 0, sizeof(*entry));
+        entry->seq = seq;
+        snprintf(entry->name, sizeof(entry->name), "%s", de->d_name);
+        snprintf(entry->kind, sizeof(entry->kind), "%.*s", (int)strcspn(de->d_name, "_"), de->d_name);
+    }
+    closedir(dir);
+
+    qsort(found, (size_t)count, sizeof(SegmentEntry), compare_seq);
+    for (int i = 0; i < count; i++) {
+        if (read_back(&found[i]) == 0 && segment_manifest_append(segment_dir, &found[i]) == 0)
+            printf("[WARNING] Listed export segment %s, sealed by the previous run but missing from the manifest\n",
+                   found[i].name);
+        else
+            quarantine(found[i].name);
+        next_seq = found[i].seq + 1;
+    }
+}
+
+int segment_writer_open(const char *dir, int max_mb, int max_seconds) {
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        printf("[ERROR] Could not create segment directory %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    snprintf(segment_dir, sizeof(segment_dir), "%s", dir);
+    if (max_mb > 0) max_raw_bytes = (uint64_t)max_mb * 1024 * 1024;
+    if (max_seconds > 0) max_age = max_seconds;
+
+    /* Continue the sequence of an existing manifest */
+    SegmentManifestReader reader;
+    if (segment_manifest_open(&reader, segment_dir, 0) == 0) {
+        SegmentEntry entry;
+        int status;
+        while ((status = segment_manifest_next(&reader, &entry)) != 0) {
+            if (status > 0 && entry.seq >= next_seq) next_seq = entry.seq + 1;
+        }
+        segment_manifest_close(&reader);
+    }
+    recover_unlisted();
+    for (int kind = 0; kind < SEGMENT_KIND_COUNT; kind++)
+        recover_open_segment((SegmentKind)kind);
+
+    segment_enabled = 1;
+    printf("[INFO] Writing export segments to %s/ (sealed at %llu MB or %d s, next seq %llu)\n", segment_dir,
+           (unsigned long long)(max_raw_bytes / (1024 * 1024)), max_age, (unsigned long long)next_seq);
+    return 0;
+}
+
+int segment_writer_enabled(void) {
+    return segment_enabled;
+}
+
+static void write_out(SegmentStream *stream, size_t len) {
+    if (len == 0 || stream->failed) return;
+    if (fwrite(stream->out, 1, len, stream->fp) != len) {
+        printf("[ERROR] Failed to write export segment: %s\n", strerror(errno));
+        stream->failed = 1;
+        return;
+    }
+    stream->crc = (uint32_t)crc32(stream->crc, stream->out, (uInt)len);
+    stream->bytes += len;
+}
+
+/* Runs `data` through the deflate stream, writing every full output chunk */
+static void deflate_data(SegmentStream *stream, const void *data, size_t len, int flush) {
+    stream->zs.next_in = (Bytef *)data;
+    stream->zs.avail_in = (uInt)len;
+    do {
+        stream->zs.next_out = stream->out;
+        stream->zs.avail_out = SEGMENT_OUT_CHUNK;
+        if (deflate(&stream->zs, flush) == Z_STREAM_ERROR) {
+            stream->failed = 1;
+            return;
+        }
+        write_out(stream, SEGMENT_OUT_CHUNK - stream->zs.avail_out);
+    } while (stream->zs.avail_out == 0);
+}
+
+static int open_stream(SegmentStream *stream, SegmentKind kind, int64_t ts_ns) {
+    char path[512];
+    open_path(kind, path, sizeof(path));
+
+    stream->fp = fopen(path, "wb");
+    if (!stream->fp) {
+        printf("[ERROR] Failed to open export segment %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    memset(&stream->zs, 0, sizeof(stream->zs));
+    if (deflateInit2(&stream->zs, SEGMENT_COMPRESSION_LEVEL, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        printf("[ERROR] Failed to start compressing export segment %s\n", path);
+        fclose(stream->fp);
+        stream->fp = NULL;
+        unlink(path);
+        return -1;
+    }
+
+    stream->failed = 0;
+    stream->crc = (uint32_t)crc32(0L, Z_NULL, 0);
+    stream->records = 0;
+    stream->raw_bytes = 0;
+    stream->bytes = 0;
+    stream->first_ns = ts_ns;
+    stream->last_ns = ts_ns;
+    stream->opened = time(NULL);
+    return 0;
+}
+
+static void sync_dir(void) {
+    int fd = open(segment_dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+}
+
+/* Finishes, renames and lists the open segment of `kind`; the caller holds its lock.
+ * Returns 0 once the file is in place under its sealed name, -1 if it was dropped. */
+static int seal_stream(SegmentStream *stream, SegmentKind kind) {
+    if (!stream->fp) return -1;
+
+    char path[512];
+    open_path(kind, path, sizeof(path));
+
+    deflate_data(stream, NULL, 0, Z_FINISH);
+    deflateEnd(&stream->zs);
+    if (fflush(stream->fp) != 0 || fsync(fileno(stream->fp)) != 0) stream->failed = 1;
+    if (fclose(stream->fp) != 0) stream->failed = 1;
+    stream->fp = NULL;
+
+    if (stream->failed) {
+        printf("[ERROR] Dropped %s export segment of %llu records after a write error\n",
+               kind_names[kind], (unsigned long long)stream->records);
+        unlink(path);
+        return -1;
+    }
+
+    int status = 0;
+    pthread_mutex_lock(&seal_lock);
+    SegmentEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.seq = next_seq;
+
+    struct tm tm;
+    gmtime_r(&stream->opened, &tm);
+    snprintf(entry.name, sizeof(entry.name), "%s_%08llu_%04d%02d%02dT%02d%02d%02dZ.jsonl.gz",
+             kind_names[kind], (unsigned long long)entry.seq, tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+             tm.tm_hour, tm.tm_min, tm.tm_sec);
+    snprintf(entry.kind, sizeof(entry.kind), "%s", kind_names[kind]);
+    entry.records = stream->records;
+    entry.raw_bytes = stream->raw_bytes;
+    entry.bytes = stream->bytes;
+    entry.crc32 = stream->crc;
+    entry.first_ns = stream->first_ns;
+    entry.last_ns = stream->last_ns;
+
+    char final_path[512];
+    snprintf(final_path, sizeof(final_path), "%s/%s", segment_dir, entry.name);
+    if (rename(path, final_path) != 0) {
+        printf("[ERROR] Failed to seal export segment %s: %s\n", final_path, strerror(errno));
+        unlink(path);
+        status = -1;
+    } else {
+        sync_dir();
+        next_seq++;     // the name is taken even if the manifest line fails
+        if (segment_manifest_append(segment_dir, &entry) == 0) {
+            stats.segments++;
+            stats.records += entry.records;
+            stats.raw_bytes += entry.raw_bytes;
+            stats.bytes += entry.bytes;
+        } else {
+            /* Later segments take higher numbers, so a restart would not find this one either */
+            printf("[ERROR] Failed to add export segment %s to the manifest\n", entry.name);
+            quarantine(entry.name);
+        }
+    }
+    pthread_mutex_unlock(&seal_lock);
+    return status;
+}
+
+/* Seals what a crash left in the open segment of `kind`: every complete line before the point
+ * where its gzip stream was cut is compressed again into a new segment */
+static void recover_open_segment(SegmentKind kind) {
+    char path[512], moved[512];
+    open_path(kind, path, sizeof(path));
+    snprintf(moved, sizeof(moved), "%s/.recover_%s.jsonl.gz", segment_dir, kind_names[kind]);
+
+    /* A .recover_ file left behind means the last recovery was cut short; it is redone */
+    if (access(moved, F_OK) == 0) unlink(path);
+    else if (rename(path, moved) != 0) return;
+
+    SegmentStream *stream = &streams[kind];
+    gzFile gz = gzopen(moved, "rb");
+    char *line = malloc(SEGMENT_OUT_CHUNK);
+    if (!gz || !line || open_stream(stream, kind, 0) != 0) {
+        printf("[ERROR] Could not recover the unsealed %s segment; kept as %s for the next start\n",
+               kind_names[kind], moved);
+        if (gz) gzclose(gz);
+        free(line);
+        return;
+    }
+
+    pthread_mutex_lock(&stream->lock);
+    while (gzgets(gz, line, SEGMENT_OUT_CHUNK) != NULL) {
+        size_t len = strlen(line);
+        if (len == 0 || line[len - 1] != '\n') break;     // the line the crash cut off
+        deflate_data(stream, line, len, Z_NO_FLUSH);
+        stream->records++;
+        stream->raw_bytes += len;
+    }
+    gzclose(gz);
+    free(line);
+
+    uint64_t records = stream->records;
+    int status = 0;
+    if (records == 0) {
+        deflateEnd(&stream->zs);
+        fclose(stream->fp);
+        stream->fp = NULL;
+        unlink(path);
+    } else {
+        status = seal_stream(stream, kind);
+    }
+    pthread_mutex_unlock(&stream->lock);
+
+    if (status != 0) {
+        printf("[ERROR] Could not seal the recovered %s segment; kept as %s for the next start\n",
+               kind_names[kind], moved);
+        return;
+    }
+    unlink(moved);
+    if (records == 0)
+        printf("[INFO] Removed an unsealed %s segment from the previous run with no complete entries\n", kind_names[kind]);
+    else
+        printf("[WARNING] Sealed %llu entries of an unsealed %s segment from the previous run\n",
+               (unsigned long long)records, kind_names[kind]);
+}
+
+void segment_writer_append(SegmentKind kind, int64_t ts_ns, const char *line, size_t len) {
+    if (!segment_enabled || kind >= SEGMENT_KIND_COUNT) return;
+    SegmentStream *stream = &streams[kind];
+
+    pthread_mutex_lock(&stream->lock);
+    if (stream->fp || open_stream(stream, kind, ts_ns) == 0) {
+        deflate_data(stream, line, len, Z_NO_FLUSH);
+        deflate_data(stream, "\n", 1, Z_NO_FLUSH);
+        stream->records++;
+        stream->raw_bytes += len + 1;
+        if (ts_ns < stream->first_ns) stream->first_ns = ts_ns;
+        if (ts_ns > stream->last_ns) stream->last_ns = ts_ns;
+
+        if (stream->raw_bytes >= max_raw_bytes) seal_stream(stream, kind);
+    }
+    pthread_mutex_unlock(&stream->lock);
+}
+
+void segment_writer_flush(int force) {
+    static time_t last_flush = 0;
+    if (!segment_enabled) return;
+
+    /* Called every housekeeping tick; segments age on a seconds scale */
+    time_t now = time(NULL);
+    if (!force && now == last_flush) return;
+    last_flush = now;
+
+    for (int kind = 0; kind < SEGMENT_KIND_COUNT; kind++) {
+        SegmentStream *stream = &streams[kind];
+        pthread_mutex_lock(&stream->lock);
+        if (stream->fp && (force || now - stream->opened >= max_age)) seal_stream(stream, (SegmentKind)kind);
+        pthread_mutex_unlock(&stream->lock);
+    }
+}
+
+void segment_writer_close_all(void) {
+    if (!segment_enabled) return;
+    segment_writer_flush(1);
+    segment_enabled = 0;
+}
+
+void segment_writer_stats(SegmentStats *out) {
+    pthread_mutex_lock(&seal_lock);
+    *out = stats;
+    pthread_mutex_unlock(&seal_lock);
+}
@@ -0,0 +1,72 @@
+/*
+ * Segment Writer Header
+ *
+ * Declares the export segment sink. Ticker and trade entries, serialized exactly
+ * as in the JSON snapshot files, are gzip-compressed into one open segment per
+ * kind. A segment is sealed on a size or age boundary: it is finished, fsynced,
+ * renamed to its final name and listed in `<dir>/manifest.tsv` (`segment_manifest.h`).
+ * A sealed segment never changes, so an uploader ships each one exactly once
+ * instead of copying the whole snapshot files again and again.
+ *
+ * Features:
+ *  - segment_writer_open(): Enables segments (`crypto_ws --segments DIR [--segment-mb N]
+ *    [--segment-seconds S]`).
+ *  - segment_writer_append(): Compresses one entry into its kind's open segment; a no-op when disabled.
+ *  - segment_writer_flush(): Seals segments that reached their age; called from housekeeping.
+ *  - segment_writer_close_all(): Seals every open segment.
+ *
+ * Dependencies:
+ *  - segment_manifest.h, zlib.
+ *
+ * Usage:
+ *  - Fed from log_ticker_price() / log_trade_price() in `utils.c` on the ingest writer threads.
+ *  - `segment_upload` ships the sealed segments listed in the manifest.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef SEGMENT_WRITER_H
+#define SEGMENT_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* A segment is sealed once it holds this many MB of JSON lines before compression... */
+#define SEGMENT_DEFAULT_MB 64
+
+/* ...or once its first entry is this many seconds old */
+#define SEGMENT_DEFAULT_SECONDS 60
+
+typedef enum {
+    SEGMENT_TICKER,
+    SEGMENT_TRADES,
+    SEGMENT_KIND_COUNT
+} SegmentKind;
+
+typedef struct {
+    uint64_t segments;          // sealed since startup
+    uint64_t records;
+    uint64_t raw_bytes;         // JSON lines before compression
+    uint64_t bytes;             // sealed .gz bytes
+} SegmentStats;
+
+/* Starts writing segments to `dir` (created if missing), sealing each at `max_mb` MB of JSON or
+ * `max_seconds` seconds, whichever comes first. Returns 0 or -1. */
+int segment_writer_open(const char *dir, int max_mb, int max_seconds);
+
+/* Non-zero once segment_writer_open() succeeded. */
+int segment_writer_enabled(void);
+
+/* Appends one serialized entry (without newline) with its record time. */
+void segment_writer_append(SegmentKind kind, int64_t ts_ns, const char *line, size_t len);
+
+/* Seals segments whose first entry is older than the age limit (every open one if forced). */
+void segment_writer_flush(int force);
+
+/* Seals every open segment and disables the writer. */
+void segment_writer_close_all(void);
+
+void segment_writer_stats(SegmentStats *stats);
+
+#endif // SEGMENT_WRITER_H
@@ -0,0 +1,568 @@
+/*
+ * Subscription Cache
+ *
+ * This module compiles the subscribe messages of every connection once and keeps
+ * them in memory, ready for lws_write(). Reconnects used to re-read the product
+ * lists and rebuild the JSON with repeated strcat()/strncat() calls, which is
+ * quadratic in the number of symbols; now a reconnect only writes buffers.
+ *
+ * Features:
+ *  - Frames are built with an appending buffer (amortized doubling), linear in symbol count.
+ *  - Each frame carries LWS_PRE bytes of headroom, so sending needs no copy or allocation.
+ *  - Binance / OKX: one frame per chunk; Huobi: a ticker and a trade frame per symbol;
+ *    Kraken: a ticker and a trade frame per SUBSCRIPTION_KRAKEN_CHUNK pairs; Coinbase and
+ *    Bitfinex: one frame. Chunk symbols come from the connection table.
+ *  - Depth channels (Binance depth diffs, OKX books, Coinbase level2_batch, one Kraken book
+ *    frame) are added for the symbols that keep an order book (`order_book.c`).
+ *  - The product lists are checked for changes from the housekeeping loop. Coinbase and Kraken
+ *    are recompiled in place; chunked exchanges keep their layout until the next start.
+ *  - Compiled sets are swapped atomically. A replaced set is freed one refresh interval
+ *    later, long after any service thread could still be writing it.
+ *  - Counts the time spent sending and the time from connect to the first record.
+ *
+ * Dependencies:
+ *  - libwebsockets: lws_write(), LWS_PRE.
+ *  - jansson: Kraken pair list, Coinbase book products.
+ *  - Standard C libraries (stdio, stdlib, string, stdarg, pthread, time, sys/stat).
+ *
+ * Usage:
+ *  - `subscription_cache_build()` runs in `main.c` after the connection table is built.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "subscription_cache.h"
+#include "connection_table.h"
+#include "symbol_table.h"
+#include "order_book.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <jansson.h>
+
+/* One ready-to-send frame: LWS_PRE bytes of headroom, then `len` bytes of text */
+typedef struct {
+    unsigned char *buf;
+    size_t len;
+} SubscriptionFrame;
+
+typedef struct SubscriptionSet {
+    SubscriptionFrame *frames;
+    int count;
+    time_t retired;                     // when it was replaced, for the deferred free
+    struct SubscriptionSet *next;       // retired list
+} SubscriptionSet;
+
+/* Growing text buffer that starts with LWS_PRE bytes of headroom */
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t capacity;
+    int failed;
+} FrameBuilder;
+
+/* Product list watched for changes */
+typedef struct {
+    const char *file;
+    ExchangeId exchange;
+    time_t mtime;
+    off_t size;
+} WatchedFile;
+
+static SubscriptionSet *sets[MAX_CONNECTIONS];
+
+static WatchedFile watched[] = {
+    { "coinbase_currency_ids.txt", EXCHANGE_COINBASE, 0, 0 },
+    { "kraken_currency_ids.txt", EXCHANGE_KRAKEN, 0, 0 },
+    { "binance_currency_ids_trades.txt", EXCHANGE_BINANCE, 0, 0 },
+    { "huobi_currency_ids.txt", EXCHANGE_HUOBI, 0, 0 },
+    { "okx_currency_ids.txt", EXCHANGE_OKX, 0, 0 },
+};
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static SubscriptionSet *retired_sets = NULL;
+static SubscriptionStats stats;
+static time_t last_refresh = 0;
+
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* ---------------------------------- Builders -------------------------------- */
+
+static void builder_reserve(FrameBuilder *b, size_t extra) {
+    if (b->failed || b->len + extra <= b->capacity) return;
+
+    size_t capacity = b->capacity ? b->capacity : 256;
+    while (b->len + extra > capacity) capacity *= 2;
+    unsigned char *data = realloc(b->data, LWS_PRE + capacity + 1);
+    if (!data) {
+        b->failed = 1;
+        return;
+    }
+    b->data = data;
+    b->capacity = capacity;
+}
+
+static void builder_append(FrameBuilder *b, const char *text, size_t len) {
+    builder_reserve(b, len);
+    if (b->failed) return;
+    memcpy(b->data + LWS_PRE + b->len, text, len);
+    b->len += len;
+}
+
+static void builder_appendf(FrameBuilder *b, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int needed = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+    if (needed < 0) {
+        b->failed = 1;
+        return;
+    }
+
+    builder_reserve(b, (size_t)needed);
+    if (b->failed) return;
+    va_start(args, fmt);
+    vsnprintf((char *)b->data + LWS_PRE + b->len, (size_t)needed + 1, fmt, args);
+    va_end(args);
+    b->len += (size_t)needed;
+}
+
+/* Moves a finished frame into the set; an empty or failed frame marks the set as failed.
+ * The builder is left empty either way. */
+static int set_add(SubscriptionSet *set, int *capacity, FrameBuilder *b) {
+    if (b->failed || !b->data) {
+        free(b->data);
+        memset(b, 0, sizeof(*b));
+        return -1;
+    }
+    if (set->count == *capacity) {
+        int grown = *capacity ? *capacity * 2 : 4;
+        SubscriptionFrame *frames = realloc(set->frames, (size_t)grown * sizeof(*frames));
+        if (!frames) {
+            free(b->data);
+            memset(b, 0, sizeof(*b));
+            return -1;
+        }
+        set->frames = frames;
+        *capacity = grown;
+    }
+    set->frames[set->count].buf = b->data;
+    set->frames[set->count].len = b->len;
+    set->count++;
+    memset(b, 0, sizeof(*b));
+    return 0;
+}
+
+static void set_free(SubscriptionSet *set) {
+    if (!set) return;
+    for (int i = 0; i < set->count; i++) free(set->frames[i].buf);
+    free(set->frames);
+    free(set);
+}
+
+/* Whole product list file, trailing whitespace removed */
+static char *read_list(const char *file, size_t *len) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", CURRENCY_FILES_DIR, file);
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "[ERROR] Could not open %s\n", path);
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long fsize = ftell(fp);
+    rewind(fp);
+    char *text = (fsize >= 0) ? malloc((size_t)fsize + 1) : NULL;
+    if (!text) {
+        fclose(fp);
+        fprintf(stderr, "[ERROR] Memory allocation failed\n");
+        return NULL;
+    }
+    size_t n = fread(text, 1, (size_t)fsize, fp);
+    fclose(fp);
+
+    while (n > 0 && (text[n - 1] == '\n' || text[n - 1] == '\r' || text[n - 1] == ' ')) n--;
+    text[n] = '\0';
+    *len = n;
+    return text;
+}
+
+/* The chunked exchanges take an op so that the same frames can also be built to unsubscribe */
+static int compile_binance(int index, const char *op, SubscriptionSet *set, int *capacity) {
+    int count = connection_symbol_count(index);
+    if (count == 0) return 0;
+
+    FrameBuilder b = {0};
+    builder_reserve(&b, (size_t)count * 48 + 64);
+    builder_appendf(&b, "{\"method\": \"%s\", \"params\": [", op);
+    for (int i = 0; i < count; i++) {
+        const char *symbol = connection_symbol(index, i);
+        builder_appendf(&b, "%s\"%s@ticker\",\"%s@trade\"", i ? "," : "", symbol, symbol);
+        if (order_book_wants(symbol_intern(symbol, strlen(symbol))))
+            builder_appendf(&b, ",\"%s@depth@100ms\"", symbol);
+    }
+    builder_appendf(&b, "], \"id\": 1}");
+    return set_add(set, capacity, &b);
+}
+
+static int compile_okx(int index, const char *op, SubscriptionSet *set, int *capacity) {
+    int count = connection_symbol_count(index);
+    if (count == 0) return 0;
+
+    const char *channels[] = { "tickers", "trades", "books" };
+    FrameBuilder b = {0};
+    builder_reserve(&b, (size_t)count * 144 + 64);
+    builder_appendf(&b, "{\"op\": \"%s\", \"args\": [", op);
+    for (int c = 0; c < 3; c++) {
+        for (int i = 0; i < count; i++) {
+            const char *symbol = connection_symbol(index, i);
+            if (c == 2 && !order_book_wants(symbol_intern(symbol, strlen(symbol)))) continue;
+            builder_appendf(&b, "%s{\"channel\": \"%s\", \"instId\": \"%s\"}",
+                            (c || i) ? ", " : "", channels[c], symbol);
+        }
+    }
+    builder_appendf(&b, "]}");
+    return set_add(set, capacity, &b);
+}
+
+static int compile_huobi(int index, const char *op, SubscriptionSet *set, int *capacity) {
+    for (int i = 0; i < connection_symbol_count(index); i++) {
+        const char *symbol = connection_symbol(index, i);
+        FrameBuilder ticker = {0}, trade = {0};
+        builder_appendf(&ticker, "{\"%s\": \"market.%s.ticker\", \"id\": \"huobi_%s_ticker\"}", op, symbol, symbol);
+        builder_appendf(&trade, "{\"%s\": \"market.%s.trade.detail\", \"id\": \"huobi_%s_trade\"}", op, symbol, symbol);
+        /* set_add() frees a frame it cannot take; one not yet added is freed here */
+        if (set_add(set, capacity, &ticker) != 0) {
+            free(trade.data);
+            return -1;
+        }
+        if (set_add(set, capacity, &trade) != 0) return -1;
+    }
+    return 0;
+}
+
+static int compile_coinbase(SubscriptionSet *set, int *capacity) {
+    size_t len;
+    char *list = read_list("coinbase_currency_ids.txt", &len);
+    if (!list) return -1;
+
+    FrameBuilder b = {0};
+    builder_reserve(&b, 2 * len + 128);
+    builder_appendf(&b, "{\"type\": \"subscribe\", \"channels\": [{ \"name\": \"ticker\", \"product_ids\": ");
+    builder_append(&b, list, len);
+    builder_appendf(&b, " },{ \"name\": \"matches\", \"product_ids\": ");
+    builder_append(&b, list, len);
+    builder_appendf(&b, " }");
+
+    /* level2_batch for the products that keep a book (the list is a JSON array of IDs) */
+    json_t *products = order_book_enabled() ? json_loadb(list, len, 0, NULL) : NULL;
+    int books = 0;
+    for (size_t i = 0; json_is_array(products) && i < json_array_size(products); i++) {
+        const char *product = json_string_value(json_array_get(products, i));
+        if (!product || !order_book_wants(symbol_intern(product, strlen(product)))) continue;
+        builder_appendf(&b, "%s\"%s\"", books++ ? ", " : ",{ \"name\": \"level2_batch\", \"product_ids\": [", product);
+    }
+    if (books) builder_appendf(&b, "] }");
+    if (products) json_decref(products);
+
+    builder_appendf(&b, " ]}");
+    free(list);
+    return set_add(set, capacity, &b);
+}
+
+static int compile_kraken(SubscriptionSet *set, int *capacity) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/kraken_currency_ids.txt", CURRENCY_FILES_DIR);
+
+    json_error_t error;
+    json_t *pair_array = json_load_file(path, 0, &error);
+    if (!pair_array || !json_is_array(pair_array)) {
+        fprintf(stderr, "[ERROR] Failed to parse JSON array: %s\n", error.text);
+        if (pair_array) json_decref(pair_array);
+        return -1;
+    }
+
+    const char *channels[] = { "ticker", "trade" };
+    size_t total = json_array_size(pair_array);
+    int status = 0;
+    for (size_t i = 0; i < total && status == 0; i += SUBSCRIPTION_KRAKEN_CHUNK) {
+        json_t *chunk = json_array();
+        size_t end = (i + SUBSCRIPTION_KRAKEN_CHUNK > total) ? total : i + SUBSCRIPTION_KRAKEN_CHUNK;
+        for (size_t j = i; j < end; j++)
+            json_array_append(chunk, json_array_get(pair_array, j));
+
+        char *pair_list_str = json_dumps(chunk, JSON_ENSURE_ASCII);
+        json_decref(chunk);
+        if (!pair_list_str) {
+            fprintf(stderr, "[ERROR] Failed to serialize chunk JSON\n");
+            status = -1;
+            break;
+        }
+
+        for (int c = 0; c < 2 && status == 0; c++) {
+            FrameBuilder b = {0};
+            builder_appendf(&b, "{\"event\": \"subscribe\", \"pair\": %s, \"subscription\": {\"name\": \"%s\"}}",
+                            pair_list_str, channels[c]);
+            status = set_add(set, capacity, &b);
+        }
+        free(pair_list_str);
+    }
+
+    /* One book frame for the pairs that keep a book */
+    json_t *book_pairs = order_book_enabled() ? json_array() : NULL;
+    for (size_t i = 0; book_pairs && i < total; i++) {
+        const char *pair = json_string_value(json_array_get(pair_array, i));
+        if (pair && order_book_wants(symbol_intern(pair, strlen(pair))))
+            json_array_append(book_pairs, json_array_get(pair_array, i));
+    }
+    if (status == 0 && book_pairs && json_array_size(book_pairs) > 0) {
+        char *pair_list_str = json_dumps(book_pairs, JSON_ENSURE_ASCII);
+        FrameBuilder b = {0};
+        if (pair_list_str)
+            builder_appendf(&b, "{\"event\": \"subscribe\", \"pair\": %s, \"subscription\": {\"name\": \"book\", \"depth\": %d}}",
+                            pair_list_str, BOOK_KRAKEN_DEPTH);
+        status = set_add(set, capacity, &b);
+        free(pair_list_str);
+    }
+    if (book_pairs) json_decref(book_pairs);
+
+    json_decref(pair_array);
+    return status;
+}
+
+static int compile_bitfinex(SubscriptionSet *set, int *capacity) {
+    FrameBuilder b = {0};
+    builder_appendf(&b, "{\"event\": \"subscribe\", \"channel\": \"ticker\", \"symbol\": \"tBTCUSD\"}");
+    return set_add(set, capacity, &b);
+}
+
+/* Builds a connection's frames; NULL on failure */
+static SubscriptionSet *compile_connection(int index) {
+    SubscriptionSet *set = calloc(1, sizeof(*set));
+    if (!set) return NULL;
+
+    int capacity = 0, status;
+    switch (connection_exchange(index)) {
+        case EXCHANGE_BINANCE:  status = compile_binance(index, "SUBSCRIBE", set, &capacity); break;
+        case EXCHANGE_OKX:      status = compile_okx(index, "subscribe", set, &capacity); break;
+        case EXCHANGE_HUOBI:    status = compile_huobi(index, "sub", set, &capacity); break;
+        case EXCHANGE_COINBASE: status = compile_coinbase(set, &capacity); break;
+        case EXCHANGE_KRAKEN:   status = compile_kraken(set, &capacity); break;
+        case EXCHANGE_BITFINEX: status = compile_bitfinex(set, &capacity); break;
+        default:                status = 0; break;
+    }
+
+    if (status != 0) {
+        printf("[ERROR] Failed to compile subscription frames for %s\n", connection_name(index));
+        set_free(set);
+        return NULL;
+    }
+    return set;
+}
+
+/* Publishes a new set; the old one is freed by a later refresh */
+static void install(int index, SubscriptionSet *set) {
+    SubscriptionSet *old = __atomic_exchange_n(&sets[index], set, __ATOMIC_ACQ_REL);
+    if (!old) return;
+
+    pthread_mutex_lock(&cache_lock);
+    old->retired = time(NULL);
+    old->next = retired_sets;
+    retired_sets = old;
+    pthread_mutex_unlock(&cache_lock);
+}
+
+/* ----------------------------------- Cache ---------------------------------- */
+
+static void stat_watched(WatchedFile *file, time_t *mtime, off_t *size) {
+    char path[256];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/%s", CURRENCY_FILES_DIR, file->file);
+    if (stat(path, &st) != 0) {
+        *mtime = 0;
+        *size = 0;
+        return;
+    }
+    *mtime = st.st_mtime;
+    *size = st.st_size;
+}
+
+int subscription_cache_build(void) {
+    for (size_t f = 0; f < sizeof(watched) / sizeof(watched[0]); f++)
+        stat_watched(&watched[f], &watched[f].mtime, &watched[f].size);
+
+    int64_t start = monotonic_ns();
+    int frames = 0;
+    for (int i = 0; i < connection_count(); i++) {
+        SubscriptionSet *set = compile_connection(i);
+        if (!set) return -1;
+        frames += set->count;
+        install(i, set);
+    }
+
+    last_refresh = time(NULL);
+    printf("[INFO] Compiled %d subscription frames for %d connections in %.1f ms\n",
+           frames, connection_count(), (double)(monotonic_ns() - start) / 1e6);
+    return 0;
+}
+
+void subscription_cache_rebuild(int index) {
+    if (index < 0 || index >= connection_count()) return;
+
+    SubscriptionSet *set = compile_connection(index);
+    if (!set) return;       // keep sending the previous frames
+    install(index, set);
+
+    pthread_mutex_lock(&cache_lock);
+    stats.rebuilds++;
+    pthread_mutex_unlock(&cache_lock);
+}
+
+int subscription_cache_send(struct lws *wsi, int index) {
+    if (index < 0 || index >= MAX_CONNECTIONS) return 0;
+    SubscriptionSet *set = __atomic_load_n(&sets[index], __ATOMIC_ACQUIRE);
+    if (!set) return 0;
+
+    int64_t start = monotonic_ns();
+    for (int i = 0; i < set->count; i++) {
+        SubscriptionFrame *frame = &set->frames[i];
+        if (lws_write(wsi, frame->buf + LWS_PRE, frame->len, LWS_WRITE_TEXT) < 0)
+            return -1;
+    }
+    uint64_t elapsed = (uint64_t)(monotonic_ns() - start);
+
+    pthread_mutex_lock(&cache_lock);
+    stats.sends++;
+    stats.frames += (uint64_t)set->count;
+    stats.send_total_ns += elapsed;
+    if (elapsed > stats.send_max_ns) stats.send_max_ns = elapsed;
+    pthread_mutex_unlock(&cache_lock);
+    return set->count;
+}
+
+int subscription_cache_unsubscribe(struct lws *wsi, int index) {
+    if (index < 0 || index >= MAX_CONNECTIONS) return 0;
+    SubscriptionSet *set = calloc(1, sizeof(*set));
+    if (!set) return -1;
+
+    int capacity = 0, status;
+    switch (connection_exchange(index)) {
+        case EXCHANGE_BINANCE: status = compile_binance(index, "UNSUBSCRIBE", set, &capacity); break;
+        case EXCHANGE_OKX:     status = compile_okx(index, "unsubscribe", set, &capacity); break;
+        case EXCHANGE_HUOBI:   status = compile_huobi(index, "unsub", set, &capacity); break;
+        default:               status = 0; break;
+    }
+
+    for (int i = 0; status == 0 && i < set->count; i++) {
+        SubscriptionFrame *frame = &set->frames[i];
+        if (lws_write(wsi, frame->buf + LWS_PRE, frame->len, LWS_WRITE_TEXT) < 0)
+            status = -1;
+    }
+    set_free(set);
+    return status;
+}
+
+int subscription_book_resubscribe(struct lws *wsi, uint16_t exchange_id, uint16_t symbol_id) {
+    const char *symbol = symbol_name(symbol_id);
+    const char *ops[] = { "unsubscribe", "subscribe" };
+
+    for (int o = 0; o < 2; o++) {
+        FrameBuilder b = {0};
+        if (exchange_id == EXCHANGE_OKX) {
+            builder_appendf(&b, "{\"op\": \"%s\", \"args\": [{\"channel\": \"books\", \"instId\": \"%s\"}]}",
+                            ops[o], symbol);
+        } else if (exchange_id == EXCHANGE_KRAKEN) {
+            builder_appendf(&b, "{\"event\": \"%s\", \"pair\": [\"%s\"], \"subscription\": {\"name\": \"book\", \"depth\": %d}}",
+                            ops[o], symbol, BOOK_KRAKEN_DEPTH);
+        } else {
+            return 0;
+        }
+
+        int written = b.failed ? -1 : lws_write(wsi, b.data + LWS_PRE, b.len, LWS_WRITE_TEXT);
+        free(b.data);
+        if (written < 0) return -1;
+    }
+    return 0;
+}
+
+void subscription_cache_refresh(void) {
+    time_t now = time(NULL);
+    if (now - last_refresh < SUBSCRIPTION_REFRESH_INTERVAL) return;
+    last_refresh = now;
+
+    /* Sets replaced at least one interval ago are no longer being written by anyone */
+    pthread_mutex_lock(&cache_lock);
+    SubscriptionSet **link = &retired_sets;
+    while (*link) {
+        SubscriptionSet *set = *link;
+        if (now - set->retired >= SUBSCRIPTION_REFRESH_INTERVAL) {
+            *link = set->next;
+            set_free(set);
+        } else {
+            link = &set->next;
+        }
+    }
+    pthread_mutex_unlock(&cache_lock);
+
+    for (size_t f = 0; f < sizeof(watched) / sizeof(watched[0]); f++) {
+        WatchedFile *file = &watched[f];
+        time_t mtime;
+        off_t size;
+        stat_watched(file, &mtime, &size);
+        if (mtime == file->mtime && size == file->size) continue;
+        file->mtime = mtime;
+        file->size = size;
+
+        if (file->exchange == EXCHANGE_COINBASE || file->exchange == EXCHANGE_KRAKEN) {
+            for (int i = 0; i < connection_count(); i++) {
+                if (connection_exchange(i) == file->exchange) subscription_cache_rebuild(i);
+            }
+            printf("[INFO] %s changed; %s subscriptions recompiled for the next connect\n",
+                   file->file, exchange_name(file->exchange));
+        } else {
+            printf("[WARNING] %s changed; %s connections keep their symbols until restart\n",
+                   file->file, exchange_name(file->exchange));
+        }
+    }
+}
+
+void subscription_first_tick(int index, int64_t elapsed_ns) {
+    pthread_mutex_lock(&cache_lock);
+    stats.first_ticks++;
+    stats.first_tick_total_ns += (uint64_t)elapsed_ns;
+    if ((uint64_t)elapsed_ns > stats.first_tick_max_ns) stats.first_tick_max_ns = (uint64_t)elapsed_ns;
+    pthread_mutex_unlock(&cache_lock);
+
+    printf("[INFO] %s first record %.1f ms after connect\n", connection_name(index), (double)elapsed_ns / 1e6);
+}
+
+void subscription_stats(SubscriptionStats *out) {
+    pthread_mutex_lock(&cache_lock);
+    *out = stats;
+    pthread_mutex_unlock(&cache_lock);
+}
+
+void subscription_cache_free(void) {
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+        set_free(sets[i]);
+        sets[i] = NULL;
+    }
+    pthread_mutex_lock(&cache_lock);
+    while (retired_sets) {
+        SubscriptionSet *next = retired_sets->next;
+        set_free(retired_sets);
+        retired_sets = next;
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
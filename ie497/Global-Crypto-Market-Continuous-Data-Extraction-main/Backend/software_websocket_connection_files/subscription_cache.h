@@ -0,0 +1,84 @@
+/*
+ * Subscription Cache Header
+ *
+ * Declares the per-connection cache of compiled subscription frames. Every
+ * connection's subscribe messages are built once, in memory and with LWS_PRE
+ * headroom, so a (re)connect only writes them out: no file reads, no JSON
+ * building and no allocation on LWS_CALLBACK_CLIENT_ESTABLISHED.
+ *
+ * Features:
+ *  - subscription_cache_build(): Compiles every connection's frames at startup.
+ *  - subscription_cache_rebuild(): Recompiles one connection after its symbols changed (splits).
+ *  - subscription_cache_send(): Writes a connection's frames to its socket.
+ *  - subscription_cache_unsubscribe(): Drops a split target's symbols from the socket they moved off.
+ *  - subscription_book_resubscribe(): Restarts one symbol's depth channel.
+ *  - subscription_cache_refresh(): Watches the fetch_currency_id output and recompiles on change.
+ *  - subscription_first_tick() / subscription_stats(): Send time and time-to-first-tick counters.
+ *
+ * Dependencies:
+ *  - libwebsockets: lws_write() and LWS_PRE.
+ *  - Standard C libraries (stdint.h).
+ *
+ * Usage:
+ *  - Built from `main.c`; frames sent from `exchange_websocket.c`; rebuilt by `connection_table.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef SUBSCRIPTION_CACHE_H
+#define SUBSCRIPTION_CACHE_H
+
+#include <stdint.h>
+#include <libwebsockets.h>
+
+/* Kraken pairs per subscribe message */
+#define SUBSCRIPTION_KRAKEN_CHUNK 100
+
+/* Seconds between checks of the product lists for changes */
+#define SUBSCRIPTION_REFRESH_INTERVAL 30
+
+/* Subscription counters over every connection */
+typedef struct {
+    uint64_t sends;                 // connections subscribed
+    uint64_t frames;                // frames written
+    uint64_t send_total_ns;         // time spent writing the frames, summed over `sends`
+    uint64_t send_max_ns;
+    uint64_t first_ticks;           // subscriptions that produced a record
+    uint64_t first_tick_total_ns;   // connection established to first record, summed over `first_ticks`
+    uint64_t first_tick_max_ns;
+    uint64_t rebuilds;              // connections recompiled after startup
+} SubscriptionStats;
+
+/* Compiles the frames of every connection in the connection table. Returns 0, or -1 on allocation failure. */
+int subscription_cache_build(void);
+
+/* Recompiles one connection's frames. Call on the connection's service thread. */
+void subscription_cache_rebuild(int index);
+
+/* Writes a connection's frames. Returns the number of frames written, or -1 if a write failed. */
+int subscription_cache_send(struct lws *wsi, int index);
+
+/* Writes unsubscribe frames for connection `index`'s symbols (Binance, Huobi, OKX) to another
+ * connection's socket, the source they were split off. Call on the service thread of both.
+ * Returns 0 or -1. */
+int subscription_cache_unsubscribe(struct lws *wsi, int index);
+
+/* Unsubscribes and resubscribes one symbol's depth channel (OKX, Kraken) after its book lost
+ * sync, for a fresh snapshot. Call on the connection's service thread. Returns 0 or -1. */
+int subscription_book_resubscribe(struct lws *wsi, uint16_t exchange_id, uint16_t symbol_id);
+
+/* Recompiles connections whose product list changed on disk and frees frames retired
+ * by the previous call. Call from the main thread; checks at most every SUBSCRIPTION_REFRESH_INTERVAL. */
+void subscription_cache_refresh(void);
+
+/* Records the delay between a connection being established and its first record. */
+void subscription_first_tick(int index, int64_t elapsed_ns);
+
+/* Snapshot of the subscription counters. */
+void subscription_stats(SubscriptionStats *stats);
+
+/* Frees every compiled frame (shutdown, after the service threads stopped). */
+void subscription_cache_free(void);
+
+#endif // SUBSCRIPTION_CACHE_H
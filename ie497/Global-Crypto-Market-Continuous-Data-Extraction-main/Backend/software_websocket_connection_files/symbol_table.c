@@ -0,0 +1,265 @@
+/*
+ * Symbol Table
+ *
+ * This module interns exchange symbols into dense IDs and resolves each one to
+ * a canonical "BASE-QUOTE" product name exactly once, when it is first seen.
+ * The message path only ever does a hash lookup and array reads.
+ *
+ * Features:
+ *  - Open-addressing hash table (FNV-1a, linear probing) over fixed arrays.
+ *  - Canonical names derived from separators ("BTC-USDT", "XBT/USD") or known
+ *    quote suffixes ("BTCUSDT", "btcusdt"), after stripping exchange prefixes
+ *    ("market." for Huobi, "t" for Bitfinex pairs).
+ *  - Built-in alias table for products that are reported under another name.
+ *  - Startup loader for the product lists written by `fetch_currency_id`.
+ *  - Lock-free lookups; inserts from concurrent service threads take a mutex.
+ *
+ * Dependencies:
+ *  - jansson: Reading the product lists in `currency_text_files/`.
+ *  - Standard C libraries (stdio, string, ctype, pthread).
+ *
+ * Usage:
+ *  - `symbol_table_load()` is called once from `main.c`; lookups happen on the service threads.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "symbol_table.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <jansson.h>
+
+/* Hash slots; twice MAX_SYMBOLS keeps probe chains short */
+#define SYMBOL_SLOTS (MAX_SYMBOLS * 2)
+
+typedef struct {
+    char name[MAX_SYMBOL_LENGTH];
+    uint16_t canonical;         // ID of the "BASE-QUOTE" form
+    SymbolScales scales;
+} SymbolEntry;
+
+static SymbolEntry symbols[MAX_SYMBOLS];
+static uint16_t symbol_count = 1;       // ID 0 is "no symbol"
+static uint16_t symbol_slots[SYMBOL_SLOTS];
+
+/* Lookups are lock-free; inserts from concurrent service threads are serialized.
+ * An entry is complete before its slot is published with a release store. */
+static pthread_mutex_t symbol_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Products reported under a different name than their canonical product */
+static const struct {
+    const char *raw;
+    const char *canonical;
+} symbol_aliases[] = {
+    {"tBTCUSD", "BTC-USD"},
+    {"BTCUSDT", "BTC-USD"},
+    {"market.btcusdt", "BTC-USD"},
+    {"btcusdt", "BTC-USD"},
+    {"BTC-USDT", "BTC-USD"},
+    {"BTC/USD", "BTC-USD"},
+
+    {"ADAUSDT", "ADA-USD"},
+    {"ICXUSDT", "ICX-USD"},
+    {"ADA/USD", "ADA-USD"},
+    {"adausdt", "ADA-USD"},
+    {"icxusdt", "ICX-USD"},
+
+    {"ETHUSDT", "ETH-USD"},
+    {"ETH/USD", "ETH-USD"},
+    {"ethusdt", "ETH-USD"},
+
+    {"XBT/USD", "XBT-USD"},
+};
+
+/* Quote currencies recognised at the end of concatenated symbols, longest first */
+static const char *quote_suffixes[] = {
+    "FDUSD", "USDT", "USDC", "BUSD", "TUSD", "USDP", "USDD", "EURT", "EURC",
+    "USD", "EUR", "GBP", "JPY", "TRY", "AUD", "BRL", "CAD", "CHF",
+    "BTC", "ETH", "BNB", "DAI", "XBT", "SOL", "DOT", "TRX", "HT"
+};
+
+/* Product lists written by fetch_currency_id; Binance lists are lowercase but its stream uses uppercase */
+static const struct {
+    const char *file;
+    int uppercase;
+} symbol_files[] = {
+    {"binance_currency_ids_trades.txt", 1},
+    {"coinbase_currency_ids.txt", 0},
+    {"huobi_currency_ids.txt", 0},
+    {"kraken_currency_ids.txt", 0},
+    {"okx_currency_ids.txt", 0},
+};
+
+static uint32_t hash_symbol(const char *name, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Writes the "BASE-QUOTE" form of a raw symbol into `out` (MAX_SYMBOL_LENGTH bytes) */
+static size_t derive_canonical(const char *raw, size_t len, char *out) {
+    if (len > 7 && memcmp(raw, "market.", 7) == 0) {
+        raw += 7;
+        len -= 7;
+    } else if (len > 1 && raw[0] == 't' && isupper((unsigned char)raw[1])) {
+        raw += 1;
+        len -= 1;
+    }
+
+    char upper[MAX_SYMBOL_LENGTH];
+    size_t split = 0;
+    for (size_t i = 0; i < len; i++) {
+        upper[i] = (char)toupper((unsigned char)raw[i]);
+        if (!split && i > 0 && (raw[i] == '-' || raw[i] == '/' || raw[i] == '_' || raw[i] == ':'))
+            split = i;
+    }
+
+    if (!split) {
+        for (size_t q = 0; q < sizeof(quote_suffixes) / sizeof(quote_suffixes[0]); q++) {
+            size_t qlen = strlen(quote_suffixes[q]);
+            if (len > qlen && memcmp(upper + len - qlen, quote_suffixes[q], qlen) == 0) {
+                split = len - qlen;
+                break;
+            }
+        }
+        if (!split || len + 1 >= MAX_SYMBOL_LENGTH) {
+            memcpy(out, upper, len);
+            out[len] = '\0';
+            return len;
+        }
+        memcpy(out, upper, split);
+        out[split] = '-';
+        memcpy(out + split + 1, upper + split, len - split);
+        out[len + 1] = '\0';
+        return len + 1;
+    }
+
+    memcpy(out, upper, len);
+    out[split] = '-';
+    out[len] = '\0';
+    return len;
+}
+
+/* Finds a symbol's slot; returns the ID there, or 0 with `*slot_out` set to the free slot */
+static uint16_t find_symbol(const char *name, size_t len, uint32_t *slot_out) {
+    uint32_t slot = hash_symbol(name, len) & (SYMBOL_SLOTS - 1);
+    uint16_t id;
+    while ((id = __atomic_load_n(&symbol_slots[slot], __ATOMIC_ACQUIRE)) != 0) {
+        const SymbolEntry *entry = &symbols[id];
+        if (strncmp(entry->name, name, len) == 0 && entry->name[len] == '\0')
+            return id;
+        slot = (slot + 1) & (SYMBOL_SLOTS - 1);
+    }
+    *slot_out = slot;
+    return 0;
+}
+
+uint16_t symbol_intern(const char *name, size_t len) {
+    if (len == 0) return 0;
+    if (len >= MAX_SYMBOL_LENGTH) len = MAX_SYMBOL_LENGTH - 1;
+
+    uint32_t slot;
+    uint16_t id = find_symbol(name, len, &slot);
+    if (id) return id;
+
+    /* The canonical form is idempotent, so this recurses at most once */
+    uint16_t canonical_id = 0;
+    char canonical[MAX_SYMBOL_LENGTH];
+    size_t canonical_len = derive_canonical(name, len, canonical);
+    if (canonical_len != len || memcmp(canonical, name, len) != 0)
+        canonical_id = symbol_intern(canonical, canonical_len);
+
+    pthread_mutex_lock(&symbol_lock);
+    id = find_symbol(name, len, &slot);     // another thread may have added it meanwhile
+    if (!id) {
+        if (symbol_count == MAX_SYMBOLS) {
+            pthread_mutex_unlock(&symbol_lock);
+            printf("[ERROR] Symbol table full, dropping symbol %.*s\n", (int)len, name);
+            return 0;
+        }
+
+        id = symbol_count;
+        memcpy(symbols[id].name, name, len);
+        symbols[id].name[len] = '\0';
+        symbols[id].canonical = canonical_id ? canonical_id : id;
+        __atomic_store_n(&symbol_count, id + 1, __ATOMIC_RELEASE);
+        __atomic_store_n(&symbol_slots[slot], id, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&symbol_lock);
+    return id;
+}
+
+const char *symbol_name(uint16_t symbol_id) {
+    return (symbol_id < __atomic_load_n(&symbol_count, __ATOMIC_ACQUIRE)) ? symbols[symbol_id].name : "";
+}
+
+uint16_t symbol_canonical_id(uint16_t symbol_id) {
+    if (symbol_id >= __atomic_load_n(&symbol_count, __ATOMIC_ACQUIRE)) return 0;
+    return __atomic_load_n(&symbols[symbol_id].canonical, __ATOMIC_RELAXED);
+}
+
+const char *symbol_canonical(uint16_t symbol_id) {
+    return symbol_name(symbol_canonical_id(symbol_id));
+}
+
+SymbolScales *symbol_scales(uint16_t symbol_id) {
+    return (symbol_id && symbol_id < __atomic_load_n(&symbol_count, __ATOMIC_ACQUIRE)) ? &symbols[symbol_id].scales : NULL;
+}
+
+uint16_t symbol_alias(const char *raw, const char *canonical) {
+    uint16_t id = symbol_intern(raw, strlen(raw));
+    uint16_t canonical_id = symbol_intern(canonical, strlen(canonical));
+    if (!id || !canonical_id) return 0;
+
+    __atomic_store_n(&symbols[id].canonical, canonical_id, __ATOMIC_RELAXED);
+    __atomic_store_n(&symbols[canonical_id].canonical, canonical_id, __ATOMIC_RELAXED);
+    return id;
+}
+
+/* Interns every product in one fetch_currency_id list (strings, or objects with "instId") */
+static void load_symbol_file(const char *path, int uppercase) {
+    json_error_t error;
+    json_t *array = json_load_file(path, 0, &error);
+    if (!array || !json_is_array(array)) {
+        printf("[WARNING] Could not load symbols from %s\n", path);
+        if (array) json_decref(array);
+        return;
+    }
+
+    size_t i;
+    json_t *item;
+    json_array_foreach(array, i, item) {
+        const char *name = json_is_object(item) ? json_string_value(json_object_get(item, "instId"))
+                                                : json_string_value(item);
+        if (!name) continue;
+
+        char buf[MAX_SYMBOL_LENGTH];
+        size_t len = strlen(name);
+        if (len >= sizeof(buf)) len = sizeof(buf) - 1;
+        for (size_t c = 0; c < len; c++)
+            buf[c] = uppercase ? (char)toupper((unsigned char)name[c]) : name[c];
+        symbol_intern(buf, len);
+    }
+
+    json_decref(array);
+}
+
+size_t symbol_table_load(const char *dir) {
+    for (size_t i = 0; i < sizeof(symbol_aliases) / sizeof(symbol_aliases[0]); i++)
+        symbol_alias(symbol_aliases[i].raw, symbol_aliases[i].canonical);
+
+    for (size_t i = 0; i < sizeof(symbol_files) / sizeof(symbol_files[0]); i++) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s", dir, symbol_files[i].file);
+        load_symbol_file(path, symbol_files[i].uppercase);
+    }
+
+    return __atomic_load_n(&symbol_count, __ATOMIC_ACQUIRE) - 1;
+}
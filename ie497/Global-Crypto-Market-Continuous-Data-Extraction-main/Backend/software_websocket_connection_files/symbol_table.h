@@ -0,0 +1,67 @@
+/*
+ * Symbol Table Header
+ *
+ * Declares the interned symbol table shared by every exchange connection.
+ * Each raw exchange symbol ("BTCUSDT", "btcusdt", "BTC/USD", "tBTCUSD") gets a
+ * dense 16-bit ID plus the ID of its canonical "BASE-QUOTE" product name, so
+ * normalization on the message path is a single array read.
+ *
+ * Features:
+ *  - symbol_intern(): Open-addressing (FNV-1a) lookup/insert of raw symbols.
+ *  - symbol_canonical(): Normalized "BASE-QUOTE" name, resolved once per symbol.
+ *  - symbol_alias(): Explicit overrides (e.g. "BTCUSDT" -> "BTC-USD").
+ *  - symbol_table_load(): Pre-interns every product in `currency_text_files/` at startup.
+ *  - symbol_scales(): Per-symbol price/quantity scale used by the record normalizer.
+ *
+ * Dependencies:
+ *  - Standard C libraries (stddef.h, stdint.h).
+ *
+ * Usage:
+ *  - Loaded from `main.c`; used by `market_record.c`, `utils.c` and `exchange_websocket.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Symbol table limits; ID 0 is reserved for "no symbol" */
+#define MAX_SYMBOLS 16384
+#define MAX_SYMBOL_LENGTH 32
+
+/* Directory written by fetch_currency_id */
+#define CURRENCY_FILES_DIR "currency_text_files"
+
+/* Widest decimal scale seen so far for one symbol */
+typedef struct {
+    int8_t price_scale;
+    int8_t qty_scale;
+} SymbolScales;
+
+/* Returns the ID for a symbol, adding it on first sight; 0 if empty or the table is full. */
+uint16_t symbol_intern(const char *name, size_t len);
+
+/* Raw exchange symbol for an ID ("" for 0). */
+const char *symbol_name(uint16_t symbol_id);
+
+/* ID of the canonical "BASE-QUOTE" symbol (a canonical symbol maps to itself). */
+uint16_t symbol_canonical_id(uint16_t symbol_id);
+
+/* Canonical "BASE-QUOTE" name for an ID ("" for 0). */
+const char *symbol_canonical(uint16_t symbol_id);
+
+/* Scale state for a symbol, or NULL for ID 0. */
+SymbolScales *symbol_scales(uint16_t symbol_id);
+
+/* Maps a raw symbol to an explicit canonical name. Returns the raw symbol's ID, or 0. */
+uint16_t symbol_alias(const char *raw, const char *canonical);
+
+/* Registers the built-in aliases and interns every product listed in `dir`.
+ * Returns the number of symbols in the table afterwards. */
+size_t symbol_table_load(const char *dir);
+
+#endif // SYMBOL_TABLE_H
@@ -0,0 +1,371 @@
+/*
+ * Tick Archive
+ *
+ * This module implements the column codec and the sequential reader of the
+ * columnar tick archive described in `tick_archive.h`. It has no dependency
+ * on the rest of `crypto_ws`, so `tick_query` links it on its own.
+ *
+ * Features:
+ *  - Presence bitmaps, per-block common decimal scale, delta + zigzag LEB128 varints.
+ *  - Optional zlib pass per column, kept only when it makes the column smaller.
+ *  - Reader seeks past blocks and columns it is not asked for; only requested columns are read.
+ *
+ * Dependencies:
+ *  - zlib: compress2() / uncompress().
+ *  - Standard C libraries (stdio, stdlib, string).
+ *
+ * Usage:
+ *  - Linked into `crypto_ws` (through `archive_writer.c`) and into `tick_query`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "tick_archive.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+/* Sanity bound on a stored column; anything bigger means a corrupt file */
+#define ARCHIVE_MAX_COLUMN_BYTES (64u * 1024 * 1024)
+
+#define NAME_ENTRY(member) #member,
+
+static const char *ticker_columns[] = { "timestamp", ARCHIVE_TICKER_FIELDS(NAME_ENTRY) };
+static const char *trade_columns[] = { "timestamp", ARCHIVE_TRADE_FIELDS(NAME_ENTRY) "market_maker" };
+
+static const int64_t powers_of_ten[] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL,
+    1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL,
+    100000000000000LL, 1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+    1000000000000000000LL
+};
+
+int archive_column_count(ArchiveKind kind) {
+    return kind == ARCHIVE_KIND_TICKER ? (int)(sizeof(ticker_columns) / sizeof(ticker_columns[0]))
+                                       : (int)(sizeof(trade_columns) / sizeof(trade_columns[0]));
+}
+
+const char *archive_column_name(ArchiveKind kind, int column) {
+    if (column < 0 || column >= archive_column_count(kind)) return "";
+    return kind == ARCHIVE_KIND_TICKER ? ticker_columns[column] : trade_columns[column];
+}
+
+int archive_column_find(ArchiveKind kind, const char *name) {
+    for (int i = 0; i < archive_column_count(kind); i++) {
+        if (strcmp(archive_column_name(kind, i), name) == 0) return i;
+    }
+    return -1;
+}
+
+/* -------------------------------- Buffers --------------------------------- */
+
+static int buffer_reserve(ArchiveBuffer *buffer, size_t extra) {
+    if (buffer->len + extra <= buffer->capacity) return 0;
+
+    size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+    while (buffer->len + extra > capacity) capacity *= 2;
+    uint8_t *data = realloc(buffer->data, capacity);
+    if (!data) return -1;
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return 0;
+}
+
+int archive_buffer_append(ArchiveBuffer *buffer, const void *data, size_t len) {
+    if (buffer_reserve(buffer, len) != 0) return -1;
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+    return 0;
+}
+
+void archive_buffer_free(ArchiveBuffer *buffer) {
+    free(buffer->data);
+    memset(buffer, 0, sizeof(*buffer));
+}
+
+/* --------------------------------- Codec ---------------------------------- */
+
+static size_t put_varint(uint8_t *out, uint64_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/* value * 10^shift, or 0 if it does not fit */
+static int rescale(int64_t value, int shift, int64_t *out) {
+    if (shift == 0) {
+        *out = value;
+        return 1;
+    }
+    if (shift >= (int)(sizeof(powers_of_ten) / sizeof(powers_of_ten[0]))) return 0;
+    return !__builtin_mul_overflow(value, powers_of_ten[shift], out);
+}
+
+int archive_encode_column(ArchiveBuffer *out, const int64_t *values, const int8_t *scales,
+                          uint32_t rows, int compress, ArchiveColumnInfo *info) {
+    uint32_t present = 0;
+    int8_t widest = 0;
+    for (uint32_t i = 0; i < rows; i++) {
+        if (scales[i] < 0) continue;
+        present++;
+        if (scales[i] > widest) widest = scales[i];
+    }
+    if (present == 0) return 1;
+
+    /* Common scale unless a rescaled value would overflow */
+    uint8_t flags = (present < rows) ? ARCHIVE_COLUMN_NULLS : 0;
+    for (uint32_t i = 0; i < rows; i++) {
+        int64_t scaled;
+        if (scales[i] >= 0 && !rescale(values[i], widest - scales[i], &scaled)) {
+            flags |= ARCHIVE_COLUMN_SCALES;
+            break;
+        }
+    }
+
+    /* Worst case: bitmap, a scale byte and a 10-byte varint per row */
+    size_t bitmap_len = (flags & ARCHIVE_COLUMN_NULLS) ? (rows + 7) / 8 : 0;
+    uint8_t *raw = calloc(1, bitmap_len + (size_t)present * 11);
+    if (!raw) return -1;
+
+    size_t len = bitmap_len;
+    if (flags & ARCHIVE_COLUMN_NULLS) {
+        for (uint32_t i = 0; i < rows; i++) {
+            if (scales[i] >= 0) raw[i / 8] |= (uint8_t)(1u << (i % 8));
+        }
+    }
+    if (flags & ARCHIVE_COLUMN_SCALES) {
+        for (uint32_t i = 0; i < rows; i++) {
+            if (scales[i] >= 0) raw[len++] = (uint8_t)scales[i];
+        }
+    }
+
+    int64_t previous = 0;
+    for (uint32_t i = 0; i < rows; i++) {
+        if (scales[i] < 0) continue;
+        int64_t value = values[i];
+        if (!(flags & ARCHIVE_COLUMN_SCALES)) rescale(values[i], widest - scales[i], &value);
+        len += put_varint(raw + len, zigzag((int64_t)((uint64_t)value - (uint64_t)previous)));
+        previous = value;
+    }
+
+    info->codec = ARCHIVE_CODEC_RAW;
+    info->flags = flags;
+    info->scale = (flags & ARCHIVE_COLUMN_SCALES) ? 0 : widest;
+    info->raw_len = (uint32_t)len;
+    info->stored_len = (uint32_t)len;
+
+    const uint8_t *stored = raw;
+    uint8_t *packed = NULL;
+    if (compress && len >= 64) {
+        uLongf packed_len = compressBound((uLong)len);
+        packed = malloc(packed_len);
+        if (packed && compress2(packed, &packed_len, raw, (uLong)len, Z_DEFAULT_COMPRESSION) == Z_OK &&
+            packed_len < len) {
+            info->codec = ARCHIVE_CODEC_ZLIB;
+            info->stored_len = (uint32_t)packed_len;
+            stored = packed;
+        }
+    }
+
+    int result = archive_buffer_append(out, stored, info->stored_len);
+    free(packed);
+    free(raw);
+    return result;
+}
+
+int archive_decode_column(const uint8_t *raw, size_t len, const ArchiveColumnInfo *info,
+                          uint32_t rows, int64_t *values, int8_t *scales) {
+    size_t pos = 0;
+    const uint8_t *bitmap = NULL;
+    if (info->flags & ARCHIVE_COLUMN_NULLS) {
+        bitmap = raw;
+        pos = (rows + 7) / 8;
+        if (pos > len) return -1;
+    }
+
+    uint32_t present = 0;
+    for (uint32_t i = 0; i < rows; i++) {
+        int has = !bitmap || (bitmap[i / 8] >> (i % 8) & 1);
+        scales[i] = has ? info->scale : -1;
+        values[i] = 0;
+        present += (uint32_t)has;
+    }
+
+    if (info->flags & ARCHIVE_COLUMN_SCALES) {
+        if (pos + present > len) return -1;
+        for (uint32_t i = 0; i < rows; i++) {
+            if (scales[i] >= 0) scales[i] = (int8_t)raw[pos++];
+        }
+    }
+
+    int64_t previous = 0;
+    for (uint32_t i = 0; i < rows; i++) {
+        if (scales[i] < 0) continue;
+
+        uint64_t encoded = 0;
+        int shift = 0;
+        for (;;) {
+            if (pos >= len || shift > 63) return -1;
+            uint8_t byte = raw[pos++];
+            encoded |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+            shift += 7;
+        }
+        previous = (int64_t)((uint64_t)previous + (uint64_t)unzigzag(encoded));
+        values[i] = previous;
+    }
+    return 0;
+}
+
+/* --------------------------------- Reader --------------------------------- */
+
+static int grow(uint8_t **data, size_t *capacity, size_t needed) {
+    if (needed <= *capacity) return 0;
+    uint8_t *grown = realloc(*data, needed);
+    if (!grown) return -1;
+    *data = grown;
+    *capacity = needed;
+    return 0;
+}
+
+int archive_reader_open(ArchiveReader *reader, const char *path) {
+    memset(reader, 0, sizeof(*reader));
+    reader->file = fopen(path, "rb");
+    if (!reader->file) {
+        fprintf(stderr, "[ERROR] Could not open archive %s\n", path);
+        return -1;
+    }
+    setvbuf(reader->file, NULL, _IOFBF, 1 << 20);
+
+    if (fread(&reader->header, sizeof(reader->header), 1, reader->file) != 1 ||
+        memcmp(reader->header.magic, ARCHIVE_MAGIC, ARCHIVE_MAGIC_LENGTH) != 0 ||
+        reader->header.version != ARCHIVE_VERSION) {
+        fprintf(stderr, "[ERROR] %s is not a version %d tick archive\n", path, ARCHIVE_VERSION);
+        fclose(reader->file);
+        reader->file = NULL;
+        return -1;
+    }
+    reader->header.exchange[sizeof(reader->header.exchange) - 1] = '\0';
+    reader->data_offset = -1;
+    return 0;
+}
+
+static int read_dict_entry(ArchiveReader *reader, uint32_t magic) {
+    ArchiveDictEntry entry;
+    entry.magic = magic;
+    if (fread((char *)&entry + sizeof(magic), sizeof(entry) - sizeof(magic), 1, reader->file) != 1) return -1;
+
+    if (entry.symbol >= reader->name_count) {
+        size_t count = (size_t)entry.symbol + 1;
+        void *names = realloc(reader->names, count * sizeof(*reader->names));
+        if (!names) return -1;
+        reader->names = names;
+        memset(reader->names + reader->name_count, 0, (count - reader->name_count) * sizeof(*reader->names));
+        reader->name_count = count;
+    }
+
+    char *name = reader->names[entry.symbol];
+    size_t keep = entry.name_len > ARCHIVE_MAX_NAME ? ARCHIVE_MAX_NAME : entry.name_len;
+    if (fread(name, 1, keep, reader->file) != keep) return -1;
+    name[keep] = '\0';
+    if (entry.name_len > keep && fseeko(reader->file, entry.name_len - keep, SEEK_CUR) != 0) return -1;
+    return 0;
+}
+
+int archive_reader_next(ArchiveReader *reader) {
+    /* Skip whatever is left of the previous block's column data */
+    if (reader->data_offset >= 0) {
+        if (fseeko(reader->file, (off_t)(reader->data_offset + reader->block.data_len), SEEK_SET) != 0) return -1;
+        reader->data_offset = -1;
+    }
+
+    for (;;) {
+        uint32_t magic;
+        if (fread(&magic, sizeof(magic), 1, reader->file) != 1) return feof(reader->file) ? 0 : -1;
+
+        if (magic == ARCHIVE_DICT_MAGIC) {
+            if (read_dict_entry(reader, magic) != 0) return -1;
+            continue;
+        }
+        if (magic != ARCHIVE_BLOCK_MAGIC) return -1;
+
+        reader->block.magic = magic;
+        if (fread((char *)&reader->block + sizeof(magic), sizeof(reader->block) - sizeof(magic), 1, reader->file) != 1)
+            return -1;
+        if (reader->block.column_count > ARCHIVE_MAX_COLUMNS || reader->block.rows > ARCHIVE_BLOCK_ROWS) return -1;
+        if (fread(reader->columns, sizeof(ArchiveColumnInfo), reader->block.column_count, reader->file) !=
+            reader->block.column_count)
+            return -1;
+
+        reader->data_offset = (long long)ftello(reader->file);
+        return 1;
+    }
+}
+
+const char *archive_reader_symbol(const ArchiveReader *reader, uint16_t symbol) {
+    return symbol < reader->name_count ? reader->names[symbol] : "";
+}
+
+int archive_reader_column(ArchiveReader *reader, int column, int64_t *values, int8_t *scales) {
+    uint32_t rows = reader->block.rows;
+    long long offset = reader->data_offset;
+    const ArchiveColumnInfo *info = NULL;
+    for (int i = 0; i < reader->block.column_count; i++) {
+        if (reader->columns[i].column == column) {
+            info = &reader->columns[i];
+            break;
+        }
+        offset += reader->columns[i].stored_len;
+    }
+
+    if (!info) {
+        for (uint32_t i = 0; i < rows; i++) {
+            values[i] = 0;
+            scales[i] = -1;
+        }
+        return 0;
+    }
+    if (info->stored_len > ARCHIVE_MAX_COLUMN_BYTES || info->raw_len > ARCHIVE_MAX_COLUMN_BYTES) return -1;
+
+    if (grow(&reader->stored, &reader->stored_capacity, info->stored_len) != 0) return -1;
+    if (fseeko(reader->file, (off_t)offset, SEEK_SET) != 0 ||
+        fread(reader->stored, 1, info->stored_len, reader->file) != info->stored_len)
+        return -1;
+    reader->bytes_read += info->stored_len;
+
+    const uint8_t *raw = reader->stored;
+    if (info->codec == ARCHIVE_CODEC_ZLIB) {
+        if (grow(&reader->raw, &reader->raw_capacity, info->raw_len) != 0) return -1;
+        uLongf raw_len = info->raw_len;
+        if (uncompress(reader->raw, &raw_len, reader->stored, info->stored_len) != Z_OK || raw_len != info->raw_len)
+            return -1;
+        raw = reader->raw;
+    } else if (info->codec != ARCHIVE_CODEC_RAW) {
+        return -1;
+    }
+
+    return archive_decode_column(raw, info->raw_len, info, rows, values, scales);
+}
+
+void archive_reader_close(ArchiveReader *reader) {
+    if (reader->file) fclose(reader->file);
+    free(reader->names);
+    free(reader->stored);
+    free(reader->raw);
+    memset(reader, 0, sizeof(*reader));
+}
@@ -0,0 +1,184 @@
+/*
+ * Tick Archive Header
+ *
+ * Declares the columnar tick archive format shared by the writer in `crypto_ws`
+ * (`archive_writer.c`) and the `tick_query` reader. One file holds one
+ * (exchange, kind, UTC day), like the BSON output, but records are grouped in
+ * per-symbol blocks and stored column by column instead of as text documents.
+ *
+ * File layout (host byte order, like capture files):
+ *  - ArchiveFileHeader (magic "CWSTCA01").
+ *  - Repeated records, each starting with a uint32 magic:
+ *      ARCHIVE_DICT_MAGIC:  ArchiveDictEntry + `name_len` bytes; gives a symbol its file index.
+ *      ARCHIVE_BLOCK_MAGIC: ArchiveBlockHeader + `column_count` ArchiveColumnInfo + column data.
+ *
+ * Column encoding (before the optional zlib pass, chosen per column):
+ *  - Columns whose values are all absent are not stored at all.
+ *  - ARCHIVE_COLUMN_NULLS: a presence bitmap (one bit per row) comes first.
+ *  - Values are rescaled to the widest decimal scale in the block (`scale`), or, if that
+ *    would overflow, stored with one scale byte per value (ARCHIVE_COLUMN_SCALES).
+ *  - Present values are then written as zigzag LEB128 varints of the difference from the
+ *    previous present value, so timestamps and slowly moving prices take 1-3 bytes.
+ *
+ * Features:
+ *  - ARCHIVE_TICKER_FIELDS / ARCHIVE_TRADE_FIELDS: column lists shared by writer and reader.
+ *  - archive_encode_column() / archive_decode_column(): The column codec.
+ *  - ArchiveReader: Walks blocks, reads only the columns asked for and seeks past the rest.
+ *
+ * Dependencies:
+ *  - zlib (`-lz`).
+ *  - Standard C libraries (stdio.h, stddef.h, stdint.h).
+ *
+ * Usage:
+ *  - Written by `archive_writer.c` (`crypto_ws --archive DIR`); read by `tick_query.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef TICK_ARCHIVE_H
+#define TICK_ARCHIVE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARCHIVE_MAGIC "CWSTCA01"
+#define ARCHIVE_MAGIC_LENGTH 8
+#define ARCHIVE_VERSION 1
+
+#define ARCHIVE_DICT_MAGIC 0x54434944u     // "DICT"
+#define ARCHIVE_BLOCK_MAGIC 0x4B4C4254u    // "TBLK"
+
+/* Most rows in one block; the writer starts a new block for a symbol after this many */
+#define ARCHIVE_BLOCK_ROWS 1024
+
+/* Most columns a block can have (timestamp plus every ticker field) */
+#define ARCHIVE_MAX_COLUMNS 32
+
+/* Longest symbol name stored in the dictionary */
+#define ARCHIVE_MAX_NAME 63
+
+/* Column codecs */
+#define ARCHIVE_CODEC_RAW 0
+#define ARCHIVE_CODEC_ZLIB 1
+
+/* ArchiveColumnInfo.flags */
+#define ARCHIVE_COLUMN_NULLS 0x01
+#define ARCHIVE_COLUMN_SCALES 0x02
+
+typedef enum {
+    ARCHIVE_KIND_TICKER = 0,
+    ARCHIVE_KIND_TRADE = 1
+} ArchiveKind;
+
+/* Fixed-point members of TickerData / TradeData stored as columns 1..n, in this order.
+ * Column 0 is always the timestamp ("timestamp", epoch ns). */
+#define ARCHIVE_TICKER_FIELDS(X) \
+    X(price) X(bid) X(ask) X(bid_qty) X(ask_qty) \
+    X(open_price) X(high_price) X(low_price) X(close_price) \
+    X(volume_24h) X(volume_30d) X(quote_volume) \
+    X(last_trade_time) X(last_trade_price) X(last_trade_size) X(trade_id) X(sequence) \
+    X(bid_whole) X(ask_whole) X(last_vol) X(vol_today) X(vwap_today) \
+    X(low_today) X(vwap_24h) X(high_today) X(open_today)
+
+/* Trades also store "market_maker" (1 / 0, absent when unknown) after these */
+#define ARCHIVE_TRADE_FIELDS(X) X(price) X(size) X(trade_id)
+
+typedef struct {
+    char magic[ARCHIVE_MAGIC_LENGTH];
+    uint16_t exchange_id;       // ExchangeId
+    uint8_t kind;               // ArchiveKind
+    uint8_t version;            // ARCHIVE_VERSION
+    uint32_t reserved;
+    char exchange[16];          // display name, NUL-padded
+} ArchiveFileHeader;
+
+typedef struct {
+    uint32_t magic;             // ARCHIVE_DICT_MAGIC
+    uint16_t symbol;            // index used by later blocks of this file
+    uint8_t name_len;
+    uint8_t reserved;
+} ArchiveDictEntry;
+
+typedef struct {
+    uint32_t magic;             // ARCHIVE_BLOCK_MAGIC
+    uint16_t symbol;            // dictionary index
+    uint8_t kind;               // ArchiveKind
+    uint8_t column_count;       // stored columns (absent columns are left out)
+    uint32_t rows;
+    uint32_t data_len;          // column data bytes after the directory
+    int64_t ts_min;             // epoch ns, for skipping blocks outside a time range
+    int64_t ts_max;
+} ArchiveBlockHeader;
+
+typedef struct {
+    uint8_t column;             // column number (0 = timestamp)
+    uint8_t codec;              // ARCHIVE_CODEC_*
+    uint8_t flags;              // ARCHIVE_COLUMN_*
+    int8_t scale;               // decimal scale of every value, unless ARCHIVE_COLUMN_SCALES
+    uint32_t raw_len;           // encoded bytes before compression
+    uint32_t stored_len;        // bytes in the file
+} ArchiveColumnInfo;
+
+/* Growable byte buffer used while encoding */
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t capacity;
+} ArchiveBuffer;
+
+/* Sequential reader; the current block's header and directory are in `block` / `columns` */
+typedef struct {
+    FILE *file;
+    ArchiveFileHeader header;
+    char (*names)[ARCHIVE_MAX_NAME + 1];    // dictionary, indexed by block symbol
+    size_t name_count;
+    ArchiveBlockHeader block;
+    ArchiveColumnInfo columns[ARCHIVE_MAX_COLUMNS];
+    long long data_offset;                  // file offset of the current block's column data
+    uint8_t *stored;                        // scratch for compressed and decoded column bytes
+    size_t stored_capacity;
+    uint8_t *raw;
+    size_t raw_capacity;
+    uint64_t bytes_read;                    // column bytes actually read from the file
+} ArchiveReader;
+
+/* Number of columns (timestamp included) and column names for a kind. */
+int archive_column_count(ArchiveKind kind);
+const char *archive_column_name(ArchiveKind kind, int column);
+
+/* Column number for a name, or -1. */
+int archive_column_find(ArchiveKind kind, const char *name);
+
+/* Appends bytes to a buffer. Returns 0, or -1 on allocation failure. */
+int archive_buffer_append(ArchiveBuffer *buffer, const void *data, size_t len);
+void archive_buffer_free(ArchiveBuffer *buffer);
+
+/* Encodes one column of `rows` values (scale < 0 marks an absent value) and appends the stored
+ * bytes to `out`. Returns 0 with `info` filled in, 1 if every value is absent (nothing stored),
+ * or -1 on failure. `compress` enables the zlib pass where it makes the column smaller. */
+int archive_encode_column(ArchiveBuffer *out, const int64_t *values, const int8_t *scales,
+                          uint32_t rows, int compress, ArchiveColumnInfo *info);
+
+/* Decodes `raw` (already decompressed) into `rows` values and scales (-1 for absent). Returns 0 or -1. */
+int archive_decode_column(const uint8_t *raw, size_t len, const ArchiveColumnInfo *info,
+                          uint32_t rows, int64_t *values, int8_t *scales);
+
+/* Opens an archive and checks its header. Returns 0 or -1. */
+int archive_reader_open(ArchiveReader *reader, const char *path);
+
+/* Advances to the next block (dictionary entries are absorbed on the way).
+ * Returns 1 with the block loaded, 0 at the end of the file, or -1 on a corrupt file. */
+int archive_reader_next(ArchiveReader *reader);
+
+/* Symbol name of a dictionary index, "" if unknown. */
+const char *archive_reader_symbol(const ArchiveReader *reader, uint16_t symbol);
+
+/* Reads and decodes one column of the current block into `values` / `scales` (block.rows each).
+ * A column the block does not store decodes as all absent. Returns 0 or -1. */
+int archive_reader_column(ArchiveReader *reader, int column, int64_t *values, int8_t *scales);
+
+void archive_reader_close(ArchiveReader *reader);
+
+#endif // TICK_ARCHIVE_H
@@ -0,0 +1,284 @@
+/*
+ * Tick Query
+ *
+ * Command-line reader for the columnar tick archives written by
+ * `crypto_ws --archive DIR`. It scans one column (plus timestamps) for a
+ * symbol and time range, reading only the blocks and columns it needs.
+ *
+ * Features:
+ *  - `--info`: Blocks, rows, symbols and stored bytes per column for each file.
+ *  - Default: CSV `timestamp_ns,symbol,<column>` of every present value in range.
+ *  - `--stats`: No per-row output; count, first/last/min/max and scan throughput.
+ *  - Blocks outside the symbol or time range are skipped with a seek; only the
+ *    timestamp column and the requested column are read from the others.
+ *
+ * Dependencies:
+ *  - tick_archive.c (zlib).
+ *  - Standard C libraries (stdio, stdlib, string, time).
+ *
+ * Usage:
+ *  make tick_query
+ *  ./tick_query FILE... [--info] [--symbol NAME] [--column NAME] [--from TIME] [--to TIME] [--stats]
+ *  TIME is epoch nanoseconds or UTC "YYYY-MM-DDTHH:MM:SS".
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#define _GNU_SOURCE
+#include "tick_archive.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+typedef struct {
+    const char *symbol;
+    const char *column;
+    int64_t from_ns;
+    int64_t to_ns;
+    int info;
+    int stats;
+} QueryOptions;
+
+typedef struct {
+    uint64_t blocks_read;
+    uint64_t blocks_skipped;
+    uint64_t matched;
+    uint64_t bytes_read;
+    uint64_t file_bytes;
+    int64_t first_ts, last_ts;
+    double first, last, min, max;
+} QueryTotals;
+
+static int64_t column_values[ARCHIVE_BLOCK_ROWS];
+static int8_t column_scales[ARCHIVE_BLOCK_ROWS];
+static int64_t ts_values[ARCHIVE_BLOCK_ROWS];
+static int8_t ts_scales[ARCHIVE_BLOCK_ROWS];
+
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Epoch nanoseconds, or a UTC "YYYY-MM-DDTHH:MM:SS" time */
+static int parse_time(const char *text, int64_t *out) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char *end = strptime(text, "%Y-%m-%dT%H:%M:%S", &tm);
+    if (end && (*end == '\0' || strcmp(end, "Z") == 0)) {
+        *out = (int64_t)timegm(&tm) * 1000000000LL;
+        return 0;
+    }
+
+    char *rest;
+    long long value = strtoll(text, &rest, 10);
+    if (*text == '\0' || *rest != '\0') return -1;
+    *out = value;
+    return 0;
+}
+
+static double fixed_to_double(int64_t value, int scale) {
+    double result = (double)value;
+    for (int i = 0; i < scale; i++) result /= 10.0;
+    return result;
+}
+
+/* value / 10^scale as text, without going through a double (scales past 18 cannot come from the writer) */
+static void format_fixed(int64_t value, int scale, char *buf, size_t size) {
+    if (scale <= 0) {
+        snprintf(buf, size, "%lld", (long long)value);
+        return;
+    }
+    if (scale > 18) {
+        snprintf(buf, size, "%.17g", fixed_to_double(value, scale));
+        return;
+    }
+
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    unsigned long long divisor = 1;
+    for (int i = 0; i < scale; i++) divisor *= 10;
+    snprintf(buf, size, "%s%llu.%0*llu", value < 0 ? "-" : "", magnitude / divisor, scale, magnitude % divisor);
+}
+
+static int print_info(const char *path) {
+    ArchiveReader reader;
+    if (archive_reader_open(&reader, path) != 0) return -1;
+
+    ArchiveKind kind = (ArchiveKind)reader.header.kind;
+    int column_total = archive_column_count(kind);
+    uint64_t stored[ARCHIVE_MAX_COLUMNS] = {0}, raw[ARCHIVE_MAX_COLUMNS] = {0}, blocks_with[ARCHIVE_MAX_COLUMNS] = {0};
+    uint64_t blocks = 0, rows = 0;
+    int64_t ts_min = INT64_MAX, ts_max = INT64_MIN;
+
+    int result;
+    while ((result = archive_reader_next(&reader)) > 0) {
+        blocks++;
+        rows += reader.block.rows;
+        if (reader.block.ts_min < ts_min) ts_min = reader.block.ts_min;
+        if (reader.block.ts_max > ts_max) ts_max = reader.block.ts_max;
+        for (int i = 0; i < reader.block.column_count; i++) {
+            const ArchiveColumnInfo *info = &reader.columns[i];
+            if (info->column >= ARCHIVE_MAX_COLUMNS) continue;
+            stored[info->column] += info->stored_len;
+            raw[info->column] += info->raw_len;
+            blocks_with[info->column]++;
+        }
+    }
+
+    struct stat st;
+    long long file_size = stat(path, &st) == 0 ? (long long)st.st_size : 0;
+    printf("%s: %s %s, %zu symbols, %llu blocks, %llu rows, %lld bytes (%.1f bytes/row)\n",
+           path, reader.header.exchange, kind == ARCHIVE_KIND_TICKER ? "ticker" : "trade",
+           reader.name_count, (unsigned long long)blocks, (unsigned long long)rows, file_size,
+           rows ? (double)file_size / (double)rows : 0.0);
+    if (blocks) {
+        char from[32], to[32];
+        time_t from_s = (time_t)(ts_min / 1000000000LL), to_s = (time_t)(ts_max / 1000000000LL);
+        strftime(from, sizeof(from), "%Y-%m-%dT%H:%M:%SZ", gmtime(&from_s));
+        strftime(to, sizeof(to), "%Y-%m-%dT%H:%M:%SZ", gmtime(&to_s));
+        printf("  time range %s .. %s\n", from, to);
+    }
+    for (int c = 0; c < column_total; c++) {
+        if (!blocks_with[c]) continue;
+        printf("  %-18s %10llu bytes stored, %10llu encoded, in %llu/%llu blocks\n",
+               archive_column_name(kind, c), (unsigned long long)stored[c], (unsigned long long)raw[c],
+               (unsigned long long)blocks_with[c], (unsigned long long)blocks);
+    }
+
+    archive_reader_close(&reader);
+    return result < 0 ? -1 : 0;
+}
+
+static int scan_file(const char *path, const QueryOptions *options, QueryTotals *totals) {
+    ArchiveReader reader;
+    if (archive_reader_open(&reader, path) != 0) return -1;
+
+    struct stat st;
+    if (stat(path, &st) == 0) totals->file_bytes += (uint64_t)st.st_size;
+
+    ArchiveKind kind = (ArchiveKind)reader.header.kind;
+    int column = archive_column_find(kind, options->column);
+    if (column < 0) {
+        fprintf(stderr, "[ERROR] %s has no column \"%s\"\n", path, options->column);
+        archive_reader_close(&reader);
+        return -1;
+    }
+
+    int result;
+    while ((result = archive_reader_next(&reader)) > 0) {
+        const ArchiveBlockHeader *block = &reader.block;
+        if (block->ts_max < options->from_ns || block->ts_min > options->to_ns ||
+            (options->symbol && strcmp(archive_reader_symbol(&reader, block->symbol), options->symbol) != 0)) {
+            totals->blocks_skipped++;
+            continue;
+        }
+
+        if (archive_reader_column(&reader, 0, ts_values, ts_scales) != 0 ||
+            (column != 0 && archive_reader_column(&reader, column, column_values, column_scales) != 0)) {
+            result = -1;
+            break;
+        }
+        const int64_t *values = column ? column_values : ts_values;
+        const int8_t *scales = column ? column_scales : ts_scales;
+        const char *symbol = archive_reader_symbol(&reader, block->symbol);
+        totals->blocks_read++;
+
+        for (uint32_t i = 0; i < block->rows; i++) {
+            if (scales[i] < 0 || ts_values[i] < options->from_ns || ts_values[i] > options->to_ns) continue;
+
+            if (options->stats) {
+                double value = fixed_to_double(values[i], scales[i]);
+                if (totals->matched == 0 || ts_values[i] < totals->first_ts) {
+                    totals->first_ts = ts_values[i];
+                    totals->first = value;
+                }
+                if (totals->matched == 0 || ts_values[i] >= totals->last_ts) {
+                    totals->last_ts = ts_values[i];
+                    totals->last = value;
+                }
+                if (totals->matched == 0 || value < totals->min) totals->min = value;
+                if (totals->matched == 0 || value > totals->max) totals->max = value;
+            } else {
+                char text[48];
+                format_fixed(values[i], scales[i], text, sizeof(text));
+                printf("%lld,%s,%s\n", (long long)ts_values[i], symbol, text);
+            }
+            totals->matched++;
+        }
+    }
+
+    totals->bytes_read += reader.bytes_read;
+    archive_reader_close(&reader);
+    if (result < 0) fprintf(stderr, "[ERROR] %s is corrupt or truncated\n", path);
+    return result < 0 ? -1 : 0;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "[ERROR] Usage: %s FILE... [--info] [--symbol NAME] [--column NAME] "
+                    "[--from TIME] [--to TIME] [--stats]\n", program);
+}
+
+int main(int argc, char **argv) {
+    QueryOptions options = { NULL, "price", INT64_MIN, INT64_MAX, 0, 0 };
+    const char **files = calloc((size_t)argc, sizeof(char *));
+    int file_count = 0;
+    if (!files) return 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--info") == 0) {
+            options.info = 1;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            options.stats = 1;
+        } else if (strcmp(argv[i], "--symbol") == 0 && i + 1 < argc) {
+            options.symbol = argv[++i];
+        } else if (strcmp(argv[i], "--column") == 0 && i + 1 < argc) {
+            options.column = argv[++i];
+        } else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            if (parse_time(argv[++i], &options.from_ns) != 0) { usage(argv[0]); return 1; }
+        } else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            if (parse_time(argv[++i], &options.to_ns) != 0) { usage(argv[0]); return 1; }
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            files[file_count++] = argv[i];
+        }
+    }
+    if (file_count == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int status = 0;
+    if (options.info) {
+        for (int i = 0; i < file_count; i++) status |= print_info(files[i]) != 0;
+        free(files);
+        return status;
+    }
+
+    QueryTotals totals;
+    memset(&totals, 0, sizeof(totals));
+    int64_t start = monotonic_ns();
+    if (!options.stats) printf("timestamp_ns,symbol,%s\n", options.column);
+    for (int i = 0; i < file_count; i++) status |= scan_file(files[i], &options, &totals) != 0;
+    double seconds = (double)(monotonic_ns() - start) / 1e9;
+
+    if (options.stats) {
+        printf("%llu values", (unsigned long long)totals.matched);
+        if (totals.matched)
+            printf(", first %.10g, last %.10g, min %.10g, max %.10g", totals.first, totals.last, totals.min, totals.max);
+        printf("\n%llu blocks read, %llu skipped; %.1f MB of %.1f MB read in %.3f s "
+               "(%.0f MB/s of file, %.1f M values/s)\n",
+               (unsigned long long)totals.blocks_read, (unsigned long long)totals.blocks_skipped,
+               (double)totals.bytes_read / 1e6, (double)totals.file_bytes / 1e6, seconds,
+               seconds > 0 ? (double)totals.file_bytes / 1e6 / seconds : 0.0,
+               seconds > 0 ? (double)totals.matched / 1e6 / seconds : 0.0);
+    }
+
+    free(files);
+    return status;
+}
@@ -0,0 +1,242 @@
+/*
+ * Timestamp Codec
+ *
+ * This module parses and formats the timestamps of every record. Parsers read
+ * fixed digit positions and fold all validity checks into one flag, so a
+ * well-formed timestamp takes no data-dependent branches until the fraction.
+ * The formatter keeps the text of the last second it wrote per thread; records
+ * arrive in time order, so most of them only need their fraction digits.
+ *
+ * Features:
+ *  - ISO 8601 (Coinbase "time"), epoch milliseconds (Binance "E", Huobi/OKX "ts") and
+ *    fractional epoch seconds (Kraken trades).
+ *  - Calendar math from days since the epoch (civil_from_days / days_from_civil), not gmtime_r/timegm.
+ *  - Two-digit lookup table for every number written.
+ *
+ * Dependencies:
+ *  - Standard C libraries (string).
+ *
+ * Usage:
+ *  - See `timestamp_codec.h`; `make bench_timestamp` compares it against the libc calls it replaced.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "timestamp_codec.h"
+
+#include <string.h>
+
+/* Text of one epoch second, "YYYY-MM-DD?HH:MM:SS"; the date/time separator is set per format */
+typedef struct {
+    int64_t second;
+    int64_t day;
+    char text[19];
+    int valid;
+} SecondCache;
+
+static __thread SecondCache second_cache;
+
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const int64_t fraction_scale[10] = {
+    1000000000LL, 100000000LL, 10000000LL, 1000000LL, 100000LL, 10000LL, 1000LL, 100LL, 10LL, 1LL
+};
+
+/* Positions of the digits in "YYYY-MM-DDTHH:MM:SS" */
+static const uint8_t iso_digits[14] = { 0, 1, 2, 3, 5, 6, 8, 9, 11, 12, 14, 15, 17, 18 };
+
+static int64_t floor_div(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return q - ((a % b) < 0);
+}
+
+static void put2(char *out, unsigned value) {
+    memcpy(out, digit_pairs + 2 * value, 2);
+}
+
+/* ------------------------------- Calendar --------------------------------- */
+
+int64_t ts_days_from_civil(int64_t y, int m, int d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+void ts_civil_from_days(int64_t days, int *year, int *month, int *day) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned doe = (unsigned)(days - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+
+    *day = (int)(doy - (153 * mp + 2) / 5 + 1);
+    *month = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *year = (int)((int64_t)yoe + era * 400 + (*month <= 2));
+}
+
+/* -------------------------------- Parsing --------------------------------- */
+
+/* Unsigned decimal of exactly `len` (1-18) digits */
+static int parse_digits(const char *text, size_t len, uint64_t *out) {
+    if (len == 0 || len > 18) return 0;
+
+    uint64_t value = 0;
+    unsigned bad = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned digit = (unsigned)(unsigned char)text[i] - '0';
+        bad |= digit > 9;
+        value = value * 10 + digit;
+    }
+    if (bad) return 0;
+    *out = value;
+    return 1;
+}
+
+/* Up to 9 fraction digits from text[i] as nanoseconds; further digits are skipped. Returns the end. */
+static size_t parse_fraction(const char *text, size_t i, size_t len, int64_t *fraction_ns) {
+    int64_t fraction = 0;
+    int digits = 0;
+    for (; i < len && (unsigned)(unsigned char)text[i] - '0' <= 9; i++) {
+        if (digits < 9) {
+            fraction = fraction * 10 + (text[i] - '0');
+            digits++;
+        }
+    }
+    *fraction_ns = fraction * fraction_scale[digits];
+    return i;
+}
+
+int ts_parse_iso(const char *text, size_t len, int64_t *out_ns) {
+    if (len < 19) return 0;
+    const unsigned char *p = (const unsigned char *)text;
+
+    unsigned v[14];
+    unsigned bad = (p[4] != '-') | (p[7] != '-') | (p[10] != 'T' && p[10] != ' ') | (p[13] != ':') | (p[16] != ':');
+    for (int i = 0; i < 14; i++) {
+        v[i] = (unsigned)p[iso_digits[i]] - '0';
+        bad |= v[i] > 9;
+    }
+
+    int year = (int)(v[0] * 1000 + v[1] * 100 + v[2] * 10 + v[3]);
+    unsigned month = v[4] * 10 + v[5];
+    unsigned day = v[6] * 10 + v[7];
+    unsigned hour = v[8] * 10 + v[9];
+    unsigned minute = v[10] * 10 + v[11];
+    unsigned second = v[12] * 10 + v[13];
+    bad |= (month - 1 > 11) | (day - 1 > 30) | (hour > 23) | (minute > 59) | (second > 60);
+    if (bad) return 0;
+
+    int64_t fraction_ns = 0;
+    size_t i = 19;
+    if (i < len && p[i] == '.') i = parse_fraction(text, i + 1, len, &fraction_ns);
+
+    /* "+HH:MM" / "-HH:MM" offsets; 'Z' and anything else (" UTC") mean UTC */
+    int64_t offset = 0;
+    if (i + 6 <= len && (p[i] == '+' || p[i] == '-') && p[i + 3] == ':') {
+        uint64_t hours, minutes;
+        if (!parse_digits(text + i + 1, 2, &hours) || !parse_digits(text + i + 4, 2, &minutes)) return 0;
+        offset = (int64_t)(hours * 3600 + minutes * 60) * (p[i] == '-' ? -1 : 1);
+    }
+
+    int64_t seconds = ts_days_from_civil(year, (int)month, (int)day) * TS_SECONDS_PER_DAY +
+                      hour * 3600 + minute * 60 + second - offset;
+    *out_ns = seconds * TS_NS_PER_SECOND + fraction_ns;
+    return 1;
+}
+
+int ts_parse_epoch_ms(const char *text, size_t len, int64_t *out_ns) {
+    uint64_t ms;
+    if (!parse_digits(text, len, &ms) || ms > (uint64_t)INT64_MAX / TS_NS_PER_MS) return 0;
+    *out_ns = (int64_t)ms * TS_NS_PER_MS;
+    return 1;
+}
+
+int ts_parse_epoch_seconds(const char *text, size_t len, int64_t *out_ns) {
+    size_t dot = 0;
+    while (dot < len && text[dot] != '.') dot++;
+
+    uint64_t seconds;
+    if (!parse_digits(text, dot, &seconds) || seconds >= (uint64_t)INT64_MAX / TS_NS_PER_SECOND) return 0;
+
+    int64_t fraction_ns = 0;
+    if (dot < len && parse_fraction(text, dot + 1, len, &fraction_ns) != len) return 0;
+    *out_ns = (int64_t)seconds * TS_NS_PER_SECOND + fraction_ns;
+    return 1;
+}
+
+/* ------------------------------- Formatting ------------------------------- */
+
+/* Fills the cache with the text of `second`; the date is only recomputed when the day changes */
+static void cache_second(int64_t second) {
+    SecondCache *cache = &second_cache;
+    int64_t day = floor_div(second, TS_SECONDS_PER_DAY);
+
+    if (!cache->valid || day != cache->day) {
+        int year, month, mday;
+        ts_civil_from_days(day, &year, &month, &mday);
+        year = year < 0 ? 0 : year % 10000;     // four digits; out-of-range years wrap
+        put2(cache->text, (unsigned)(year / 100));
+        put2(cache->text + 2, (unsigned)(year % 100));
+        cache->text[4] = '-';
+        put2(cache->text + 5, (unsigned)month);
+        cache->text[7] = '-';
+        put2(cache->text + 8, (unsigned)mday);
+        cache->day = day;
+    }
+
+    unsigned of_day = (unsigned)(second - day * TS_SECONDS_PER_DAY);
+    put2(cache->text + 11, of_day / 3600);
+    cache->text[13] = ':';
+    put2(cache->text + 14, of_day / 60 % 60);
+    cache->text[16] = ':';
+    put2(cache->text + 17, of_day % 60);
+    cache->second = second;
+    cache->valid = 1;
+}
+
+size_t ts_format(int64_t ts_ns, TsFormat format, char *buf, size_t size) {
+    int64_t second = floor_div(ts_ns, TS_NS_PER_SECOND);
+    unsigned sub_ns = (unsigned)(ts_ns - second * TS_NS_PER_SECOND);
+    if (!second_cache.valid || second != second_cache.second) cache_second(second);
+
+    char text[TS_TEXT_SIZE];
+    memcpy(text, second_cache.text, sizeof(second_cache.text));
+    text[10] = format == TS_FORMAT_UTC ? ' ' : 'T';
+    text[19] = '.';
+
+    size_t len;
+    if (format == TS_FORMAT_ISO_MS) {
+        unsigned ms = sub_ns / 1000000;
+        text[20] = (char)('0' + ms / 100);
+        put2(text + 21, ms % 100);
+        text[23] = 'Z';
+        len = 24;
+    } else {
+        unsigned micros = sub_ns / 1000;
+        put2(text + 20, micros / 10000);
+        put2(text + 22, micros / 100 % 100);
+        put2(text + 24, micros % 100);
+        if (format == TS_FORMAT_UTC) {
+            memcpy(text + 26, " UTC", 4);
+            len = 30;
+        } else {
+            text[26] = 'Z';
+            len = 27;
+        }
+    }
+
+    if (size) {
+        size_t copy = len < size - 1 ? len : size - 1;
+        memcpy(buf, text, copy);
+        buf[copy] = '\0';
+    }
+    return len;
+}
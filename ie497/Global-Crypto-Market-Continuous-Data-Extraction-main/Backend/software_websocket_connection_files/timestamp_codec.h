@@ -0,0 +1,61 @@
+/*
+ * Timestamp Codec Header
+ *
+ * Declares the epoch-nanosecond timestamp parser and formatter used on the
+ * message path. Timestamps stay int64 nanoseconds since the Unix epoch
+ * everywhere; text is only read from exchange messages and produced for the
+ * JSON snapshot and BSON documents.
+ *
+ * Features:
+ *  - ts_parse_iso(): "YYYY-MM-DDTHH:MM:SS[.fraction][Z|+HH:MM]" (also with a space for the 'T').
+ *  - ts_parse_epoch_ms(): Epoch milliseconds ("1747064305123").
+ *  - ts_parse_epoch_seconds(): Epoch seconds with a fraction, as Kraken sends them ("1534614057.321597").
+ *  - ts_format(): UTC text from a per-thread cache of the current second's
+ *    "YYYY-MM-DD HH:MM:SS" prefix; only the fraction is written for later records of that second.
+ *  - No gmtime_r(), timegm(), sscanf() or snprintf() on any of these paths.
+ *
+ * Dependencies:
+ *  - Standard C libraries (stddef.h, stdint.h).
+ *
+ * Usage:
+ *  - Called through the FieldSpec parsers and format_timestamp_ns() in `market_record.c`,
+ *    and by the timestamp helpers in `utils.c`. Benchmarked by `bench_timestamp.c`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef TIMESTAMP_CODEC_H
+#define TIMESTAMP_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TS_NS_PER_SECOND 1000000000LL
+#define TS_NS_PER_MS 1000000LL
+#define TS_SECONDS_PER_DAY 86400
+
+/* Buffer size that holds every format, including the NUL */
+#define TS_TEXT_SIZE 32
+
+typedef enum {
+    TS_FORMAT_UTC,          // "YYYY-MM-DD HH:MM:SS.ffffff UTC" (JSON snapshot entries)
+    TS_FORMAT_ISO,          // "YYYY-MM-DDTHH:MM:SS.ffffffZ"    (BSON documents)
+    TS_FORMAT_ISO_MS        // "YYYY-MM-DDTHH:MM:SS.fffZ"
+} TsFormat;
+
+/* Each parser returns 1 and stores epoch ns on success, 0 (leaving `out_ns` alone) otherwise.
+ * `text` need not be NUL-terminated. */
+int ts_parse_iso(const char *text, size_t len, int64_t *out_ns);
+int ts_parse_epoch_ms(const char *text, size_t len, int64_t *out_ns);
+int ts_parse_epoch_seconds(const char *text, size_t len, int64_t *out_ns);
+
+/* Writes the text of `ts_ns` (years 0-9999) to `buf`, truncated to `size` - 1 characters like
+ * snprintf, and returns its full length. */
+size_t ts_format(int64_t ts_ns, TsFormat format, char *buf, size_t size);
+
+/* Days since 1970-01-01 of a proleptic Gregorian date, and back. */
+int64_t ts_days_from_civil(int64_t year, int month, int day);
+void ts_civil_from_days(int64_t days, int *year, int *month, int *day);
+
+#endif // TIMESTAMP_CODEC_H
@@ -0,0 +1,146 @@
+/*
+ * Trade De-duplication
+ *
+ * This module remembers the trade IDs written in the last few minutes of each
+ * exchange and suppresses trades whose ID comes back. Each exchange has a
+ * fixed table of 64-byte buckets; a slot packs a 44-bit fingerprint of
+ * (symbol, trade ID) with the 20 low bits of the exchange second it was
+ * stored in, so expiry needs no second pass over the table.
+ *
+ * Features:
+ *  - Each ID has two candidate buckets (as in a cuckoo filter, without relocation): lookup and
+ *    insert read two cache lines, and a duplicate is a fingerprint match in a slot younger
+ *    than TRADE_DEDUP_WINDOW_SECONDS.
+ *  - Empty and expired slots are reused first; otherwise the older of the two buckets' oldest slots is replaced.
+ *  - The exchange clock is its newest trade time, so replayed or late trades do not age the table.
+ *  - Counters are relaxed atomics, read by the stats line in `main.c`.
+ *
+ * Dependencies:
+ *  - Standard C libraries (stdio, stdlib, string, stdatomic).
+ *
+ * Usage:
+ *  - See `trade_dedup.h`.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#include "trade_dedup.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define DEDUP_BUCKETS (1u << TRADE_DEDUP_BUCKET_BITS)
+#define DEDUP_TIME_BITS 20
+#define DEDUP_TIME_MASK ((1u << DEDUP_TIME_BITS) - 1)
+
+typedef struct {
+    _Alignas(64) uint64_t slots[TRADE_DEDUP_BUCKET_SLOTS];  // fingerprint << DEDUP_TIME_BITS | second; 0 = empty
+} DedupBucket;
+
+typedef struct {
+    DedupBucket *buckets;       // NULL until the exchange's first trade with an ID
+    int64_t newest_second;      // newest trade time seen, epoch seconds
+    atomic_uint_fast64_t checked;
+    atomic_uint_fast64_t suppressed;
+    atomic_uint_fast64_t unkeyed;
+    atomic_uint_fast64_t evicted;
+} DedupTable;
+
+static DedupTable tables[EXCHANGE_COUNT];
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static void count(atomic_uint_fast64_t *counter) {
+    atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+int trade_dedup_accept(const TradeData *trade) {
+    if (trade->exchange_id >= EXCHANGE_COUNT) return 1;
+    DedupTable *table = &tables[trade->exchange_id];
+
+    if (!FIXED_PRESENT(trade->trade_id)) {
+        count(&table->unkeyed);
+        return 1;
+    }
+
+    if (!table->buckets) {
+        table->buckets = aligned_alloc(sizeof(DedupBucket), DEDUP_BUCKETS * sizeof(DedupBucket));
+        if (!table->buckets) {
+            printf("[ERROR] Memory allocation failed for the %s trade de-duplication table\n",
+                   exchange_name(trade->exchange_id));
+            return 1;
+        }
+        memset(table->buckets, 0, DEDUP_BUCKETS * sizeof(DedupBucket));
+    }
+
+    int64_t second = trade->ts_ns / 1000000000LL;
+    if (second > table->newest_second) table->newest_second = second;
+    uint32_t now = (uint32_t)table->newest_second & DEDUP_TIME_MASK;
+
+    /* First bucket from the high bits, fingerprint from the low bits (never 0), second bucket
+     * from a rehash; the ID may sit in either */
+    uint64_t hash = mix64((uint64_t)trade->trade_id.value ^
+                          mix64((uint64_t)trade->symbol_id << 8 | (uint8_t)trade->trade_id.scale));
+    uint64_t fingerprint = (hash & ((1ULL << (64 - DEDUP_TIME_BITS)) - 1)) | 1;
+    DedupBucket *candidates[2] = {
+        &table->buckets[hash >> (64 - TRADE_DEDUP_BUCKET_BITS)],
+        &table->buckets[mix64(hash) >> (64 - TRADE_DEDUP_BUCKET_BITS)],
+    };
+
+    count(&table->checked);
+    uint64_t *victim = NULL;
+    uint32_t victim_age = 0;
+    for (int b = 0; b < 2; b++) {
+        for (int i = 0; i < TRADE_DEDUP_BUCKET_SLOTS; i++) {
+            uint64_t *slot = &candidates[b]->slots[i];
+            uint32_t age = *slot ? (now - (uint32_t)(*slot & DEDUP_TIME_MASK)) & DEDUP_TIME_MASK : DEDUP_TIME_MASK;
+            if (age <= TRADE_DEDUP_WINDOW_SECONDS && *slot >> DEDUP_TIME_BITS == fingerprint) {
+                count(&table->suppressed);
+                return 0;
+            }
+            if (!victim || age > victim_age) {
+                victim = slot;
+                victim_age = age;
+            }
+        }
+    }
+
+    if (victim_age <= TRADE_DEDUP_WINDOW_SECONDS) count(&table->evicted);
+    *victim = fingerprint << DEDUP_TIME_BITS | now;
+    return 1;
+}
+
+void trade_dedup_reset(void) {
+    for (int e = 0; e < EXCHANGE_COUNT; e++) {
+        if (tables[e].buckets) memset(tables[e].buckets, 0, DEDUP_BUCKETS * sizeof(DedupBucket));
+        tables[e].newest_second = 0;
+    }
+}
+
+void trade_dedup_close(void) {
+    for (int e = 0; e < EXCHANGE_COUNT; e++) {
+        free(tables[e].buckets);
+        tables[e].buckets = NULL;
+    }
+}
+
+void trade_dedup_stats(uint16_t exchange_id, TradeDedupStats *out) {
+    memset(out, 0, sizeof(*out));
+    for (int e = 0; e < EXCHANGE_COUNT; e++) {
+        if (exchange_id != EXCHANGE_UNKNOWN && e != exchange_id) continue;
+        out->checked += atomic_load_explicit(&tables[e].checked, memory_order_relaxed);
+        out->suppressed += atomic_load_explicit(&tables[e].suppressed, memory_order_relaxed);
+        out->unkeyed += atomic_load_explicit(&tables[e].unkeyed, memory_order_relaxed);
+        out->evicted += atomic_load_explicit(&tables[e].evicted, memory_order_relaxed);
+    }
+}
@@ -0,0 +1,61 @@
+/*
+ * Trade De-duplication Header
+ *
+ * Declares the filter that drops trades already written. A re-subscribe after a
+ * reconnect, or a symbol on two overlapping connections, delivers the same
+ * trade IDs again; without the filter they were logged and written to BSON twice.
+ *
+ * Features:
+ *  - Keyed on (exchange, symbol, trade ID); one fixed-size table per exchange, allocated
+ *    on its first trade and never grown.
+ *  - Buckets of TRADE_DEDUP_BUCKET_SLOTS fingerprints in one cache line, two candidate
+ *    buckets per ID: two line reads and no allocation per trade.
+ *  - A trade ID is remembered for TRADE_DEDUP_WINDOW_SECONDS of its exchange's trade time;
+ *    when both buckets are full of live IDs the oldest gives way, which is counted.
+ *  - Trades without an ID (Kraken) always pass and are counted.
+ *
+ * Dependencies:
+ *  - market_record.h: TradeData.
+ *
+ * Usage:
+ *  - Checked on the ingest writer threads before log_trade_price() / write_trade_to_bson().
+ *    Every trade of an exchange goes to the same writer thread, so a table has one owner.
+ *
+ * Created: 10/18/2026
+ * Updated: 10/18/2026
+ */
+
+#ifndef TRADE_DEDUP_H
+#define TRADE_DEDUP_H
+
+#include <stdint.h>
+
+#include "market_record.h"
+
+/* How long a trade ID is remembered, in seconds of its exchange's newest trade time */
+#define TRADE_DEDUP_WINDOW_SECONDS 120
+
+/* 2^15 buckets of 8 = 262,144 trade IDs (2 MB) per exchange; about 2,000 trades/s over the window */
+#define TRADE_DEDUP_BUCKET_BITS 15
+#define TRADE_DEDUP_BUCKET_SLOTS 8
+
+typedef struct {
+    uint64_t checked;           // trades with an ID looked up
+    uint64_t suppressed;        // duplicates not written
+    uint64_t unkeyed;           // trades without an ID, written unchecked
+    uint64_t evicted;           // IDs dropped from a full bucket before their window ended
+} TradeDedupStats;
+
+/* Returns 1 if the trade should be written, 0 if its ID was already seen within the window. */
+int trade_dedup_accept(const TradeData *trade);
+
+/* Forgets every trade ID; counters are kept. Only while no writer thread is running. */
+void trade_dedup_reset(void);
+
+/* Frees the tables. */
+void trade_dedup_close(void);
+
+/* Counters of one exchange; EXCHANGE_UNKNOWN sums every exchange. */
+void trade_dedup_stats(uint16_t exchange_id, TradeDedupStats *out);
+
+#endif // TRADE_DEDUP_H
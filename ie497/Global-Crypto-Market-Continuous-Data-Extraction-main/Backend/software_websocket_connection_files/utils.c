@@ -2,88 +2,58 @@
  * Utility Functions
  * 
  * This module provides helper functions for time formatting, data logging,
- * file buffering, symbol normalization, and Gzip decompression.
+ * file buffering and symbol normalization. Gzip frames are handled by `inflate_stream.c`.
  * 
  * Features:
- *  - Converts timestamps to ISO 8601 format.
- *  - Logs ticker and trade data using Jansson.
- *  - Loads and trims in-memory JSON buffers from file.
- *  - Handles product name normalization across exchanges.
- *  - Decompresses Huobi Gzip payloads.
+ *  - Converts timestamps to ISO 8601 format through the timestamp codec.
+ *  - Logs ticker and trade records using Jansson, formatting fixed-point values at this edge.
+ *  - Keeps the last 10 minutes of JSON entries in rolling window stores.
+ *  - Hands every entry to the export segments (`segment_writer.c`) when they are enabled.
+ *  - Writes canonical "BASE-QUOTE" product names resolved by the symbol table.
  * 
  * Dependencies:
  *  - jansson     : JSON parsing and writing.
- *  - zlib        : Gzip decompression for WebSocket messages.
  *  - stdio.h     : File I/O operations.
  *  - stdlib.h    : Memory management and conversions.
  *  - string.h    : String operations.
- *  - time.h      : Time formatting and conversion.
- *  - sys/time.h  : Microsecond-resolution time functions.
+ *  - time.h      : Rolling window ages.
  *  - math.h      : Price comparison and numeric utilities.
- *  - errno.h     : Error handling for decompression.
- *  - ctype.h     : Character validation.
+ *  - timestamp_codec.h: Timestamp parsing and formatting.
  * 
  * Usage:
  *  - Called by `exchange_websocket.c` for logging and parsing.
  * 
  * Created: 3/7/2025
- * Updated: 5/12/2025
+ * Updated: 10/18/2026
  */
 
 #include "utils.h"
+#include "rolling_window.h"
+#include "timestamp_codec.h"
+#include "segment_writer.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#include <ctype.h>
 #include <jansson.h>
-#include <sys/time.h>
 #include <math.h>
-#include <errno.h>
-#include <zlib.h>
 
 /* Global file pointer for log file */
 FILE *ticker_data_file = NULL;
 FILE *trades_data_file = NULL;
 
-json_t *ticker_buffer = NULL;
-json_t *trades_buffer = NULL;
+RollingWindow *ticker_window = NULL;
+RollingWindow *trades_window = NULL;
 
 /* Parse timestamp like "2025-03-27 01:56:22.856523 UTC" to time_t */
 time_t parse_precise_timestamp(const char *timestamp) {
-    struct tm t = {0};
+    int64_t ts_ns;
+    if (!ts_parse_iso(timestamp, strlen(timestamp), &ts_ns)) return 0;
 
-    if (sscanf(timestamp, "%4d-%2d-%2d %2d:%2d:%2d",
-               &t.tm_year, &t.tm_mon, &t.tm_mday,
-               &t.tm_hour, &t.tm_min, &t.tm_sec) != 6)
-        return 0;
-
-    t.tm_year -= 1900;
-    t.tm_mon -= 1;
-
-    return timegm(&t);
+    int64_t seconds = ts_ns / TS_NS_PER_SECOND;
+    return (time_t)(seconds - (ts_ns % TS_NS_PER_SECOND < 0));
 }
 
-/* Mapping for product replacements */
-static ProductMapping product_mappings_arr[] = {
-    {"tBTCUSD", "BTC-USD"},
-    {"BTCUSDT", "BTC-USD"},
-    {"market.btcusdt", "BTC-USD"},
-    {"BTC-USDT", "BTC-USD"},
-    {"BTC/USD", "BTC-USD"},
-
-    {"ADAUSDT", "ADA-USD"},
-    {"ICXUSDT", "ICX-USD"},
-    {"ADA/USD", "ADA-USD"},
-
-    {"ETHUSDT", "ETH-USD"},
-    {"ETH/USD", "ETH-USD"},
-
-    {"XBT/USD", "XBT-USD"},
-
-    {NULL, NULL}
-};
-
 int count_symbols_in_file(const char *filename) {
     FILE *fp = fopen(filename, "r");
     if (!fp) {
@@ -124,62 +94,30 @@ int count_symbols_in_file(const char *filename) {
 
 /* Convert any millisecond timestamp to ISO 8601 format */
 void convert_binance_timestamp(char *timestamp_buffer, size_t buf_size, const char *ms_timestamp) {
-    long long milliseconds = atoll(ms_timestamp);
-    time_t seconds = milliseconds / 1000;
-    struct tm t;
-    gmtime_r(&seconds, &t);
-    snprintf(timestamp_buffer, buf_size, "%04d-%02d-%02dT%02d:%02d:%02d.%03lldZ",
-             t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
-             t.tm_hour, t.tm_min, t.tm_sec, milliseconds % 1000);
+    int64_t ts_ns = 0;
+    ts_parse_epoch_ms(ms_timestamp, strlen(ms_timestamp), &ts_ns);
+    ts_format(ts_ns, TS_FORMAT_ISO_MS, timestamp_buffer, buf_size);
 }
 
 /* Get the current timestamp in ISO 8601 format with milliseconds */
 void get_timestamp(char *buffer, size_t buf_size) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    struct tm t;
-    gmtime_r(&tv.tv_sec, &t);
-    snprintf(buffer, buf_size, "%04d-%02d-%02dT%02d:%02d:%02d.%03ldZ",
-             t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
-             t.tm_hour, t.tm_min, t.tm_sec, tv.tv_usec / 1000);
+    ts_format(market_clock_ns(), TS_FORMAT_ISO_MS, buffer, buf_size);
 }
 
 /* Normalize and format any timestamp into "YYYY-MM-DD HH:MM:SS.ssssss UTC" */
 int normalize_timestamp(const char *input, char *output, size_t output_size) {
     if (!input || !output) return 0;
 
-    int is_digit = 1;
-    for (const char *p = input; *p; p++) {
-        if (!isdigit(*p)) {
-            is_digit = 0;
-            break;
-        }
-    }
-
-    if (is_digit) {
-        long long millis = atoll(input);
-        time_t seconds = millis / 1000;
-        int micros = (millis % 1000) * 1000;
-        struct tm t;
-        gmtime_r(&seconds, &t);
-        snprintf(output, output_size,
-                 "%04d-%02d-%02d %02d:%02d:%02d.%06d UTC",
-                 t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
-                 t.tm_hour, t.tm_min, t.tm_sec, micros);
-        return 1;
-    }
-
-    char date[11], time[16];
-    if (sscanf(input, "%10[^T]T%15[^Z]", date, time) == 2) {
-        snprintf(output, output_size, "%s %s UTC", date, time);
-        return 1;
-    }
+    size_t len = strlen(input);
+    int64_t ts_ns;
+    if (!ts_parse_epoch_ms(input, len, &ts_ns) && !ts_parse_iso(input, len, &ts_ns)) return 0;
 
-    return 0;
+    ts_format(ts_ns, TS_FORMAT_UTC, output, output_size);
+    return 1;
 }
 
-/* Helper to set the buffer on startup */
-void load_buffer_from_file(json_t *buffer, const char *filename) {
+/* Helper to seed a rolling window from the previous session's snapshot on startup */
+void load_window_from_file(RollingWindow *window, const char *filename) {
     FILE *f = fopen(filename, "r");
     if (!f) return;
 
@@ -197,158 +135,129 @@ void load_buffer_from_file(json_t *buffer, const char *filename) {
 
         time_t entry_time = parse_precise_timestamp(ts);
         time_t now; time(&now);
-        if (difftime(now, entry_time) <= 600) {
-            json_array_append_new(buffer, entry);
-        } else {
-            json_decref(entry);
+        if (difftime(now, entry_time) <= ROLLING_WINDOW_SECONDS) {
+            append_entry_to_window(window, entry_time, entry);
         }
+        json_decref(entry);
     }
 
     fclose(f);
 }
 
-/* Helper to clean buffer and write to disk */
-void flush_buffer_to_file(const char *filename, json_t *buffer) {
-    FILE *f = fopen(filename, "w");
-    if (!f) return;
+/* Serialize one entry exactly as the snapshot file stores it and append it to the window */
+void append_entry_to_window(RollingWindow *window, time_t entry_time, json_t *entry) {
+    char *line = json_dumps(entry, 0);
+    if (!line) return;
 
-    size_t len = json_array_size(buffer);
-    for (size_t i = 0; i < len; i++) {
-        json_t *entry = json_array_get(buffer, i);
-        char *line = json_dumps(entry, 0);
-        fprintf(f, "%s\n", line);
-        free(line);
-    }
+    rolling_window_append(window, entry_time, line, strlen(line));
+    free(line);
+}
 
-    fclose(f);
+/* Serialize a live entry once for the rolling window (if still inside it) and the export segments */
+static void log_entry(RollingWindow *window, SegmentKind kind, int64_t ts_ns, json_t *entry) {
+    char *line = json_dumps(entry, 0);
+    if (!line) return;
+
+    size_t len = strlen(line);
+    if (window) rolling_window_append(window, (time_t)(ts_ns / 1000000000LL), line, len);
+    segment_writer_append(kind, ts_ns, line, len);
+    free(line);
 }
 
-/* Keep only last 10 minutes of entries */
-void trim_buffer(json_t *buffer) {
+/* Write the ticker/trade snapshots if due (or unconditionally when forced) */
+void flush_json_snapshots(int force) {
     time_t now;
     time(&now);
-    size_t i = 0;
+    rolling_window_maybe_snapshot(ticker_window, now, force);
+    rolling_window_maybe_snapshot(trades_window, now, force);
+}
 
-    while (i < json_array_size(buffer)) {
-        json_t *item = json_array_get(buffer, i);
-        const char *ts = json_string_value(json_object_get(item, "timestamp"));
-        if (!ts) {
-            json_array_remove(buffer, i);
-            continue;
-        }
+void init_json_buffers() {
+    ticker_window = rolling_window_create("ticker_output_data.json", ROLLING_WINDOW_SECONDS);
+    trades_window = rolling_window_create("trades_output_data.json", ROLLING_WINDOW_SECONDS);
 
-        time_t entry_time = parse_precise_timestamp(ts);
-        if (difftime(now, entry_time) > 600) {
-            json_array_remove(buffer, i);
-        } else {
-            i++;
-        }
-    }
+    load_window_from_file(ticker_window, "ticker_output_data.json");
+    load_window_from_file(trades_window, "trades_output_data.json");
 }
 
-void init_json_buffers() {
-    ticker_buffer = json_array();
-    trades_buffer = json_array();
+/* Release the rolling windows after the final snapshot has been written */
+void free_json_buffers() {
+    rolling_window_destroy(ticker_window);
+    rolling_window_destroy(trades_window);
+    ticker_window = NULL;
+    trades_window = NULL;
+}
 
-    load_buffer_from_file(ticker_buffer, "ticker_output_data.json");
-    load_buffer_from_file(trades_buffer, "trades_output_data.json");
+/* Fixed-point values are written to the JSON snapshot as decimal strings */
+static void set_fixed(json_t *entry, const char *key, Fixed value) {
+    char text[FIXED_TEXT_SIZE];
+    fixed_format(value, text, sizeof(text));
+    json_object_set_new(entry, key, json_string(text));
 }
 
-/* Log price with provided timestamp, exchange, and currency in JSON format */
-void log_ticker_price(TickerData *ticker_data) {
+/* Log a ticker record to the rolling JSON window and export segments, formatting its values as text */
+void log_ticker_price(const TickerData *ticker_data) {
     if (!ticker_data_file)
         return;
 
-    // printf("[DEBUG] log_ticker_price() called for %s - %s | %s | %s\n", ticker_data->exchange, ticker_data->currency, ticker_data->price, ticker_data->timestamp);
-
-    char mapped_currency[32];
-    strncpy(mapped_currency, ticker_data->currency, sizeof(mapped_currency) - 1);
-    mapped_currency[sizeof(mapped_currency) - 1] = '\0';
+    time_t entry_time = (time_t)(ticker_data->ts_ns / 1000000000LL);
+    int in_window = difftime(time(NULL), entry_time) <= ROLLING_WINDOW_SECONDS;
+    if (!in_window && !segment_writer_enabled()) return;
 
-    for (ProductMapping *m = product_mappings_arr; m->key; m++) {
-        if (strcmp(ticker_data->currency, m->key) == 0) {
-            strncpy(mapped_currency, m->value, sizeof(mapped_currency) - 1);
-            break;
-        }
-    }
-
-    char formatted_timestamp[64];
-    if (!normalize_timestamp(ticker_data->timestamp, formatted_timestamp, sizeof(formatted_timestamp))) {
-        strncpy(formatted_timestamp, ticker_data->timestamp, sizeof(formatted_timestamp));
-    }
-
-    time_t now;
-    time(&now);
-    time_t entry_time = parse_precise_timestamp(formatted_timestamp);
-    if (difftime(now, entry_time) > 600) return;
+    char formatted_timestamp[40];
+    format_timestamp_ns(ticker_data->ts_ns, 0, formatted_timestamp, sizeof(formatted_timestamp));
 
     json_t *entry = json_object();
-    // json_object_set_new(entry, "timestamp", "string");
 
     json_object_set_new(entry, "timestamp", json_string(formatted_timestamp));
-    json_object_set_new(entry, "exchange", json_string(ticker_data->exchange));
-    json_object_set_new(entry, "currency", json_string(mapped_currency));
-    json_object_set_new(entry, "price", json_string(ticker_data->price));
-    json_object_set_new(entry, "bid", json_string(ticker_data->bid));
-    json_object_set_new(entry, "bid_qty", json_string(ticker_data->bid_qty));
-    json_object_set_new(entry, "ask", json_string(ticker_data->ask));
-    json_object_set_new(entry, "ask_qty", json_string(ticker_data->ask_qty));
-    json_object_set_new(entry, "open_price", json_string(ticker_data->open_price));
-    json_object_set_new(entry, "high_price", json_string(ticker_data->high_price));
-    json_object_set_new(entry, "low_price", json_string(ticker_data->low_price));
-    json_object_set_new(entry, "volume_24h", json_string(ticker_data->volume_24h));
-    json_object_set_new(entry, "volume_30d", json_string(ticker_data->volume_30d));
-    json_object_set_new(entry, "quote_volume", json_string(ticker_data->quote_volume));
-    json_object_set_new(entry, "symbol", json_string(ticker_data->symbol));
-    json_object_set_new(entry, "last_trade_time", json_string(ticker_data->last_trade_time));
-    json_object_set_new(entry, "last_trade_price", json_string(ticker_data->last_trade_price));
-    json_object_set_new(entry, "last_trade_size", json_string(ticker_data->last_trade_size));
-    json_object_set_new(entry, "close_price", json_string(ticker_data->close_price));
-    json_object_set_new(entry, "trade_id", json_string(ticker_data->trade_id));
-
-    json_array_append_new(ticker_buffer, entry);
-    trim_buffer(ticker_buffer);
-    flush_buffer_to_file("ticker_output_data.json", ticker_buffer);
+    json_object_set_new(entry, "exchange", json_string(exchange_name(ticker_data->exchange_id)));
+    json_object_set_new(entry, "currency", json_string(symbol_canonical(ticker_data->symbol_id)));
+    set_fixed(entry, "price", ticker_data->price);
+    set_fixed(entry, "bid", ticker_data->bid);
+    set_fixed(entry, "bid_qty", ticker_data->bid_qty);
+    set_fixed(entry, "ask", ticker_data->ask);
+    set_fixed(entry, "ask_qty", ticker_data->ask_qty);
+    set_fixed(entry, "open_price", ticker_data->open_price);
+    set_fixed(entry, "high_price", ticker_data->high_price);
+    set_fixed(entry, "low_price", ticker_data->low_price);
+    set_fixed(entry, "volume_24h", ticker_data->volume_24h);
+    set_fixed(entry, "volume_30d", ticker_data->volume_30d);
+    set_fixed(entry, "quote_volume", ticker_data->quote_volume);
+    json_object_set_new(entry, "symbol", json_string(symbol_name(ticker_data->symbol_id)));
+    set_fixed(entry, "last_trade_time", ticker_data->last_trade_time);
+    set_fixed(entry, "last_trade_price", ticker_data->last_trade_price);
+    set_fixed(entry, "last_trade_size", ticker_data->last_trade_size);
+    set_fixed(entry, "close_price", ticker_data->close_price);
+    set_fixed(entry, "trade_id", ticker_data->trade_id);
+
+    log_entry(in_window ? ticker_window : NULL, SEGMENT_TICKER, ticker_data->ts_ns, entry);
+    json_decref(entry);
 }
 
-/* Log trade price data with provided timestamp, exchange, currency, price, and size in JSON format */
-void log_trade_price(const char *timestamp, const char *exchange, const char *currency, const char *price, const char *size, const char *trade_id, const char *market_maker) {
+/* Log a trade record to the rolling JSON window and export segments, formatting its values as text */
+void log_trade_price(const TradeData *trade) {
     if (!trades_data_file)
         return;
-    // printf("[DEBUG] log_trade_price() called for %s - %s | %s | %s | %s\n", exchange, currency, price, size, timestamp);
-    char mapped_currency[32];
-    strncpy(mapped_currency, currency, sizeof(mapped_currency) - 1);
-    mapped_currency[sizeof(mapped_currency) - 1] = '\0';
-
-    for (ProductMapping *m = product_mappings_arr; m->key; m++) {
-        if (strcmp(currency, m->key) == 0) {
-            strncpy(mapped_currency, m->value, sizeof(mapped_currency) - 1);
-            break;
-        }
-    }
 
-    char formatted_timestamp[64];
-    if (!normalize_timestamp(timestamp, formatted_timestamp, sizeof(formatted_timestamp))) {
-        strncpy(formatted_timestamp, timestamp, sizeof(formatted_timestamp));
-    }
+    time_t entry_time = (time_t)(trade->ts_ns / 1000000000LL);
+    int in_window = difftime(time(NULL), entry_time) <= ROLLING_WINDOW_SECONDS;
+    if (!in_window && !segment_writer_enabled()) return;
 
-    time_t now;
-    time(&now);
-    time_t entry_time = parse_precise_timestamp(formatted_timestamp);
-    if (difftime(now, entry_time) > 600) return;
+    char formatted_timestamp[40];
+    format_timestamp_ns(trade->ts_ns, 0, formatted_timestamp, sizeof(formatted_timestamp));
 
     json_t *entry = json_object();
     json_object_set_new(entry, "timestamp", json_string(formatted_timestamp));
-    json_object_set_new(entry, "exchange", json_string(exchange));
-    json_object_set_new(entry, "currency", json_string(mapped_currency));
-    json_object_set_new(entry, "price", json_string(price));
-    json_object_set_new(entry, "size", json_string(size));
-    json_object_set_new(entry, "trade_id", json_string(trade_id));
-    json_object_set_new(entry, "market_maker", json_string(market_maker));
-
-    json_array_append_new(trades_buffer, entry);
-    trim_buffer(trades_buffer);
-    flush_buffer_to_file("trades_output_data.json", trades_buffer);
+    json_object_set_new(entry, "exchange", json_string(exchange_name(trade->exchange_id)));
+    json_object_set_new(entry, "currency", json_string(symbol_canonical(trade->symbol_id)));
+    set_fixed(entry, "price", trade->price);
+    set_fixed(entry, "size", trade->size);
+    set_fixed(entry, "trade_id", trade->trade_id);
+    json_object_set_new(entry, "market_maker",
+                        json_string(trade->market_maker < 0 ? "" : (trade->market_maker ? "true" : "false")));
+
+    log_entry(in_window ? trades_window : NULL, SEGMENT_TRADES, trade->ts_ns, entry);
+    json_decref(entry);
 }
 
 
@@ -430,21 +339,3 @@ void log_trade_price(const char *timestamp, const char *exchange, const char *cu
 //     fflush(trades_data_file);
 // }
 // -------------- //
-
-/* Decompresses a Gzip-compressed input buffer into an output buffer using zlib. */
-int decompress_gzip(const char *input, size_t input_len, char *output, size_t output_size) {
-    z_stream strm = {0};
-    strm.next_in = (Bytef *)input;
-    strm.avail_in = input_len;
-    strm.next_out = (Bytef *)output;
-    strm.avail_out = output_size;
-
-    if (inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK) {
-        return -1;
-    }
-
-    int result = inflate(&strm, Z_FINISH);
-    inflateEnd(&strm);
-
-    return (result == Z_STREAM_END) ? (int)strm.total_out : -1;
-}
\ No newline at end of file
@@ -2,19 +2,18 @@
  * Utility Functions Header
  * 
  * Declares utility functions and structures for timestamp handling, JSON logging,
- * buffer management, Gzip decompression, and product symbol normalization.
+ * and buffer management. Product names come from `symbol_table.h`; gzip frames are
+ * inflated by `inflate_stream.h`.
  * 
  * Features:
  *  - convert_binance_timestamp(): Converts millisecond timestamps to ISO 8601.
  *  - get_timestamp(): Returns the current UTC timestamp with milliseconds.
  *  - log_ticker_price(): Logs ticker-level JSON entries.
  *  - log_trade_price(): Logs trade-level JSON entries.
- *  - decompress_gzip(): Inflates compressed WebSocket payloads.
- *  - flush_buffer_to_file(): Writes buffered JSON to disk.
+ *  - flush_json_snapshots(): Writes the rolling JSON windows to disk on a timer.
  *  - init_json_buffers(): Loads recent entries from previous session.
  * 
  * Structures:
- *  - ProductMapping: Symbol translation map for exchange data.
  *  - PriceCounter: Tracks unknown price patterns (future use).
  * 
  * Dependencies:
@@ -25,7 +24,7 @@
  *  - Used by exchange_websocket.c, main.c, and reconnect logic.
  * 
  * Created: 3/7/2025
- * Updated: 5/4/2025
+ * Updated: 10/18/2026
  */
 
  #ifndef UTILS_H
@@ -36,6 +35,7 @@
  #include <jansson.h>
 
  #include "exchange_websocket.h"
+ #include "rolling_window.h"
  
  /* ---------------------------- File Logging ---------------------------- */
  
@@ -55,43 +55,38 @@
  
  /* ---------------------------- Logging Helpers ------------------------- */
  
- /* Logs ticker data in JSON format using timestamp, exchange, currency, and price. */
- void log_ticker_price(TickerData *ticker_data);
+ /* Logs a ticker record in JSON format; numeric fields are formatted from fixed-point here. */
+ void log_ticker_price(const TickerData *ticker_data);
  
- /* Logs trade data in JSON format using timestamp, exchange, currency, price, and size. */
- void log_trade_price(const char *timestamp, const char *exchange, const char *currency, const char *price, const char *size, const char *trade_id, const char *market_maker);
+ /* Logs a trade record in JSON format; numeric fields are formatted from fixed-point here. */
+ void log_trade_price(const TradeData *trade);
  
- /* Flushes a JSON buffer to a file, used for efficient batch writing. */
- void flush_buffer_to_file(const char *filename, json_t *buffer);
+ /* Serializes a JSON entry and appends it to a rolling window. */
+ void append_entry_to_window(RollingWindow *window, time_t entry_time, json_t *entry);
+ 
+ /* Writes the ticker/trade snapshot files if due; `force` writes them immediately. */
+ void flush_json_snapshots(int force);
  
  /* Initializes global JSON buffers used for ticker and trade data. */
  void init_json_buffers();
  
+ /* Releases the global JSON buffers. */
+ void free_json_buffers();
+ 
  /* ---------------------------- JSON Buffers ---------------------------- */
  
- /* Global JSON buffers used for batch log flushing */
- extern json_t *ticker_buffer;
- extern json_t *trades_buffer;
+ /* Rolling windows holding the last 10 minutes of serialized ticker/trade entries */
+ extern RollingWindow *ticker_window;
+ extern RollingWindow *trades_window;
  
  /* ------------------------- Data Structures ---------------------------- */
  
- /* Represents a mapping between an exchange-specific key and its standardized equivalent. */
- typedef struct {
-     char *key;
-     char *value;
- } ProductMapping;
- 
  /* Tracks price state for a specific product, used in identifying unknown products or filtering noise. */
  typedef struct {
      char *product;
      double value;
      int initialized;
  } PriceCounter;
- 
- /* ------------------------- Compression Utils -------------------------- */
- 
- /* Decompresses a Gzip-compressed buffer into a readable string using zlib. */
- int decompress_gzip(const char *input, size_t input_len, char *output, size_t output_size);
- 
+  
  #endif // UTILS_H
  
\ No newline at end of file